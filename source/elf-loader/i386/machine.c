@@ -19,6 +19,13 @@ bool machine_reloc_is_copy (unsigned long reloc_type)
 {
   return reloc_type == R_386_COPY;
 }
+bool machine_reloc_is_base_relative (unsigned long reloc_type)
+{
+  return reloc_type == R_386_RELATIVE ||
+    reloc_type == R_386_GLOB_DAT ||
+    reloc_type == R_386_JMP_SLOT ||
+    reloc_type == R_386_32;
+}
 void machine_reloc (const struct VdlFile *file,
 		    unsigned long *reloc_addr,
 		    unsigned long reloc_type,
@@ -15,6 +15,10 @@ bool machine_reloc_is_relative (unsigned long reloc_type);
 // returns whether the type of reloc is a R_XXX_COPY relocation entry
 // the input to this function is the output of the ELFXX_TYPE macro.
 bool machine_reloc_is_copy (unsigned long reloc_type);
+// returns whether machine_reloc stores the load base of the file
+// which holds the symbol plus a value which does not depend on where
+// any file is loaded, as R_XXX_RELATIVE and R_XXX_GLOB_DAT do.
+bool machine_reloc_is_base_relative (unsigned long reloc_type);
 void machine_reloc (const struct VdlFile *file,
 		    unsigned long *reloc_addr,
 		    unsigned long reloc_type,
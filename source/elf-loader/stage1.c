@@ -8,6 +8,7 @@
 #include "vdl-list.h"
 #include "vdl-utils.h"
 #include "machine.h"
+#include "vdl-reloc-cache.h"
 #include <elf.h>
 #include <link.h>
 
@@ -92,6 +93,8 @@ static void global_initialize (unsigned long interpreter_load_base)
   vdl->errors = vdl_list_new ();
   vdl->n_added = 0;
   vdl->n_removed = 0;
+  vdl->reloc_snapshots = vdl_list_new ();
+  vdl->reloc_cache_dir = 0;
 }
 
 
@@ -199,6 +202,7 @@ void stage1_freeres (void)
       return;
     }
   stage2_freeres ();
+  vdl_reloc_cache_delete ();
   vdl_utils_str_list_delete (g_vdl.search_dirs);
   vdl_list_delete (g_vdl.contexts);
   futex_delete (g_vdl.futex);
@@ -22,6 +22,7 @@
 #include "vdl-unmap.h"
 #include "vdl-init.h"
 #include "vdl-fini.h"
+#include "vdl-lookup.h"
 
 
 static unsigned long 
@@ -155,6 +156,13 @@ setup_env_vars (const char **envp)
     {
       g_vdl.bind_now = 1;
     }
+
+  // keep the relocations done in the directory given by LD_RELOC_CACHE
+  const char *reloc_cache = vdl_utils_getenv (envp, "LD_RELOC_CACHE");
+  if (reloc_cache != 0 && *reloc_cache != 0)
+    {
+      g_vdl.reloc_cache_dir = vdl_utils_strdup (reloc_cache);
+    }
 }
 
 struct Stage2Output
@@ -241,6 +249,7 @@ stage2_initialize (struct Stage2Input input)
 			 vdl_list_end (all_deps));
   vdl_list_delete (all_deps);
   vdl_list_unicize (context->global_scope);
+  vdl_lookup_flush (context);
 
   vdl_list_delete (ld_preload);
 
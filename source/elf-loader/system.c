@@ -50,6 +50,28 @@ int system_open_ro (const char *file)
     }
   return status;
 }
+int system_open (const char *file, int flags, int mode)
+{
+  int status = MACHINE_SYSCALL3 (open,file,flags,mode);
+  if (status < 0 && status > -256)
+    {
+      return -1;
+    }
+  return status;
+}
+int system_rename (const char *oldpath, const char *newpath)
+{
+  int status = MACHINE_SYSCALL2 (rename,oldpath,newpath);
+  if (status < 0 && status > -256)
+    {
+      return -1;
+    }
+  return status;
+}
+int system_getpid (void)
+{
+  return MACHINE_SYSCALL1 (getpid,0);
+}
 int system_read (int fd, void *buffer, size_t to_read)
 {
   int status = MACHINE_SYSCALL3 (read, fd, buffer, to_read);
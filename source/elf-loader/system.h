@@ -13,6 +13,9 @@ int system_munmap (uint8_t *start, size_t size);
 int system_mprotect (const void *addr, size_t len, int prot);
 void system_write (int fd, const void *buf, size_t size);
 int system_open_ro (const char *file);
+int system_open (const char *file, int flags, int mode);
+int system_rename (const char *oldpath, const char *newpath);
+int system_getpid (void);
 int system_read (int fd, void *buffer, size_t to_read);
 int system_lseek (int fd, off_t offset, int whence);
 int system_fstat (const char *file, struct stat *buf);
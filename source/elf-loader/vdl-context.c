@@ -4,6 +4,7 @@
 #include "vdl-alloc.h"
 #include "vdl-log.h"
 #include "vdl-unmap.h"
+#include "vdl-lookup.h"
 
 bool
 vdl_context_empty (const struct VdlContext *context)
@@ -36,6 +37,7 @@ void vdl_context_add_symbol_remap (struct VdlContext *context,
   entry->dst_ver_name = vdl_utils_strdup (dst_ver_name);
   entry->dst_ver_filename = vdl_utils_strdup (dst_ver_filename);
   vdl_list_push_back (context->symbol_remaps, entry);
+  vdl_lookup_flush (context);
 }
 void vdl_context_add_callback (struct VdlContext *context,
 			       void (*cb) (void *handle, enum VdlEvent event, void *context),
@@ -148,6 +150,7 @@ struct VdlContext *vdl_context_new (int argc, char **argv, char **envp)
   context->lib_remaps = vdl_list_new ();
   context->symbol_remaps = vdl_list_new ();
   context->event_callbacks = vdl_list_new ();
+  context->lookup_cache = 0;
   // keep a reference to argc, argv and envp.
   context->argc = argc;
   context->argv = argv;
@@ -170,6 +173,7 @@ void
 vdl_context_delete (struct VdlContext *context)
 {
   VDL_LOG_FUNCTION ("context=%p", context);
+  vdl_lookup_flush (context);
   // get rid of associated global scope
   vdl_list_delete (context->global_scope);
   context->global_scope = 0;
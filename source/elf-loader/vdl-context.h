@@ -6,6 +6,7 @@
 
 struct VdlList;
 struct VdlFile;
+struct VdlLookupCache;
 
 struct VdlContextSymbolRemapEntry
 {
@@ -49,6 +50,9 @@ struct VdlContext
   struct VdlList *lib_remaps;
   // report events within this context
   struct VdlList *event_callbacks;
+  // the symbols already found in the global scope by vdl_lookup.
+  // allocated on first use.
+  struct VdlLookupCache *lookup_cache;
   // These variables are used by all .init functions
   // _some_ libc .init functions make use of these
   // 3 arguments so, even though no one else uses them, 
@@ -224,6 +224,7 @@ static void *dlopen_with_context (struct VdlContext *context, const char *filena
 			     vdl_list_begin (scope),
 			     vdl_list_end (scope));
       vdl_list_unicize (context->global_scope);
+      vdl_lookup_flush (context);
     }
 
   // setup the local scope of each newly-loaded file.
@@ -335,6 +336,7 @@ remove_from_scopes (struct VdlList *files, struct VdlFile *file)
 
   // finally, remove from the global scope map
   vdl_list_remove (file->context->global_scope, file);
+  vdl_lookup_flush (file->context);
 }
 
 int vdl_dlclose (void *handle)
@@ -90,6 +90,9 @@ struct VdlFile
   char *name;
   dev_t st_dev;
   ino_t st_ino;
+  // hash of the device, inode, size and modification time of the
+  // file, or zero if it was not mapped from a file.
+  uint64_t file_hash;
   struct VdlList *maps;
   // indicates if the deps field has been initialized correctly
   uint32_t deps_initialized : 1;
@@ -4,8 +4,31 @@
 #include "vdl-list.h"
 #include "vdl-context.h"
 #include "vdl-file.h"
+#include "vdl-alloc.h"
+#include "vdl-mem.h"
 #include <stdint.h>
 
+// Symbols found in the global scope of a context, by name and
+// version, with the file of the version: without it, the version is
+// not required at all. They are found again for every file which refers to
+// them, and for every context which loads the same files.
+struct VdlLookupCacheEntry
+{
+  struct VdlLookupCacheEntry *next;
+  uint32_t gnu_hash;
+  int no_exec;
+  char *name;
+  char *ver_name;
+  char *ver_filename;
+  struct VdlLookupResult result;
+};
+struct VdlLookupCache
+{
+  struct VdlLookupCacheEntry **buckets;
+  uint32_t size;
+  uint32_t n;
+};
+
 static uint32_t
 vdl_gnu_hash (const char *s)
 {
@@ -425,7 +448,8 @@ vdl_lookup_with_scope_internal (struct VdlFile *file,
 				uint32_t gnu_hash,
 				unsigned long ver_hash,
 				enum VdlLookupFlag flags,
-				struct VdlList *scope)
+				struct VdlList *scope,
+				bool *cacheable)
 {
   VDL_LOG_FUNCTION ("name=%s, ver_name=%s, ver_filename=%s, elf_hash=0x%lx, gnu_hash=0x%x, "
 		    "ver_hash=0x%x, flags=0x%x, scope=%p", 
@@ -451,6 +475,13 @@ vdl_lookup_with_scope_internal (struct VdlFile *file,
       while (vdl_lookup_file_has_next (&i))
 	{
 	  unsigned long index = vdl_lookup_file_next (&i);
+	  if (cacheable != 0 && item->dt_versym != 0 &&
+	      (item->dt_versym[index] == 0 || (item->dt_versym[index] & 0x8000)))
+	    {
+	      // whether this one matches depends on the file the
+	      // lookup is done from.
+	      *cacheable = false;
+	    }
 	  enum VdlVersionMatch version_match = symbol_version_matches (item, file, 
 								       ver_name, ver_filename, ver_hash,
 								       index);
@@ -519,6 +550,123 @@ vdl_lookup_with_scope_internal (struct VdlFile *file,
   return result;
 }
 
+static bool
+lookup_cache_key_equal (const char *a, const char *b)
+{
+  if (a == 0 || b == 0)
+    {
+      return a == b;
+    }
+  return vdl_utils_strisequal (a, b);
+}
+
+static struct VdlLookupCacheEntry *
+lookup_cache_find (const struct VdlContext *context, uint32_t gnu_hash,
+		   const char *name, const char *ver_name,
+		   const char *ver_filename, int no_exec)
+{
+  struct VdlLookupCache *cache = context->lookup_cache;
+  if (cache == 0)
+    {
+      return 0;
+    }
+  struct VdlLookupCacheEntry *entry;
+  for (entry = cache->buckets[gnu_hash & (cache->size - 1)]; entry != 0; entry = entry->next)
+    {
+      if (entry->gnu_hash == gnu_hash &&
+	  entry->no_exec == no_exec &&
+	  vdl_utils_strisequal (entry->name, name) &&
+	  lookup_cache_key_equal (entry->ver_name, ver_name) &&
+	  lookup_cache_key_equal (entry->ver_filename, ver_filename))
+	{
+	  return entry;
+	}
+    }
+  return 0;
+}
+
+static void
+lookup_cache_add (struct VdlContext *context, uint32_t gnu_hash,
+		  const char *name, const char *ver_name,
+		  const char *ver_filename, int no_exec,
+		  struct VdlLookupResult result)
+{
+  struct VdlLookupCache *cache = context->lookup_cache;
+  if (cache == 0)
+    {
+      cache = vdl_alloc_new (struct VdlLookupCache);
+      cache->size = 256;
+      cache->n = 0;
+      cache->buckets = vdl_alloc_malloc (cache->size * sizeof (struct VdlLookupCacheEntry *));
+      vdl_memset (cache->buckets, 0, cache->size * sizeof (struct VdlLookupCacheEntry *));
+      context->lookup_cache = cache;
+    }
+  if (cache->n >= cache->size)
+    {
+      uint32_t size = cache->size * 2;
+      struct VdlLookupCacheEntry **buckets = vdl_alloc_malloc (size * sizeof (struct VdlLookupCacheEntry *));
+      vdl_memset (buckets, 0, size * sizeof (struct VdlLookupCacheEntry *));
+      uint32_t j;
+      for (j = 0; j < cache->size; j++)
+	{
+	  struct VdlLookupCacheEntry *entry, *next;
+	  for (entry = cache->buckets[j]; entry != 0; entry = next)
+	    {
+	      next = entry->next;
+	      entry->next = buckets[entry->gnu_hash & (size - 1)];
+	      buckets[entry->gnu_hash & (size - 1)] = entry;
+	    }
+	}
+      vdl_alloc_free (cache->buckets);
+      cache->buckets = buckets;
+      cache->size = size;
+    }
+  // the strings belong to the file the lookup came from, which
+  // might be unloaded before the symbol found.
+  struct VdlLookupCacheEntry *entry = vdl_alloc_new (struct VdlLookupCacheEntry);
+  entry->gnu_hash = gnu_hash;
+  entry->no_exec = no_exec;
+  entry->name = vdl_utils_strdup (name);
+  entry->ver_name = (ver_name != 0) ? vdl_utils_strdup (ver_name) : 0;
+  entry->ver_filename = (ver_filename != 0) ? vdl_utils_strdup (ver_filename) : 0;
+  entry->result = result;
+  entry->next = cache->buckets[gnu_hash & (cache->size - 1)];
+  cache->buckets[gnu_hash & (cache->size - 1)] = entry;
+  cache->n++;
+}
+
+void
+vdl_lookup_flush (struct VdlContext *context)
+{
+  struct VdlLookupCache *cache = context->lookup_cache;
+  if (cache == 0)
+    {
+      return;
+    }
+  uint32_t j;
+  for (j = 0; j < cache->size; j++)
+    {
+      struct VdlLookupCacheEntry *entry, *next;
+      for (entry = cache->buckets[j]; entry != 0; entry = next)
+	{
+	  next = entry->next;
+	  vdl_alloc_free (entry->name);
+	  if (entry->ver_name != 0)
+	    {
+	      vdl_alloc_free (entry->ver_name);
+	    }
+	  if (entry->ver_filename != 0)
+	    {
+	      vdl_alloc_free (entry->ver_filename);
+	    }
+	  vdl_alloc_delete (entry);
+	}
+    }
+  vdl_alloc_free (cache->buckets);
+  vdl_alloc_delete (cache);
+  context->lookup_cache = 0;
+}
+
 struct VdlLookupResult
 vdl_lookup (struct VdlFile *file,
 	    const char *name, 
@@ -561,15 +709,43 @@ vdl_lookup (struct VdlFile *file,
       second = 0;
       break;
     }
+  // Only what is found in the global scope is the same for all
+  // the files of the context.
+  bool use_cache = (first == file->context->global_scope);
+  int no_exec = (flags & VDL_LOOKUP_NO_EXEC) ? 1 : 0;
   struct VdlLookupResult result;
+  if (use_cache)
+    {
+      struct VdlLookupCacheEntry *entry;
+      entry = lookup_cache_find (file->context, gnu_hash, name, ver_name,
+				 ver_filename, no_exec);
+      if (entry != 0)
+	{
+	  if (entry->result.file != file)
+	    {
+	      vdl_list_push_front (file->gc_symbols_resolved_in, 
+				   (struct VdlFile *)entry->result.file);
+	    }
+	  return entry->result;
+	}
+    }
+  bool cacheable = true;
   result = vdl_lookup_with_scope_internal (file, name, ver_name, ver_filename, 
 					   elf_hash, gnu_hash, ver_hash,
-					   flags, first);
-  if (!result.found)
+					   flags, first, &cacheable);
+  if (result.found)
+    {
+      if (use_cache && cacheable)
+	{
+	  lookup_cache_add (file->context, gnu_hash, name, ver_name,
+			    ver_filename, no_exec, result);
+	}
+    }
+  else
     {
       result = vdl_lookup_with_scope_internal (file, name, ver_name, ver_filename,
 					       elf_hash, gnu_hash, ver_hash,
-					       flags, second);
+					       flags, second, 0);
     }
   return result;
 }
@@ -618,6 +794,6 @@ vdl_lookup_with_scope (const struct VdlContext *from_context,
   struct VdlLookupResult result;
   result = vdl_lookup_with_scope_internal (0, name, ver_name, ver_filename,
 					   elf_hash, gnu_hash, ver_hash,
-					   flags, scope);
+					   flags, scope, 0);
   return result;
 }
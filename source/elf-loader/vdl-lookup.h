@@ -38,5 +38,8 @@ struct VdlLookupResult vdl_lookup_with_scope (const struct VdlContext *from_cont
 					      const char *ver_filename,
 					      enum VdlLookupFlag flags,
 					      struct VdlList *scope);
+// forget the lookups memoized in this context. Must be called
+// whenever its global scope or its symbol remaps change.
+void vdl_lookup_flush (struct VdlContext *context);
 
 #endif /* VDL_LOOKUP_H */
@@ -325,6 +325,7 @@ file_new (unsigned long load_base,
   file->context = context;
   file->st_dev = 0;
   file->st_ino = 0;
+  file->file_hash = 0;
   file->maps = maps;
   void **i;
   for (i = vdl_list_begin (maps); i != vdl_list_end (maps); i = vdl_list_next (i))
@@ -688,6 +689,10 @@ vdl_file_map_single (struct VdlContext *context,
 				   context);
   file->st_dev = st_buf.st_dev;
   file->st_ino = st_buf.st_ino;
+  file->file_hash = vdl_utils_hash (VDL_UTILS_HASH_INIT, &st_buf.st_dev, sizeof (st_buf.st_dev));
+  file->file_hash = vdl_utils_hash (file->file_hash, &st_buf.st_ino, sizeof (st_buf.st_ino));
+  file->file_hash = vdl_utils_hash (file->file_hash, &st_buf.st_size, sizeof (st_buf.st_size));
+  file->file_hash = vdl_utils_hash (file->file_hash, &st_buf.st_mtime, sizeof (st_buf.st_mtime));
   
   file->phdr = phdr;
   file->phnum = header.e_phnum;
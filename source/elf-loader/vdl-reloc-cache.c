@@ -0,0 +1,211 @@
+#include "vdl-reloc-cache.h"
+#include "vdl.h"
+#include "vdl-alloc.h"
+#include "vdl-list.h"
+#include "vdl-log.h"
+#include "vdl-utils.h"
+#include "system.h"
+#include <fcntl.h>
+
+#define VDL_RELOC_CACHE_MAGIC 0x434c5256 // "VRLC"
+#define VDL_RELOC_CACHE_VERSION 1
+
+struct VdlRelocCacheHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t n_files;
+  uint32_t n_entries;
+  // tells entries written by another architecture
+  uint32_t entry_size;
+  uint32_t reserved;
+};
+
+struct VdlRelocSnapshot *
+vdl_reloc_snapshot_new (uint64_t key, uint32_t n_files, uint32_t max_entries)
+{
+  struct VdlRelocSnapshot *snapshot = vdl_alloc_new (struct VdlRelocSnapshot);
+  snapshot->key = key;
+  snapshot->n_files = n_files;
+  snapshot->n_entries = 0;
+  snapshot->checked = 1;
+  snapshot->entries = vdl_alloc_malloc (vdl_utils_max (max_entries, 1) *
+					sizeof (struct VdlRelocCacheEntry));
+  return snapshot;
+}
+
+void
+vdl_reloc_snapshot_delete (struct VdlRelocSnapshot *snapshot)
+{
+  vdl_alloc_free (snapshot->entries);
+  vdl_alloc_delete (snapshot);
+}
+
+static char *
+cache_filename (uint64_t key)
+{
+  char hex[17];
+  int i;
+  for (i = 15; i >= 0; i--)
+    {
+      hex[i] = "0123456789abcdef"[key & 0xf];
+      key >>= 4;
+    }
+  hex[16] = 0;
+  return vdl_utils_strconcat (g_vdl.reloc_cache_dir, "/", hex, ".reloc", 0);
+}
+
+static bool
+read_all (int fd, void *buffer, unsigned long size)
+{
+  uint8_t *p = buffer;
+  while (size > 0)
+    {
+      int n = system_read (fd, p, size);
+      if (n <= 0)
+	{
+	  return false;
+	}
+      p += n;
+      size -= n;
+    }
+  return true;
+}
+
+static struct VdlRelocSnapshot *
+cache_read (uint64_t key, uint32_t n_files)
+{
+  char *filename = cache_filename (key);
+  int fd = system_open_ro (filename);
+  vdl_alloc_free (filename);
+  if (fd == -1)
+    {
+      return 0;
+    }
+  struct VdlRelocSnapshot *snapshot = 0;
+  struct VdlRelocCacheHeader header;
+  // the entries must fill the rest of the file exactly: n_entries is
+  // not trusted before it is checked against the size.
+  int size = system_lseek (fd, 0, SEEK_END);
+  if (size < (int)sizeof (header) ||
+      system_lseek (fd, 0, SEEK_SET) != 0 ||
+      !read_all (fd, &header, sizeof (header)) ||
+      header.magic != VDL_RELOC_CACHE_MAGIC ||
+      header.version != VDL_RELOC_CACHE_VERSION ||
+      header.key != key ||
+      header.n_files != n_files ||
+      header.entry_size != sizeof (struct VdlRelocCacheEntry) ||
+      (size - sizeof (header)) % sizeof (struct VdlRelocCacheEntry) != 0 ||
+      (size - sizeof (header)) / sizeof (struct VdlRelocCacheEntry) != header.n_entries)
+    {
+      VDL_LOG_DEBUG ("Ignoring relocation cache of key 0x%llx\n", key);
+      goto out;
+    }
+  snapshot = vdl_reloc_snapshot_new (key, n_files, header.n_entries);
+  if (!read_all (fd, snapshot->entries,
+		 header.n_entries * sizeof (struct VdlRelocCacheEntry)))
+    {
+      vdl_reloc_snapshot_delete (snapshot);
+      snapshot = 0;
+      goto out;
+    }
+  snapshot->n_entries = header.n_entries;
+  snapshot->checked = 0;
+ out:
+  system_close (fd);
+  return snapshot;
+}
+
+static void
+cache_write (const struct VdlRelocSnapshot *snapshot)
+{
+  char *filename = cache_filename (snapshot->key);
+  char *tmp = vdl_utils_sprintf ("%s.%d", filename, system_getpid ());
+  // written aside and renamed, so that another process never reads
+  // half of it.
+  int fd = system_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd == -1)
+    {
+      VDL_LOG_DEBUG ("Unable to write relocation cache %s\n", tmp);
+      goto out;
+    }
+  struct VdlRelocCacheHeader header;
+  header.magic = VDL_RELOC_CACHE_MAGIC;
+  header.version = VDL_RELOC_CACHE_VERSION;
+  header.key = snapshot->key;
+  header.n_files = snapshot->n_files;
+  header.n_entries = snapshot->n_entries;
+  header.entry_size = sizeof (struct VdlRelocCacheEntry);
+  header.reserved = 0;
+  system_write (fd, &header, sizeof (header));
+  system_write (fd, snapshot->entries,
+		snapshot->n_entries * sizeof (struct VdlRelocCacheEntry));
+  system_close (fd);
+  system_rename (tmp, filename);
+ out:
+  vdl_alloc_free (tmp);
+  vdl_alloc_free (filename);
+}
+
+struct VdlRelocSnapshot *
+vdl_reloc_cache_get (uint64_t key, uint32_t n_files)
+{
+  void **i;
+  for (i = vdl_list_begin (g_vdl.reloc_snapshots);
+       i != vdl_list_end (g_vdl.reloc_snapshots);
+       i = vdl_list_next (i))
+    {
+      struct VdlRelocSnapshot *snapshot = *i;
+      if (snapshot->key == key && snapshot->n_files == n_files)
+	{
+	  return snapshot;
+	}
+    }
+  if (g_vdl.reloc_cache_dir == 0)
+    {
+      return 0;
+    }
+  struct VdlRelocSnapshot *snapshot = cache_read (key, n_files);
+  if (snapshot != 0)
+    {
+      vdl_list_push_back (g_vdl.reloc_snapshots, snapshot);
+    }
+  return snapshot;
+}
+
+void
+vdl_reloc_cache_put (struct VdlRelocSnapshot *snapshot)
+{
+  vdl_list_push_back (g_vdl.reloc_snapshots, snapshot);
+  if (g_vdl.reloc_cache_dir != 0)
+    {
+      cache_write (snapshot);
+    }
+}
+
+void
+vdl_reloc_cache_remove (struct VdlRelocSnapshot *snapshot)
+{
+  vdl_list_remove (g_vdl.reloc_snapshots, snapshot);
+  vdl_reloc_snapshot_delete (snapshot);
+}
+
+void
+vdl_reloc_cache_delete (void)
+{
+  void **i;
+  for (i = vdl_list_begin (g_vdl.reloc_snapshots);
+       i != vdl_list_end (g_vdl.reloc_snapshots);
+       i = vdl_list_next (i))
+    {
+      vdl_reloc_snapshot_delete (*i);
+    }
+  vdl_list_delete (g_vdl.reloc_snapshots);
+  g_vdl.reloc_snapshots = 0;
+  if (g_vdl.reloc_cache_dir != 0)
+    {
+      vdl_alloc_free (g_vdl.reloc_cache_dir);
+      g_vdl.reloc_cache_dir = 0;
+    }
+}
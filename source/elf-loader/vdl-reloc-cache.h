@@ -0,0 +1,59 @@
+#ifndef VDL_RELOC_CACHE_H
+#define VDL_RELOC_CACHE_H
+
+#include <stdint.h>
+
+// A snapshot holds the relocations of a file as they were done
+// once, in a layout: the file itself followed by the files of the
+// scopes its symbols are looked up in. In the same layout, at other
+// load addresses, most of them are replayed by adding the load base
+// of the file which held the symbol to a value, without any lookup.
+// The others are processed again.
+//
+// Snapshots are kept in memory for the other contexts which load
+// the same files, and in the LD_RELOC_CACHE directory, if set, for
+// the next runs.
+
+// the file index of the entries processed again: offset locates
+// their ElfW(Rel) or ElfW(Rela) from the load base.
+#define VDL_RELOC_CACHE_REL  0xffffffff
+#define VDL_RELOC_CACHE_RELA 0xfffffffe
+
+struct VdlRelocCacheEntry
+{
+  // of the word relocated, from the load base of the file.
+  unsigned long offset;
+  // what is added to the load base of the file which holds the symbol
+  unsigned long value;
+  // index in the layout of the file which holds the symbol
+  uint32_t file;
+};
+
+struct VdlRelocSnapshot
+{
+  // identifies the file and its layout
+  uint64_t key;
+  uint32_t n_files;
+  uint32_t n_entries;
+  struct VdlRelocCacheEntry *entries;
+  // 0 for a snapshot read back from the cache directory until its
+  // entries are checked against the file.
+  int checked;
+};
+
+// entries is allocated for max_entries
+struct VdlRelocSnapshot *vdl_reloc_snapshot_new (uint64_t key, uint32_t n_files,
+						 uint32_t max_entries);
+void vdl_reloc_snapshot_delete (struct VdlRelocSnapshot *snapshot);
+
+// returns the snapshot taken with this key, from memory or from
+// the cache directory, or 0.
+struct VdlRelocSnapshot *vdl_reloc_cache_get (uint64_t key, uint32_t n_files);
+// the cache owns the snapshot from now on.
+void vdl_reloc_cache_put (struct VdlRelocSnapshot *snapshot);
+// drops a snapshot found not to match its file. The next put of its
+// key replaces it in the cache directory.
+void vdl_reloc_cache_remove (struct VdlRelocSnapshot *snapshot);
+void vdl_reloc_cache_delete (void);
+
+#endif /* VDL_RELOC_CACHE_H */
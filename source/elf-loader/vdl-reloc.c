@@ -8,6 +8,9 @@
 #include "futex.h"
 #include "vdl-mem.h"
 #include "vdl-file.h"
+#include "vdl-context.h"
+#include "vdl-alloc.h"
+#include "vdl-reloc-cache.h"
 #include <sys/mman.h>
 #include <stdbool.h>
 
@@ -16,6 +19,14 @@
 #define STT_GNU_IFUNC 10
 #endif
 
+// The snapshot being taken of the relocations of a file, see
+// vdl-reloc-cache.h
+struct VdlRelocRecord
+{
+  struct VdlRelocSnapshot *snapshot;
+  struct VdlFile **layout;
+};
+
 static bool
 sym_to_ver_req (struct VdlFile *file,
 		unsigned long index,
@@ -92,10 +103,13 @@ sym_to_ver_req (struct VdlFile *file,
   return false;
 }
 
+// base_file, if not null, is set to the file whose load base the
+// relocated word is relative to, if it is, or 0.
 static unsigned long
 do_process_reloc (struct VdlFile *file, 
 		  unsigned long reloc_type, unsigned long *reloc_addr,
-		  unsigned long reloc_addend, unsigned long reloc_sym)
+		  unsigned long reloc_addend, unsigned long reloc_sym,
+		  const struct VdlFile **base_file)
 {
   const char *dt_strtab = file->dt_strtab;
   ElfW(Sym) *dt_symtab = file->dt_symtab;
@@ -191,33 +205,85 @@ do_process_reloc (struct VdlFile *file,
   machine_reloc (symbol_file, reloc_addr, reloc_type, reloc_addend,
 		 symbol_value, symbol_type);
 
+  if (base_file != 0 && symbol_type != STT_GNU_IFUNC &&
+      machine_reloc_is_base_relative (reloc_type))
+    {
+      *base_file = symbol_file;
+    }
+
   return *reloc_addr;
 }
 
+static void
+reloc_record (struct VdlRelocRecord *record, struct VdlFile *file,
+	      const struct VdlFile *base_file, unsigned long reloc_offset,
+	      void *entry, uint32_t kind)
+{
+  struct VdlRelocSnapshot *snapshot = record->snapshot;
+  struct VdlRelocCacheEntry *cache_entry = &snapshot->entries[snapshot->n_entries];
+  snapshot->n_entries++;
+  if (base_file != 0)
+    {
+      uint32_t i;
+      for (i = 0; i < snapshot->n_files; i++)
+	{
+	  if (record->layout[i] == base_file)
+	    {
+	      unsigned long *reloc_addr = (unsigned long *)(file->load_base + reloc_offset);
+	      cache_entry->offset = reloc_offset;
+	      cache_entry->value = *reloc_addr - base_file->load_base;
+	      cache_entry->file = i;
+	      return;
+	    }
+	}
+    }
+  // symbols not found, copies, ifuncs and tls: all of these are
+  // done again.
+  cache_entry->offset = (unsigned long)entry - file->load_base;
+  cache_entry->value = 0;
+  cache_entry->file = kind;
+}
+
 static unsigned long
-process_rel (struct VdlFile *file, ElfW(Rel) *rel)
+process_rel (struct VdlFile *file, ElfW(Rel) *rel, struct VdlRelocRecord *record)
 {
   unsigned long reloc_type = ELFW_R_TYPE (rel->r_info);
   unsigned long *reloc_addr = (unsigned long*) (file->load_base + rel->r_offset);
   unsigned long reloc_addend = *reloc_addr;
   unsigned long reloc_sym = ELFW_R_SYM (rel->r_info);
 
-  return do_process_reloc (file, reloc_type, reloc_addr, reloc_addend, reloc_sym);
+  if (record == 0)
+    {
+      return do_process_reloc (file, reloc_type, reloc_addr, reloc_addend, reloc_sym, 0);
+    }
+  const struct VdlFile *base_file = 0;
+  unsigned long symbol = do_process_reloc (file, reloc_type, reloc_addr, reloc_addend, 
+					   reloc_sym, &base_file);
+  reloc_record (record, file, base_file, rel->r_offset, rel, VDL_RELOC_CACHE_REL);
+  return symbol;
 }
 
 static unsigned long
-process_rela (struct VdlFile *file, ElfW(Rela) *rela)
+process_rela (struct VdlFile *file, ElfW(Rela) *rela, struct VdlRelocRecord *record)
 {
   unsigned long reloc_type = ELFW_R_TYPE (rela->r_info);
   unsigned long *reloc_addr = (unsigned long*) (file->load_base + rela->r_offset);
   unsigned long reloc_addend = rela->r_addend;
   unsigned long reloc_sym = ELFW_R_SYM (rela->r_info);
 
-  return do_process_reloc (file, reloc_type, reloc_addr, reloc_addend, reloc_sym);
+  if (record == 0)
+    {
+      return do_process_reloc (file, reloc_type, reloc_addr, reloc_addend, reloc_sym, 0);
+    }
+  const struct VdlFile *base_file = 0;
+  unsigned long symbol = do_process_reloc (file, reloc_type, reloc_addr, reloc_addend, 
+					   reloc_sym, &base_file);
+  reloc_record (record, file, base_file, rela->r_offset, rela, VDL_RELOC_CACHE_RELA);
+  return symbol;
 }
 
 static void
-reloc_jmprel (struct VdlFile *file)
+reloc_jmprel (struct VdlFile *file, struct VdlRelocRecord *record)
 {
   VDL_LOG_FUNCTION ("file=%s", file->name);
   unsigned long dt_jmprel = file->dt_jmprel;
@@ -235,7 +301,7 @@ reloc_jmprel (struct VdlFile *file)
       for (i = 0; i < dt_pltrelsz/sizeof(ElfW(Rel)); i++)
 	{
 	  ElfW(Rel) *rel = &(((ElfW(Rel)*)dt_jmprel)[i]);
-	  process_rel (file, rel);
+	  process_rel (file, rel, record);
 	}
     }
   else
@@ -244,7 +310,7 @@ reloc_jmprel (struct VdlFile *file)
       for (i = 0; i < dt_pltrelsz/sizeof(ElfW(Rela)); i++)
 	{
 	  ElfW(Rela) *rela = &(((ElfW(Rela)*)dt_jmprel)[i]);
-	  process_rela (file, rela);
+	  process_rela (file, rela, record);
 	}
     }
 }
@@ -271,12 +337,12 @@ vdl_reloc_offset_jmprel (struct VdlFile *file,
   if (dt_pltrel == DT_REL)
     {
       ElfW(Rel) *rel = (ElfW(Rel)*)(dt_jmprel+offset);
-      symbol = process_rel (file, rel);
+      symbol = process_rel (file, rel, 0);
     }
   else
     {
       ElfW(Rela) *rela = (ElfW(Rela)*)(dt_jmprel+offset);
-      symbol = process_rela (file, rela);
+      symbol = process_rela (file, rela, 0);
     }
   futex_unlock (g_vdl.futex);
   return symbol;
@@ -305,14 +371,14 @@ vdl_reloc_index_jmprel (struct VdlFile *file,
       VDL_LOG_ASSERT (index < dt_pltrelsz / sizeof(ElfW(Rel)), 
 		      "Relocation entry not within range");
       ElfW(Rel) *rel = &((ElfW(Rel)*)dt_jmprel)[index];
-      symbol = process_rel (file, rel);
+      symbol = process_rel (file, rel, 0);
     }
   else
     {
       VDL_LOG_ASSERT (index < dt_pltrelsz / sizeof(ElfW(Rela)), 
 		      "Relocation entry not within range");
       ElfW(Rela) *rela = &((ElfW(Rela)*)dt_jmprel)[index];
-      symbol = process_rela (file, rela);
+      symbol = process_rela (file, rela, 0);
     }
   futex_unlock (g_vdl.futex);
   return symbol;
@@ -320,7 +386,7 @@ vdl_reloc_index_jmprel (struct VdlFile *file,
 
 
 static void
-reloc_dtrel (struct VdlFile *file)
+reloc_dtrel (struct VdlFile *file, struct VdlRelocRecord *record)
 {
   VDL_LOG_FUNCTION ("file=%s", file->name);
   ElfW(Rel) *dt_rel = file->dt_rel;
@@ -334,12 +400,12 @@ reloc_dtrel (struct VdlFile *file)
   for (i = 0; i < dt_relsz/dt_relent; i++)
     {
       ElfW(Rel) *rel = &dt_rel[i];
-      process_rel (file, rel);
+      process_rel (file, rel, record);
     }
 }
 
 static void
-reloc_dtrela (struct VdlFile *file)
+reloc_dtrela (struct VdlFile *file, struct VdlRelocRecord *record)
 {
   VDL_LOG_FUNCTION ("file=%s", file->name);
   ElfW(Rela) *dt_rela = file->dt_rela;
@@ -353,8 +419,242 @@ reloc_dtrela (struct VdlFile *file)
   for (i = 0; i < dt_relasz/dt_relaent; i++)
     {
       ElfW(Rela) *rela = &dt_rela[i];
-      process_rela (file, rela);
+      process_rela (file, rela, record);
+    }
+}
+
+static uint32_t
+reloc_count (struct VdlFile *file, int now)
+{
+  uint32_t count = 0;
+  if (file->dt_rel != 0 && file->dt_relent != 0)
+    {
+      count += file->dt_relsz / file->dt_relent;
+    }
+  if (file->dt_rela != 0 && file->dt_relaent != 0)
+    {
+      count += file->dt_relasz / file->dt_relaent;
+    }
+  if (now && file->dt_jmprel != 0)
+    {
+      if (file->dt_pltrel == DT_REL)
+	{
+	  count += file->dt_pltrelsz / sizeof (ElfW(Rel));
+	}
+      else if (file->dt_pltrel == DT_RELA)
+	{
+	  count += file->dt_pltrelsz / sizeof (ElfW(Rela));
+	}
+    }
+  return count;
+}
+
+static uint64_t
+hash_string (uint64_t hash, const char *str)
+{
+  if (str == 0)
+    {
+      return vdl_utils_hash (hash, "", 1);
+    }
+  return vdl_utils_hash (hash, str, vdl_utils_strlen (str) + 1);
+}
+
+static uint64_t
+hash_layout_file (uint64_t hash, const struct VdlFile *file)
+{
+  unsigned long is_executable = file->is_executable;
+  hash = vdl_utils_hash (hash, &file->file_hash, sizeof (file->file_hash));
+  return vdl_utils_hash (hash, &is_executable, sizeof (is_executable));
+}
+
+// The file followed by the files its symbols are looked up in, in
+// the order vdl_lookup looks at them, and a key for all of what the
+// relocations depend on besides load addresses. Returns 0 if one of
+// the files was not mapped from a file.
+static struct VdlFile **
+reloc_layout (struct VdlFile *file, int now, uint32_t *n_files, uint64_t *key)
+{
+  struct VdlList *first = file->context->global_scope;
+  struct VdlList *second = file->local_scope;
+  switch (file->lookup_type)
+    {
+    case FILE_LOOKUP_LOCAL_GLOBAL:
+      first = file->local_scope;
+      second = file->context->global_scope;
+      break;
+    case FILE_LOOKUP_GLOBAL_ONLY:
+      second = 0;
+      break;
+    case FILE_LOOKUP_LOCAL_ONLY:
+      first = file->local_scope;
+      second = 0;
+      break;
+    case FILE_LOOKUP_GLOBAL_LOCAL:
+      break;
+    }
+  uint32_t n = 1 + vdl_list_size (first) + ((second != 0) ? vdl_list_size (second) : 0);
+  struct VdlFile **layout = vdl_alloc_malloc (n * sizeof (struct VdlFile *));
+  uint64_t hash = VDL_UTILS_HASH_INIT;
+  unsigned long header[3] = {file->lookup_type, now, n};
+  hash = vdl_utils_hash (hash, header, sizeof (header));
+  uint32_t j = 0;
+  layout[j++] = file;
+  struct VdlList *scopes[2] = {first, second};
+  int k;
+  for (k = 0; k < 2 && scopes[k] != 0; k++)
+    {
+      void **i;
+      for (i = vdl_list_begin (scopes[k]); i != vdl_list_end (scopes[k]); i = vdl_list_next (i))
+	{
+	  layout[j++] = *i;
+	}
     }
+  for (j = 0; j < n; j++)
+    {
+      if (layout[j]->file_hash == 0)
+	{
+	  vdl_alloc_free (layout);
+	  return 0;
+	}
+      hash = hash_layout_file (hash, layout[j]);
+    }
+  void **i;
+  for (i = vdl_list_begin (file->context->symbol_remaps);
+       i != vdl_list_end (file->context->symbol_remaps);
+       i = vdl_list_next (i))
+    {
+      struct VdlContextSymbolRemapEntry *remap = *i;
+      hash = hash_string (hash, remap->src_name);
+      hash = hash_string (hash, remap->src_ver_name);
+      hash = hash_string (hash, remap->src_ver_filename);
+      hash = hash_string (hash, remap->dst_name);
+      hash = hash_string (hash, remap->dst_ver_name);
+      hash = hash_string (hash, remap->dst_ver_filename);
+    }
+  *n_files = n;
+  *key = hash;
+  return layout;
+}
+
+// whether [start, start+size) lies in one of the maps of file.
+static int
+reloc_in_maps (const struct VdlFile *file, unsigned long start,
+	       unsigned long size)
+{
+  void **i;
+  for (i = vdl_list_begin (file->maps); i != vdl_list_end (file->maps); i = vdl_list_next (i))
+    {
+      const struct VdlFileMap *map = *i;
+      if (start >= map->mem_start_align &&
+	  start - map->mem_start_align <= map->mem_size_align - size)
+	{
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+// whether entry locates an entry of the size given in the table
+// [table, table+table_size).
+static int
+reloc_in_table (unsigned long entry, unsigned long table,
+		unsigned long table_size, unsigned long entry_size)
+{
+  return table != 0 && entry_size != 0 &&
+    entry >= table && entry - table < table_size &&
+    (entry - table) % entry_size == 0;
+}
+
+// A snapshot read back from the cache directory may be stale or
+// damaged: it is only replayed if every entry writes within the
+// file and every entry processed again is one of its relocations.
+static int
+reloc_snapshot_valid (struct VdlFile *file,
+		      const struct VdlRelocSnapshot *snapshot, int now)
+{
+  if (snapshot->n_entries != reloc_count (file, now))
+    {
+      return 0;
+    }
+  unsigned long jmprelsz = now ? file->dt_pltrelsz : 0;
+  uint32_t j;
+  for (j = 0; j < snapshot->n_entries; j++)
+    {
+      const struct VdlRelocCacheEntry *entry = &snapshot->entries[j];
+      unsigned long addr = file->load_base + entry->offset;
+      if (entry->offset > ~0UL - file->load_base)
+	{
+	  return 0;
+	}
+      switch (entry->file)
+	{
+	case VDL_RELOC_CACHE_REL:
+	  if (!reloc_in_table (addr, (unsigned long)file->dt_rel,
+			       file->dt_relsz, file->dt_relent) &&
+	      !(file->dt_pltrel == DT_REL &&
+		reloc_in_table (addr, file->dt_jmprel, jmprelsz,
+				sizeof (ElfW(Rel)))))
+	    {
+	      return 0;
+	    }
+	  break;
+	case VDL_RELOC_CACHE_RELA:
+	  if (!reloc_in_table (addr, (unsigned long)file->dt_rela,
+			       file->dt_relasz, file->dt_relaent) &&
+	      !(file->dt_pltrel == DT_RELA &&
+		reloc_in_table (addr, file->dt_jmprel, jmprelsz,
+				sizeof (ElfW(Rela)))))
+	    {
+	      return 0;
+	    }
+	  break;
+	default:
+	  if (entry->file >= snapshot->n_files ||
+	      !reloc_in_maps (file, addr, sizeof (unsigned long)))
+	    {
+	      return 0;
+	    }
+	  break;
+	}
+    }
+  return 1;
+}
+
+static void
+reloc_replay (struct VdlFile *file, const struct VdlRelocSnapshot *snapshot,
+	      struct VdlFile **layout)
+{
+  VDL_LOG_FUNCTION ("file=%s, entries=%u", file->name, snapshot->n_entries);
+  uint8_t *resolved_in = vdl_alloc_malloc (snapshot->n_files);
+  vdl_memset (resolved_in, 0, snapshot->n_files);
+  uint32_t j;
+  for (j = 0; j < snapshot->n_entries; j++)
+    {
+      const struct VdlRelocCacheEntry *entry = &snapshot->entries[j];
+      switch (entry->file)
+	{
+	case VDL_RELOC_CACHE_REL:
+	  process_rel (file, (ElfW(Rel) *)(file->load_base + entry->offset), 0);
+	  break;
+	case VDL_RELOC_CACHE_RELA:
+	  process_rela (file, (ElfW(Rela) *)(file->load_base + entry->offset), 0);
+	  break;
+	default:
+	  *(unsigned long *)(file->load_base + entry->offset) =
+	    layout[entry->file]->load_base + entry->value;
+	  resolved_in[entry->file] = 1;
+	  break;
+	}
+    }
+  // as vdl_lookup would have, for vdl_gc
+  for (j = 1; j < snapshot->n_files; j++)
+    {
+      if (resolved_in[j] && layout[j] != file)
+	{
+	  vdl_list_push_front (file->gc_symbols_resolved_in, layout[j]);
+	}
+    }
+  vdl_alloc_free (resolved_in);
 }
 
 static void
@@ -379,14 +679,61 @@ do_reloc (struct VdlFile *file, int now)
 	}
     }
 
-  reloc_dtrel (file);
-  reloc_dtrela (file);
-  if (now)
+  uint32_t n_files = 0;
+  uint64_t key = 0;
+  struct VdlFile **layout = reloc_layout (file, now, &n_files, &key);
+  struct VdlRelocSnapshot *snapshot = 0;
+  if (layout != 0)
     {
-      // perform full PLT relocs _now_
-      reloc_jmprel (file);
+      snapshot = vdl_reloc_cache_get (key, n_files);
+    }
+  if (snapshot != 0 &&
+      (!snapshot->checked || snapshot->n_entries != reloc_count (file, now)))
+    {
+      // the same key gives the same offsets from the load base in any
+      // context, so the entries are checked once.
+      if (!reloc_snapshot_valid (file, snapshot, now))
+	{
+	  VDL_LOG_DEBUG ("Relocation snapshot of %s does not match, ignored\n", file->name);
+	  vdl_reloc_cache_remove (snapshot);
+	  snapshot = 0;
+	}
+      else
+	{
+	  snapshot->checked = 1;
+	}
+    }
+  if (snapshot != 0)
+    {
+      reloc_replay (file, snapshot, layout);
     }
   else
+    {
+      struct VdlRelocRecord record;
+      struct VdlRelocRecord *precord = 0;
+      if (layout != 0)
+	{
+	  record.snapshot = vdl_reloc_snapshot_new (key, n_files, reloc_count (file, now));
+	  record.layout = layout;
+	  precord = &record;
+	}
+      reloc_dtrel (file, precord);
+      reloc_dtrela (file, precord);
+      if (now)
+	{
+	  // perform full PLT relocs _now_
+	  reloc_jmprel (file, precord);
+	}
+      if (precord != 0)
+	{
+	  vdl_reloc_cache_put (record.snapshot);
+	}
+    }
+  if (layout != 0)
+    {
+      vdl_alloc_free (layout);
+    }
+  if (!now)
     {
       machine_lazy_reloc (file);
     }
@@ -199,6 +199,17 @@ struct VdlList *vdl_utils_splitpath (const char *value)
   return list;
 }
 
+uint64_t vdl_utils_hash (uint64_t hash, const void *buffer, unsigned long size)
+{
+  const uint8_t *p = buffer;
+  unsigned long i;
+  for (i = 0; i < size; i++)
+    {
+      hash ^= p[i];
+      hash *= 0x100000001b3ULL;
+    }
+  return hash;
+}
 
 unsigned long vdl_utils_align_down (unsigned long v, unsigned long align)
 {
@@ -22,6 +22,10 @@ void vdl_utils_str_list_delete (struct VdlList *list);
 struct VdlList *vdl_utils_strsplit (const char *value, char separator);
 struct VdlList *vdl_utils_splitpath (const char *value);
 
+// FNV-1a, to be started from VDL_UTILS_HASH_INIT
+#define VDL_UTILS_HASH_INIT 0xcbf29ce484222325ULL
+uint64_t vdl_utils_hash (uint64_t hash, const void *buffer, unsigned long size);
+
 unsigned long vdl_utils_align_down (unsigned long v, unsigned long align);
 unsigned long vdl_utils_align_up (unsigned long v, unsigned long align);
 
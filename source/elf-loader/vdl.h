@@ -65,6 +65,10 @@ struct Vdl
   // both member variables are used exclusively by vdl_dl_iterate_phdr
   unsigned long n_added;
   unsigned long n_removed;
+  // the relocations of the files already relocated, see vdl-reloc-cache.h
+  struct VdlList *reloc_snapshots;
+  // where they are also kept across runs, from LD_RELOC_CACHE.
+  char *reloc_cache_dir;
 };
 
 extern struct Vdl g_vdl;
@@ -22,6 +22,13 @@ bool machine_reloc_is_copy (unsigned long reloc_type)
 {
   return reloc_type == R_X86_64_COPY;
 }
+bool machine_reloc_is_base_relative (unsigned long reloc_type)
+{
+  return reloc_type == R_X86_64_RELATIVE ||
+    reloc_type == R_X86_64_GLOB_DAT ||
+    reloc_type == R_X86_64_JUMP_SLOT ||
+    reloc_type == R_X86_64_64;
+}
 void machine_reloc (const struct VdlFile *file,
 		    unsigned long *reloc_addr,
 		    unsigned long reloc_type,
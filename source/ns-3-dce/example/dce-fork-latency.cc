@@ -0,0 +1,64 @@
+#include "ns3/network-module.h"
+#include "ns3/core-module.h"
+#include "ns3/dce-module.h"
+#include <sys/time.h>
+#include <sstream>
+
+using namespace ns3;
+
+// Runs test-fork --bench, which forks and execs a child exiting right
+// away a number of times with a heap of the given size, and reports the
+// wall-clock time of each fork and exec.
+//
+// With --cow the heap of the children is shared with the parent until
+// written rather than copied (DceManager::CopyOnWriteFork).
+
+static double
+WallTime (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t iterations = 100;
+  uint32_t heapKB = 4096;
+  bool cow = false;
+  CommandLine cmd;
+  cmd.AddValue ("iterations", "Number of fork and exec", iterations);
+  cmd.AddValue ("heap", "Size of the heap of the parent in KB", heapKB);
+  cmd.AddValue ("cow", "Share the heap of the children with the parent until written", cow);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::DceManager::CopyOnWriteFork", BooleanValue (cow));
+
+  NodeContainer nodes;
+  nodes.Create (1);
+
+  DceManagerHelper dceManager;
+  dceManager.Install (nodes);
+
+  DceApplicationHelper dce;
+  dce.SetStackSize (1 << 20);
+  dce.SetBinary ("test-fork");
+  dce.AddArgument ("--bench");
+  std::ostringstream oss;
+  oss << iterations;
+  dce.AddArgument (oss.str ());
+  oss.str ("");
+  oss << heapKB;
+  dce.AddArgument (oss.str ());
+  ApplicationContainer apps = dce.Install (nodes);
+  apps.Start (Seconds (1.0));
+
+  double start = WallTime ();
+  Simulator::Run ();
+  double took = WallTime () - start;
+  Simulator::Destroy ();
+
+  std::cout << iterations << " fork and exec with a heap of " << heapKB << " KB in "
+            << took << " s, " << took * 1e6 / iterations << " us each" << std::endl;
+  return 0;
+}
@@ -10,6 +10,10 @@
 cpp_examples = [
     ("dce-tcp-simple", "True", "True"),
     ("dce-udp-simple", "True", "True"), 
+    ("dce-switch-latency --nodes=10 --iterations=100", "True", "True"),
+    ("dce-switch-latency --nodes=10 --iterations=100 --remap=1", "True", "True"),
+    ("dce-fork-latency --iterations=20", "True", "True"),
+    ("dce-fork-latency --iterations=20 --cow=1", "True", "True"),
     ("dce-udp-perf", "True", "True"), 
     ("dce-ccnd-simple", "True", "True"), 
     ("dce-ccnd-short-stuff", "True", "True"), 
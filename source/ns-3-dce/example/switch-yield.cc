@@ -0,0 +1,20 @@
+#include <unistd.h>
+#include <stdlib.h>
+
+// Writable data about the size a routing daemon carries across its
+// libraries, so that the loader has that much to swap in and out.
+static char state[256 * 1024] = { 1 };
+
+// Sleeps a number of times (by default 1000), so that another process
+// runs in between each time.
+int main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 1000;
+
+  for (int i = 0; i < iterations; i++)
+    {
+      state[(i * 4096) % sizeof (state)]++;
+      usleep (1000);
+    }
+  return 0;
+}
@@ -53,6 +53,7 @@ DceManagerHelper::DceManagerHelper ()
   m_managerFactory.SetTypeId ("ns3::DceManager");
   m_networkStackFactory.SetTypeId ("ns3::Ns3SocketFdFactory");
   m_delayFactory.SetTypeId ("ns3::RandomProcessDelayModel");
+  m_useFileSystem = false;
   m_virtualPath = "";
 }
 void
@@ -74,6 +75,14 @@ DceManagerHelper::SetDelayModel (std::string type,
   m_delayFactory.Set (n1, v1);
 }
 void
+DceManagerHelper::SetFileSystem (std::string type,
+                                 std::string n0, const AttributeValue &v0)
+{
+  m_fileSystemFactory.SetTypeId (type);
+  m_fileSystemFactory.Set (n0, v0);
+  m_useFileSystem = true;
+}
+void
 DceManagerHelper::SetTaskManagerAttribute (std::string n0, const AttributeValue &v0)
 {
   m_taskManagerFactory.Set (n0, v0);
@@ -125,6 +134,10 @@ DceManagerHelper::Install (Ptr<Node> node)
       node->AggregateObject (networkStack);
       node->AggregateObject (CreateObject<LocalSocketFdFactory> ());
       manager->AggregateObject (CreateObject<DceNodeContext> ());
+      if (m_useFileSystem)
+        {
+          node->AggregateObject (m_fileSystemFactory.Create<Object> ());
+        }
       manager->SetVirtualPath (GetVirtualPath ());
 }
 void
@@ -105,7 +105,8 @@ public:
 
   /**
    * \param type the name of the ProcessDelayModel to set
-   * (ns3::RandomProcessDelayModel and ns3::TimeOfDayProcessDelayModel are available)
+   * (ns3::RandomProcessDelayModel, ns3::TimeOfDayProcessDelayModel and
+   * ns3::CpuTimeProcessDelayModel are available)
    * \param n0 the name of the attribute to set to the ProcessDelayModel
    * \param v0 the value of the attribute to set to the ProcessDelayModel
    * \param n1 the name of the attribute to set to the ProcessDelayModel
@@ -143,6 +144,19 @@ public:
   void SetNetworkStack (std::string type,
                         std::string n0 = "", const AttributeValue &v0 = EmptyAttributeValue ());
 
+  /**
+   * \param type the name of the file system of the nodes
+   * (ns3::MemFileSystem is available)
+   * \param n0 the name of the attribute to set to the file system
+   * \param v0 the value of the attribute to set to the file system
+   *
+   * Keep the files of each node in a file system of this type rather
+   * than in the files-<nodeid> directories of the host, which is the
+   * default.
+   */
+  void SetFileSystem (std::string type,
+                      std::string n0 = "", const AttributeValue &v0 = EmptyAttributeValue ());
+
   /**
    * \param n1 the name of the attribute to set to the ns3::DceManager
    * \param v1 the value of the attribute to set to the ns3::DceManager
@@ -188,6 +202,8 @@ private:
   ObjectFactory m_managerFactory;
   ObjectFactory m_networkStackFactory;
   ObjectFactory m_delayFactory;
+  ObjectFactory m_fileSystemFactory;
+  bool m_useFileSystem;
   std::string m_virtualPath;
   static unsigned long nanoCpt;
 };
@@ -0,0 +1,213 @@
+#include "asm-fiber-manager.h"
+#include "fiber-stack.h"
+#include "ns3/fatal-error.h"
+#include "ns3/assert.h"
+#include <stdint.h>
+
+#ifdef HAVE_VALGRIND_H
+# include "valgrind/valgrind.h"
+#else
+# define VALGRIND_STACK_REGISTER(start,end) (0)
+# define VALGRIND_STACK_DEREGISTER(id)
+#endif
+
+#if defined(__x86_64__)
+
+/**
+ * void dce_fiber_switch (void **fromSp, void *toSp);
+ *
+ * Pushes the registers the callee must preserve, then the MXCSR and
+ * the x87 control word, stores the stack pointer in *fromSp and pops
+ * the same from toSp.  The other registers are clobbered by the call
+ * anyway.
+ *
+ * A new fiber starts in dce_fiber_start with the callback in %r12 and
+ * its argument in %r13, see AsmFiberManager::Create.
+ */
+__asm__ (
+  ".text\n"
+  ".p2align 4\n"
+  ".globl dce_fiber_switch\n"
+  ".hidden dce_fiber_switch\n"
+  ".type dce_fiber_switch, @function\n"
+  "dce_fiber_switch:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $8, %rsp\n"
+  "  stmxcsr (%rsp)\n"
+  "  fnstcw 4(%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  ldmxcsr (%rsp)\n"
+  "  fldcw 4(%rsp)\n"
+  "  addq $8, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size dce_fiber_switch, .-dce_fiber_switch\n"
+  "\n"
+  ".p2align 4\n"
+  ".globl dce_fiber_start\n"
+  ".hidden dce_fiber_start\n"
+  ".type dce_fiber_start, @function\n"
+  "dce_fiber_start:\n"
+  "  movq %r13, %rdi\n"
+  "  callq *%r12\n"
+  "  ud2\n"
+  ".size dce_fiber_start, .-dce_fiber_start\n"
+  );
+
+extern "C" void dce_fiber_switch (void **fromSp, void *toSp);
+extern "C" void dce_fiber_start (void);
+
+#endif /* __x86_64__ */
+
+namespace ns3 {
+
+struct AsmFiber : public Fiber
+{
+  void *sp;
+  uint8_t *stack;
+  uint32_t stackSize;
+  unsigned int vgId;
+};
+
+// The initial frame of a fiber, as dce_fiber_switch pops it.
+struct AsmFiberFrame
+{
+  uint32_t mxcsr;
+  uint16_t fpucw;
+  uint16_t pad;
+  uint64_t r15;
+  uint64_t r14;
+  uint64_t r13;
+  uint64_t r12;
+  uint64_t rbx;
+  uint64_t rbp;
+  uint64_t ret;
+};
+
+AsmFiberManager::AsmFiberManager ()
+  : m_notifySwitch (0)
+{
+  if (!IsSupported ())
+    {
+      NS_FATAL_ERROR ("AsmFiberManager is only available on x86-64");
+    }
+}
+AsmFiberManager::~AsmFiberManager ()
+{
+}
+
+bool
+AsmFiberManager::IsSupported (void)
+{
+#if defined(__x86_64__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+struct Fiber *
+AsmFiberManager::Clone (struct Fiber *fiber)
+{
+  NS_FATAL_ERROR ("AsmFiberManager cannot clone fibers, use the PthreadFiberManager for fork");
+  return 0;
+}
+
+struct Fiber *
+AsmFiberManager::Create (void (*callback)(void *),
+                         void *context,
+                         uint32_t stackSize)
+{
+  struct AsmFiber *fiber = new struct AsmFiber ();
+  uint8_t *stack = FiberStack::Allocate (stackSize);
+  fiber->vgId = VALGRIND_STACK_REGISTER (stack, stack + stackSize);
+  fiber->stack = stack;
+  fiber->stackSize = stackSize;
+
+#if defined(__x86_64__)
+  // The frame ends at a 16 bytes boundary, so that dce_fiber_start is
+  // entered with the stack aligned as after a call, and calls the
+  // callback with it aligned on 16 bytes.
+  uintptr_t top = ((uintptr_t)stack + stackSize) & ~(uintptr_t)15;
+  struct AsmFiberFrame *frame = (struct AsmFiberFrame *)top - 1;
+  frame->mxcsr = 0x1f80; // all exceptions masked, round to nearest
+  frame->fpucw = 0x037f; // same, double extended precision
+  frame->pad = 0;
+  frame->r15 = 0;
+  frame->r14 = 0;
+  frame->r13 = (uint64_t)context;
+  frame->r12 = (uint64_t)callback;
+  frame->rbx = 0;
+  frame->rbp = 0;
+  frame->ret = (uint64_t)&dce_fiber_start;
+  fiber->sp = frame;
+#endif
+
+  return fiber;
+}
+
+struct Fiber *
+AsmFiberManager::CreateFromCaller (void)
+{
+  struct AsmFiber *fiber = new struct AsmFiber ();
+  fiber->sp = 0;
+  fiber->stack = 0;
+  fiber->stackSize = 0;
+  fiber->vgId = 0;
+  return fiber;
+}
+
+void
+AsmFiberManager::Delete (struct Fiber *fib)
+{
+  struct AsmFiber *fiber = (struct AsmFiber *)fib;
+  if (fiber->stack != 0)
+    {
+      VALGRIND_STACK_DEREGISTER (fiber->vgId);
+      FiberStack::Deallocate (fiber->stack, fiber->stackSize);
+    }
+  fiber->stack = 0;
+  fiber->stackSize = 0xdeadbeaf;
+  delete fiber;
+}
+
+void
+AsmFiberManager::SwitchTo (struct Fiber *fromFiber,
+                           const struct Fiber *toFiber)
+{
+  struct AsmFiber *from = (struct AsmFiber *)fromFiber;
+  const struct AsmFiber *to = (const struct AsmFiber *)toFiber;
+#if defined(__x86_64__)
+  dce_fiber_switch (&from->sp, to->sp);
+#endif
+  if (m_notifySwitch != 0)
+    {
+      m_notifySwitch ();
+    }
+}
+
+uint32_t
+AsmFiberManager::GetStackSize (struct Fiber *fib) const
+{
+  struct AsmFiber *fiber = (struct AsmFiber *)fib;
+  return fiber->stackSize;
+}
+
+void
+AsmFiberManager::SetSwitchNotification (void (*fn)(void))
+{
+  m_notifySwitch = fn;
+}
+
+} // namespace ns3
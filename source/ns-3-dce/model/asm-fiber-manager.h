@@ -0,0 +1,46 @@
+#ifndef ASM_FIBER_MANAGER_H
+#define ASM_FIBER_MANAGER_H
+
+#include "fiber-manager.h"
+
+namespace ns3 {
+
+/**
+ * Fibers switched by saving and restoring the callee-saved registers
+ * by hand, x86-64 only.  Unlike swapcontext this does not save and
+ * restore the signal mask, which costs a system call on every switch;
+ * the signal mask is the same in all fibers anyway.  The SSE and x87
+ * control words are kept per fiber, as the ABI wants them preserved
+ * across calls.
+ *
+ * Like the UcontextFiberManager, fibers cannot be cloned, so fork
+ * needs the PthreadFiberManager.
+ */
+class AsmFiberManager : public FiberManager
+{
+public:
+  AsmFiberManager ();
+  virtual ~AsmFiberManager ();
+
+  virtual struct Fiber * Clone (struct Fiber *fiber);
+  virtual struct Fiber *Create (void (*callback)(void *),
+                                void *context,
+                                uint32_t stackSize);
+  virtual struct Fiber * CreateFromCaller (void);
+  virtual void Delete (struct Fiber *fiber);
+  virtual void SwitchTo (struct Fiber *from,
+                         const struct Fiber *to);
+  virtual uint32_t GetStackSize (struct Fiber *fiber) const;
+  virtual void SetSwitchNotification (void (*fn)(void));
+
+  /**
+   * \returns whether this fiber manager can be used on this machine.
+   */
+  static bool IsSupported (void);
+private:
+  void (*m_notifySwitch)(void);
+};
+
+} // namespace ns3
+
+#endif /* ASM_FIBER_MANAGER_H */
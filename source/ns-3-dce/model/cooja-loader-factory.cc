@@ -3,6 +3,8 @@
 #include "elf-cache.h"
 #include "elf-dependencies.h"
 #include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
 #ifdef DCE_MPI
 #include "ns3/mpi-interface.h"
 #endif
@@ -15,7 +17,9 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <list>
+#include <vector>
 #include <errno.h>
 
 namespace {
@@ -29,6 +33,14 @@ struct SharedModule
   uint32_t id;
   uint32_t refcount;
   std::list<struct SharedModule *> deps;
+  // When the data is remapped rather than copied, the pages holding it,
+  // and the memfd with one slot of map_size bytes for each instance.
+  int memfd;
+  void *map_start;
+  uint32_t map_size;
+  uint32_t slots;
+  uint32_t current_slot;
+  std::vector<uint32_t> free_slots;
 };
 }
 
@@ -48,7 +60,7 @@ struct SharedModules
 class CoojaLoader : public Loader
 {
 public:
-  CoojaLoader ();
+  CoojaLoader (bool remapData, uint32_t remapThreshold);
 private:
   struct Module
   {
@@ -56,6 +68,7 @@ private:
     std::list<struct Module *> deps;
     uint32_t refcount;
     void *buffer;
+    uint32_t slot;
   };
 
   virtual ~CoojaLoader ();
@@ -73,10 +86,19 @@ private:
   struct CoojaLoader::Module * LoadModule (std::string filename, int flag,
                                            bool failsafe = false);
   void UnrefSharedModule (SharedModule *search);
+  void FreeModuleData (struct Module *module);
+
+  static void SetupRemap (struct SharedModule *module);
+  static uint32_t AllocateSlot (struct SharedModule *module, const void *data);
+  static void MapSlot (struct SharedModule *module, uint32_t slot);
 
   std::list<struct Module *> m_modules;
+  bool m_remapData;
+  uint32_t m_remapThreshold;
 };
 
+#define NO_SLOT 0xffffffff
+
 SharedModules::SharedModules ()
 #ifdef DCE_MPI
   : cache ("elf-cache", MpiInterface::GetSystemId ())
@@ -95,6 +117,10 @@ SharedModules::~SharedModules ()
       NS_LOG_DEBUG ("delete shared module " << module);
       free (module->template_buffer);
       dlclose (module->handle);
+      if (module->memfd != -1)
+        {
+          close (module->memfd);
+        }
       delete module;
     }
   modules.clear ();
@@ -107,12 +133,100 @@ CoojaLoader::Peek (void)
   return &modules;
 }
 
+#define ROUND_DOWN(addr, align) \
+  (((unsigned long)addr) - (((unsigned long)(addr)) % (align)))
+#define ROUND_UP(addr, align) \
+  ROUND_DOWN ((unsigned long)(addr) + (align) - 1, align)
+
+// The data of the library is mapped whole pages at a time.  Those
+// hold nothing else than the data segment, save for relro data ahead
+// of it, which is the same in all instances, and the unused tail of
+// the bss.  The template then is an image of all these pages.
+void
+CoojaLoader::SetupRemap (struct SharedModule *module)
+{
+  unsigned long pagesize = sysconf (_SC_PAGE_SIZE);
+  unsigned long start = ROUND_DOWN (module->data_buffer, pagesize);
+  unsigned long end = ROUND_UP ((unsigned long)module->data_buffer + module->buffer_size,
+                                pagesize);
+
+  module->memfd = -1;
+  module->slots = 0;
+  module->current_slot = NO_SLOT;
+  if (module->buffer_size == 0)
+    {
+      return;
+    }
+#ifdef SYS_memfd_create
+  module->memfd = syscall (SYS_memfd_create, "dce-cooja", 1 /* MFD_CLOEXEC */);
+#endif
+  if (module->memfd == -1)
+    {
+      NS_LOG_WARN ("memfd not available, copying data of module " << module->id);
+      return;
+    }
+  module->map_start = (void *)start;
+  module->map_size = end - start;
+  free (module->template_buffer);
+  module->template_buffer = malloc (module->map_size);
+  memcpy (module->template_buffer, module->map_start, module->map_size);
+}
+
+// A new slot for an instance, filled with a copy of data.
+uint32_t
+CoojaLoader::AllocateSlot (struct SharedModule *module, const void *data)
+{
+  uint32_t slot;
+  if (!module->free_slots.empty ())
+    {
+      slot = module->free_slots.back ();
+      module->free_slots.pop_back ();
+    }
+  else
+    {
+      slot = module->slots++;
+      if (ftruncate (module->memfd, (off_t)module->slots * module->map_size) == -1)
+        {
+          NS_FATAL_ERROR ("Could not grow memfd of module " << module->id << ": " << strerror (errno));
+        }
+    }
+  ssize_t written = pwrite (module->memfd, data, module->map_size,
+                            (off_t)slot * module->map_size);
+  if (written != (ssize_t)module->map_size)
+    {
+      NS_FATAL_ERROR ("Could not fill slot of module " << module->id << ": " << strerror (errno));
+    }
+  return slot;
+}
+
+void
+CoojaLoader::MapSlot (struct SharedModule *module, uint32_t slot)
+{
+  void *p = mmap (module->map_start, module->map_size,
+                  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                  module->memfd, (off_t)slot * module->map_size);
+  if (p == MAP_FAILED)
+    {
+      NS_FATAL_ERROR ("Could not map data of module " << module->id << ": " << strerror (errno));
+    }
+  module->current_slot = slot;
+}
+
 void
 CoojaLoader::NotifyStartExecute (void)
 {
   for (std::list<struct Module *>::const_iterator i = m_modules.begin (); i != m_modules.end (); ++i)
     {
       const struct Module *module = *i;
+      if (module->module->memfd != -1)
+        {
+          if (module->slot != module->module->current_slot)
+            {
+              // the data of the previous instance stays in its slot.
+              MapSlot (module->module, module->slot);
+            }
+          continue;
+        }
       if (module->buffer == module->module->current_buffer)
         {
           continue;
@@ -140,7 +254,7 @@ CoojaLoader::NotifyEndExecute (void)
 Loader *
 CoojaLoader::Clone (void)
 {
-  CoojaLoader *clone = new CoojaLoader ();
+  CoojaLoader *clone = new CoojaLoader (m_remapData, m_remapThreshold);
   for (std::list<struct Module *>::const_iterator i = m_modules.begin (); i != m_modules.end (); ++i)
     {
       struct Module *module = *i;
@@ -148,10 +262,20 @@ CoojaLoader::Clone (void)
       clonedModule->module = module->module;
       clonedModule->module->refcount++;
       clonedModule->refcount = module->refcount;
-      clonedModule->buffer = malloc (module->module->buffer_size);
-      memcpy (clonedModule->buffer,
-              module->module->data_buffer,
-              clonedModule->module->buffer_size);
+      if (module->module->memfd != -1)
+        {
+          clonedModule->buffer = 0;
+          clonedModule->slot = AllocateSlot (module->module,
+                                             module->module->map_start);
+        }
+      else
+        {
+          clonedModule->buffer = malloc (module->module->buffer_size);
+          memcpy (clonedModule->buffer,
+                  module->module->data_buffer,
+                  clonedModule->module->buffer_size);
+          clonedModule->slot = NO_SLOT;
+        }
       // setup deps.
       for (std::list<struct Module *>::iterator j = module->deps.begin ();
            j != module->deps.end (); ++j)
@@ -211,9 +335,6 @@ CoojaLoader::SearchSharedModule (uint32_t id)
   return 0;
 }
 
-#define ROUND_DOWN(addr, align) \
-  (((unsigned long)addr) - (((unsigned long)(addr)) % (align)))
-
 struct CoojaLoader::Module *
 CoojaLoader::LoadModule (std::string filename, int flag, bool failsafe)
 {
@@ -251,6 +372,11 @@ CoojaLoader::LoadModule (std::string filename, int flag, bool failsafe)
                   sharedModule->data_buffer,
                   sharedModule->buffer_size);
           sharedModule->current_buffer = 0;
+          sharedModule->memfd = -1;
+          if (m_remapData && sharedModule->buffer_size >= m_remapThreshold)
+            {
+              SetupRemap (sharedModule);
+            }
           for (std::vector<uint32_t>::const_iterator j = cached.deps.begin ();
                j != cached.deps.end (); ++j)
             {
@@ -269,20 +395,32 @@ CoojaLoader::LoadModule (std::string filename, int flag, bool failsafe)
           module->module = sharedModule;
           sharedModule->refcount++;
           module->refcount = 0;
-          module->buffer = malloc (sharedModule->buffer_size);
-          if (sharedModule->current_buffer != 0)
+          if (sharedModule->memfd != -1)
             {
-              // save the previous one
-              memcpy (module->module->current_buffer,
-                      module->module->data_buffer,
-                      module->module->buffer_size);
+              // start from the template in a slot of our own
+              module->buffer = 0;
+              module->slot = AllocateSlot (sharedModule,
+                                           sharedModule->template_buffer);
+              MapSlot (sharedModule, module->slot);
+            }
+          else
+            {
+              module->buffer = malloc (sharedModule->buffer_size);
+              module->slot = NO_SLOT;
+              if (sharedModule->current_buffer != 0)
+                {
+                  // save the previous one
+                  memcpy (module->module->current_buffer,
+                          module->module->data_buffer,
+                          module->module->buffer_size);
+                }
+              // make sure we re-initialize the data section with the template
+              memcpy (sharedModule->data_buffer,
+                      sharedModule->template_buffer,
+                      sharedModule->buffer_size);
+              // record current buffer to ensure that it is saved later
+              sharedModule->current_buffer = module->buffer;
             }
-          // make sure we re-initialize the data section with the template
-          memcpy (sharedModule->data_buffer,
-                  sharedModule->template_buffer,
-                  sharedModule->buffer_size);
-          // record current buffer to ensure that it is saved later
-          sharedModule->current_buffer = module->buffer;
           // setup deps.
           for (std::vector<uint32_t>::const_iterator j = cached.deps.begin ();
                j != cached.deps.end (); ++j)
@@ -320,6 +458,10 @@ CoojaLoader::UnrefSharedModule (SharedModule *search)
                 }
               dlclose (module->handle);
               free (module->template_buffer);
+              if (module->memfd != -1)
+                {
+                  close (module->memfd);
+                }
               delete module;
               ns->modules.erase (i);
             }
@@ -328,6 +470,25 @@ CoojaLoader::UnrefSharedModule (SharedModule *search)
     }
 }
 void
+CoojaLoader::FreeModuleData (struct Module *module)
+{
+  struct SharedModule *shared = module->module;
+  if (shared->memfd != -1)
+    {
+      if (shared->current_slot == module->slot)
+        {
+          shared->current_slot = NO_SLOT;
+        }
+      shared->free_slots.push_back (module->slot);
+      return;
+    }
+  if (shared->current_buffer == module->buffer)
+    {
+      shared->current_buffer = 0;
+    }
+  free (module->buffer);
+}
+void
 CoojaLoader::UnloadAll (void)
 {
   NS_LOG_FUNCTION (this);
@@ -335,12 +496,8 @@ CoojaLoader::UnloadAll (void)
     {
       struct Module *module = *i;
       NS_LOG_DEBUG ("Delete module " << module);
-      if (module->module->current_buffer == module->buffer)
-        {
-          module->module->current_buffer = 0;
-        }
+      FreeModuleData (module);
       UnrefSharedModule (module->module);
-      free (module->buffer);
       delete module;
     }
   m_modules.clear ();
@@ -366,12 +523,8 @@ CoojaLoader::Unload (void *handle)
                 }
               // close only after unloading the deps.
               NS_LOG_DEBUG ("Delete module for " << module->module->handle);
-              if (module->module->current_buffer == module->buffer)
-                {
-                  module->module->current_buffer = 0;
-                }
+              FreeModuleData (module);
               UnrefSharedModule (module->module);
-              free (module->buffer);
               delete module;
             }
           break;
@@ -390,9 +543,11 @@ CoojaLoader::Lookup (void *module, std::string symbol)
   return p;
 }
 
-CoojaLoader::CoojaLoader ()
+CoojaLoader::CoojaLoader (bool remapData, uint32_t remapThreshold)
+  : m_remapData (remapData),
+    m_remapThreshold (remapThreshold)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << remapData << remapThreshold);
 }
 
 CoojaLoader::~CoojaLoader ()
@@ -408,6 +563,17 @@ CoojaLoaderFactory::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::CoojaLoaderFactory")
     .SetParent<LoaderFactory> ()
     .AddConstructor<CoojaLoaderFactory> ()
+    .AddAttribute ("RemapData", "Map the data of each instance from a memfd "
+                   "instead of copying it in and out on every switch",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&CoojaLoaderFactory::m_remapData),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RemapThreshold", "Size of data under which a module is "
+                   "still copied with RemapData, as an mmap and the page "
+                   "faults that follow cost more than copying a few pages",
+                   UintegerValue (64 * 1024),
+                   MakeUintegerAccessor (&CoojaLoaderFactory::m_remapThreshold),
+                   MakeUintegerChecker<uint32_t> ())
   ;
   return tid;
 }
@@ -420,7 +586,7 @@ CoojaLoaderFactory::~CoojaLoaderFactory ()
 Loader *
 CoojaLoaderFactory::Create (int argc, char **argv, char **envp)
 {
-  CoojaLoader *loader = new CoojaLoader ();
+  CoojaLoader *loader = new CoojaLoader (m_remapData, m_remapThreshold);
   return loader;
 }
 
@@ -5,6 +5,15 @@
 
 namespace ns3 {
 
+/**
+ * Loads each library once and gives every process instance its own
+ * copy of the writable data of the library, swapped in whenever the
+ * instance runs.  By default the data is copied out and back in; with
+ * RemapData the pages of each instance are kept in a memfd instead and
+ * mapped over the data of the library, so that a switch costs an mmap
+ * per library whatever the size of its data.  Libraries with less data
+ * than RemapThreshold are still copied.
+ */
 class CoojaLoaderFactory : public LoaderFactory
 {
 public:
@@ -12,6 +21,9 @@ public:
   CoojaLoaderFactory ();
   virtual ~CoojaLoaderFactory ();
   virtual Loader * Create (int argc, char **argv, char **envp);
+private:
+  bool m_remapData;
+  uint32_t m_remapThreshold;
 };
 
 } // namespace ns3
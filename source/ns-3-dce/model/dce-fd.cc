@@ -31,6 +31,7 @@
 #include "file-usage.h"
 #include "dce-stdlib.h"
 #include "pipe-fd.h"
+#include "mem-file-system.h"
 
 NS_LOG_COMPONENT_DEFINE ("DceFd");
 
@@ -103,12 +104,23 @@ int dce_open (const char *path, int flags, ...)
       return -1;
     }
   UnixFd *unixFd = 0;
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (path));
 
   if ((std::string (path) == "/dev/random") || (std::string (path) == "/dev/urandom")
       || (std::string (path) == "/dev/srandom"))
     {
       unixFd = new UnixRandomFd (path);
     }
+  else if (fs != 0)
+    {
+      unixFd = fs->Open (UtilsGetVirtualFilePath (path), flags,
+                         mode & ~(current->process->uMask));
+      if (unixFd == 0)
+        {
+          current->err = errno;
+          return -1;
+        }
+    }
   else
     {
       std::string fullpath = UtilsGetRealFilePath (path);
@@ -165,6 +177,16 @@ void unlink_notify (std::string fullpath)
 int dce_unlink (const char *pathname)
 {
   NS_LOG_FUNCTION (pathname);
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (pathname));
+  if (fs != 0)
+    {
+      if (fs->Unlink (UtilsGetVirtualFilePath (pathname)) == -1)
+        {
+          Current ()->err = errno;
+          return -1;
+        }
+      return 0;
+    }
   int ret = dce_unlink_real (pathname);
 
   if (0 == ret)
@@ -181,12 +203,36 @@ int dce_mkdir (const char *pathname, mode_t mode)
   mode_t m =  (mode & ~(Current ()->process->uMask));
   DEFINE_FORWARDER_PATH (mkdir, pathname, m);
 }
+int dce_chmod (const char *pathname, mode_t mode)
+{
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (pathname));
+  if (fs != 0)
+    {
+      if (fs->Chmod (UtilsGetVirtualFilePath (pathname), mode) == -1)
+        {
+          Current ()->err = errno;
+          return -1;
+        }
+      return 0;
+    }
+  DEFINE_FORWARDER_PATH (chmod, pathname, mode);
+}
 int dce_rmdir (const char *pathname)
 {
   DEFINE_FORWARDER_PATH (rmdir, pathname);
 }
 int dce_access (const char *pathname, int mode)
 {
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (pathname));
+  if (fs != 0)
+    {
+      if (fs->Access (UtilsGetVirtualFilePath (pathname), mode) == -1)
+        {
+          Current ()->err = errno;
+          return -1;
+        }
+      return 0;
+    }
   DEFINE_FORWARDER_PATH (access, pathname, mode);
 }
 int dce_close (int fd)
@@ -696,11 +742,14 @@ int dce_truncate (const char *path, off_t length)
   int fd = dce_open (path, O_WRONLY, 0);
   if (fd == -1)
     {
-      current->err = errno;
       return -1;
     }
 
-  return dce_ftruncate (fd, length);
+  int retval = dce_ftruncate (fd, length);
+  int err = current->err;
+  dce_close (fd);
+  current->err = err;
+  return retval;
 }
 
 int dce_ftruncate (int fd, off_t length)
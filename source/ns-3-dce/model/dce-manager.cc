@@ -49,6 +49,9 @@
 #include "waiter.h"
 #include "dce-dirent.h"
 #include "exec-utils.h"
+#include "mem-file-system.h"
+#include "log-sink.h"
+#include "syscall-stats.h"
 
 #include <errno.h>
 #include <dlfcn.h>
@@ -60,6 +63,7 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <fstream>
 
 #define INITSTACKSIZE 0
 
@@ -81,6 +85,11 @@ DceManager::GetTypeId (void)
                      MakeTraceSourceAccessor (&DceManager::m_processExit),
                      "ns3::DceManager::ProcessExitTracedCallback"
                      )
+    .AddTraceSource ("SyscallStats", "A process has ended, with the dce_ functions it called, or the"
+                     " simulation, with those called by all the processes of the node, under pid 0.",
+                     MakeTraceSourceAccessor (&DceManager::m_syscallStatsTrace),
+                     "ns3::DceManager::SyscallStatsTracedCallback"
+                     )
     .AddAttribute ("FirstPid", "The PID used by default when creating a process in this manager.",
                    UintegerValue (1),
                    MakeUintegerAccessor (&DceManager::m_nextPid),
@@ -91,6 +100,32 @@ DceManager::GetTypeId (void)
                    BooleanValue (false),
                    MakeBooleanAccessor (&DceManager::m_minimizeFiles),
                    MakeBooleanChecker ())
+    .AddAttribute ("LogOutput", "How the stdout, stderr and syslog of the processes are written: Direct writes them"
+                   " to their files in the node directory as the processes write them, Batched writes them there"
+                   " from a thread of its own by large writes, and Binary writes them the same way to dce-logs.bin,"
+                   " as records tagged with the node, the pid and the simulated time.",
+                   EnumValue (LOG_DIRECT),
+                   MakeEnumAccessor (&DceManager::m_logOutput),
+                   MakeEnumChecker (LOG_DIRECT, "Direct",
+                                    LOG_BATCHED, "Batched",
+                                    LOG_BINARY, "Binary"))
+    .AddAttribute ("CopyOnWriteFork", "Keep the heap of the processes in a memfd, so that a child shares the"
+                   " pages of its parent until either writes to them, and a switch between them moves"
+                   " mappings rather than copying the heap. Each chunk of heap is then a mapping of its own,"
+                   " which counts against vm.max_map_count.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&DceManager::m_copyOnWriteFork),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SyscallStats", "Count the calls of each dce_ function by the processes, with a histogram"
+                   " of the cycles they took: None does not, Trace reports them to the SyscallStats trace"
+                   " source, and Csv and Json also write them to var/log/syscall-stats.csv or .json"
+                   " in the node directory at the end of the simulation.",
+                   EnumValue (SYSCALL_STATS_NONE),
+                   MakeEnumAccessor (&DceManager::m_syscallStatsOutput),
+                   MakeEnumChecker (SYSCALL_STATS_NONE, "None",
+                                    SYSCALL_STATS_TRACE, "Trace",
+                                    SYSCALL_STATS_CSV, "Csv",
+                                    SYSCALL_STATS_JSON, "Json"))
     .AddAttribute ("UnameStringRelease",
                    "release member of struct utsname returned by uname(2).",
                    StringValue ("3.2.3"),
@@ -106,6 +141,7 @@ DceManager::GetTypeId (void)
 }
 
 DceManager::DceManager ()
+  : m_syscallStats (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -129,6 +165,11 @@ DceManager::DoDispose (void)
       DeleteProcess (tmp, PEC_NS3_END);
     }
   mapCopy.clear ();
+  if (m_syscallStats != 0)
+    {
+      WriteSyscallStats ();
+    }
+  LogSink::Flush ();
   Object::DoDispose ();
 }
 
@@ -178,7 +219,16 @@ DceManager::CreatePidFile (struct Thread *current, std::string filename)
   EnsureDirectoryExists (current, oss.str ());
   oss << "/" << filename;
   std::string s = oss.str ();
-  int fd = dce_creat (s.c_str (), S_IWUSR | S_IRUSR);
+  int fd;
+  if (current->process->logOutput == LOG_DIRECT || (filename != "stdout" && filename != "stderr"))
+    {
+      fd = dce_creat (s.c_str (), S_IWUSR | S_IRUSR);
+    }
+  else
+    {
+      fd = LogSinkFd::Open (s, current->process->logOutput == LOG_BINARY ? LogSinkFd::BINARY : LogSinkFd::TEXT,
+                            filename == "stdout" ? LogSinkFd::STDOUT : LogSinkFd::STDERR);
+    }
   return fd;
 }
 int (*DceManager::PrepareDoStartProcess (Thread * current)) (int, char **, char **)
@@ -317,7 +367,7 @@ DceManager::CreateProcess (std::string name, std::string stdinfilename, std::vec
   process->egid = 0;
   process->rgid = 0;
   process->sgid = 0;
-  process->alloc = new KingsleyAlloc ();
+  process->alloc = new KingsleyAlloc (m_copyOnWriteFork);
   process->originalArgv = 0;
   process->originalArgc = 0;
   process->originalEnvp = 0;
@@ -373,6 +423,13 @@ DceManager::CreateProcess (std::string name, std::string stdinfilename, std::vec
   process->nodeId = UtilsGetNodeId ();
 
   process->minimizeFiles = (m_minimizeFiles ? 1 : 0);
+  process->logOutput = m_logOutput;
+  process->syscallStats = 0;
+  if (m_syscallStatsOutput != SYSCALL_STATS_NONE)
+    {
+      process->syscallStats = new SyscallStats ();
+      SyscallStats::Enable ();
+    }
 
   if (!pid)
     {
@@ -390,9 +447,17 @@ DceManager::TaskSwitch (enum Task::SwitchType type, void *context)
     case Task::TO:
       process->loader->NotifyStartExecute ();
       process->alloc->SwitchTo ();
+      if (process->syscallStats != 0)
+        {
+          SyscallStats::NotifySwitchTo (Current ());
+        }
       break;
     case Task::FROM:
       process->loader->NotifyEndExecute ();
+      if (process->syscallStats != 0)
+        {
+          SyscallStats::NotifySwitchFrom (Current ());
+        }
       break;
     }
 }
@@ -543,6 +608,8 @@ DceManager::CreateThread (struct Process *process)
   thread->childWaiter = 0;
   thread->pollTable = 0;
   thread->ioWait = std::make_pair ((UnixFd*)0,(WaitQueueEntry*)0);
+  thread->switchedOut = 0;
+  thread->suspended = 0;
   sigemptyset (&thread->signalMask);
   if (!process->threads.empty ())
     {
@@ -647,6 +714,12 @@ DceManager::Clone (Thread *thread)
   clone->pstdout = thread->process->pstdout;
   clone->pstderr = thread->process->pstderr;
   clone->penvp = thread->process->penvp;
+  clone->logOutput = thread->process->logOutput;
+  clone->syscallStats = 0;
+  if (thread->process->syscallStats != 0)
+    {
+      clone->syscallStats = new SyscallStats ();
+    }
 
   //"seeding" random variable
   clone->rndVariable = CreateObject<UniformRandomVariable> ();
@@ -920,6 +993,10 @@ DceManager::DeleteProcess (struct Process *process, ProcessEndCause type)
         }
       m_processExit (process->pid, process->timing.exitValue);
     }
+  if (process->syscallStats != 0)
+    {
+      EndSyscallStats (process);
+    }
   delete process->loader;
   process->loader = 0;
   if (type == PEC_EXIT)
@@ -953,6 +1030,79 @@ DceManager::DeleteProcess (struct Process *process, ProcessEndCause type)
 
 }
 
+void
+DceManager::EndSyscallStats (struct Process *process)
+{
+  m_syscallStatsTrace (process->pid, *process->syscallStats);
+  if (m_syscallStats == 0)
+    {
+      m_syscallStats = new SyscallStats ();
+    }
+  m_syscallStats->Add (*process->syscallStats);
+  std::ostringstream oss;
+  if (m_syscallStatsOutput == SYSCALL_STATS_CSV)
+    {
+      process->syscallStats->WriteCsv (oss, process->pid, process->name);
+    }
+  else if (m_syscallStatsOutput == SYSCALL_STATS_JSON)
+    {
+      oss << "    {\"pid\": " << process->pid << ", \"process\": ";
+      SyscallStats::WriteJsonString (oss, process->name);
+      oss << ", \"functions\": ";
+      process->syscallStats->WriteJson (oss);
+      oss << "}";
+    }
+  if (m_syscallStatsOutput != SYSCALL_STATS_TRACE)
+    {
+      m_syscallStatsDump.push_back (oss.str ());
+    }
+  delete process->syscallStats;
+  process->syscallStats = 0;
+}
+
+void
+DceManager::WriteSyscallStats (void)
+{
+  m_syscallStatsTrace (0, *m_syscallStats);
+  if (m_syscallStatsOutput == SYSCALL_STATS_CSV
+      || m_syscallStatsOutput == SYSCALL_STATS_JSON)
+    {
+      bool csv = m_syscallStatsOutput == SYSCALL_STATS_CSV;
+      Ptr<Node> node = GetObject<Node> ();
+      std::ostringstream oss;
+      oss << "files-" << (node != 0 ? node->GetId () : 0)
+          << "/var/log/syscall-stats." << (csv ? "csv" : "json");
+      std::string path = oss.str ();
+      UtilsEnsureAllDirectoriesExist (path);
+      std::ofstream file (path.c_str ());
+      if (csv)
+        {
+          // the processes, then their total under pid 0.
+          SyscallStats::WriteCsvHeader (file);
+          for (uint32_t i = 0; i < m_syscallStatsDump.size (); i++)
+            {
+              file << m_syscallStatsDump[i];
+            }
+          m_syscallStats->WriteCsv (file, 0, "");
+        }
+      else
+        {
+          file << "{\n  \"node\": " << (node != 0 ? node->GetId () : 0)
+               << ",\n  \"total\": ";
+          m_syscallStats->WriteJson (file);
+          file << ",\n  \"processes\": [";
+          for (uint32_t i = 0; i < m_syscallStatsDump.size (); i++)
+            {
+              file << (i == 0 ? "\n" : ",\n") << m_syscallStatsDump[i];
+            }
+          file << "\n  ]\n}\n";
+        }
+    }
+  m_syscallStatsDump.clear ();
+  delete m_syscallStats;
+  m_syscallStats = 0;
+}
+
 bool
 DceManager::CheckProcessContext (void) const
 {
@@ -1042,19 +1192,30 @@ void
 DceManager::AppendStatusFile (uint16_t pid, uint32_t nodeId,  std::string &line)
 {
   std::ostringstream oss;
-  oss << "files-" << nodeId << "/var/log/" << pid << "/status";
+  oss << "/var/log/" << pid << "/status";
+  std::string path = oss.str ();
+  oss.str ("");
+  oss.clear ();
+  oss << "      Time: " << GetTimeStamp () << " --> " << line << std::endl;
+  std::string wholeLine = oss.str ();
+  int l =  wholeLine.length ();
+  const char *str = wholeLine.c_str ();
+
+  Ptr<MemFileSystem> fs = MemFileSystem::GetFileSystem (nodeId);
+  if (fs != 0 && fs->Handles (path))
+    {
+      fs->Append (path, str, l);
+      return;
+    }
+  oss.str ("");
+  oss.clear ();
+  oss << "files-" << nodeId << path;
   std::string s = oss.str ();
 
   int fd = ::open (s.c_str (), O_WRONLY | O_APPEND, 0);
 
   if (fd >= 0) // XXX: When fork is used the pid directory is not created, I plan to fix it when I will work on fork/exec/wait...
     {
-      oss.str ("");
-      oss.clear ();
-      oss << "      Time: " << GetTimeStamp () << " --> " << line << std::endl;
-      std::string wholeLine = oss.str ();
-      int l =  wholeLine.length ();
-      const char *str = wholeLine.c_str ();
       ::write (fd, str, l);
       ::close (fd);
     }
@@ -1518,7 +1679,7 @@ DceManager::Execve (const char *path, const char *argv0, char *const argv[], cha
   Oldthreads.clear ();
   process->alloc->Dispose ();
   delete process->alloc;
-  process->alloc = new KingsleyAlloc ();
+  process->alloc = new KingsleyAlloc (m_copyOnWriteFork);
 
   while (!process->mutexes.empty ())
     {
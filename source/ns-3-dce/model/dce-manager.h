@@ -37,6 +37,7 @@ struct Process;
 struct Thread;
 struct SignalHandler;
 class Loader;
+class SyscallStats;
 
 
 /**
@@ -80,6 +81,29 @@ public:
     PEC_NS3_END, // NO MORE EVENTS
     PEC_NS3_STOP, // STOP AT PREDEFINED TIME
   } ProcessEndCause;
+  // How stdout, stderr and syslog of the processes are written.
+  typedef enum
+  {
+    LOG_DIRECT, // to their files, as the processes write them
+    LOG_BATCHED, // to their files, by the LogSink
+    LOG_BINARY, // to dce-logs.bin, by the LogSink
+  } LogOutput;
+  // Whether the dce_ functions called by the processes are counted,
+  // and where the counts go.
+  typedef enum
+  {
+    SYSCALL_STATS_NONE,
+    SYSCALL_STATS_TRACE, // to the SyscallStats trace source only
+    SYSCALL_STATS_CSV, // also to var/log/syscall-stats.csv of the node
+    SYSCALL_STATS_JSON, // also to var/log/syscall-stats.json of the node
+  } SyscallStatsOutput;
+
+  /**
+   * \param pid the pid of a process which ended, or 0 for the total
+   * of all the processes of the node, at the end of the simulation.
+   * \param stats what it called
+   */
+  typedef void (* SyscallStatsTracedCallback)(uint16_t pid, const SyscallStats &stats);
 
   static TypeId GetTypeId (void);
 
@@ -154,12 +178,22 @@ private:
   static void* LoadMain (Loader *ld, std::string filename, Process *proc, int &err);
   static void DoExecProcess (void *c);
   static void SetDefaultSigHandler (std::vector<SignalHandler> &signalHandlers);
+  void EndSyscallStats (struct Process *process);
+  void WriteSyscallStats (void);
 
   std::map<uint16_t, Process *> m_processes; // Key is the pid
   uint16_t m_nextPid;
   TracedCallback<uint16_t, int> m_processExit;
   // If true close stderr and stdout between writes .
   bool m_minimizeFiles;
+  LogOutput m_logOutput;
+  // If true the heap of a child is shared with its parent until written.
+  bool m_copyOnWriteFork;
+  SyscallStatsOutput m_syscallStatsOutput;
+  TracedCallback<uint16_t, const SyscallStats &> m_syscallStatsTrace;
+  // of all the processes which ended, and what is left to write.
+  SyscallStats *m_syscallStats;
+  std::vector<std::string> m_syscallStatsDump;
   std::string m_virtualPath;
   std::string m_release;  //!< Returned by `uname -r`
   std::string m_version;  //!< Returned by `uname -v`
@@ -7,6 +7,7 @@
 #include "ns3/assert.h"
 #include <errno.h>
 #include "file-usage.h"
+#include "mem-file-system.h"
 
 using namespace ns3;
 
@@ -22,7 +23,16 @@ int dce___xstat (int ver, const char *path, struct stat *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__xstat (ver, UtilsGetRealFilePath (path).c_str (), buf);
+  int retval;
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (path));
+  if (fs != 0)
+    {
+      retval = fs->Stat (UtilsGetVirtualFilePath (path), buf);
+    }
+  else
+    {
+      retval = ::__xstat (ver, UtilsGetRealFilePath (path).c_str (), buf);
+    }
   if (retval == -1)
     {
       current->err = errno;
@@ -40,7 +50,16 @@ int dce___xstat64 (int ver, const char *path, struct stat64 *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__xstat64 (ver, UtilsGetRealFilePath (path).c_str (), buf);
+  int retval;
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (path));
+  if (fs != 0)
+    {
+      retval = fs->Stat64 (UtilsGetVirtualFilePath (path), buf);
+    }
+  else
+    {
+      retval = ::__xstat64 (ver, UtilsGetRealFilePath (path).c_str (), buf);
+    }
   if (retval == -1)
     {
       current->err = errno;
@@ -74,7 +93,16 @@ int dce___lxstat (int ver, const char *pathname, struct stat *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__lxstat (ver, UtilsGetRealFilePath (pathname).c_str (), buf);
+  int retval;
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (pathname));
+  if (fs != 0)
+    {
+      retval = fs->Stat (UtilsGetVirtualFilePath (pathname), buf);
+    }
+  else
+    {
+      retval = ::__lxstat (ver, UtilsGetRealFilePath (pathname).c_str (), buf);
+    }
   if (retval == -1)
     {
       current->err = errno;
@@ -92,7 +120,16 @@ int dce___lxstat64 (int ver, const char *pathname, struct stat64 *buf)
       current->err = ENOENT;
       return -1;
     }
-  int retval = ::__lxstat64 (ver, UtilsGetRealFilePath (pathname).c_str (), buf);
+  int retval;
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (pathname));
+  if (fs != 0)
+    {
+      retval = fs->Stat64 (UtilsGetVirtualFilePath (pathname), buf);
+    }
+  else
+    {
+      retval = ::__lxstat64 (ver, UtilsGetRealFilePath (pathname).c_str (), buf);
+    }
   if (retval == -1)
     {
       current->err = errno;
@@ -7,6 +7,7 @@
 #include "process.h"
 #include "utils.h"
 #include "unix-fd.h"
+#include "mem-file-system.h"
 #include "ns3/log.h"
 #include <errno.h>
 #include <fcntl.h>
@@ -696,6 +697,16 @@ int dce_remove (const char *pathname)
       current->err = ENOENT;
       return -1;
     }
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (pathname));
+  if (fs != 0)
+    {
+      if (fs->Unlink (UtilsGetVirtualFilePath (pathname)) == -1)
+        {
+          current->err = errno;
+          return -1;
+        }
+      return 0;
+    }
   std::string fullpath = UtilsGetRealFilePath (pathname);
   int status = ::remove (fullpath.c_str ());
   if (status == -1)
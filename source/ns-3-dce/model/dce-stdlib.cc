@@ -5,9 +5,14 @@
 #include "unix-fd.h"
 #include "unix-file-fd.h"
 #include "file-usage.h"
+#include "mem-file-system.h"
+#include "dce-fcntl.h"
 #include "ns3/log.h"
 #include <errno.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
 
 
 NS_LOG_COMPONENT_DEFINE ("DceStdlib");
@@ -93,40 +98,37 @@ int dce_atexit (void (*function)(void))
  This suffix is then replaced with a string that makes the filename unique */
 int dce_mkstemp (char *temp)
 {
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  static uint32_t count = 0;
   Thread *current = Current ();
-  NS_LOG_FUNCTION (current << UtilsGetNodeId ());
+  NS_LOG_FUNCTION (current << UtilsGetNodeId () << temp);
   NS_ASSERT (current != 0);
 
-  std::string fullpath = UtilsGetRealFilePath (temp);
-  NS_LOG_FUNCTION (fullpath);
-
-  char* c_fullpath = new char[fullpath.length()+1];
-  fullpath.copy (c_fullpath, fullpath.length());
-  c_fullpath[fullpath.length()] = '\0';
-
-  int realFd = mkstemp (c_fullpath);
-  if (realFd == -1)
+  size_t length = strlen (temp);
+  if (length < 6 || strcmp (temp + length - 6, "XXXXXX") != 0)
     {
-      current->err = errno;
-      delete c_fullpath;
+      current->err = EINVAL;
       return -1;
     }
-
-  int fd = UtilsAllocateFd ();
-  if (fd == -1)
+  // opened as any other file, in the MemFileSystem of the node if it
+  // has one; the names do not depend on the random() of the process.
+  for (int attempt = 0; attempt < 100; attempt++)
     {
-      current->err = EMFILE;
-      delete c_fullpath;
-      return -1;
+      uint64_t value = ((uint64_t)UtilsGetNodeId () << 40)
+        ^ ((uint64_t)current->process->pid << 20) ^ count++;
+      for (size_t i = length - 6; i < length; i++)
+        {
+          temp[i] = letters[value % 62];
+          value /= 62;
+        }
+      int fd = dce_open (temp, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+      if (fd != -1 || current->err != EEXIST)
+        {
+          return fd;
+        }
     }
-  UnixFd *unixFd = 0;
-  unixFd = new UnixFileFd (realFd);
-  unixFd->IncFdCount ();
-  current->process->openFiles[fd] = new FileUsage (fd, unixFd);
-
-  strncpy (temp, &c_fullpath[strlen(c_fullpath)-strlen(temp)], strlen(temp));
-  delete c_fullpath;
-  return fd;
+  current->err = EEXIST;
+  return -1;
 }
 
 FILE * dce_tmpfile (void)
@@ -142,6 +144,17 @@ int dce_rename (const char *oldpath, const char *newpath)
   NS_LOG_FUNCTION (current << UtilsGetNodeId ());
   NS_ASSERT (current != 0);
 
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (oldpath));
+  if (fs != 0)
+    {
+      if (fs->Rename (UtilsGetVirtualFilePath (oldpath), UtilsGetVirtualFilePath (newpath)) == -1)
+        {
+          current->err = errno;
+          return -1;
+        }
+      return 0;
+    }
+
   std::string oldFullpath = UtilsGetRealFilePath (oldpath);
   std::string newFullpath = UtilsGetRealFilePath (newpath);
 
@@ -6,6 +6,7 @@
 #include <ns3/simulator.h>
 
 #include "dce-manager.h"
+#include "log-sink.h"
 #include "process.h"
 #include "utils.h"
 
@@ -24,7 +25,16 @@ dce_openlog (const char *ident, int logopt, int facility)
 
   std::ostringstream os; // form the syslog filename
   os << "/var/log/" << process->pid << "/syslog";
-  process->syslog = dce_fopen (os.str ().c_str (), "w");
+  if (process->logOutput == DceManager::LOG_DIRECT)
+    {
+      process->syslog = dce_fopen (os.str ().c_str (), "w");
+    }
+  else
+    {
+      int fd = LogSinkFd::Open (os.str (), process->logOutput == DceManager::LOG_BINARY ?
+                                LogSinkFd::BINARY : LogSinkFd::TEXT, LogSinkFd::SYSLOG);
+      process->syslog = (fd == -1) ? 0 : dce_fdopen (fd, "w");
+    }
   NS_ASSERT_MSG (process->syslog != 0, "Cannot open " << os.str () << " file to output all syslog messages");
 }
 
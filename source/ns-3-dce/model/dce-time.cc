@@ -9,6 +9,7 @@
 #include "sys/dce-timerfd.h"
 #include "unix-timer-fd.h"
 #include "file-usage.h"
+#include "mem-file-system.h"
 
 NS_LOG_COMPONENT_DEFINE ("DceTime");
 
@@ -110,9 +111,28 @@ int dce_utime (const char *filename, const struct utimbuf *times)
   NS_LOG_FUNCTION (Current () << UtilsGetNodeId ());
   NS_ASSERT (Current () != 0);
 
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (filename));
+  if (fs != 0)
+    {
+      struct timespec mtime;
+      mtime.tv_sec = times != 0 ? times->modtime : 0;
+      mtime.tv_nsec = 0;
+      if (fs->Utime (UtilsGetVirtualFilePath (filename), times != 0 ? &mtime : 0) == -1)
+        {
+          Current ()->err = errno;
+          return -1;
+        }
+      return 0;
+    }
+
   std::string fullpath = UtilsGetRealFilePath (filename);
 
-  return utime (fullpath.c_str (), times);
+  int retval = utime (fullpath.c_str (), times);
+  if (retval == -1)
+    {
+      Current ()->err = errno;
+    }
+  return retval;
 }
 
 
@@ -32,6 +32,7 @@
 #include "ns3/names.h"
 #include "ns3/ipv4-l3-protocol.h"
 #include "socket-fd-factory.h"
+#include "mem-file-system.h"
 
 NS_LOG_COMPONENT_DEFINE ("Dce");
 
@@ -978,6 +979,14 @@ ssize_t dce_readlink (const char *path, char *buf, size_t bufsize)
   NS_LOG_FUNCTION (current << UtilsGetNodeId ());
   NS_ASSERT (current != 0);
 
+  Ptr<MemFileSystem> fs = MemFileSystem::Find (UtilsGetVirtualFilePath (path));
+  if (fs != 0)
+    {
+      fs->Readlink (UtilsGetVirtualFilePath (path));
+      current->err = errno;
+      return -1;
+    }
+
   std::string fullpath = UtilsGetRealFilePath (path);
 
   ssize_t ret = readlink (fullpath.c_str (), buf, bufsize);
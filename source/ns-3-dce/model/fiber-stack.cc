@@ -0,0 +1,375 @@
+#include "fiber-stack.h"
+#include "ns3/fatal-error.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DceFiberStack");
+
+// stacks kept in the free list of a size class, beyond which they
+// are unmapped.
+#define FIBER_STACK_POOL_MAX 1024
+#define GUARD_TABLE_MIN 64
+
+void *FiberStack::g_alternateSignalStack = 0;
+uint32_t FiberStack::g_pageSize = 0;
+struct FiberStack::GuardTable FiberStack::g_guardPages;
+struct FiberStack::SizeClass FiberStack::g_classes[32];
+
+void
+FiberStack::SegfaultHandler (int sig, siginfo_t *si, void *unused)
+{
+  unsigned long page = (unsigned long) si->si_addr;
+  page = page - (page % g_pageSize);
+  if (IsGuard (page))
+    {
+      // This is a stack overflow: all we can do is print some error message
+      char message[] = "Stack overflow !";
+      write (2, message, strlen (message));
+    }
+}
+
+void
+FiberStack::FreeAlternateSignalStack (void)
+{
+  free (g_alternateSignalStack);
+}
+
+void
+FiberStack::SetupSignalHandler (void)
+{
+  static bool alreadySetup = false;
+  if (alreadySetup)
+    {
+      return;
+    }
+  alreadySetup = true;
+
+  stack_t ss;
+
+  /**
+   * We _need_ to setup an alternate signal stack because the kernel will
+   * refuse to deliver a SIGSEGV signal to our process while it is on
+   * the stack which triggered this same error. This kind of makes sense
+   * so, we cannot blame the kernel for this.
+   */
+  ss.ss_sp = malloc (SIGSTKSZ);
+  ss.ss_size = SIGSTKSZ;
+  ss.ss_flags = 0;
+  int status = sigaltstack (&ss, NULL);
+  if (status == -1)
+    {
+      NS_FATAL_ERROR ("Unable to setup an alternate signal stack handler, errno="
+                      << strerror (errno));
+    }
+  g_alternateSignalStack = ss.ss_sp;
+
+  atexit (&FreeAlternateSignalStack);
+
+  struct sigaction sa;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_sigaction = &FiberStack::SegfaultHandler;
+  status = sigaction (SIGSEGV, &sa, NULL);
+  if (status == -1)
+    {
+      NS_FATAL_ERROR ("Unable to setup page fault handler, errno="
+                      << strerror (errno));
+    }
+}
+
+
+uint32_t
+FiberStack::GetPageSize (void)
+{
+  if (g_pageSize == 0)
+    {
+      long pagesize = sysconf (_SC_PAGE_SIZE);
+      if (pagesize == -1)
+        {
+          NS_FATAL_ERROR ("Unable to query page size");
+        }
+      g_pageSize = pagesize;
+    }
+  return g_pageSize;
+}
+
+static inline uint32_t
+GuardHash (unsigned long page, uint32_t pagesize, uint32_t size)
+{
+  return ((page / pagesize) * 2654435761UL) & (size - 1);
+}
+
+bool
+FiberStack::IsGuard (unsigned long page)
+{
+  if (g_guardPages.size == 0)
+    {
+      return false;
+    }
+  uint32_t mask = g_guardPages.size - 1;
+  for (uint32_t i = GuardHash (page, g_pageSize, g_guardPages.size);
+       g_guardPages.slots[i] != 0; i = (i + 1) & mask)
+    {
+      if (g_guardPages.slots[i] == page)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+FiberStack::AddGuard (unsigned long page)
+{
+  if ((g_guardPages.used + 1) * 2 > g_guardPages.size)
+    {
+      // Grow to twice the size and put back what was there: the table
+      // in use is only replaced once the new one is complete.
+      uint32_t size = g_guardPages.size ? g_guardPages.size * 2 : GUARD_TABLE_MIN;
+      unsigned long *slots = new unsigned long [size]();
+      for (uint32_t j = 0; j < g_guardPages.size; j++)
+        {
+          unsigned long old = g_guardPages.slots[j];
+          if (old == 0)
+            {
+              continue;
+            }
+          uint32_t i = GuardHash (old, g_pageSize, size);
+          while (slots[i] != 0)
+            {
+              i = (i + 1) & (size - 1);
+            }
+          slots[i] = old;
+        }
+      unsigned long *old = g_guardPages.slots;
+      g_guardPages.slots = slots;
+      g_guardPages.size = size;
+      delete [] old;
+    }
+  uint32_t mask = g_guardPages.size - 1;
+  uint32_t i = GuardHash (page, g_pageSize, g_guardPages.size);
+  while (g_guardPages.slots[i] != 0)
+    {
+      i = (i + 1) & mask;
+    }
+  g_guardPages.slots[i] = page;
+  g_guardPages.used++;
+}
+
+void
+FiberStack::RemoveGuard (unsigned long page)
+{
+  uint32_t mask = g_guardPages.size - 1;
+  uint32_t i = GuardHash (page, g_pageSize, g_guardPages.size);
+  while (g_guardPages.slots[i] != page)
+    {
+      NS_ASSERT (g_guardPages.slots[i] != 0);
+      i = (i + 1) & mask;
+    }
+  g_guardPages.slots[i] = 0;
+  g_guardPages.used--;
+  // Move back the entries after it which would no longer be found,
+  // rather than leaving a tombstone.
+  for (uint32_t j = (i + 1) & mask; g_guardPages.slots[j] != 0; j = (j + 1) & mask)
+    {
+      uint32_t k = GuardHash (g_guardPages.slots[j], g_pageSize, g_guardPages.size);
+      bool reachable = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+      if (!reachable)
+        {
+          g_guardPages.slots[i] = g_guardPages.slots[j];
+          g_guardPages.slots[j] = 0;
+          i = j;
+        }
+    }
+}
+
+uint32_t
+FiberStack::GetClass (uint32_t size)
+{
+  uint32_t pages = (size + g_pageSize - 1) / g_pageSize;
+  uint32_t c = 0;
+  while ((1U << c) < pages)
+    {
+      c++;
+    }
+  return c;
+}
+
+uint32_t
+FiberStack::MeasureUsed (uint8_t *stack, uint32_t size)
+{
+  // Stacks grow down, so the lowest page the fiber touched tells how
+  // deep it went: the pages below it were never faulted in.
+  static std::vector<unsigned char> resident;
+  uint32_t pages = size / g_pageSize;
+  resident.resize (pages);
+  if (mincore (stack, size, &resident[0]) == -1)
+    {
+      return 0;
+    }
+  for (uint32_t i = 0; i < pages; i++)
+    {
+      if (resident[i] & 1)
+        {
+          return size - i * g_pageSize;
+        }
+    }
+  return 0;
+}
+
+uint8_t *
+FiberStack::GetSlackGuard (uint8_t *stack, uint32_t classSize, uint32_t size)
+{
+  uint32_t slackPages = (classSize - size) / g_pageSize;
+  if (slackPages == 0)
+    {
+      // the guard page of the mapping is right below.
+      return 0;
+    }
+  return stack + (slackPages - 1) * g_pageSize;
+}
+
+uint8_t *
+FiberStack::Allocate (uint32_t size)
+{
+  uint32_t pagesize = GetPageSize ();
+
+  SetupSignalHandler ();
+
+  uint32_t c = GetClass (size);
+  uint32_t classSize = pagesize << c;
+  struct SizeClass *sc = &g_classes[c];
+  uint8_t *stack;
+  if (!sc->free.empty ())
+    {
+      stack = sc->free.back ();
+      sc->free.pop_back ();
+      sc->reused++;
+    }
+  else
+    {
+      uint32_t realSize = classSize + 2 * pagesize;
+      // The stack is only given pages as the fiber touches them: do not
+      // account for all of it up front either.
+      void *map = mmap (0, realSize, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (map == MAP_FAILED)
+        {
+          NS_FATAL_ERROR ("Unable to allocate stack pages: size=" << size <<
+                          ", alloced=" << realSize <<
+                          ", errno=" << strerror (errno));
+        }
+      stack = (uint8_t *)map + pagesize;
+      int status = mprotect (stack, classSize, PROT_READ | PROT_WRITE);
+      if (status == -1)
+        {
+          NS_FATAL_ERROR ("Unable to protect bottom of stack space, errno=" << strerror (errno));
+        }
+      AddGuard ((unsigned long)(stack - pagesize));
+    }
+  sc->allocated++;
+  sc->live++;
+  if (sc->live > sc->peakLive)
+    {
+      sc->peakLive = sc->live;
+    }
+  // The caller's stack ends where the size class does. Below it, the
+  // slack of the class is cut by a guard page of its own, so that
+  // overflowing it faults as overflowing a stack of the full class would.
+  uint8_t *guard = GetSlackGuard (stack, classSize, size);
+  if (guard != 0)
+    {
+      if (mprotect (guard, pagesize, PROT_NONE) == -1)
+        {
+          NS_FATAL_ERROR ("Unable to protect bottom of stack space, errno=" << strerror (errno));
+        }
+      AddGuard ((unsigned long)guard);
+    }
+  return stack + classSize - size;
+}
+
+void
+FiberStack::Deallocate (uint8_t *buffer, uint32_t stackSize)
+{
+  uint32_t pagesize = GetPageSize ();
+  uint32_t c = GetClass (stackSize);
+  uint32_t classSize = pagesize << c;
+  struct SizeClass *sc = &g_classes[c];
+  uint8_t *stack = buffer + stackSize - classSize;
+
+  uint8_t *guard = GetSlackGuard (stack, classSize, stackSize);
+  if (guard != 0)
+    {
+      RemoveGuard ((unsigned long)guard);
+      if (mprotect (guard, pagesize, PROT_READ | PROT_WRITE) == -1)
+        {
+          NS_FATAL_ERROR ("Unable to unprotect stack space, errno=" << strerror (errno));
+        }
+    }
+  uint32_t used = MeasureUsed (stack, classSize);
+  if (used > sc->highWater)
+    {
+      sc->highWater = used;
+      NS_LOG_INFO ("stacks of " << classSize << " bytes used up to " << used << " bytes");
+    }
+  sc->live--;
+
+  if (sc->free.size () < FIBER_STACK_POOL_MAX)
+    {
+      // The pages are only taken back when memory runs short, and not
+      // faulted in again if still there when the stack is used again.
+#ifdef MADV_FREE
+      static int advice = MADV_FREE;
+#else
+      static int advice = MADV_DONTNEED;
+#endif
+      int status = madvise (stack, classSize, advice);
+      if (status == -1 && errno == EINVAL && advice != MADV_DONTNEED)
+        {
+          // before linux 4.5
+          advice = MADV_DONTNEED;
+          status = madvise (stack, classSize, advice);
+        }
+      if (status == -1)
+        {
+          NS_FATAL_ERROR ("Unable to release stack pages, errno=" << strerror (errno));
+        }
+      sc->free.push_back (stack);
+      return;
+    }
+
+  int status = munmap (stack - pagesize, classSize + 2 * pagesize);
+  if (status == -1)
+    {
+      NS_FATAL_ERROR ("Unable to unmap stack, errno=" << strerror (errno));
+    }
+  RemoveGuard ((unsigned long)(stack - pagesize));
+}
+
+void
+FiberStack::PrintStatistics (std::ostream &os)
+{
+  for (uint32_t c = 0; c < 32; c++)
+    {
+      struct SizeClass *sc = &g_classes[c];
+      if (sc->allocated == 0)
+        {
+          continue;
+        }
+      os << "stacks of " << ((uint64_t)GetPageSize () << c) << " bytes: "
+         << sc->allocated << " allocated, "
+         << sc->reused << " from the pool, "
+         << sc->peakLive << " in use at most, "
+         << sc->highWater << " bytes used at most" << std::endl;
+    }
+}
+
+} // namespace ns3
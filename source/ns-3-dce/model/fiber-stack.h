@@ -0,0 +1,81 @@
+#ifndef FIBER_STACK_H
+#define FIBER_STACK_H
+
+#include <stdint.h>
+#include <signal.h>
+#include <vector>
+#include <ostream>
+
+namespace ns3 {
+
+/**
+ * Stacks of the fibers which run on stacks of their own, with a
+ * guard page on either side: overflowing the stack faults on the
+ * guard page, and a message is printed from the fault handler.
+ *
+ * Stacks come in size classes of a power of two pages. A stack
+ * smaller than its class is handed out at the top of it, with a guard
+ * page right below it in the class as well. A stack given
+ * back is kept in the free list of its class, its pages handed back
+ * to the kernel with MADV_FREE, and used again for the next fiber of
+ * that class. Mappings are made with MAP_NORESERVE, so a stack only
+ * takes memory for the pages its fiber touches. How deep the fibers
+ * of each class went is measured when their stacks come back, and
+ * can be printed with PrintStatistics.
+ */
+class FiberStack
+{
+public:
+  /**
+   * \param stackSize usable size of the stack
+   * \returns the lowest usable address of the stack
+   */
+  static uint8_t * Allocate (uint32_t stackSize);
+  static void Deallocate (uint8_t *stack, uint32_t stackSize);
+  /**
+   * Print, for each size class used, the number of stacks handed out
+   * and taken from the pool, the most in use at once and the deepest
+   * any of them was used.
+   */
+  static void PrintStatistics (std::ostream &os);
+private:
+  struct SizeClass
+  {
+    std::vector<uint8_t *> free;
+    uint32_t live;
+    uint32_t peakLive;
+    uint64_t allocated;
+    uint64_t reused;
+    uint32_t highWater;
+  };
+  // open addressing, so that the fault handler looks it up without locks
+  // or allocations.
+  struct GuardTable
+  {
+    unsigned long *slots;
+    uint32_t size;
+    uint32_t used;
+  };
+
+  static void SegfaultHandler (int sig, siginfo_t *si, void *unused);
+  // invoked as atexit handler
+  static void FreeAlternateSignalStack (void);
+  static void SetupSignalHandler (void);
+  static uint32_t GetPageSize (void);
+  static uint32_t GetClass (uint32_t size);
+  static uint32_t MeasureUsed (uint8_t *stack, uint32_t size);
+  // the page protected below a stack of size in its class, or 0
+  static uint8_t * GetSlackGuard (uint8_t *stack, uint32_t classSize, uint32_t size);
+  static void AddGuard (unsigned long page);
+  static void RemoveGuard (unsigned long page);
+  static bool IsGuard (unsigned long page);
+
+  static void *g_alternateSignalStack;
+  static uint32_t g_pageSize;
+  static struct GuardTable g_guardPages;
+  static struct SizeClass g_classes[32];
+};
+
+} // namespace ns3
+
+#endif /* FIBER_STACK_H */
@@ -89,7 +89,10 @@ KernelSocketFdFactory::KernelSocketFdFactory ()
   : m_loader (0),
     m_exported (0),
     m_alloc (new KingsleyAlloc ()),
-    m_logFile (0)
+    m_logFile (0),
+    m_worker (0),
+    m_workerIdle (false),
+    m_workerBusy (false)
 {
   TypeId::LookupByNameFailSafe ("ns3::LteUeNetDevice", &m_lteUeTid);
   m_variable = CreateObject<UniformRandomVariable> ();
@@ -124,6 +127,13 @@ KernelSocketFdFactory::DoDispose (void)
       m_manager->Stop (*i);
     }
   m_kernelTasks.clear ();
+  m_worker = 0;
+  m_workerBusy = false;
+  for (std::deque<EventImpl *>::const_iterator i = m_events.begin (); i != m_events.end (); ++i)
+    {
+      (*i)->Unref ();
+    }
+  m_events.clear ();
   m_manager = 0;
   m_listeners.clear ();
 }
@@ -345,8 +355,10 @@ KernelSocketFdFactory::TaskCurrent (struct SimKernel *kernel)
 void
 KernelSocketFdFactory::TaskWait (struct SimKernel *kernel)
 {
+  KernelSocketFdFactory *self = (KernelSocketFdFactory *)kernel;
   // force initialization of 'current'
   TaskCurrent (kernel);
+  self->DetachWorker ();
   // now, sleep.
   TaskManager::Current ()->Sleep ();
 }
@@ -367,8 +379,10 @@ KernelSocketFdFactory::TaskWakeup (struct SimKernel *kernel, struct SimTask *tas
 void
 KernelSocketFdFactory::TaskYield (struct SimKernel *kernel)
 {
+  KernelSocketFdFactory *self = (KernelSocketFdFactory *)kernel;
   // force initialization of 'current'
   TaskCurrent (kernel);
+  self->DetachWorker ();
   // now, yield.
   TaskManager::Current ()->Yield ();
 }
@@ -479,26 +493,77 @@ KernelSocketFdFactory::NotifyDeviceStateChangeTask (Ptr<NetDevice> device)
 }
 
 void
-KernelSocketFdFactory::ScheduleTaskTrampoline (void *context)
+KernelSocketFdFactory::WorkerTrampoline (void *context)
 {
+  KernelSocketFdFactory *self = (KernelSocketFdFactory *)context;
   Task *current = TaskManager::Current ()->CurrentTask ();
-  KernelSocketFdFactory *self = (KernelSocketFdFactory *) current->GetExtraContext ();
-  current->SetExtraContext (0);
-  EventImpl *event = (EventImpl *)context;
-  event->Invoke ();
-  event->Unref ();
+  while (self->m_worker == current)
+    {
+      NS_ASSERT_MSG (!self->m_workerBusy, "worker " << current << " has an event in flight");
+      if (self->m_events.empty ())
+        {
+          self->m_workerIdle = true;
+          TaskManager::Current ()->Sleep ();
+          continue;
+        }
+      EventImpl *event = self->m_events.front ();
+      self->m_events.pop_front ();
+      self->m_workerBusy = true;
+      event->Invoke ();
+      event->Unref ();
+      if (self->m_worker == current)
+        {
+          self->m_workerBusy = false;
+        }
+    }
+  // The last event blocked in the kernel and was left this task:
+  // another worker has taken over the events queued behind it.
   self->m_kernelTasks.remove (current);
   TaskManager::Current ()->Exit ();
 }
 
+void
+KernelSocketFdFactory::StartWorker (void)
+{
+  m_worker = m_manager->Start (&KernelSocketFdFactory::WorkerTrampoline,
+                               this, 1 << 17);
+  m_worker->SetSwitchNotifier (&KernelSocketFdFactory::TaskSwitch, m_loader);
+  m_workerIdle = false;
+  m_workerBusy = false;
+  m_kernelTasks.push_back (m_worker);
+}
+
+void
+KernelSocketFdFactory::DetachWorker (void)
+{
+  if (m_worker == 0 || TaskManager::Current ()->CurrentTask () != m_worker)
+    {
+      return;
+    }
+  NS_LOG_DEBUG ("event blocks in worker " << m_worker);
+  NS_ASSERT (m_workerBusy);
+  m_worker = 0;
+  m_workerBusy = false;
+  if (!m_events.empty ())
+    {
+      StartWorker ();
+    }
+}
+
 void
 KernelSocketFdFactory::ScheduleTask (EventImpl *event)
 {
-  Task *task = m_manager->Start (&KernelSocketFdFactory::ScheduleTaskTrampoline,
-                                 event, 1 << 17);
-  task->SetExtraContext (this);
-  task->SetSwitchNotifier (&KernelSocketFdFactory::TaskSwitch, m_loader);
-  m_kernelTasks.push_back (task);
+  m_events.push_back (event);
+  if (m_worker == 0)
+    {
+      StartWorker ();
+    }
+  else if (m_workerIdle)
+    {
+      NS_ASSERT (!m_workerBusy);
+      m_workerIdle = false;
+      m_manager->Wakeup (m_worker);
+    }
 }
 
 void
@@ -7,6 +7,7 @@
 #include "ns3/random-variable-stream.h"
 #include <sys/socket.h>
 #include <vector>
+#include <deque>
 #include <string>
 #include <utility>
 #include <stdarg.h>
@@ -43,6 +44,12 @@ public:
 
   virtual UnixFd * CreateSocket (int domain, int type, int protocol);
 
+  /**
+   * Run the event in a task of the kernel. Events are run one after
+   * the other by a worker task kept for this: an event which blocks in
+   * the kernel keeps the worker task to itself, and a new worker is
+   * started for the events after it.
+   */
   void ScheduleTask (EventImpl *event);
   std::string m_library;
 
@@ -56,6 +63,7 @@ protected:
 private:
   friend class KernelSocketFd;
   friend class KernelDeviceStateListener;
+  friend class KernelWorkerTestCase;
   struct EventIdHolder : public SimpleRefCount<EventIdHolder>
   {
     EventId id;
@@ -134,7 +142,9 @@ private:
 
   void DoSet (std::string path, std::string value);
   static void TaskSwitch (enum Task::SwitchType type, void *context);
-  static void ScheduleTaskTrampoline (void *context);
+  static void WorkerTrampoline (void *context);
+  void StartWorker (void);
+  void DetachWorker (void);
   void EventTrampoline (void (*fn)(void *context),
                         void *context, void (*pre_fn)(void),
                         Ptr<EventIdHolder> event);
@@ -142,6 +152,16 @@ private:
 
   std::vector<std::pair<Ptr<NetDevice>,struct SimDevice *> > m_devices;
   std::list<Task *> m_kernelTasks;
+  std::deque<EventImpl *> m_events;
+  // The worker runs one event at a time, to its end or until it
+  // blocks, at which point the worker task is the event's and no
+  // longer m_worker: the SimTask the kernel creates as current for a
+  // task is only ever that of one event in flight, and is reused by
+  // the next event as a kernel thread reuses its task between work
+  // items. m_workerBusy tracks the event in flight on m_worker.
+  Task *m_worker;
+  bool m_workerIdle;
+  bool m_workerBusy;
   Ptr<UniformRandomVariable> m_variable;
   KingsleyAlloc *m_alloc;
   std::vector<Ptr<KernelDeviceStateListener> > m_listeners;
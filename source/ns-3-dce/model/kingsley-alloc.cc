@@ -1,7 +1,13 @@
 #include "kingsley-alloc.h"
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <map>
+#include <vector>
 #include "ns3/assert.h"
 #include "ns3/log.h"
 
@@ -25,11 +31,23 @@ NS_LOG_COMPONENT_DEFINE ("DceKingsleyAlloc");
 # define MARK_UNDEFINED(buffer, size)
 #endif
 
+#define ROUND_UP(size, align) \
+  ((((size) + (align) - 1) / (align)) * (align))
 
-KingsleyAlloc::KingsleyAlloc ()
-  : m_defaultMmapSize (1 << 15)
+// The pages of the heaps of all processes which can be cloned, and
+// the ranges of it which are free, by size.
+static int g_memfd = -1;
+static uint64_t g_memfdSize = 0;
+static std::multimap<uint32_t, uint64_t> g_freeRanges;
+
+KingsleyAlloc::KingsleyAlloc (bool copyOnWrite)
+  : m_defaultMmapSize (1 << 15),
+    // mapping a chunk costs a few system calls whatever its size, and
+    // its pages are only allocated once touched.
+    m_brkMmapSize (copyOnWrite ? (1 << 20) : (1 << 15)),
+    m_copyOnWrite (copyOnWrite)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << copyOnWrite);
   memset (m_buckets, 0, sizeof(m_buckets));
 }
 KingsleyAlloc::~KingsleyAlloc ()
@@ -39,31 +57,52 @@ KingsleyAlloc::~KingsleyAlloc ()
   for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
        i != m_chunks.end (); ++i)
     {
-      if (i->copy)
+      ReleaseChunk (&*i);
+    }
+  m_chunks.clear ();
+}
+void
+KingsleyAlloc::ReleaseChunk (struct MmapChunk *chunk)
+{
+  NS_LOG_FUNCTION (this << chunk);
+  if (chunk->range)
+    {
+      if (chunk->mmap->owner == chunk)
         {
-          // ok, this means that _our_ buffer is not the
-          // original mmap buffer which means that we were
-          // cloned once so, we need to free our local
-          // buffer.
-          free (i->copy);
-
-          if (i->copy == i->mmap->current)
-            {
-              // Current must be nullify because we the next switch of context do not need to save our heap.
-              i->mmap->current = 0;
-            }
-          i->copy = 0;
+          // our pages stay at buffer until another clone maps its own.
+          chunk->mmap->owner = 0;
         }
-      i->mmap->refcount--;
-      if (i->mmap->refcount == 0)
+      if (chunk->parked)
         {
-          // we are the last to release this chunk.
-          // so, release the mmaped data.
-          MmapFree (i->mmap->buffer, i->mmap->size);
-          delete i->mmap;
+          ::munmap (chunk->parked, chunk->range->size);
+          chunk->parked = 0;
         }
+      UnrefRange (chunk->range);
+      chunk->range = 0;
+    }
+  if (chunk->copy)
+    {
+      // ok, this means that _our_ buffer is not the
+      // original mmap buffer which means that we were
+      // cloned once so, we need to free our local
+      // buffer.
+      free (chunk->copy);
+
+      if (chunk->copy == chunk->mmap->current)
+        {
+          // Current must be nullify because we the next switch of context do not need to save our heap.
+          chunk->mmap->current = 0;
+        }
+      chunk->copy = 0;
+    }
+  chunk->mmap->refcount--;
+  if (chunk->mmap->refcount == 0)
+    {
+      // we are the last to release this chunk.
+      // so, release the mmaped data.
+      MmapFree (chunk->mmap->buffer, chunk->mmap->size);
+      delete chunk->mmap;
     }
-  m_chunks.clear ();
 }
 // Call me only from my context
 void
@@ -73,6 +112,11 @@ KingsleyAlloc::Dispose ()
   for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
        i != m_chunks.end (); ++i)
     {
+      if (i->range && i->mmap->owner == &*i)
+        {
+          // nor to park it.
+          i->mmap->owner = 0;
+        }
       if (i->copy == i->mmap->current)
         {
           // Current must be nullify because we the next switch of context do not need to save our heap.
@@ -84,13 +128,26 @@ KingsleyAlloc *
 KingsleyAlloc::Clone (void)
 {
   NS_LOG_FUNCTION (this << "begin");
-  KingsleyAlloc *clone = new KingsleyAlloc ();
-  *clone->m_buckets = *m_buckets;
+  KingsleyAlloc *clone = new KingsleyAlloc (m_copyOnWrite);
+  memcpy (clone->m_buckets, m_buckets, sizeof (m_buckets));
   for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
        i != m_chunks.end (); ++i)
     {
       struct KingsleyAlloc::MmapChunk chunk = *i;
       chunk.mmap->refcount++;
+      if (chunk.range)
+        {
+          // freeze our pages in the memfd, and map them for the clone:
+          // nothing is copied until one of us writes to them.
+          Freeze (&*i, chunk.mmap->owner == &*i ? chunk.mmap->buffer : i->parked);
+          struct KingsleyAlloc::MmapChunk chunkClone = *i;
+          chunkClone.range->refcount++;
+          chunkClone.parked = (uint8_t *)::mmap (0, chunkClone.range->size, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE, g_memfd, chunkClone.range->offset);
+          NS_ASSERT_MSG (chunkClone.parked != MAP_FAILED, "Unable to map heap of clone");
+          clone->m_chunks.push_back (chunkClone);
+          continue;
+        }
       if ((chunk.mmap->refcount == 2)&&(0 == chunk.copy))
         {
           // this is the first clone of this heap so, we first
@@ -112,11 +169,30 @@ void
 KingsleyAlloc::SwitchTo (void)
 {
   NS_LOG_FUNCTION (this);
-  for (std::list<struct KingsleyAlloc::MmapChunk>::const_iterator i = m_chunks.begin ();
+  for (std::list<struct KingsleyAlloc::MmapChunk>::iterator i = m_chunks.begin ();
        i != m_chunks.end (); ++i)
     {
       struct KingsleyAlloc::MmapChunk chunk = *i;
 
+      if (chunk.range)
+        {
+          if (chunk.mmap->owner == &*i || chunk.parked == 0)
+            {
+              continue;
+            }
+          if (chunk.mmap->owner != 0)
+            {
+              Park (chunk.mmap->owner);
+            }
+          // move our pages back over whatever is left at buffer.
+          void *p = ::mremap (chunk.parked, chunk.range->size, chunk.range->size,
+                              MREMAP_MAYMOVE | MREMAP_FIXED, chunk.mmap->buffer);
+          NS_ASSERT_MSG (p != MAP_FAILED, "Unable to move heap back: " << strerror (errno));
+          i->parked = 0;
+          chunk.mmap->owner = &*i;
+          continue;
+        }
+
       // save the previous user's heap if necessary
       if (chunk.mmap->current && (chunk.mmap->current != chunk.mmap->buffer))
         {
@@ -133,6 +209,157 @@ KingsleyAlloc::SwitchTo (void)
     }
 }
 
+// Move the pages of chunk, at buffer, to an address of their own.
+void
+KingsleyAlloc::Park (struct MmapChunk *chunk)
+{
+  NS_LOG_FUNCTION (chunk);
+  uint32_t size = chunk->range->size;
+  void *p = MAP_FAILED;
+#ifdef MREMAP_DONTUNMAP
+  // leaves buffer mapped until the next pages are moved over it, so
+  // that no other mmap of this process lands there in between.
+  p = ::mremap (chunk->mmap->buffer, size, size, MREMAP_MAYMOVE | MREMAP_DONTUNMAP);
+#endif
+  if (p == MAP_FAILED)
+    {
+      void *parked = ::mmap (0, size, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      NS_ASSERT_MSG (parked != MAP_FAILED, "Unable to reserve room for heap");
+      p = ::mremap (chunk->mmap->buffer, size, size,
+                    MREMAP_MAYMOVE | MREMAP_FIXED, parked);
+    }
+  NS_ASSERT_MSG (p != MAP_FAILED, "Unable to park heap: " << strerror (errno));
+  chunk->parked = (uint8_t *)p;
+  chunk->mmap->owner = 0;
+}
+
+// Make the pages of chunk, at address, a range which its clones can
+// map private, and map them private there too.
+void
+KingsleyAlloc::Freeze (struct MmapChunk *chunk, uint8_t *address)
+{
+  NS_LOG_FUNCTION (chunk << (void*)address);
+  if (!chunk->cow)
+    {
+      // the range holds exactly our pages.
+      chunk->cow = true;
+    }
+  else if (chunk->range->refcount == 1)
+    {
+      // no other clone maps the range anymore: only the pages we wrote
+      // to since are to be written to it.
+      WriteBack (address, chunk->range);
+    }
+  else
+    {
+      struct Range *range = AllocateRange (chunk->range->size);
+      NS_ASSERT_MSG (range != 0, "Unable to grow the heap memfd");
+      ssize_t written = ::pwrite (g_memfd, address, range->size, range->offset);
+      NS_ASSERT_MSG (written == (ssize_t)range->size, "Unable to copy heap: " << strerror (errno));
+      UnrefRange (chunk->range);
+      chunk->range = range;
+    }
+  MapRange (address, chunk->range, true);
+}
+
+struct KingsleyAlloc::Range *
+KingsleyAlloc::AllocateRange (uint32_t size)
+{
+  static bool tried = false;
+  if (!tried)
+    {
+      tried = true;
+#ifdef SYS_memfd_create
+      g_memfd = syscall (SYS_memfd_create, "dce-heap", 1 /* MFD_CLOEXEC */);
+#endif
+      if (g_memfd == -1)
+        {
+          NS_LOG_WARN ("memfd not available, heaps are copied on fork");
+        }
+    }
+  if (g_memfd == -1)
+    {
+      return 0;
+    }
+  struct Range *range = new Range ();
+  range->size = ROUND_UP (size, (uint32_t)sysconf (_SC_PAGE_SIZE));
+  range->refcount = 1;
+  std::multimap<uint32_t, uint64_t>::iterator i = g_freeRanges.find (range->size);
+  if (i != g_freeRanges.end ())
+    {
+      range->offset = i->second;
+      g_freeRanges.erase (i);
+      return range;
+    }
+  range->offset = g_memfdSize;
+  if (::ftruncate (g_memfd, g_memfdSize + range->size) == -1)
+    {
+      NS_LOG_WARN ("Unable to grow the heap memfd: " << strerror (errno));
+      delete range;
+      return 0;
+    }
+  g_memfdSize += range->size;
+  return range;
+}
+
+void
+KingsleyAlloc::UnrefRange (struct Range *range)
+{
+  range->refcount--;
+  if (range->refcount > 0)
+    {
+      return;
+    }
+  // give the pages back, and zeros to the next user of the range.
+  ::fallocate (g_memfd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+               range->offset, range->size);
+  g_freeRanges.insert (std::make_pair (range->size, range->offset));
+  delete range;
+}
+
+void
+KingsleyAlloc::MapRange (uint8_t *address, struct Range *range, bool cow)
+{
+  void *p = ::mmap (address, range->size, PROT_READ | PROT_WRITE,
+                    (cow ? MAP_PRIVATE : MAP_SHARED) | MAP_FIXED,
+                    g_memfd, range->offset);
+  NS_ASSERT_MSG (p != MAP_FAILED, "Unable to map heap: " << strerror (errno));
+}
+
+// Write the pages at address which differ from range to it: those of a
+// private mapping which were written to are anonymous, as the pagemap
+// tells. Without the pagemap, all pages are written.
+void
+KingsleyAlloc::WriteBack (uint8_t *address, struct Range *range)
+{
+  static int pagemap = ::open ("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  uint32_t pageSize = sysconf (_SC_PAGE_SIZE);
+  uint32_t nPages = range->size / pageSize;
+  std::vector<uint64_t> entries (nPages);
+  off_t where = ((unsigned long)address / pageSize) * sizeof (uint64_t);
+  if (pagemap == -1
+      || ::pread (pagemap, &entries[0], nPages * sizeof (uint64_t), where)
+      != (ssize_t)(nPages * sizeof (uint64_t)))
+    {
+      ssize_t written = ::pwrite (g_memfd, address, range->size, range->offset);
+      NS_ASSERT_MSG (written == (ssize_t)range->size, "Unable to write heap back: " << strerror (errno));
+      return;
+    }
+  for (uint32_t i = 0; i < nPages; i++)
+    {
+      bool inMemory = (entries[i] >> 63) & 1;
+      bool swapped = (entries[i] >> 62) & 1;
+      bool filePage = (entries[i] >> 61) & 1;
+      if ((inMemory || swapped) && !filePage)
+        {
+          ssize_t written = ::pwrite (g_memfd, address + i * pageSize, pageSize,
+                                      range->offset + (uint64_t)i * pageSize);
+          NS_ASSERT_MSG (written == (ssize_t)pageSize, "Unable to write heap back: " << strerror (errno));
+        }
+    }
+}
+
 void
 KingsleyAlloc::MmapFree (uint8_t *buffer, uint32_t size)
 {
@@ -146,18 +373,30 @@ KingsleyAlloc::MmapAlloc (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   struct Mmap *mmap_struct = new Mmap ();
+  struct MmapChunk chunk;
+  chunk.range = m_copyOnWrite ? AllocateRange (size) : 0;
+  chunk.cow = false;
+  chunk.parked = 0;
   mmap_struct->refcount = 1;
   mmap_struct->size = size;
-  mmap_struct->buffer = (uint8_t*)::mmap (0, size, PROT_READ | PROT_WRITE,
-                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (chunk.range)
+    {
+      mmap_struct->buffer = (uint8_t*)::mmap (0, chunk.range->size, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED, g_memfd, chunk.range->offset);
+    }
+  else
+    {
+      mmap_struct->buffer = (uint8_t*)::mmap (0, size, PROT_READ | PROT_WRITE,
+                                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
   NS_ASSERT_MSG (mmap_struct->buffer != MAP_FAILED, "Unable to mmap memory buffer");
   mmap_struct->current = mmap_struct->buffer;
-  struct MmapChunk chunk;
   chunk.mmap = mmap_struct;
   chunk.brk = 0;
   chunk.copy = 0; // no clone yet, no copy yet.
 
   m_chunks.push_front (chunk);
+  mmap_struct->owner = chunk.range ? &m_chunks.front () : 0;
   NS_LOG_DEBUG ("mmap alloced=" << size << " at=" << (void*)mmap_struct->buffer);
   MARK_UNDEFINED (mmap_struct->buffer, size);
 }
@@ -179,7 +418,7 @@ KingsleyAlloc::Brk (uint32_t needed)
         }
     }
   NS_ASSERT_MSG (needed <= m_defaultMmapSize, needed << " " << m_defaultMmapSize);
-  MmapAlloc (m_defaultMmapSize);
+  MmapAlloc (m_brkMmapSize);
   return Brk (needed);
 }
 uint8_t
@@ -258,7 +497,8 @@ KingsleyAlloc::Free (uint8_t *buffer, uint32_t size)
           if (i->mmap->buffer == buffer && i->mmap->size == size)
             {
               REPORT_FREE (buffer);
-              MmapFree (buffer, size);
+              // our clones may still use the chunk.
+              ReleaseChunk (&*i);
               m_chunks.erase (i);
               return;
             }
@@ -7,7 +7,13 @@
 class KingsleyAlloc
 {
 public:
-  KingsleyAlloc (void);
+  /**
+   * \param copyOnWrite if true, the heap is kept in a memfd, and a clone
+   * shares its pages with this one until either writes to them.
+   * Switching between clones then moves their mappings rather than
+   * copying the heap out and in.
+   */
+  KingsleyAlloc (bool copyOnWrite = false);
   ~KingsleyAlloc ();
 
   KingsleyAlloc * Clone (void);
@@ -19,6 +25,15 @@ public:
   void Dispose ();
 
 private:
+  // A range of the memfd holding the pages of one chunk, either for
+  // the only clone using it, or frozen and mapped private by each.
+  struct Range
+  {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t refcount;
+  };
+  struct MmapChunk;
   // The following structure is unique for all clone of this.
   struct Mmap
   {
@@ -28,6 +43,7 @@ private:
     uint8_t *buffer;
     uint8_t *current; // Where to save current context , is used when another context is coming up
                       // Zero if there is no clone yet(refcount == 1)
+    struct MmapChunk *owner; // With a Range, the chunk whose pages are at buffer, or zero.
   };
 
   // But this one is differente between the clones.
@@ -36,6 +52,9 @@ private:
     struct Mmap *mmap;
     uint8_t *copy; // My own copy of mmap->buffer used when there is at less one clone else ZERO.
     uint32_t brk; // Amount of memory used.
+    struct Range *range; // Zero if the heap is copied rather than mapped.
+    bool cow; // Mapped private on range, rather than shared.
+    uint8_t *parked; // Where our pages are while another clone runs.
   };
   struct Available
   {
@@ -43,6 +62,13 @@ private:
   };
   void MmapAlloc (uint32_t size);
   void MmapFree (uint8_t *buffer, uint32_t size);
+  void ReleaseChunk (struct MmapChunk *chunk);
+  static void Park (struct MmapChunk *chunk);
+  static void Freeze (struct MmapChunk *chunk, uint8_t *address);
+  static struct Range * AllocateRange (uint32_t size);
+  static void UnrefRange (struct Range *range);
+  static void MapRange (uint8_t *address, struct Range *range, bool cow);
+  static void WriteBack (uint8_t *address, struct Range *range);
   uint8_t * Brk (uint32_t needed);
   uint8_t SizeToBucket (uint32_t size);
   uint32_t BucketToSize (uint8_t bucket);
@@ -50,6 +76,9 @@ private:
   std::list<struct KingsleyAlloc::MmapChunk> m_chunks;
   struct Available *m_buckets[32];
   uint32_t m_defaultMmapSize;
+  // size of the chunks small blocks are taken from
+  uint32_t m_brkMmapSize;
+  bool m_copyOnWrite;
 };
 
 
@@ -42,6 +42,7 @@
 #include "dce-vfs.h"
 #include "dce-termio.h"
 #include "dce-dl.h"
+#include "syscall-stats.h"
 
 #include <arpa/inet.h>
 #include <ctype.h>
@@ -186,9 +187,11 @@ void libc_dce (struct Libc **libc)
 {
   *libc = new Libc;
 
-#define DCE(name) (*libc)->name ## _fn = (func_t)(__typeof (&name))dce_ ## name;
+#define DCE(name) (*libc)->name ## _fn = (func_t)(__typeof (&name))  \
+    ns3::SyscallWrapper<ns3::SYSCALL_ ## name, __typeof (&dce_ ## name), &dce_ ## name>::Get ();
 #define DCET(rtype,name) DCE (name)
-#define DCE_EXPLICIT(name,rtype,...) (*libc)->name ## _fn = dce_ ## name;
+#define DCE_EXPLICIT(name,rtype,...) (*libc)->name ## _fn =            \
+    ns3::SyscallWrapper<ns3::SYSCALL_ ## name, rtype (*)(__VA_ARGS__), &dce_ ## name>::Get ();
 
 #define NATIVE(name)                                                    \
   (*libc)->name ## _fn = (func_t)name;
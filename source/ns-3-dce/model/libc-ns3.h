@@ -425,7 +425,7 @@ NATIVE (madvise)
 // SYS/STAT/H
 DCE (mkdir)
 DCE (umask)
-NATIVE (chmod)
+DCE (chmod)
 
 // SYS/IOCTL.H
 DCE (ioctl)
@@ -0,0 +1,459 @@
+#include "log-sink.h"
+#include "process.h"
+#include "utils.h"
+#include "file-usage.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/simulator.h"
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
+
+NS_LOG_COMPONENT_DEFINE ("DceLogSink");
+
+namespace ns3 {
+
+// Wake up the writer at once past this much,
+#define LOG_SINK_BATCH (64 * 1024)
+// and make the simulation wait for it past this much.
+#define LOG_SINK_MAX_PENDING (64 * 1024 * 1024)
+// Written anyway after this delay, in real time.
+#define LOG_SINK_DELAY_NS (100 * 1000 * 1000)
+
+#define LOG_SINK_BINARY_FILE "dce-logs.bin"
+#define LOG_SINK_BINARY_MAGIC "DCELOG1\n"
+
+pthread_mutex_t LogSink::g_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t LogSink::g_wakeWriter = PTHREAD_COND_INITIALIZER;
+pthread_cond_t LogSink::g_drained = PTHREAD_COND_INITIALIZER;
+pthread_t LogSink::g_writer;
+bool LogSink::g_started = false;
+bool LogSink::g_stopping = false;
+bool LogSink::g_writing = false;
+bool LogSink::g_flushing = false;
+size_t LogSink::g_pending = 0;
+std::vector<struct LogSink::Stream *> LogSink::g_streams;
+std::map<std::string, int> LogSink::g_paths;
+
+int
+LogSink::Open (std::string path, bool reset, std::string header)
+{
+  NS_LOG_FUNCTION (path << reset);
+  pthread_mutex_lock (&g_mutex);
+  Start ();
+  struct Stream *stream;
+  int id;
+  bool truncate = true;
+  std::map<std::string, int>::iterator i = g_paths.find (path);
+  if (i == g_paths.end ())
+    {
+      stream = new Stream ();
+      stream->path = path;
+      stream->header = header;
+      stream->fd = -1;
+      stream->users = 0;
+      id = g_streams.size ();
+      g_streams.push_back (stream);
+      g_paths[path] = id;
+    }
+  else
+    {
+      id = i->second;
+      stream = g_streams[id];
+      truncate = reset && stream->users == 0;
+    }
+  if (truncate)
+    {
+      // as creat would: what was not written yet is dropped, and the
+      // writer must not be writing to the file.
+      while (g_writing)
+        {
+          pthread_cond_wait (&g_drained, &g_mutex);
+        }
+      g_pending -= stream->pending.size ();
+      stream->pending = stream->header;
+      if (g_pending == 0 && !stream->header.empty ())
+        {
+          pthread_cond_signal (&g_wakeWriter);
+        }
+      g_pending += stream->header.size ();
+      if (stream->fd != -1 && ::ftruncate (stream->fd, 0) == -1)
+        {
+          NS_FATAL_ERROR ("Unable to truncate log file " << path << ": " << strerror (errno));
+        }
+    }
+  if (stream->fd == -1)
+    {
+      int flags = O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0);
+      stream->fd = ::open (path.c_str (), flags, 0644);
+      if (stream->fd == -1)
+        {
+          UtilsEnsureAllDirectoriesExist (path);
+          stream->fd = ::open (path.c_str (), flags, 0644);
+        }
+      if (stream->fd == -1)
+        {
+          NS_FATAL_ERROR ("Unable to open log file " << path << ": " << strerror (errno));
+        }
+    }
+  stream->users++;
+  pthread_mutex_unlock (&g_mutex);
+  return id;
+}
+
+void
+LogSink::Close (int id)
+{
+  NS_LOG_FUNCTION (id);
+  pthread_mutex_lock (&g_mutex);
+  NS_ASSERT (g_streams[id]->users > 0);
+  g_streams[id]->users--;
+  // its file is closed by the writer once all is written.
+  pthread_mutex_unlock (&g_mutex);
+}
+
+void
+LogSink::Write (int id, const void *prefix, size_t prefixSize,
+                const void *buf, size_t count)
+{
+  pthread_mutex_lock (&g_mutex);
+  struct Stream *stream = g_streams[id];
+  stream->pending.append ((const char *)prefix, prefixSize);
+  stream->pending.append ((const char *)buf, count);
+  // an idle writer waits for nothing but the first byte: it is then
+  // written within LOG_SINK_DELAY_NS, sooner once a batch piled up.
+  bool idle = g_pending == 0;
+  g_pending += prefixSize + count;
+  if ((idle && g_pending > 0) || g_pending >= LOG_SINK_BATCH)
+    {
+      pthread_cond_signal (&g_wakeWriter);
+    }
+  while (g_pending > LOG_SINK_MAX_PENDING)
+    {
+      pthread_cond_wait (&g_drained, &g_mutex);
+    }
+  pthread_mutex_unlock (&g_mutex);
+}
+
+void
+LogSink::Flush (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  pthread_mutex_lock (&g_mutex);
+  if (g_started)
+    {
+      g_flushing = true;
+      pthread_cond_signal (&g_wakeWriter);
+      while (g_pending > 0 || g_writing)
+        {
+          pthread_cond_wait (&g_drained, &g_mutex);
+        }
+      g_flushing = false;
+    }
+  pthread_mutex_unlock (&g_mutex);
+}
+
+void
+LogSink::Start (void)
+{
+  if (g_started)
+    {
+      return;
+    }
+  int status = pthread_create (&g_writer, 0, &LogSink::Run, 0);
+  if (status != 0)
+    {
+      NS_FATAL_ERROR ("Unable to start the log writer: " << strerror (status));
+    }
+  g_started = true;
+  atexit (&LogSink::Stop);
+}
+
+void
+LogSink::Stop (void)
+{
+  pthread_mutex_lock (&g_mutex);
+  g_stopping = true;
+  pthread_cond_signal (&g_wakeWriter);
+  pthread_mutex_unlock (&g_mutex);
+  pthread_join (g_writer, 0);
+  for (std::vector<struct Stream *>::iterator i = g_streams.begin (); i != g_streams.end (); ++i)
+    {
+      if ((*i)->fd != -1)
+        {
+          ::close ((*i)->fd);
+        }
+      delete *i;
+    }
+  g_streams.clear ();
+  g_paths.clear ();
+}
+
+void
+LogSink::WriteStream (struct Stream *stream, const std::string &data)
+{
+  // Errors cannot be reported to the processes which wrote the data
+  // anymore: what cannot be written is dropped.
+  const char *p = data.data ();
+  size_t left = data.size ();
+  while (left > 0)
+    {
+      ssize_t n = ::write (stream->fd, p, left);
+      if (n == -1 && errno == EINTR)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          return;
+        }
+      p += n;
+      left -= n;
+    }
+}
+
+void *
+LogSink::Run (void *context)
+{
+  struct Batch
+  {
+    struct Stream *stream;
+    std::string data;
+  };
+  std::vector<struct Batch> batches;
+  pthread_mutex_lock (&g_mutex);
+  while (true)
+    {
+      while (g_pending == 0 && !g_stopping)
+        {
+          pthread_cond_wait (&g_wakeWriter, &g_mutex);
+        }
+      if (g_pending == 0)
+        {
+          break;
+        }
+      if (g_pending < LOG_SINK_BATCH && !g_flushing && !g_stopping)
+        {
+          // let more pile up, but not for long.
+          struct timespec deadline;
+          clock_gettime (CLOCK_REALTIME, &deadline);
+          deadline.tv_nsec += LOG_SINK_DELAY_NS;
+          if (deadline.tv_nsec >= 1000000000)
+            {
+              deadline.tv_sec++;
+              deadline.tv_nsec -= 1000000000;
+            }
+          pthread_cond_timedwait (&g_wakeWriter, &g_mutex, &deadline);
+        }
+      // take the buffers of all streams: the processes go on writing to
+      // new ones while these are written.
+      for (std::vector<struct Stream *>::iterator i = g_streams.begin (); i != g_streams.end (); ++i)
+        {
+          struct Stream *stream = *i;
+          if (stream->pending.empty ())
+            {
+              continue;
+            }
+          struct Batch batch;
+          batch.stream = stream;
+          batches.push_back (batch);
+          batches.back ().data.swap (stream->pending);
+        }
+      g_pending = 0;
+      g_writing = true;
+      pthread_mutex_unlock (&g_mutex);
+
+      for (std::vector<struct Batch>::iterator i = batches.begin (); i != batches.end (); ++i)
+        {
+          WriteStream (i->stream, i->data);
+        }
+
+      pthread_mutex_lock (&g_mutex);
+      for (std::vector<struct Stream *>::iterator i = g_streams.begin (); i != g_streams.end (); ++i)
+        {
+          struct Stream *stream = *i;
+          if (stream->fd != -1 && stream->users == 0 && stream->pending.empty ())
+            {
+              ::close (stream->fd);
+              stream->fd = -1;
+            }
+        }
+      batches.clear ();
+      g_writing = false;
+      pthread_cond_broadcast (&g_drained);
+    }
+  pthread_mutex_unlock (&g_mutex);
+  return 0;
+}
+
+LogSinkFd::LogSinkFd (std::string path, enum Format format, enum Source source)
+  : UnixFileFdBase (-1),
+    m_format (format),
+    m_source (source),
+    m_written (0)
+{
+  m_statusFlags = O_WRONLY;
+  if (format == BINARY)
+    {
+      m_stream = LogSink::Open (LOG_SINK_BINARY_FILE, false, LOG_SINK_BINARY_MAGIC);
+    }
+  else
+    {
+      m_stream = LogSink::Open (UtilsGetRealFilePath (path), true, "");
+    }
+}
+LogSinkFd::~LogSinkFd ()
+{
+  Close ();
+}
+int
+LogSinkFd::Close (void)
+{
+  if (m_stream != -1)
+    {
+      LogSink::Close (m_stream);
+      m_stream = -1;
+    }
+  return 0;
+}
+ssize_t
+LogSinkFd::Write (const void *buf, size_t count)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << buf << count);
+  NS_ASSERT (current != 0);
+  if (m_format == BINARY)
+    {
+      struct LogSinkRecord record;
+      record.time = Simulator::Now ().GetNanoSeconds ();
+      record.nodeId = UtilsGetNodeId ();
+      record.pid = current->process->pid;
+      record.length = count;
+      record.source = m_source;
+      record.reserved = 0;
+      LogSink::Write (m_stream, &record, sizeof (record), buf, count);
+    }
+  else
+    {
+      LogSink::Write (m_stream, 0, 0, buf, count);
+    }
+  m_written += count;
+  return count;
+}
+ssize_t
+LogSinkFd::Read (void *buf, size_t count)
+{
+  Current ()->err = EBADF;
+  return -1;
+}
+bool
+LogSinkFd::Isatty (void) const
+{
+  return false;
+}
+void *
+LogSinkFd::Mmap (void *start, size_t length, int prot, int flags,
+                 off64_t offset)
+{
+  Current ()->err = ENODEV;
+  return MAP_FAILED;
+}
+off64_t
+LogSinkFd::Lseek (off64_t offset, int whence)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << offset << whence);
+  NS_ASSERT (current != 0);
+  // only the position can be asked for, as stdio does on ftell.
+  if (offset != 0 || (whence != SEEK_CUR && whence != SEEK_END))
+    {
+      current->err = ESPIPE;
+      return -1;
+    }
+  return m_written;
+}
+int
+LogSinkFd::Fxstat (int ver, struct ::stat *buf)
+{
+  memset (buf, 0, sizeof (*buf));
+  buf->st_mode = S_IFREG | S_IRUSR | S_IWUSR;
+  buf->st_nlink = 1;
+  buf->st_size = m_written;
+  // the size of the stdio buffers
+  buf->st_blksize = LOG_SINK_BATCH;
+  return 0;
+}
+int
+LogSinkFd::Fxstat64 (int ver, struct ::stat64 *buf)
+{
+  memset (buf, 0, sizeof (*buf));
+  buf->st_mode = S_IFREG | S_IRUSR | S_IWUSR;
+  buf->st_nlink = 1;
+  buf->st_size = m_written;
+  buf->st_blksize = LOG_SINK_BATCH;
+  return 0;
+}
+int
+LogSinkFd::Fcntl (int cmd, unsigned long arg)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << cmd << arg);
+  NS_ASSERT (current != 0);
+  switch (cmd)
+    {
+    case F_GETFL:
+    case F_SETFL:
+    case F_GETFD:
+    case F_SETFD:
+      return UnixFd::Fcntl (cmd, arg);
+    default:
+      current->err = EINVAL;
+      return -1;
+    }
+}
+int
+LogSinkFd::Ftruncate (off_t length)
+{
+  Current ()->err = EINVAL;
+  return -1;
+}
+bool
+LogSinkFd::CanRecv (void) const
+{
+  return false;
+}
+bool
+LogSinkFd::CanSend (void) const
+{
+  return true;
+}
+int
+LogSinkFd::Fsync (void)
+{
+  LogSink::Flush ();
+  return 0;
+}
+
+int
+LogSinkFd::Open (std::string path, enum Format format, enum Source source)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (current << path << format << source);
+  NS_ASSERT (current != 0);
+  int fd = UtilsAllocateFd ();
+  if (fd == -1)
+    {
+      current->err = EMFILE;
+      return -1;
+    }
+  UnixFd *unixFd = new LogSinkFd (path, format, source);
+  unixFd->IncFdCount ();
+  current->process->openFiles[fd] = new FileUsage (fd, unixFd);
+  return fd;
+}
+
+} // namespace ns3
@@ -0,0 +1,137 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include "unix-file-fd.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief Writes the logs of the processes to the host from a thread
+ * of its own.
+ *
+ * What the processes write to a stream is only copied to its buffer;
+ * the writer thread takes the buffers of all streams at once and
+ * writes each of them with a single write, once enough has piled up,
+ * every 100ms of real time otherwise, or on Flush. The simulation only
+ * waits for the disk when more than 64MB are pending.
+ */
+class LogSink
+{
+public:
+  /**
+   * \param path path of the file on the host
+   * \param reset if true and no one has the stream opened, empty the
+   * file as creat would; the file is always emptied the first time.
+   * \param header written first to the file whenever it is emptied
+   * \returns the stream
+   */
+  static int Open (std::string path, bool reset, std::string header);
+  static void Close (int stream);
+  // the prefix and the data are written together.
+  static void Write (int stream, const void *prefix, size_t prefixSize,
+                     const void *buf, size_t count);
+  // Wait until everything written so far is on the host.
+  static void Flush (void);
+
+private:
+  struct Stream
+  {
+    std::string path;
+    std::string header;
+    std::string pending;
+    int fd;
+    uint32_t users;
+  };
+
+  static void Start (void);
+  static void Stop (void);
+  static void * Run (void *context);
+  static void WriteStream (struct Stream *stream, const std::string &data);
+
+  static pthread_mutex_t g_mutex;
+  static pthread_cond_t g_wakeWriter;
+  static pthread_cond_t g_drained;
+  static pthread_t g_writer;
+  static bool g_started;
+  static bool g_stopping;
+  static bool g_writing;
+  static bool g_flushing;
+  static size_t g_pending;
+  static std::vector<struct Stream *> g_streams;
+  static std::map<std::string, int> g_paths;
+};
+
+/**
+ * \brief stdout, stderr or syslog of a process, written through the
+ * LogSink.
+ *
+ * With the binary format, the logs of all processes go to the same
+ * file, as records of a LogSinkRecord followed by its data.
+ */
+class LogSinkFd : public UnixFileFdBase
+{
+public:
+  enum Format
+  {
+    TEXT,
+    BINARY
+  };
+  // in the records of the binary format
+  enum Source
+  {
+    STDOUT = 1,
+    STDERR = 2,
+    SYSLOG = 3
+  };
+  /**
+   * \param path the path of the file in the node, for the text format
+   */
+  LogSinkFd (std::string path, enum Format format, enum Source source);
+  virtual ~LogSinkFd ();
+  virtual int Close (void);
+  virtual ssize_t Write (const void *buf, size_t count);
+  virtual ssize_t Read (void *buf, size_t count);
+  virtual bool Isatty (void) const;
+  virtual void * Mmap (void *start, size_t length, int prot, int flags,
+                       off64_t offset);
+  virtual off64_t Lseek (off64_t offset, int whence);
+  virtual int Fxstat (int ver, struct ::stat *buf);
+  virtual int Fxstat64 (int ver, struct ::stat64 *buf);
+  virtual int Fcntl (int cmd, unsigned long arg);
+  virtual int Ftruncate (off_t length);
+  virtual bool CanRecv (void) const;
+  virtual bool CanSend (void) const;
+  virtual int Fsync (void);
+
+  /**
+   * \returns the fd of the current process on a new LogSinkFd, or -1
+   */
+  static int Open (std::string path, enum Format format, enum Source source);
+
+private:
+  int m_stream;
+  enum Format m_format;
+  enum Source m_source;
+  off64_t m_written;
+};
+
+// The binary format: dce-logs.bin starts with the 8 bytes "DCELOG1\n",
+// and each record with this header, in host byte order.
+struct LogSinkRecord
+{
+  int64_t time; // simulated, in nanoseconds
+  uint32_t nodeId;
+  uint32_t pid;
+  uint32_t length; // of the data which follows
+  uint16_t source; // LogSinkFd::Source
+  uint16_t reserved;
+};
+
+} // namespace ns3
+
+#endif /* LOG_SINK_H */
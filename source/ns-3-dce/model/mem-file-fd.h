@@ -0,0 +1,69 @@
+#ifndef MEM_FILE_FD_H
+#define MEM_FILE_FD_H
+
+#include "unix-file-fd.h"
+#include "ns3/simple-ref-count.h"
+#include <vector>
+
+namespace ns3 {
+
+class MemFileData : public SimpleRefCount<MemFileData>
+{
+public:
+  std::vector<uint8_t> bytes;
+};
+
+class MemFileInode : public SimpleRefCount<MemFileInode>
+{
+public:
+  MemFileInode (Ptr<MemFileData> data, mode_t mode, ino_t ino);
+  // Make the data of this file its own, before it is modified.
+  std::vector<uint8_t> & GetWritableBytes (void);
+  void Touch (void);
+  template <typename T>
+  void Fill (T *buf) const;
+
+  // Shared with the template, and with the other nodes which read the
+  // same template file, until written to.
+  Ptr<MemFileData> data;
+  mode_t mode;
+  ino_t ino;
+  struct timespec mtime;
+  struct timespec ctime;
+  // flushed to the node directory, unless false
+  bool dirty;
+};
+
+/**
+ * \brief An opened file of a MemFileSystem.
+ *
+ * Reads and writes are copies, which never block.
+ */
+class MemFileFd : public UnixFileFdBase
+{
+public:
+  MemFileFd (Ptr<MemFileInode> inode, int flags);
+  virtual ~MemFileFd ();
+  virtual int Close (void);
+  virtual ssize_t Write (const void *buf, size_t count);
+  virtual ssize_t Read (void *buf, size_t count);
+  virtual bool Isatty (void) const;
+  virtual void * Mmap (void *start, size_t length, int prot, int flags,
+                       off64_t offset);
+  virtual off64_t Lseek (off64_t offset, int whence);
+  virtual int Fxstat (int ver, struct ::stat *buf);
+  virtual int Fxstat64 (int ver, struct ::stat64 *buf);
+  virtual int Fcntl (int cmd, unsigned long arg);
+  virtual int Ftruncate (off_t length);
+  virtual bool CanRecv (void) const;
+  virtual bool CanSend (void) const;
+  virtual int Fsync (void);
+
+private:
+  Ptr<MemFileInode> m_inode;
+  off64_t m_offset;
+};
+
+} // namespace ns3
+
+#endif /* MEM_FILE_FD_H */
@@ -0,0 +1,711 @@
+#include "mem-file-system.h"
+#include "mem-file-fd.h"
+#include "process.h"
+#include "utils.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE ("DceMemFileSystem");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MemFileSystem);
+
+std::map<std::string, Ptr<MemFileData> > MemFileSystem::g_templateFiles;
+
+MemFileInode::MemFileInode (Ptr<MemFileData> data, mode_t mode, ino_t ino)
+  : data (data),
+    mode (mode),
+    ino (ino),
+    dirty (false)
+{
+  Touch ();
+}
+std::vector<uint8_t> &
+MemFileInode::GetWritableBytes (void)
+{
+  if (data->GetReferenceCount () > 1)
+    {
+      Ptr<MemFileData> copy = Create<MemFileData> ();
+      copy->bytes = data->bytes;
+      data = copy;
+    }
+  dirty = true;
+  return data->bytes;
+}
+void
+MemFileInode::Touch (void)
+{
+  mtime = UtilsTimeToTimespec (UtilsSimulationTimeToTime (Simulator::Now ()));
+  ctime = mtime;
+}
+template <typename T>
+void
+MemFileInode::Fill (T *buf) const
+{
+  memset (buf, 0, sizeof (*buf));
+  buf->st_ino = ino;
+  buf->st_mode = S_IFREG | mode;
+  buf->st_nlink = 1;
+  buf->st_uid = getuid ();
+  buf->st_gid = getgid ();
+  buf->st_size = data->bytes.size ();
+  buf->st_blksize = 4096;
+  buf->st_blocks = (data->bytes.size () + 511) / 512;
+  buf->st_atim = mtime;
+  buf->st_mtim = mtime;
+  buf->st_ctim = ctime;
+}
+
+TypeId
+MemFileSystem::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MemFileSystem")
+    .SetParent<Object> ()
+    .AddConstructor<MemFileSystem> ()
+    .AddAttribute ("Template",
+                   "A host directory holding the files every node starts with, "
+                   "under those of its own files-<nodeid> directory.",
+                   StringValue (""),
+                   MakeStringAccessor (&MemFileSystem::m_template),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+MemFileSystem::MemFileSystem ()
+  : m_nodeId (0),
+    m_nextIno (1)
+{
+  NS_LOG_FUNCTION (this);
+}
+MemFileSystem::~MemFileSystem ()
+{
+  NS_LOG_FUNCTION (this);
+  // what was written while the other objects of the node were disposed.
+  Flush ();
+}
+void
+MemFileSystem::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+  Object::DoDispose ();
+}
+void
+MemFileSystem::NotifyNewAggregate (void)
+{
+  Ptr<Node> node = GetObject<Node> ();
+  if (node != 0)
+    {
+      m_nodeId = node->GetId ();
+    }
+  Object::NotifyNewAggregate ();
+}
+
+Ptr<MemFileSystem>
+MemFileSystem::GetFileSystem (uint32_t nodeId)
+{
+  if (nodeId >= NodeList::GetNNodes ())
+    {
+      return 0;
+    }
+  return NodeList::GetNode (nodeId)->GetObject<MemFileSystem> ();
+}
+Ptr<MemFileSystem>
+MemFileSystem::Find (std::string path)
+{
+  Ptr<MemFileSystem> fs = GetFileSystem (UtilsGetNodeId ());
+  if (fs == 0 || !fs->Handles (path))
+    {
+      return 0;
+    }
+  return fs;
+}
+
+std::string
+MemFileSystem::Normalize (std::string path)
+{
+  std::vector<std::string> parts;
+  std::string::size_type start = 0;
+  while (start <= path.length ())
+    {
+      std::string::size_type end = path.find ('/', start);
+      if (end == std::string::npos)
+        {
+          end = path.length ();
+        }
+      std::string part = path.substr (start, end - start);
+      if (part == "..")
+        {
+          if (!parts.empty ())
+            {
+              parts.pop_back ();
+            }
+        }
+      else if (part != "" && part != ".")
+        {
+          parts.push_back (part);
+        }
+      start = end + 1;
+    }
+  std::string result;
+  for (std::vector<std::string>::const_iterator i = parts.begin (); i != parts.end (); ++i)
+    {
+      result += "/" + *i;
+    }
+  return result == "" ? "/" : result;
+}
+std::string
+MemFileSystem::GetRealPath (std::string path) const
+{
+  std::ostringstream oss;
+  oss << "files-" << m_nodeId << path;
+  return oss.str ();
+}
+
+Ptr<MemFileInode>
+MemFileSystem::Seed (std::string realPath, bool shared)
+{
+  NS_LOG_FUNCTION (this << realPath << shared);
+  struct stat st;
+  int fd = ::open (realPath.c_str (), O_RDONLY);
+  if (fd == -1)
+    {
+      return 0;
+    }
+  if (::fstat (fd, &st) == -1)
+    {
+      ::close (fd);
+      return 0;
+    }
+  Ptr<MemFileData> data;
+  if (shared)
+    {
+      std::map<std::string, Ptr<MemFileData> >::iterator i = g_templateFiles.find (realPath);
+      if (i != g_templateFiles.end ())
+        {
+          data = i->second;
+        }
+    }
+  if (data == 0)
+    {
+      data = Create<MemFileData> ();
+      data->bytes.resize (st.st_size);
+      size_t done = 0;
+      while (done < data->bytes.size ())
+        {
+          ssize_t n = ::read (fd, &data->bytes[done], data->bytes.size () - done);
+          if (n <= 0)
+            {
+              break;
+            }
+          done += n;
+        }
+      data->bytes.resize (done);
+      if (shared)
+        {
+          g_templateFiles[realPath] = data;
+        }
+    }
+  ::close (fd);
+  return Create<MemFileInode> (data, st.st_mode & 07777, m_nextIno++);
+}
+
+bool
+MemFileSystem::Handles (std::string path)
+{
+  path = Normalize (path);
+  if (m_files.find (path) != m_files.end ())
+    {
+      return true;
+    }
+  struct stat st;
+  std::string realPath = GetRealPath (path);
+  if (::lstat (realPath.c_str (), &st) == 0)
+    {
+      if (!S_ISREG (st.st_mode))
+        {
+          return false;
+        }
+      Ptr<MemFileInode> inode = Seed (realPath, false);
+      if (inode == 0)
+        {
+          return false;
+        }
+      m_files[path] = inode;
+      return true;
+    }
+  if (errno != ENOENT && errno != ENOTDIR)
+    {
+      return false;
+    }
+  if (m_template != "")
+    {
+      std::string templatePath = m_template + path;
+      if (::stat (templatePath.c_str (), &st) == 0)
+        {
+          if (!S_ISREG (st.st_mode))
+            {
+              return false;
+            }
+          Ptr<MemFileInode> inode = Seed (templatePath, true);
+          if (inode == 0)
+            {
+              return false;
+            }
+          m_files[path] = inode;
+          return true;
+        }
+    }
+  // or created here, in a directory of the node or of the template:
+  // the host reports the error otherwise.
+  std::string parent = path.substr (0, path.rfind ('/'));
+  if (::stat (GetRealPath (parent + "/").c_str (), &st) == 0 && S_ISDIR (st.st_mode))
+    {
+      return true;
+    }
+  return m_template != ""
+         && ::stat ((m_template + parent + "/").c_str (), &st) == 0 && S_ISDIR (st.st_mode);
+}
+Ptr<MemFileInode>
+MemFileSystem::Lookup (std::string path)
+{
+  if (!Handles (path))
+    {
+      return 0;
+    }
+  std::map<std::string, Ptr<MemFileInode> >::iterator i = m_files.find (path);
+  if (i == m_files.end ())
+    {
+      return 0;
+    }
+  return i->second;
+}
+
+UnixFd *
+MemFileSystem::Open (std::string path, int flags, mode_t mode)
+{
+  NS_LOG_FUNCTION (this << path << flags << mode);
+  path = Normalize (path);
+  Ptr<MemFileInode> inode = Lookup (path);
+  if (inode == 0)
+    {
+      if (!(flags & O_CREAT))
+        {
+          errno = ENOENT;
+          return 0;
+        }
+      inode = Create<MemFileInode> (Create<MemFileData> (), mode & 07777, m_nextIno++);
+      inode->dirty = true;
+      m_files[path] = inode;
+    }
+  else
+    {
+      if ((flags & O_CREAT) && (flags & O_EXCL))
+        {
+          errno = EEXIST;
+          return 0;
+        }
+      if (flags & O_DIRECTORY)
+        {
+          errno = ENOTDIR;
+          return 0;
+        }
+      if ((flags & O_TRUNC) && (flags & O_ACCMODE) != O_RDONLY
+          && !inode->data->bytes.empty ())
+        {
+          inode->data = Create<MemFileData> ();
+          inode->dirty = true;
+          inode->Touch ();
+        }
+    }
+  return new MemFileFd (inode, flags);
+}
+int
+MemFileSystem::Stat (std::string path, struct ::stat *buf)
+{
+  Ptr<MemFileInode> inode = Lookup (Normalize (path));
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  inode->Fill (buf);
+  return 0;
+}
+int
+MemFileSystem::Stat64 (std::string path, struct ::stat64 *buf)
+{
+  Ptr<MemFileInode> inode = Lookup (Normalize (path));
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  inode->Fill (buf);
+  return 0;
+}
+int
+MemFileSystem::Access (std::string path, int mode)
+{
+  Ptr<MemFileInode> inode = Lookup (Normalize (path));
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  if ((mode & X_OK) && !(inode->mode & 0111))
+    {
+      errno = EACCES;
+      return -1;
+    }
+  return 0;
+}
+int
+MemFileSystem::Chmod (std::string path, mode_t mode)
+{
+  NS_LOG_FUNCTION (this << path << mode);
+  Ptr<MemFileInode> inode = Lookup (Normalize (path));
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  inode->mode = mode & 07777;
+  inode->ctime = UtilsTimeToTimespec (UtilsSimulationTimeToTime (Simulator::Now ()));
+  inode->dirty = true;
+  return 0;
+}
+int
+MemFileSystem::Utime (std::string path, const struct timespec *mtime)
+{
+  NS_LOG_FUNCTION (this << path);
+  Ptr<MemFileInode> inode = Lookup (Normalize (path));
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  inode->Touch ();
+  if (mtime != 0)
+    {
+      inode->mtime = *mtime;
+    }
+  return 0;
+}
+int
+MemFileSystem::Readlink (std::string path)
+{
+  // no file of the node is a link.
+  errno = Lookup (Normalize (path)) == 0 ? ENOENT : EINVAL;
+  return -1;
+}
+int
+MemFileSystem::Unlink (std::string path)
+{
+  NS_LOG_FUNCTION (this << path);
+  path = Normalize (path);
+  if (Lookup (path) == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  // the fds still opened on it keep the inode.
+  m_files[path] = 0;
+  return 0;
+}
+int
+MemFileSystem::Rename (std::string oldPath, std::string newPath)
+{
+  NS_LOG_FUNCTION (this << oldPath << newPath);
+  oldPath = Normalize (oldPath);
+  newPath = Normalize (newPath);
+  Ptr<MemFileInode> inode = Lookup (oldPath);
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  if (!Handles (newPath))
+    {
+      errno = EISDIR;
+      return -1;
+    }
+  if (oldPath == newPath)
+    {
+      return 0;
+    }
+  m_files[newPath] = inode;
+  m_files[oldPath] = 0;
+  inode->dirty = true;
+  return 0;
+}
+int
+MemFileSystem::Append (std::string path, const void *buf, size_t count)
+{
+  Ptr<MemFileInode> inode = Lookup (Normalize (path));
+  if (inode == 0)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+  std::vector<uint8_t> &bytes = inode->GetWritableBytes ();
+  bytes.insert (bytes.end (), (const uint8_t *)buf, (const uint8_t *)buf + count);
+  inode->Touch ();
+  return 0;
+}
+
+void
+MemFileSystem::Flush (void)
+{
+  NS_LOG_FUNCTION (this << m_files.size ());
+  for (std::map<std::string, Ptr<MemFileInode> >::iterator i = m_files.begin ();
+       i != m_files.end (); ++i)
+    {
+      std::string realPath = GetRealPath (i->first);
+      Ptr<MemFileInode> inode = i->second;
+      if (inode == 0)
+        {
+          ::unlink (realPath.c_str ());
+          continue;
+        }
+      if (!inode->dirty)
+        {
+          continue;
+        }
+      UtilsEnsureAllDirectoriesExist (realPath);
+      int fd = ::open (realPath.c_str (), O_WRONLY | O_CREAT | O_TRUNC, inode->mode);
+      if (fd == -1)
+        {
+          NS_LOG_WARN ("Unable to flush " << realPath << ": " << strerror (errno));
+          continue;
+        }
+      // the file may have existed with another mode.
+      ::fchmod (fd, inode->mode);
+      const std::vector<uint8_t> &bytes = inode->data->bytes;
+      size_t done = 0;
+      while (done < bytes.size ())
+        {
+          ssize_t n = ::write (fd, &bytes[done], bytes.size () - done);
+          if (n <= 0)
+            {
+              NS_LOG_WARN ("Unable to flush " << realPath << ": " << strerror (errno));
+              break;
+            }
+          done += n;
+        }
+      ::close (fd);
+      inode->dirty = false;
+    }
+}
+
+MemFileFd::MemFileFd (Ptr<MemFileInode> inode, int flags)
+  : UnixFileFdBase (-1),
+    m_inode (inode),
+    m_offset (0)
+{
+  m_statusFlags = flags & (O_ACCMODE | O_APPEND | O_NONBLOCK);
+  m_fdFlags = (flags & O_CLOEXEC) ? FD_CLOEXEC : 0;
+}
+MemFileFd::~MemFileFd ()
+{
+  m_inode = 0;
+}
+int
+MemFileFd::Close (void)
+{
+  return 0;
+}
+ssize_t
+MemFileFd::Write (const void *buf, size_t count)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << buf << count);
+  NS_ASSERT (current != 0);
+  if ((m_statusFlags & O_ACCMODE) == O_RDONLY)
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  std::vector<uint8_t> &bytes = m_inode->GetWritableBytes ();
+  if (m_statusFlags & O_APPEND)
+    {
+      m_offset = bytes.size ();
+    }
+  if (m_offset + count > bytes.size ())
+    {
+      bytes.resize (m_offset + count);
+    }
+  memcpy (&bytes[m_offset], buf, count);
+  m_offset += count;
+  m_inode->Touch ();
+  return count;
+}
+ssize_t
+MemFileFd::Read (void *buf, size_t count)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << buf << count);
+  NS_ASSERT (current != 0);
+  if ((m_statusFlags & O_ACCMODE) == O_WRONLY)
+    {
+      current->err = EBADF;
+      return -1;
+    }
+  const std::vector<uint8_t> &bytes = m_inode->data->bytes;
+  if (m_offset >= (off64_t)bytes.size ())
+    {
+      return 0;
+    }
+  size_t n = std::min (count, (size_t)(bytes.size () - m_offset));
+  memcpy (buf, &bytes[m_offset], n);
+  m_offset += n;
+  return n;
+}
+bool
+MemFileFd::Isatty (void) const
+{
+  return false;
+}
+void *
+MemFileFd::Mmap (void *start, size_t length, int prot, int flags,
+                 off64_t offset)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << start << length << prot << flags << offset);
+  NS_ASSERT (current != 0);
+  if ((flags & MAP_SHARED) && (prot & PROT_WRITE))
+    {
+      // nothing would write the mapping back to the file.
+      current->err = ENODEV;
+      return MAP_FAILED;
+    }
+  void *retval = ::mmap (start, length, prot | PROT_WRITE,
+                         (flags & ~MAP_SHARED) | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (retval == MAP_FAILED)
+    {
+      current->err = errno;
+      return retval;
+    }
+  const std::vector<uint8_t> &bytes = m_inode->data->bytes;
+  if (offset < (off64_t)bytes.size ())
+    {
+      memcpy (retval, &bytes[offset], std::min (length, (size_t)(bytes.size () - offset)));
+    }
+  if (!(prot & PROT_WRITE))
+    {
+      ::mprotect (retval, length, prot);
+    }
+  return retval;
+}
+off64_t
+MemFileFd::Lseek (off64_t offset, int whence)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << offset << whence);
+  NS_ASSERT (current != 0);
+  off64_t base;
+  switch (whence)
+    {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = m_offset;
+      break;
+    case SEEK_END:
+      base = m_inode->data->bytes.size ();
+      break;
+    default:
+      current->err = EINVAL;
+      return -1;
+    }
+  if (base + offset < 0)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  m_offset = base + offset;
+  return m_offset;
+}
+int
+MemFileFd::Fxstat (int ver, struct ::stat *buf)
+{
+  m_inode->Fill (buf);
+  return 0;
+}
+int
+MemFileFd::Fxstat64 (int ver, struct ::stat64 *buf)
+{
+  m_inode->Fill (buf);
+  return 0;
+}
+int
+MemFileFd::Fcntl (int cmd, unsigned long arg)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << cmd << arg);
+  NS_ASSERT (current != 0);
+  switch (cmd)
+    {
+    case F_GETFL:
+    case F_SETFL:
+    case F_GETFD:
+    case F_SETFD:
+      return UnixFd::Fcntl (cmd, arg);
+    case F_GETLK:
+      // only the processes of the node see the file: the locks they
+      // take are not modelled, and always granted.
+      ((struct flock *)arg)->l_type = F_UNLCK;
+      return 0;
+    case F_SETLK:
+    case F_SETLKW:
+      return 0;
+    default:
+      current->err = EINVAL;
+      return -1;
+    }
+}
+int
+MemFileFd::Ftruncate (off_t length)
+{
+  Thread *current = Current ();
+  NS_LOG_FUNCTION (this << current << length);
+  NS_ASSERT (current != 0);
+  if (length < 0 || (m_statusFlags & O_ACCMODE) == O_RDONLY)
+    {
+      current->err = EINVAL;
+      return -1;
+    }
+  m_inode->GetWritableBytes ().resize (length);
+  m_inode->Touch ();
+  return 0;
+}
+bool
+MemFileFd::CanRecv (void) const
+{
+  return true;
+}
+bool
+MemFileFd::CanSend (void) const
+{
+  return true;
+}
+int
+MemFileFd::Fsync (void)
+{
+  return 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+#ifndef MEM_FILE_SYSTEM_H
+#define MEM_FILE_SYSTEM_H
+
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include <sys/stat.h>
+#include <string>
+#include <map>
+
+namespace ns3 {
+
+class UnixFd;
+class MemFileData;
+class MemFileInode;
+
+/**
+ * \brief Regular files of a node, kept in memory.
+ *
+ * Aggregated to a node by DceManagerHelper::SetFileSystem, it takes
+ * over the regular files opened by the processes of this node from
+ * files-<nodeid>/: a file is read from there, or else from the
+ * Template directory shared by all nodes, the first time it is
+ * opened, and then only lives in memory. A template file is shared
+ * by every node which reads it until one of them writes to it.
+ *
+ * Files created or modified are written back to files-<nodeid>/ on
+ * Flush, which is done when the node is disposed, at the end of the
+ * simulation, and files removed are removed from there.
+ *
+ * Directories, devices, sockets and links stay on the host, as do
+ * directory listings: a file created in memory is not listed by
+ * readdir until it is flushed.
+ */
+class MemFileSystem : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MemFileSystem ();
+  virtual ~MemFileSystem ();
+
+  /**
+   * \returns the file system of the node, or 0 if files of this node
+   * stay on the host.
+   */
+  static Ptr<MemFileSystem> GetFileSystem (uint32_t nodeId);
+  /**
+   * \param path an absolute path in the node
+   * \returns the file system of the current node, if path is one of
+   * its files or can be created as one, or 0.
+   */
+  static Ptr<MemFileSystem> Find (std::string path);
+
+  /**
+   * \returns false if path is left to the host, because it is a
+   * directory or a special file there, or because it does not exist
+   * and neither does its directory.
+   */
+  bool Handles (std::string path);
+  // The functions below set errno and return -1 or 0 as their libc
+  // counterparts do.
+  UnixFd * Open (std::string path, int flags, mode_t mode);
+  int Stat (std::string path, struct ::stat *buf);
+  int Stat64 (std::string path, struct ::stat64 *buf);
+  int Access (std::string path, int mode);
+  int Chmod (std::string path, mode_t mode);
+  // the modification time is set to mtime, or to now if it is 0.
+  int Utime (std::string path, const struct timespec *mtime);
+  // always fails, with EINVAL if path exists: none is a link.
+  int Readlink (std::string path);
+  int Unlink (std::string path);
+  int Rename (std::string oldPath, std::string newPath);
+  int Append (std::string path, const void *buf, size_t count);
+
+  /**
+   * Write the files created or modified since the last flush to the
+   * node directory, and remove from there those which were removed.
+   */
+  void Flush (void);
+
+private:
+  virtual void DoDispose (void);
+  virtual void NotifyNewAggregate (void);
+  static std::string Normalize (std::string path);
+  Ptr<MemFileInode> Lookup (std::string path);
+  Ptr<MemFileInode> Seed (std::string realPath, bool shared);
+  std::string GetRealPath (std::string path) const;
+
+  // A null inode stands for a file removed, which must not be read
+  // again from the node directory or the template.
+  std::map<std::string, Ptr<MemFileInode> > m_files;
+  std::string m_template;
+  uint32_t m_nodeId;
+  ino_t m_nextIno;
+  // Template files, read once for all nodes.
+  static std::map<std::string, Ptr<MemFileData> > g_templateFiles;
+};
+
+} // namespace ns3
+
+#endif /* MEM_FILE_SYSTEM_H */
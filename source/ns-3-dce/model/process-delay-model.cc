@@ -21,8 +21,10 @@
 #include "ns3/log.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
+#include "ns3/double.h"
 #include <sys/time.h>
 #include <time.h>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -38,6 +40,15 @@ ProcessDelayModel::GetTypeId (void)
   return tid;
 }
 
+void
+ProcessDelayModel::NotifyResume (void)
+{
+}
+void
+ProcessDelayModel::NotifySuspend (void)
+{
+}
+
 NS_OBJECT_ENSURE_REGISTERED (RandomProcessDelayModel);
 
 TypeId
@@ -119,5 +130,108 @@ TimeOfDayProcessDelayModel::RecordEnd (void)
   return delay;
 }
 
+NS_OBJECT_ENSURE_REGISTERED (CpuTimeProcessDelayModel);
+
+TypeId
+CpuTimeProcessDelayModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CpuTimeProcessDelayModel")
+    .SetParent<ProcessDelayModel> ()
+    .AddConstructor<CpuTimeProcessDelayModel> ()
+    .AddAttribute ("Scale", "The delay is the CPU time measured times this factor: "
+                   "2 simulates a CPU twice as slow as the host.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&CpuTimeProcessDelayModel::m_scale),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Overhead", "Subtracted from the CPU time of each run of a task, "
+                   "for work of DCE on its behalf which the target would not do.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&CpuTimeProcessDelayModel::m_overhead),
+                   MakeTimeChecker ())
+    .AddAttribute ("Resolution", "The delay is rounded to a multiple of this, so that "
+                   "the noise of the measure below it does not change the simulation.",
+                   TimeValue (MicroSeconds (1)),
+                   MakeTimeAccessor (&CpuTimeProcessDelayModel::m_resolution),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+CpuTimeProcessDelayModel::CpuTimeProcessDelayModel ()
+  : m_start (0),
+    m_elapsed (0),
+    m_running (false)
+{
+}
+
+int64_t
+CpuTimeProcessDelayModel::GetThreadCpuTime (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// The least time measured between two reads of the clock.
+int64_t
+CpuTimeProcessDelayModel::GetClockCost (void)
+{
+  static int64_t cost = -1;
+  if (cost < 0)
+    {
+      for (int i = 0; i < 1000; i++)
+        {
+          int64_t start = GetThreadCpuTime ();
+          int64_t delta = GetThreadCpuTime () - start;
+          if (cost < 0 || delta < cost)
+            {
+              cost = delta;
+            }
+        }
+      NS_LOG_DEBUG ("thread cpu clock read in " << cost << "ns");
+    }
+  return cost;
+}
+
+void
+CpuTimeProcessDelayModel::RecordStart (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_elapsed = 0;
+  m_running = false;
+}
+void
+CpuTimeProcessDelayModel::NotifyResume (void)
+{
+  GetClockCost ();
+  m_running = true;
+  m_start = GetThreadCpuTime ();
+}
+void
+CpuTimeProcessDelayModel::NotifySuspend (void)
+{
+  if (!m_running)
+    {
+      return;
+    }
+  int64_t elapsed = GetThreadCpuTime () - m_start - GetClockCost ();
+  m_elapsed += std::max (elapsed, (int64_t)0);
+  m_running = false;
+}
+Time
+CpuTimeProcessDelayModel::RecordEnd (void)
+{
+  NS_LOG_FUNCTION (this);
+  NotifySuspend ();
+  int64_t ns = (int64_t)(m_elapsed * m_scale) - m_overhead.GetNanoSeconds ();
+  int64_t resolution = m_resolution.GetNanoSeconds ();
+  if (resolution > 1)
+    {
+      ns = ((ns + resolution / 2) / resolution) * resolution;
+    }
+  m_elapsed = 0;
+  NS_LOG_DEBUG ("cpu time " << ns << "ns");
+  return NanoSeconds (std::max (ns, (int64_t)0));
+}
 
 } // namespace ns3
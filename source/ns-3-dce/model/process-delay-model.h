@@ -33,6 +33,11 @@ public:
 
   virtual void RecordStart (void) = 0;
   virtual Time RecordEnd (void) = 0;
+  // Called in the context of the task, when it starts or goes on
+  // running after RecordStart, and when it stops running for the main
+  // context before RecordEnd.
+  virtual void NotifyResume (void);
+  virtual void NotifySuspend (void);
 };
 
 class RandomProcessDelayModel : public ProcessDelayModel
@@ -65,6 +70,39 @@ private:
   Time m_start;
 };
 
+/**
+ * \brief The delay is the CPU time the task took to run, scaled to the
+ * CPU simulated.
+ *
+ * The time is measured by the CPU clock of the thread running the task,
+ * only while the task runs: the switches to it and back, the swapping
+ * in of its data and heap, and the work done on its behalf on the main
+ * context are left out, as are the times the host preempts it. The
+ * cost of reading the clock is measured once and subtracted.
+ */
+class CpuTimeProcessDelayModel : public ProcessDelayModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CpuTimeProcessDelayModel ();
+
+  virtual void RecordStart (void);
+  virtual Time RecordEnd (void);
+  virtual void NotifyResume (void);
+  virtual void NotifySuspend (void);
+private:
+  static int64_t GetThreadCpuTime (void);
+  static int64_t GetClockCost (void);
+
+  double m_scale;
+  Time m_overhead;
+  Time m_resolution;
+  int64_t m_start;
+  int64_t m_elapsed;
+  bool m_running;
+};
+
 } // namespace ns3
 
 #endif /* PROCESS_DELAY_MODEL_H */
@@ -50,6 +50,7 @@ class Loader;
 class Task;
 class FileUsage;
 class PollTable;
+class SyscallStats;
 
 struct Mutex
 {
@@ -182,6 +183,8 @@ struct Process
   char asctime_result[ 3 + 1 + 3 + 1 + 20 + 1 + 20 + 1 + 20 + 1 + 20 + 1 + 20 + 1 + 1]; // definition is stolen from glibc
   uint32_t nodeId; // NS3 NODE ID
   uint8_t minimizeFiles; // If true close stderr and stdout between writes .
+  uint8_t logOutput; // DceManager::LogOutput
+  SyscallStats *syscallStats; // 0 unless the manager has SyscallStats
   // an array of memory buffers which must be freed upon process
   // termination to avoid memory leaks. We stick in there a bunch
   // of buffers we allocate but for which we cannot control the
@@ -226,6 +229,9 @@ struct Thread
   Waiter *childWaiter; // Not zero if thread waiting for a child in wait or waitall ...
   PollTable *pollTable; // No 0 if a poll is running on this thread
   std::pair <UnixFd*, WaitQueueEntry*> ioWait;   // Filled if the current thread is currently waiting for IO
+  // With SyscallStats, cycles at the last switch out, and spent switched out.
+  uint64_t switchedOut;
+  uint64_t suspended;
 };
 
 } // namespace ns3
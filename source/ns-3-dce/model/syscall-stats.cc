@@ -0,0 +1,250 @@
+#include "syscall-stats.h"
+#include "process.h"
+#include "utils.h"
+#include <string.h>
+#include <stdio.h>
+
+namespace ns3 {
+
+static const char *g_syscallNames[] = {
+#define DCE(name) # name,
+#define DCET(rtype,name) DCE (name)
+#define DCE_EXPLICIT(name,rtype,...) DCE (name)
+#define NATIVE(name)
+#define NATIVET(rtype,name)
+#define NATIVE_EXPLICIT(name,type)
+#include "libc-ns3.h"
+};
+
+bool SyscallStats::g_enabled = false;
+
+SyscallStats::SyscallStats ()
+  : m_functions (SYSCALL_N, (struct Function *)0)
+{
+}
+SyscallStats::~SyscallStats ()
+{
+  for (uint32_t i = 0; i < m_functions.size (); i++)
+    {
+      delete m_functions[i];
+    }
+}
+
+struct SyscallStats::Function *
+SyscallStats::Lookup (enum SyscallId id)
+{
+  struct Function *function = m_functions[id];
+  if (function == 0)
+    {
+      function = new Function ();
+      memset (function, 0, sizeof (*function));
+      m_functions[id] = function;
+    }
+  return function;
+}
+
+void
+SyscallStats::Add (const SyscallStats &o)
+{
+  for (uint32_t i = 0; i < SYSCALL_N; i++)
+    {
+      const struct Function *from = o.m_functions[i];
+      if (from == 0)
+        {
+          continue;
+        }
+      struct Function *to = Lookup ((enum SyscallId)i);
+      to->calls += from->calls;
+      to->timed += from->timed;
+      to->cycles += from->cycles;
+      for (uint32_t j = 0; j < BUCKETS; j++)
+        {
+          to->histogram[j] += from->histogram[j];
+        }
+    }
+}
+
+const struct SyscallStats::Function *
+SyscallStats::Get (enum SyscallId id) const
+{
+  return m_functions[id];
+}
+
+const char *
+SyscallStats::GetName (enum SyscallId id)
+{
+  return g_syscallNames[id];
+}
+
+void
+SyscallStats::WriteCsvHeader (std::ostream &os)
+{
+  os << "pid,process,function,calls,timed,cycles";
+  for (uint32_t j = 0; j < BUCKETS; j++)
+    {
+      os << ",bucket" << j;
+    }
+  os << std::endl;
+}
+
+void
+SyscallStats::WriteCsvField (std::ostream &os, std::string field)
+{
+  if (field.find_first_of (",\"\r\n") == std::string::npos)
+    {
+      os << field;
+      return;
+    }
+  // quoted, with the quotes doubled.
+  os << '"';
+  for (std::string::const_iterator i = field.begin (); i != field.end (); ++i)
+    {
+      if (*i == '"')
+        {
+          os << '"';
+        }
+      os << *i;
+    }
+  os << '"';
+}
+
+void
+SyscallStats::WriteJsonString (std::ostream &os, std::string s)
+{
+  os << '"';
+  for (std::string::const_iterator i = s.begin (); i != s.end (); ++i)
+    {
+      unsigned char c = *i;
+      if (c == '"' || c == '\\')
+        {
+          os << '\\' << c;
+        }
+      else if (c < 0x20)
+        {
+          char escape[7];
+          snprintf (escape, sizeof (escape), "\\u%04x", c);
+          os << escape;
+        }
+      else
+        {
+          os << c;
+        }
+    }
+  os << '"';
+}
+
+void
+SyscallStats::WriteCsv (std::ostream &os, uint16_t pid, std::string process) const
+{
+  for (uint32_t i = 0; i < SYSCALL_N; i++)
+    {
+      const struct Function *function = m_functions[i];
+      if (function == 0)
+        {
+          continue;
+        }
+      os << pid << ",";
+      WriteCsvField (os, process);
+      os << "," << g_syscallNames[i] << ","
+         << function->calls << "," << function->timed << "," << function->cycles;
+      for (uint32_t j = 0; j < BUCKETS; j++)
+        {
+          os << "," << function->histogram[j];
+        }
+      os << std::endl;
+    }
+}
+
+void
+SyscallStats::WriteJson (std::ostream &os) const
+{
+  os << "{";
+  bool first = true;
+  for (uint32_t i = 0; i < SYSCALL_N; i++)
+    {
+      const struct Function *function = m_functions[i];
+      if (function == 0)
+        {
+          continue;
+        }
+      // the histogram stops at the last bucket which is not empty.
+      uint32_t last = BUCKETS;
+      while (last > 0 && function->histogram[last - 1] == 0)
+        {
+          last--;
+        }
+      os << (first ? "" : ",") << "\n    \"" << g_syscallNames[i] << "\": {"
+         << "\"calls\": " << function->calls
+         << ", \"timed\": " << function->timed
+         << ", \"cycles\": " << function->cycles
+         << ", \"histogram\": [";
+      for (uint32_t j = 0; j < last; j++)
+        {
+          os << (j == 0 ? "" : ", ") << function->histogram[j];
+        }
+      os << "]}";
+      first = false;
+    }
+  os << (first ? "}" : "\n  }");
+}
+
+void
+SyscallStats::Enable (void)
+{
+  g_enabled = true;
+}
+
+void
+SyscallStats::NotifySwitchFrom (struct Thread *thread)
+{
+  thread->switchedOut = ReadCycles ();
+}
+
+void
+SyscallStats::NotifySwitchTo (struct Thread *thread)
+{
+  if (thread->switchedOut != 0)
+    {
+      thread->suspended += ReadCycles () - thread->switchedOut;
+      thread->switchedOut = 0;
+    }
+}
+
+void
+SyscallCall::Enter (enum SyscallId id)
+{
+  struct Thread *current = Current ();
+  if (current == 0 || current->process->syscallStats == 0)
+    {
+      return;
+    }
+  current->process->syscallStats->Lookup (id)->calls++;
+  m_thread = current;
+  m_id = id;
+  m_suspended = current->suspended;
+  m_start = SyscallStats::ReadCycles ();
+}
+
+void
+SyscallCall::Leave (void)
+{
+  uint64_t end = SyscallStats::ReadCycles ();
+  // In the child of a fork, the call returns on another thread, which
+  // did not make it.
+  if (Current () != m_thread)
+    {
+      return;
+    }
+  uint64_t cycles = end - m_start - (m_thread->suspended - m_suspended);
+  struct SyscallStats::Function *function = m_thread->process->syscallStats->Lookup (m_id);
+  function->timed++;
+  function->cycles += cycles;
+  uint32_t bucket = cycles < 2 ? 0 : 63 - __builtin_clzll (cycles);
+  if (bucket >= SyscallStats::BUCKETS)
+    {
+      bucket = SyscallStats::BUCKETS - 1;
+    }
+  function->histogram[bucket]++;
+}
+
+} // namespace ns3
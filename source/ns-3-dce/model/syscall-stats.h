@@ -0,0 +1,179 @@
+#ifndef SYSCALL_STATS_H
+#define SYSCALL_STATS_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <time.h>
+
+namespace ns3 {
+
+struct Thread;
+
+// One for each function of libc-ns3.h implemented by DCE.
+enum SyscallId
+{
+#define DCE(name) SYSCALL_ ## name,
+#define DCET(rtype,name) DCE (name)
+#define DCE_EXPLICIT(name,rtype,...) DCE (name)
+#define NATIVE(name)
+#define NATIVET(rtype,name)
+#define NATIVE_EXPLICIT(name,type)
+#include "libc-ns3.h"
+  SYSCALL_N
+};
+
+/**
+ * \brief The number of calls of each dce_ function of a process, or of
+ * all the processes of a node, and their cost.
+ *
+ * The cost of a call is the host time spent in it, in cycles of the
+ * time stamp counter, less the time its thread was switched out: a
+ * blocking call counts only the work it does itself. Calls which do
+ * not return, such as exit, are counted but not timed. A function
+ * only takes memory once called.
+ */
+class SyscallStats
+{
+public:
+  enum
+  {
+    // bucket i counts the calls which took up to 2^(i+1)-1 cycles,
+    // the last one all the longer calls.
+    BUCKETS = 32
+  };
+  struct Function
+  {
+    uint64_t calls;
+    uint64_t timed; // calls which returned
+    uint64_t cycles;
+    uint64_t histogram[BUCKETS];
+  };
+
+  SyscallStats ();
+  ~SyscallStats ();
+
+  void Add (const SyscallStats &o);
+  // 0 if the function was never called.
+  const struct Function * Get (enum SyscallId id) const;
+  static const char * GetName (enum SyscallId id);
+
+  // one line per function called, as pid,process,function,calls,timed,cycles,bucket0,...
+  void WriteCsv (std::ostream &os, uint16_t pid, std::string process) const;
+  static void WriteCsvHeader (std::ostream &os);
+  // quoted if it holds a comma, a quote or a line break.
+  static void WriteCsvField (std::ostream &os, std::string field);
+  // a map of the functions called to their counts
+  void WriteJson (std::ostream &os) const;
+  // s as a JSON string, quoted and escaped.
+  static void WriteJsonString (std::ostream &os, std::string s);
+
+  // the processes of a manager with SyscallStats enabled have their own.
+  static void Enable (void);
+  static inline bool IsEnabled (void);
+  static inline uint64_t ReadCycles (void);
+  // Called on each switch of a thread of a process with SyscallStats.
+  static void NotifySwitchFrom (struct Thread *thread);
+  static void NotifySwitchTo (struct Thread *thread);
+
+private:
+  friend class SyscallCall;
+  SyscallStats (const SyscallStats &o);
+  SyscallStats &operator = (const SyscallStats &o);
+  struct Function * Lookup (enum SyscallId id);
+
+  std::vector<struct Function *> m_functions;
+  static bool g_enabled;
+};
+
+/**
+ * \brief Counts and times one call of a dce_ function, from its
+ * construction to its destruction.
+ */
+class SyscallCall
+{
+public:
+  inline SyscallCall (enum SyscallId id);
+  inline ~SyscallCall ();
+private:
+  void Enter (enum SyscallId id);
+  void Leave (void);
+
+  struct Thread *m_thread;
+  enum SyscallId m_id;
+  uint64_t m_start;
+  uint64_t m_suspended;
+};
+
+/**
+ * \brief What libc_dce puts in the table for dce_ function F: a
+ * function of the same type which calls it within a SyscallCall.
+ *
+ * Variadic functions cannot pass their arguments on, so they are put
+ * there as they are, and not counted.
+ */
+template <enum SyscallId ID, typename T, T F>
+struct SyscallWrapper;
+
+template <enum SyscallId ID, typename R, typename ... A, R (*F)(A ...)>
+struct SyscallWrapper<ID, R (*)(A ...), F>
+{
+  static R Call (A ... a)
+  {
+    SyscallCall call (ID);
+    return F (a ...);
+  }
+  static R (*Get (void)) (A ...)
+  {
+    return &Call;
+  }
+};
+
+template <enum SyscallId ID, typename R, typename ... A, R (*F)(A ..., ...)>
+struct SyscallWrapper<ID, R (*)(A ..., ...), F>
+{
+  static R (*Get (void)) (A ..., ...)
+  {
+    return F;
+  }
+};
+
+bool
+SyscallStats::IsEnabled (void)
+{
+  return g_enabled;
+}
+
+uint64_t
+SyscallStats::ReadCycles (void)
+{
+#if defined (__x86_64__) || defined (__i386__)
+  return __builtin_ia32_rdtsc ();
+#else
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+SyscallCall::SyscallCall (enum SyscallId id)
+  : m_thread (0)
+{
+  if (SyscallStats::IsEnabled ())
+    {
+      Enter (id);
+    }
+}
+
+SyscallCall::~SyscallCall ()
+{
+  if (m_thread != 0)
+    {
+      Leave ();
+    }
+}
+
+} // namespace ns3
+
+#endif /* SYSCALL_STATS_H */
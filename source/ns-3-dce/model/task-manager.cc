@@ -1,6 +1,7 @@
 #include "task-manager.h"
 #include "fiber-manager.h"
 #include "ucontext-fiber-manager.h"
+#include "asm-fiber-manager.h"
 #include "pthread-fiber-manager.h"
 #include "task-scheduler.h"
 #include "ns3/log.h"
@@ -94,7 +95,8 @@ TaskManager::GetTypeId (void)
                    EnumValue (PTHREAD_FIBER_MANAGER),
                    MakeEnumAccessor (&TaskManager::SetFiberManagerType),
                    MakeEnumChecker (PTHREAD_FIBER_MANAGER, "PthreadFiberManager",
-                                    UCONTEXT_FIBER_MANAGER, "UcontextFiberManager"))
+                                    UCONTEXT_FIBER_MANAGER, "UcontextFiberManager",
+                                    ASM_FIBER_MANAGER, "AsmFiberManager"))
   ;
   return tid;
 }
@@ -233,6 +235,7 @@ TaskManager::Start (void (*fn)(void*), void *context, uint32_t stackSize)
   struct StartTaskContext *ctx = new StartTaskContext ();
   ctx->function = fn;
   ctx->context = context;
+  ctx->manager = this;
   task->m_fiber = m_fiberManager->Create (&TaskManager::Trampoline, ctx, stackSize);
   NS_LOG_DEBUG ("create " << task << " fiber=" << task->m_fiber);
   task->m_state = Task::BLOCKED; // must call Wakeup on task later.
@@ -262,6 +265,8 @@ TaskManager::Clone (Task *task)
       Wakeup (clone);
       return clone;
     }
+  // the clone, running for the first time.
+  m_delayModel->NotifyResume ();
   return 0;
 }
 
@@ -271,7 +276,9 @@ TaskManager::Trampoline (void *context)
   struct StartTaskContext *ctx = (struct StartTaskContext *)context;
   void (*fn)(void*) = ctx->function;
   void *fn_context = ctx->context;
+  TaskManager *manager = ctx->manager;
   delete ctx;
+  manager->m_delayModel->NotifyResume ();
   fn (fn_context);
   NS_FATAL_ERROR ("The user function must not return.");
 }
@@ -493,6 +500,7 @@ again:
       if (fiber)
         {
           m_fiberManager->SwitchTo (fiber, m_mainFiber);
+          m_delayModel->NotifyResume ();
         }
     }
 }
@@ -509,6 +517,17 @@ TaskManager::SetFiberManagerType (enum FiberManagerType type)
     case PTHREAD_FIBER_MANAGER:
       m_fiberManager = new PthreadFiberManager ();
       break;
+    case ASM_FIBER_MANAGER:
+      if (AsmFiberManager::IsSupported ())
+        {
+          m_fiberManager = new AsmFiberManager ();
+        }
+      else
+        {
+          NS_LOG_WARN ("AsmFiberManager not supported, using UcontextFiberManager");
+          m_fiberManager = new UcontextFiberManager ();
+        }
+      break;
     default:
       NS_ASSERT (false);
       break;
@@ -551,7 +570,10 @@ TaskManager::ExecOnMain (EventImpl *e)
       struct Fiber *fiber = m_current->m_fiber;
       m_current = 0;
       m_noSignal = true;
+      // the work done on main is not the task's.
+      m_delayModel->NotifySuspend ();
       m_fiberManager->SwitchTo (fiber, m_mainFiber);
+      m_delayModel->NotifyResume ();
     }
 }
 EventId
@@ -162,11 +162,13 @@ private:
   {
     UCONTEXT_FIBER_MANAGER,
     PTHREAD_FIBER_MANAGER,
+    ASM_FIBER_MANAGER,
   };
   struct StartTaskContext
   {
     void (*function)(void *);
     void *context;
+    TaskManager *manager;
   };
 
   virtual void DoDispose (void);
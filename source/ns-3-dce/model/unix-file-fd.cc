@@ -16,8 +16,14 @@ NS_LOG_COMPONENT_DEFINE ("DceUnixFileFd");
 namespace ns3 {
 
 UnixFileFdBase::UnixFileFdBase (int realFd)
-  : m_realFd (realFd)
+  : m_realFd (realFd),
+    m_regular (false)
 {
+  struct stat st;
+  if (realFd >= 0 && ::fstat (realFd, &st) == 0)
+    {
+      m_regular = S_ISREG (st.st_mode);
+    }
 }
 UnixFileFdBase::~UnixFileFdBase ()
 {
@@ -265,6 +271,10 @@ bool
 UnixFileFdBase::CanRecv (void) const
 {
   NS_LOG_FUNCTION (this << " fd:" << m_realFd);
+  if (m_regular)
+    {
+      return true;
+    }
   // Must do a real select
   fd_set readFd;
   struct timeval timeOut;
@@ -283,6 +293,10 @@ bool
 UnixFileFdBase::CanSend (void) const
 {
   NS_LOG_FUNCTION (this << " fd:" << m_realFd);
+  if (m_regular)
+    {
+      return true;
+    }
   // Must do a real select
   fd_set writeFd;
   struct timeval timeOut;
@@ -51,6 +51,8 @@ protected:
   int PeekRealFd (void) const;
 private:
   int m_realFd;
+  // select always finds a regular file ready.
+  bool m_regular;
 };
 
 class UnixFileFd : public UnixFileFdBase
@@ -40,6 +40,7 @@
 #include "ns3/names.h"
 #include <iostream>
 #include <sstream>
+#include <vector>
 #include "ns3/ipv6-address.h"
 #include "ns3/ipv6.h"
 #include "ns3/ipv4-l3-protocol.h"
@@ -433,45 +434,66 @@ NetlinkSocket::SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress)
   //receive/handle messages), we do not setup a kernel socket to receive packet.
   //
 
-  MultipartNetlinkMessage multipartnlmsg;
-  uint32_t packet_len, remain_len;
-
-  packet_len = p->GetSize ();
-  remain_len = packet_len;
-
+  uint32_t packet_len = p->GetSize ();
 
   SllHeader header = SllHeader ();
   header.SetArpType (ARPHRD_NETLINK);
   header.SetPacketType (SllHeader::UNICAST_FROM_PEER_TO_ME);
   m_promiscSnifferTrace (header, p);
 
-  while (remain_len > NetlinkMessageHeader::GetHeaderSize ())
+  // A buffer may carry any number of messages, as a batch of route
+  // changes does: take them all off, then handle each.  Every message
+  // that fails gets its own error answer, as the kernel does, and the
+  // socket keeps the error of the first failure, not of the last
+  // message.  Route notifications are held back and go out together
+  // after the batch.
+  std::vector<NetlinkMessage> messages;
+  while (p->GetSize () >= NetlinkMessageHeader::GetHeaderSize ())
     {
-      remain_len -= p->RemoveHeader (multipartnlmsg);
-      NS_ASSERT (remain_len == p->GetSize ());
+      MultipartNetlinkMessage multipartnlmsg;
 
-      //actually, message to kernel contains single one netlink message
+      if (p->RemoveHeader (multipartnlmsg) == 0)
+        {
+          break;
+        }
       for (uint32_t i = 0; i < multipartnlmsg.GetNMessages (); i++)
         {
-          NetlinkMessage nlmsg = multipartnlmsg.GetMessage (i);
-          if (HandleMessage (nlmsg) < 0)
+          messages.push_back (multipartnlmsg.GetMessage (i));
+        }
+    }
+
+  enum SocketErrno error = ERROR_NOTERROR;
+  uint32_t failed = 0;
+  for (std::vector<NetlinkMessage>::const_iterator i = messages.begin (); i != messages.end (); ++i)
+    {
+      m_errno = ERROR_NOTERROR;
+      if (HandleMessage (*i) < 0)
+        {
+          if (m_errno == ERROR_NOTERROR)
             {
-              if (m_errno)
-                {
-                  SendAckMessage (nlmsg, -ErrnoToSimuErrno ());
-                }
+              m_errno = ERROR_INVAL;
             }
-          else if (NetlinkMessage::IsMessageFlagsAck (nlmsg.GetHeader ().GetMsgFlags ()))
+          NS_LOG_INFO ("netlink message seq " << i->GetHeader ().GetMsgSeq ()
+                       << " failed, error " << ErrnoToSimuErrno ());
+          SendAckMessage (*i, -ErrnoToSimuErrno ());
+          if (failed++ == 0)
             {
-              SendAckMessage (nlmsg, 0);
+              error = m_errno;
             }
         }
+      else if (NetlinkMessage::IsMessageFlagsAck (i->GetHeader ().GetMsgFlags ()))
+        {
+          SendAckMessage (*i, 0);
+        }
     }
+  SendRouteNotifications ();
+  m_errno = error;
 
   NotifyDataSent (packet_len);
-  if (m_errno != 0)
+  if (failed)
     {
-      NS_LOG_INFO ("netlink socket kernel error " << -m_errno);
+      NS_LOG_INFO ("netlink socket kernel error " << -ErrnoToSimuErrno () << " in "
+                   << failed << " of " << messages.size () << " messages");
     }
 
   return packet_len;
@@ -1403,15 +1425,18 @@ NetlinkSocket::DoRouteMessage (const NetlinkMessage &nlmsg, uint16_t type, uint8
                         }
                     }
 
-                  NS_LOG_DEBUG ("=After change attempt=");
-                  //Dump of table
-                  NS_LOG_DEBUG (m_node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal () << ":");
-                  for (uint32_t i = 0; i < m_ipv4Routing->GetNRoutes (); ++i)
+                  //Dump of table, which is quadratic: only when it is logged
+                  if (g_log.IsEnabled (LOG_DEBUG))
                     {
-                      Ipv4RoutingTableEntry rt = m_ipv4Routing->GetRoute (i);
-                      NS_LOG_DEBUG (rt.GetDest () << " through " << rt.GetGateway ());
+                      NS_LOG_DEBUG ("=After change attempt=");
+                      NS_LOG_DEBUG (m_node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal () << ":");
+                      for (uint32_t i = 0; i < m_ipv4Routing->GetNRoutes (); ++i)
+                        {
+                          Ipv4RoutingTableEntry rt = m_ipv4Routing->GetRoute (i);
+                          NS_LOG_DEBUG (rt.GetDest () << " through " << rt.GetGateway ());
+                        }
+                      NS_LOG_DEBUG ("= = = = = = = = = = =");
                     }
-                  NS_LOG_DEBUG ("= = = = = = = = = = =");
                 }
               else // dstlen != 32
                 {
@@ -1605,16 +1630,32 @@ NetlinkSocket::DoRouteMessage (const NetlinkMessage &nlmsg, uint16_t type, uint8
         }
     }
 
-  //then send an broadcast message, let all user know this operation happened
-  MultipartNetlinkMessage nlmsg_multi;
-  NetlinkMessage nlmsg_broadcast = nlmsg;
+  //then let all users know this operation happened, once the whole
+  //buffer sent down has been handled (see SendRouteNotifications)
+  NetlinkMessage nlmsg_notify = nlmsg;
+  NetlinkMessageHeader nhr_notify = nlmsg.GetHeader ();
+  nhr_notify.SetMsgFlags (nhr_notify.GetMsgFlags () | NETLINK_MSG_F_MULTI);
+  nlmsg_notify.SetHeader (nhr_notify);
+  m_routeNotifications.AppendMessage (nlmsg_notify);
+  return 0;
+}
+
+void
+NetlinkSocket::SendRouteNotifications (void)
+{
+  NS_LOG_FUNCTION (this << m_routeNotifications.GetNMessages ());
+
+  if (m_routeNotifications.GetNMessages () == 0)
+    {
+      return;
+    }
+
   NetlinkMessage nlmsg_done;
   NetlinkMessageHeader nhr_done = NetlinkMessageHeader (NETLINK_MSG_DONE, NETLINK_MSG_F_MULTI, 0, 0);
   nlmsg_done.SetHeader (nhr_done);
-  nlmsg_multi.AppendMessage (nlmsg);
-  nlmsg_multi.AppendMessage (nlmsg_done);
-  SendMessageBroadcast (nlmsg_multi, NETLINK_RTM_GRP_IPV4_ROUTE, GetNode ());
-  return 0;
+  m_routeNotifications.AppendMessage (nlmsg_done);
+  SendMessageBroadcast (m_routeNotifications, NETLINK_RTM_GRP_IPV4_ROUTE, GetNode ());
+  m_routeNotifications.Clear ();
 }
 
 int32_t
@@ -160,6 +160,12 @@ private:
   static int32_t SendMessageBroadcast (const MultipartNetlinkMessage &nlmsg,
                                        uint32_t group, Ptr<Node> node);
 
+  /**
+  * \brief spread the route changes made by the last buffer sent down
+  * to the route group, all in one multipart message
+  */
+  void SendRouteNotifications (void);
+
   /**
    * these functions below are for NETLINK_ROUTE protocol, it handle the netlink
    * message like linux kernel work.  this implementation follows the kernel code
@@ -226,6 +232,7 @@ private:
   bool m_shutdownSend;
   bool m_shutdownRecv;
 
+  MultipartNetlinkMessage m_routeNotifications;
   std::queue<std::pair <Ptr<Packet>, Address> > m_dataReceiveQueue;
   uint32_t m_rxAvailable;
   TracedCallback<Ptr<const Packet> > m_dropTrace;
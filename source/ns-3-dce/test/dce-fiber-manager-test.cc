@@ -0,0 +1,285 @@
+#include "ns3/test.h"
+#include "fiber-manager.h"
+#include "ucontext-fiber-manager.h"
+#include "pthread-fiber-manager.h"
+#include "asm-fiber-manager.h"
+#include "fiber-stack.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <xmmintrin.h>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+namespace ns3 {
+
+// A fiber which counts and switches back to the main fiber, as tasks
+// go back to the TaskManager, with a rounding mode of its own.
+struct PingPong
+{
+  FiberManager *manager;
+  Fiber *main;
+  Fiber *fiber;
+  long count;
+  long controlErrors;
+};
+
+static void
+PingPongFiber (void *context)
+{
+  struct PingPong *pp = (struct PingPong *)context;
+  _MM_SET_ROUNDING_MODE (_MM_ROUND_DOWN);
+  for (;;)
+    {
+      pp->count++;
+      if (_MM_GET_ROUNDING_MODE () != _MM_ROUND_DOWN)
+        {
+          pp->controlErrors++;
+        }
+      pp->manager->SwitchTo (pp->fiber, pp->main);
+    }
+}
+
+static double
+WallTime (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// Returns the time a switch took, in ns.
+static double
+RunPingPong (FiberManager *manager, long roundTrips, struct PingPong *pp)
+{
+  pp->manager = manager;
+  pp->count = 0;
+  pp->controlErrors = 0;
+  pp->main = manager->CreateFromCaller ();
+  pp->fiber = manager->Create (&PingPongFiber, pp, 1 << 16);
+  double start = WallTime ();
+  for (long i = 0; i < roundTrips; i++)
+    {
+      manager->SwitchTo (pp->main, pp->fiber);
+      if (_MM_GET_ROUNDING_MODE () != _MM_ROUND_NEAREST)
+        {
+          pp->controlErrors++;
+        }
+    }
+  double took = WallTime () - start;
+  manager->Delete (pp->fiber);
+  manager->Delete (pp->main);
+  return took * 1e9 / (2 * roundTrips);
+}
+
+static FiberManager *
+CreateFiberManager (std::string name)
+{
+  if (name == "UcontextFiberManager")
+    {
+      return new UcontextFiberManager ();
+    }
+  if (name == "PthreadFiberManager")
+    {
+      return new PthreadFiberManager ();
+    }
+  return new AsmFiberManager ();
+}
+
+class FiberManagerTestCase : public TestCase
+{
+public:
+  FiberManagerTestCase (std::string name);
+private:
+  virtual void DoRun (void);
+  std::string m_name;
+};
+
+FiberManagerTestCase::FiberManagerTestCase (std::string name)
+  : TestCase (name),
+    m_name (name)
+{
+}
+
+void
+FiberManagerTestCase::DoRun (void)
+{
+  FiberManager *manager = CreateFiberManager (m_name);
+  struct PingPong pp;
+  RunPingPong (manager, 1000, &pp);
+  delete manager;
+  NS_TEST_ASSERT_MSG_EQ (pp.count, 1000, "Fiber did not run as often as switched to");
+  NS_TEST_ASSERT_MSG_EQ (pp.controlErrors, 0, "SSE control word not kept per fiber");
+}
+
+// Stacks given back are used again for the next stack of their size
+// class, whole, and stacks of other classes do not get them. The page
+// below a stack is a guard even when its class is larger.
+class FiberStackTestCase : public TestCase
+{
+public:
+  FiberStackTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+FiberStackTestCase::FiberStackTestCase ()
+  : TestCase ("FiberStack")
+{
+}
+
+static bool
+IsReadable (uint8_t *p)
+{
+  // the kernel reads it, and fails with EFAULT rather than faulting.
+  int fds[2];
+  if (pipe (fds) == -1)
+    {
+      return false;
+    }
+  bool readable = write (fds[1], p, 1) == 1;
+  close (fds[0]);
+  close (fds[1]);
+  return readable;
+}
+
+void
+FiberStackTestCase::DoRun (void)
+{
+  uint8_t *a = FiberStack::Allocate (10000);
+  memset (a, 0x5a, 10000);
+  FiberStack::Deallocate (a, 10000);
+  uint8_t *b = FiberStack::Allocate (1 << 16);
+  NS_TEST_ASSERT_MSG_NE (a + 10000, b + (1 << 16), "Stack given to another size class");
+  uint8_t *c = FiberStack::Allocate (12000);
+  NS_TEST_ASSERT_MSG_EQ (a + 10000, c + 12000, "Stack not taken back from the pool");
+  memset (c, 0xa5, 12000);
+  long pagesize = sysconf (_SC_PAGE_SIZE);
+  uint8_t *guard = c - ((unsigned long)c % pagesize) - pagesize;
+  NS_TEST_ASSERT_MSG_EQ (IsReadable (guard), false, "No guard page below a stack smaller than its class");
+  FiberStack::Deallocate (c, 12000);
+  uint8_t *d = FiberStack::Allocate (4 * pagesize);
+  NS_TEST_ASSERT_MSG_EQ (IsReadable (d), true, "Guard page left in a stack taken back from the pool");
+  FiberStack::Deallocate (d, 4 * pagesize);
+  FiberStack::Deallocate (b, 1 << 16);
+}
+
+class FiberSwitchBenchmark : public TestCase
+{
+public:
+  FiberSwitchBenchmark ();
+private:
+  virtual void DoRun (void);
+};
+
+FiberSwitchBenchmark::FiberSwitchBenchmark ()
+  : TestCase ("ping-pong")
+{
+}
+
+void
+FiberSwitchBenchmark::DoRun (void)
+{
+  const char *names[] = { "PthreadFiberManager", "UcontextFiberManager", "AsmFiberManager" };
+  long roundTrips[] = { 100000, 1000000, 1000000 };
+  for (uint32_t i = 0; i < sizeof (names) / sizeof (names[0]); i++)
+    {
+      if (std::string (names[i]) == "AsmFiberManager" && !AsmFiberManager::IsSupported ())
+        {
+          continue;
+        }
+      FiberManager *manager = CreateFiberManager (names[i]);
+      struct PingPong pp;
+      double ns = RunPingPong (manager, roundTrips[i], &pp);
+      delete manager;
+      std::cout << names[i] << ": " << ns << " ns per switch" << std::endl;
+    }
+}
+
+// Short-lived fibers, as DCE creates for each kernel event: all of them
+// are created and run a little, then deleted.
+class FiberCreateBenchmark : public TestCase
+{
+public:
+  FiberCreateBenchmark ();
+private:
+  virtual void DoRun (void);
+};
+
+FiberCreateBenchmark::FiberCreateBenchmark ()
+  : TestCase ("create-delete")
+{
+}
+
+void
+FiberCreateBenchmark::DoRun (void)
+{
+  const char *names[] = { "UcontextFiberManager", "AsmFiberManager" };
+  const uint32_t fibers = 1000;
+  const uint32_t rounds = 20;
+  for (uint32_t i = 0; i < sizeof (names) / sizeof (names[0]); i++)
+    {
+      if (std::string (names[i]) == "AsmFiberManager" && !AsmFiberManager::IsSupported ())
+        {
+          continue;
+        }
+      FiberManager *manager = CreateFiberManager (names[i]);
+      std::vector<struct PingPong> pp (fibers);
+      Fiber *main = manager->CreateFromCaller ();
+      double start = WallTime ();
+      for (uint32_t r = 0; r < rounds; r++)
+        {
+          for (uint32_t j = 0; j < fibers; j++)
+            {
+              pp[j].manager = manager;
+              pp[j].main = main;
+              pp[j].fiber = manager->Create (&PingPongFiber, &pp[j], 1 << 16);
+              manager->SwitchTo (main, pp[j].fiber);
+            }
+          for (uint32_t j = 0; j < fibers; j++)
+            {
+              manager->Delete (pp[j].fiber);
+            }
+        }
+      double took = WallTime () - start;
+      manager->Delete (main);
+      delete manager;
+      std::cout << names[i] << ": " << took * 1e9 / (rounds * fibers)
+                << " ns per fiber created, run and deleted" << std::endl;
+    }
+  FiberStack::PrintStatistics (std::cout);
+}
+
+static class FiberManagerTestSuite : public TestSuite
+{
+public:
+  FiberManagerTestSuite ();
+} g_fiberManagerTests;
+
+FiberManagerTestSuite::FiberManagerTestSuite ()
+  : TestSuite ("dce-fiber-manager", UNIT)
+{
+  AddTestCase (new FiberStackTestCase (), TestCase::QUICK);
+  AddTestCase (new FiberManagerTestCase ("PthreadFiberManager"), TestCase::QUICK);
+  AddTestCase (new FiberManagerTestCase ("UcontextFiberManager"), TestCase::QUICK);
+  if (AsmFiberManager::IsSupported ())
+    {
+      AddTestCase (new FiberManagerTestCase ("AsmFiberManager"), TestCase::QUICK);
+    }
+}
+
+static class FiberSwitchTestSuite : public TestSuite
+{
+public:
+  FiberSwitchTestSuite ();
+} g_fiberSwitchBenchmark;
+
+FiberSwitchTestSuite::FiberSwitchTestSuite ()
+  : TestSuite ("dce-fiber-switch", PERFORMANCE)
+{
+  AddTestCase (new FiberSwitchBenchmark (), TestCase::QUICK);
+  AddTestCase (new FiberCreateBenchmark (), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -0,0 +1,166 @@
+#include "ns3/test.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/make-event.h"
+#include "kernel-socket-fd-factory.h"
+#include "loader-factory.h"
+#include "task-manager.h"
+#include "rr-task-scheduler.h"
+#include "process-delay-model.h"
+#include <vector>
+
+using namespace ns3;
+namespace ns3 {
+
+// Stands for the kernel library: only told of the switches to and
+// from its tasks.
+class SwitchCountLoader : public Loader
+{
+public:
+  SwitchCountLoader () : m_switches (0)
+  {
+  }
+  virtual void NotifyStartExecute (void)
+  {
+    m_switches++;
+  }
+  virtual Loader * Clone (void)
+  {
+    return new SwitchCountLoader ();
+  }
+  virtual void UnloadAll (void)
+  {
+  }
+  virtual void * Load (std::string filename, int flag, bool failsafe)
+  {
+    return 0;
+  }
+  virtual void Unload (void *module)
+  {
+  }
+  virtual void * Lookup (void *module, std::string symbol)
+  {
+    return 0;
+  }
+  uint32_t m_switches;
+};
+
+class KernelWorkerTestCase : public TestCase
+{
+public:
+  KernelWorkerTestCase ();
+private:
+  virtual void DoRun (void);
+  void Schedule (Time at, int event, bool block);
+  void Run (int event);
+  void Block (int event);
+  void WakeupBlocked (void);
+
+  Ptr<Node> m_node;
+  Ptr<KernelSocketFdFactory> m_factory;
+  // the events in the order they ran, a blocked event as -event when
+  // it resumes.
+  std::vector<int> m_order;
+  // the task each event ran in
+  std::vector<Task *> m_tasks;
+  Task *m_blocked;
+};
+
+KernelWorkerTestCase::KernelWorkerTestCase ()
+  : TestCase ("Check that kernel events run in order in a worker task kept for them")
+{
+}
+void
+KernelWorkerTestCase::Schedule (Time at, int event, bool block)
+{
+  EventImpl *e = block ? MakeEvent (&KernelWorkerTestCase::Block, this, event)
+    : MakeEvent (&KernelWorkerTestCase::Run, this, event);
+  Simulator::ScheduleWithContext (m_node->GetId (), at, &KernelSocketFdFactory::ScheduleTask,
+                                  PeekPointer (m_factory), e);
+}
+void
+KernelWorkerTestCase::Run (int event)
+{
+  m_order.push_back (event);
+  m_tasks[event] = TaskManager::Current ()->CurrentTask ();
+}
+// as the kernel does in task_wait
+void
+KernelWorkerTestCase::Block (int event)
+{
+  Run (event);
+  m_blocked = TaskManager::Current ()->CurrentTask ();
+  m_factory->DetachWorker ();
+  TaskManager::Current ()->Sleep ();
+  m_order.push_back (-event);
+}
+void
+KernelWorkerTestCase::WakeupBlocked (void)
+{
+  TaskManager::Current ()->Wakeup (m_blocked);
+}
+void
+KernelWorkerTestCase::DoRun (void)
+{
+  m_node = CreateObject<Node> ();
+  Ptr<TaskManager> manager = CreateObject<TaskManager> ();
+  manager->SetScheduler (CreateObject<RrTaskScheduler> ());
+  manager->SetDelayModel (CreateObject<RandomProcessDelayModel> ());
+  m_node->AggregateObject (manager);
+  SwitchCountLoader *loader = new SwitchCountLoader ();
+  m_factory = CreateObject<KernelSocketFdFactory> ();
+  m_factory->m_manager = manager;
+  m_factory->m_loader = loader;
+  m_tasks.resize (5, 0);
+  m_blocked = 0;
+
+  // 1 blocks in the kernel and leaves the worker to a new task for 2,
+  // which is then kept for 3 and 4.
+  Schedule (Seconds (0), 0, false);
+  Schedule (Seconds (0), 1, true);
+  Schedule (Seconds (0), 2, false);
+  Schedule (Seconds (1), 3, false);
+  Simulator::ScheduleWithContext (m_node->GetId (), Seconds (2),
+                                  &KernelWorkerTestCase::WakeupBlocked, this);
+  Schedule (Seconds (3), 4, false);
+  Simulator::Run ();
+
+  int expected[] = { 0, 1, 2, 3, -1, 4 };
+  NS_TEST_ASSERT_MSG_EQ (m_order.size (), 6u, "not all the events ran");
+  for (uint32_t i = 0; i < m_order.size () && i < 6; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_order[i], expected[i], "event " << i << " out of order");
+    }
+  NS_TEST_ASSERT_MSG_NE (m_tasks[0], 0, "no task");
+  NS_TEST_ASSERT_MSG_EQ (m_tasks[1], m_tasks[0], "worker not kept between events");
+  NS_TEST_ASSERT_MSG_EQ (m_blocked, m_tasks[1], "blocked event not in the worker");
+  NS_TEST_ASSERT_MSG_NE (m_tasks[2], m_tasks[1], "event run in the task of a blocked event");
+  NS_TEST_ASSERT_MSG_EQ (m_tasks[3], m_tasks[2], "idle worker not woken");
+  NS_TEST_ASSERT_MSG_EQ (m_tasks[4], m_tasks[2], "idle worker not woken");
+  // the task of the blocked event is gone once it is done.
+  NS_TEST_ASSERT_MSG_EQ (m_factory->m_kernelTasks.size (), 1u, "task of the blocked event left");
+  NS_TEST_ASSERT_MSG_EQ (m_factory->m_kernelTasks.front (), m_tasks[2], "worker lost");
+  NS_TEST_ASSERT_MSG_EQ (m_factory->m_worker, m_tasks[2], "worker lost");
+  NS_TEST_ASSERT_MSG_EQ (m_factory->m_workerIdle, true, "worker not idle");
+  NS_TEST_ASSERT_MSG_EQ (m_factory->m_workerBusy, false, "event left in flight");
+  NS_TEST_ASSERT_MSG_GT (loader->m_switches, 0u, "switches not notified to the loader");
+
+  m_factory->Dispose ();
+  m_factory = 0;
+  m_node = 0;
+  Simulator::Destroy ();
+}
+
+static class KernelWorkerTestSuite : public TestSuite
+{
+public:
+  KernelWorkerTestSuite ();
+} g_kernelWorkerTests;
+
+KernelWorkerTestSuite::KernelWorkerTestSuite ()
+  : TestSuite ("dce-kernel-worker", UNIT)
+{
+  AddTestCase (new KernelWorkerTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
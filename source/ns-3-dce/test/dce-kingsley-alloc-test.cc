@@ -0,0 +1,87 @@
+#include "ns3/test.h"
+#include "kingsley-alloc.h"
+#include <string.h>
+
+using namespace ns3;
+namespace ns3 {
+
+class KingsleyAllocCloneTestCase : public TestCase
+{
+public:
+  KingsleyAllocCloneTestCase (bool copyOnWrite);
+private:
+  virtual void DoRun (void);
+  bool m_copyOnWrite;
+};
+
+KingsleyAllocCloneTestCase::KingsleyAllocCloneTestCase (bool copyOnWrite)
+  : TestCase (copyOnWrite ? "Check heaps of clones shared until written" : "Check heaps of clones copied"),
+    m_copyOnWrite (copyOnWrite)
+{
+}
+void
+KingsleyAllocCloneTestCase::DoRun (void)
+{
+  KingsleyAlloc *parent = new KingsleyAlloc (m_copyOnWrite);
+  parent->SwitchTo ();
+  char *small = (char *)parent->Malloc (100);
+  strcpy (small, "parent");
+  char *big = (char *)parent->Malloc (100000);
+  memset (big, 'p', 100000);
+
+  KingsleyAlloc *child = parent->Clone ();
+  child->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "parent", "heap not cloned");
+  strcpy (small, "child");
+  big[5] = 'c';
+  char *own = (char *)child->Malloc (100);
+  strcpy (own, "own");
+
+  parent->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "parent", "write of the child seen by the parent");
+  NS_TEST_ASSERT_MSG_EQ (big[5], 'p', "write of the child seen by the parent");
+  strcpy (small, "parent 2");
+
+  // cloned again while the first child still shares its heap.
+  KingsleyAlloc *second = parent->Clone ();
+  child->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "child", "write of the parent seen by the child");
+  NS_TEST_ASSERT_MSG_EQ (std::string (own), "own", "allocation of the child lost");
+  second->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "parent 2", "second child not cloned from the parent");
+  second->Free ((uint8_t *)big, 100000);
+  second->Dispose ();
+  delete second;
+  child->SwitchTo ();
+  child->Dispose ();
+  delete child;
+
+  // cloned again once the children are gone.
+  parent->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "parent 2", "parent heap lost");
+  NS_TEST_ASSERT_MSG_EQ (big[99999], 'p', "chunk freed by a clone lost");
+  strcpy (small, "parent 3");
+  child = parent->Clone ();
+  strcpy (small, "parent 4");
+  child->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "parent 3", "wrong heap cloned");
+  delete child;
+  parent->SwitchTo ();
+  NS_TEST_ASSERT_MSG_EQ (std::string (small), "parent 4", "parent heap lost");
+  delete parent;
+}
+
+static class KingsleyAllocTestSuite : public TestSuite
+{
+public:
+  KingsleyAllocTestSuite ();
+} g_kingsleyAllocTests;
+
+KingsleyAllocTestSuite::KingsleyAllocTestSuite ()
+  : TestSuite ("dce-kingsley-alloc", UNIT)
+{
+  AddTestCase (new KingsleyAllocCloneTestCase (false), TestCase::QUICK);
+  AddTestCase (new KingsleyAllocCloneTestCase (true), TestCase::QUICK);
+}
+
+} // namespace ns3
@@ -0,0 +1,111 @@
+#include "ns3/test.h"
+#include "log-sink.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace ns3;
+namespace ns3 {
+
+static std::string
+ReadHostFile (std::string path)
+{
+  FILE *f = fopen (path.c_str (), "r");
+  if (f == 0)
+    {
+      return "<none>";
+    }
+  char buffer[256];
+  size_t n = fread (buffer, 1, sizeof (buffer), f);
+  fclose (f);
+  return std::string (buffer, n);
+}
+
+class LogSinkTestCase : public TestCase
+{
+public:
+  LogSinkTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+LogSinkTestCase::LogSinkTestCase ()
+  : TestCase ("Check the streams written by the log writer")
+{
+}
+void
+LogSinkTestCase::DoRun (void)
+{
+  std::string text = "log-sink-test/text";
+  std::string binary = "log-sink-test/binary";
+  int a = LogSink::Open (text, true, "");
+  int b = LogSink::Open (text, true, "");
+  int c = LogSink::Open (binary, false, "HEAD");
+  LogSink::Write (a, 0, 0, "hello ", 6);
+  LogSink::Write (b, 0, 0, "world", 5);
+  LogSink::Write (c, "1", 1, "one", 3);
+  LogSink::Flush ();
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (text), "hello world", "shared stream not written in order");
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (binary), "HEAD1one", "prefix not written with its data");
+
+  // emptied when opened again, unless all users did not close it.
+  LogSink::Close (a);
+  a = LogSink::Open (text, true, "");
+  LogSink::Write (a, 0, 0, "!", 1);
+  LogSink::Flush ();
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (text), "hello world!", "stream emptied while opened");
+  LogSink::Close (a);
+  LogSink::Close (b);
+  a = LogSink::Open (text, true, "");
+  LogSink::Flush ();
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (text), "", "stream not emptied");
+  LogSink::Close (a);
+
+  LogSink::Close (c);
+  c = LogSink::Open (binary, false, "HEAD");
+  LogSink::Write (c, "2", 1, "two", 3);
+  LogSink::Flush ();
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (binary), "HEAD1one2two", "stream emptied without reset");
+  LogSink::Close (c);
+}
+
+class LogSinkDelayTestCase : public TestCase
+{
+public:
+  LogSinkDelayTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+LogSinkDelayTestCase::LogSinkDelayTestCase ()
+  : TestCase ("Check that less than a batch is written without a Flush")
+{
+}
+void
+LogSinkDelayTestCase::DoRun (void)
+{
+  std::string path = "log-sink-test/delay";
+  int a = LogSink::Open (path, true, "HEAD");
+  usleep (200 * 1000);
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (path), "HEAD", "header not written on its own");
+  LogSink::Write (a, 0, 0, "abc", 3);
+  usleep (200 * 1000);
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (path), "HEADabc", "small write not written after the delay");
+  LogSink::Close (a);
+  LogSink::Flush ();
+}
+
+static class LogSinkTestSuite : public TestSuite
+{
+public:
+  LogSinkTestSuite ();
+} g_logSinkTests;
+
+LogSinkTestSuite::LogSinkTestSuite ()
+  : TestSuite ("dce-log-sink", UNIT)
+{
+  AddTestCase (new LogSinkTestCase (), TestCase::QUICK);
+  AddTestCase (new LogSinkDelayTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
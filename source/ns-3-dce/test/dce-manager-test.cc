@@ -244,6 +244,12 @@ DceManagerTestSuite::DceManagerTestSuite ()
         {
           isUctxFiber = true;
         }
+      // fibers cannot be cloned either.
+      val = env.find ("AsmFiberManager", 0);
+      if (val != std::string::npos)
+        {
+          isUctxFiber = true;
+        }
     }
 
   // ns-3 stack
@@ -0,0 +1,132 @@
+#include "ns3/test.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "mem-file-system.h"
+#include "utils.h"
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sstream>
+
+using namespace ns3;
+namespace ns3 {
+
+static void
+WriteHostFile (std::string path, std::string content)
+{
+  UtilsEnsureAllDirectoriesExist (path);
+  FILE *f = fopen (path.c_str (), "w");
+  fwrite (content.c_str (), 1, content.length (), f);
+  fclose (f);
+}
+
+static std::string
+ReadHostFile (std::string path)
+{
+  FILE *f = fopen (path.c_str (), "r");
+  if (f == 0)
+    {
+      return "<none>";
+    }
+  char buffer[256];
+  size_t n = fread (buffer, 1, sizeof (buffer), f);
+  fclose (f);
+  return std::string (buffer, n);
+}
+
+static std::string
+NodeDir (Ptr<Node> node)
+{
+  std::ostringstream oss;
+  oss << "files-" << node->GetId ();
+  return oss.str ();
+}
+
+class MemFileSystemTestCase : public TestCase
+{
+public:
+  MemFileSystemTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+MemFileSystemTestCase::MemFileSystemTestCase ()
+  : TestCase ("Check the files kept in memory and their flush to the node directory")
+{
+}
+void
+MemFileSystemTestCase::DoRun (void)
+{
+  WriteHostFile ("mem-fs-template/etc/motd", "hello");
+  Ptr<Node> a = CreateObject<Node> ();
+  Ptr<Node> b = CreateObject<Node> ();
+  a->AggregateObject (CreateObjectWithAttributes<MemFileSystem> ("Template", StringValue ("mem-fs-template")));
+  b->AggregateObject (CreateObjectWithAttributes<MemFileSystem> ("Template", StringValue ("mem-fs-template")));
+  Ptr<MemFileSystem> fsa = MemFileSystem::GetFileSystem (a->GetId ());
+  Ptr<MemFileSystem> fsb = MemFileSystem::GetFileSystem (b->GetId ());
+  NS_TEST_ASSERT_MSG_NE (fsa, 0, "no file system on the node");
+  WriteHostFile (NodeDir (b) + "/etc/zebra.conf", "hostname b");
+  ::unlink ((NodeDir (a) + "/etc/motd").c_str ());
+  ::unlink ((NodeDir (b) + "/etc/motd").c_str ());
+
+  // both nodes share the template file until a writes to it.
+  struct stat st;
+  NS_TEST_ASSERT_MSG_EQ (fsa->Stat ("/etc/motd", &st), 0, "template file not found");
+  NS_TEST_ASSERT_MSG_EQ (st.st_size, 5, "wrong size");
+  NS_TEST_ASSERT_MSG_EQ (fsa->Append ("/etc/../etc//motd", " a", 2), 0, "append failed");
+  NS_TEST_ASSERT_MSG_EQ (fsa->Stat ("/etc/motd", &st), 0, "file lost");
+  NS_TEST_ASSERT_MSG_EQ (st.st_size, 7, "append not seen");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Stat ("/etc/motd", &st), 0, "template file not found");
+  NS_TEST_ASSERT_MSG_EQ (st.st_size, 5, "append seen from another node");
+
+  // directories stay on the host, and files are only created in one.
+  NS_TEST_ASSERT_MSG_EQ (fsb->Handles ("/etc"), false, "directory taken in memory");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Handles ("/etc/new"), true, "file not created in a node directory");
+  NS_TEST_ASSERT_MSG_EQ (fsa->Handles ("/etc/new"), true, "file not created in a template directory");
+  NS_TEST_ASSERT_MSG_EQ (fsa->Handles ("/nodir/new"), false, "file created in a missing directory");
+  NS_TEST_ASSERT_MSG_EQ (fsa->Handles ("/etc/motd/new"), false, "file created in a file");
+
+  // files of the node directory are taken over.
+  NS_TEST_ASSERT_MSG_EQ (fsb->Rename ("/etc/zebra.conf", "/etc/zebra.conf.sav"), 0, "rename failed");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Stat ("/etc/zebra.conf", &st), -1, "renamed file still there");
+  NS_TEST_ASSERT_MSG_EQ (errno, ENOENT, "wrong error");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Append ("/var/log/1/status", "x", 1), -1, "append created a file");
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (NodeDir (b) + "/etc/zebra.conf"), "hostname b",
+                         "written to the host before a flush");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Chmod ("/etc/zebra.conf.sav", 0600), 0, "chmod failed");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Stat ("/etc/zebra.conf.sav", &st), 0, "file lost");
+  NS_TEST_ASSERT_MSG_EQ (st.st_mode, (mode_t)(S_IFREG | 0600), "chmod not seen");
+  NS_TEST_ASSERT_MSG_EQ (fsb->Readlink ("/etc/zebra.conf.sav"), -1, "file read as a link");
+  NS_TEST_ASSERT_MSG_EQ (errno, EINVAL, "wrong error");
+
+  fsa->Flush ();
+  fsb->Flush ();
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (NodeDir (a) + "/etc/motd"), "hello a", "not flushed");
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (NodeDir (b) + "/etc/motd"), "<none>",
+                         "template file flushed unmodified");
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (NodeDir (b) + "/etc/zebra.conf"), "<none>",
+                         "renamed file not removed");
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile (NodeDir (b) + "/etc/zebra.conf.sav"), "hostname b",
+                         "renamed file not flushed");
+  NS_TEST_ASSERT_MSG_EQ (::stat ((NodeDir (b) + "/etc/zebra.conf.sav").c_str (), &st), 0, "not flushed");
+  NS_TEST_ASSERT_MSG_EQ ((st.st_mode & 07777), (mode_t)0600, "mode not flushed");
+  NS_TEST_ASSERT_MSG_EQ (ReadHostFile ("mem-fs-template/etc/motd"), "hello", "template modified");
+
+  Simulator::Destroy ();
+}
+
+static class MemFileSystemTestSuite : public TestSuite
+{
+public:
+  MemFileSystemTestSuite ();
+} g_memFileSystemTests;
+
+MemFileSystemTestSuite::MemFileSystemTestSuite ()
+  : TestSuite ("dce-mem-file-system", UNIT)
+{
+  AddTestCase (new MemFileSystemTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
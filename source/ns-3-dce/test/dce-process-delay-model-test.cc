@@ -0,0 +1,101 @@
+#include "ns3/test.h"
+#include "ns3/double.h"
+#include "ns3/nstime.h"
+#include "process-delay-model.h"
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+using namespace ns3;
+namespace ns3 {
+
+static volatile double g_sink;
+
+// About a few milliseconds of CPU, always the same work.
+static void
+Work (void)
+{
+  double x = 0;
+  for (int i = 0; i < 2000000; i++)
+    {
+      x += i * 0.5;
+    }
+  g_sink = x;
+}
+
+static Time
+RunSlice (Ptr<ProcessDelayModel> model, bool sleep, bool suspendedWork)
+{
+  model->RecordStart ();
+  model->NotifyResume ();
+  Work ();
+  if (sleep)
+    {
+      usleep (20000);
+    }
+  if (suspendedWork)
+    {
+      model->NotifySuspend ();
+      Work ();
+      model->NotifyResume ();
+    }
+  return model->RecordEnd ();
+}
+
+class CpuTimeProcessDelayModelTestCase : public TestCase
+{
+public:
+  CpuTimeProcessDelayModelTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+CpuTimeProcessDelayModelTestCase::CpuTimeProcessDelayModelTestCase ()
+  : TestCase ("Check the delays measured from the CPU time of tasks")
+{
+}
+void
+CpuTimeProcessDelayModelTestCase::DoRun (void)
+{
+  Ptr<ProcessDelayModel> model = CreateObject<CpuTimeProcessDelayModel> ();
+  std::vector<int64_t> delays;
+  for (int i = 0; i < 10; i++)
+    {
+      delays.push_back (RunSlice (model, false, false).GetMicroSeconds ());
+    }
+  std::sort (delays.begin (), delays.end ());
+  int64_t median = delays[delays.size () / 2];
+  NS_TEST_ASSERT_MSG_GT (median, 0, "no CPU time measured");
+  // the same work gives the same delay, give or take the noise of the
+  // host, run after run.
+  NS_TEST_ASSERT_MSG_GT (delays.front (), median / 2, "delays of the same work unstable");
+  NS_TEST_ASSERT_MSG_LT (delays.back (), median * 2, "delays of the same work unstable");
+
+  // waiting is not running, and neither is the work done while the
+  // task is suspended.
+  int64_t slept = RunSlice (model, true, false).GetMicroSeconds ();
+  NS_TEST_ASSERT_MSG_LT (slept, median * 2, "sleep counted as CPU time");
+  int64_t suspended = RunSlice (model, false, true).GetMicroSeconds ();
+  NS_TEST_ASSERT_MSG_LT (suspended, median * 3 / 2, "work while suspended counted");
+
+  model->SetAttribute ("Scale", DoubleValue (4.0));
+  int64_t scaled = RunSlice (model, false, false).GetMicroSeconds ();
+  NS_TEST_ASSERT_MSG_GT (scaled, median * 2, "delay not scaled");
+
+  model->SetAttribute ("Resolution", TimeValue (MilliSeconds (100)));
+  NS_TEST_ASSERT_MSG_EQ (RunSlice (model, false, false), Seconds (0), "delay not rounded");
+}
+
+static class ProcessDelayModelTestSuite : public TestSuite
+{
+public:
+  ProcessDelayModelTestSuite ();
+} g_processDelayModelTests;
+
+ProcessDelayModelTestSuite::ProcessDelayModelTestSuite ()
+  : TestSuite ("dce-process-delay-model", UNIT)
+{
+  AddTestCase (new CpuTimeProcessDelayModelTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
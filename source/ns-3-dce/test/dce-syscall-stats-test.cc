@@ -0,0 +1,171 @@
+#include "ns3/test.h"
+#include "syscall-stats.h"
+#include "process.h"
+#include "utils.h"
+#include <stdarg.h>
+#include <sstream>
+
+using namespace ns3;
+namespace ns3 {
+
+static struct Thread *g_child = 0;
+
+static int
+Twice (int a)
+{
+  return 2 * a;
+}
+
+static void
+Work (void)
+{
+  volatile uint32_t sum = 0;
+  for (uint32_t i = 0; i < 1000000; i++)
+    {
+      sum += i;
+    }
+}
+
+// works as much as Work, but switched out.
+static void
+Blocked (void)
+{
+  SyscallStats::NotifySwitchFrom (gDisposingThreadContext);
+  Work ();
+  SyscallStats::NotifySwitchTo (gDisposingThreadContext);
+}
+
+// returns in another thread, as fork does in the child.
+static int
+Forked (void)
+{
+  gDisposingThreadContext = g_child;
+  return 0;
+}
+
+static int
+Variadic (const char *format, ...)
+{
+  return 0;
+}
+
+class SyscallStatsTestCase : public TestCase
+{
+public:
+  SyscallStatsTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+SyscallStatsTestCase::SyscallStatsTestCase ()
+  : TestCase ("Check the counts and cycles of the dce_ functions called by a process")
+{
+}
+void
+SyscallStatsTestCase::DoRun (void)
+{
+  struct Process process;
+  struct Thread thread;
+  struct Thread child;
+  process.syscallStats = new SyscallStats ();
+  thread.process = &process;
+  thread.switchedOut = 0;
+  thread.suspended = 0;
+  child = thread;
+  g_child = &child;
+
+  // no process to count for.
+  SyscallStats::Enable ();
+  NS_TEST_ASSERT_MSG_EQ ((SyscallWrapper<SYSCALL_getpid, int (*)(int), &Twice>::Get ()(21)), 42,
+                         "wrong result");
+  NS_TEST_ASSERT_MSG_EQ (process.syscallStats->Get (SYSCALL_getpid), 0, "counted without a process");
+
+  gDisposingThreadContext = &thread;
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((SyscallWrapper<SYSCALL_getpid, int (*)(int), &Twice>::Get ()(i)), (int) (2 * i),
+                             "wrong result");
+    }
+  SyscallWrapper<SYSCALL_sleep, void (*)(void), &Work>::Get ()();
+  SyscallWrapper<SYSCALL_select, void (*)(void), &Blocked>::Get ()();
+  SyscallWrapper<SYSCALL_fork, int (*)(void), &Forked>::Get ()();
+  gDisposingThreadContext = 0;
+
+  NS_TEST_ASSERT_MSG_EQ ((SyscallWrapper<SYSCALL_printf, int (*)(const char *, ...), &Variadic>::Get ()),
+                         &Variadic, "variadic function wrapped");
+
+  const struct SyscallStats::Function *getpid = process.syscallStats->Get (SYSCALL_getpid);
+  NS_TEST_ASSERT_MSG_NE (getpid, 0, "not counted");
+  NS_TEST_ASSERT_MSG_EQ (getpid->calls, 10, "wrong count");
+  NS_TEST_ASSERT_MSG_EQ (getpid->timed, 10, "not timed");
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < SyscallStats::BUCKETS; i++)
+    {
+      total += getpid->histogram[i];
+    }
+  NS_TEST_ASSERT_MSG_EQ (total, 10, "histogram does not add up");
+
+  // the time switched out does not count.
+  const struct SyscallStats::Function *work = process.syscallStats->Get (SYSCALL_sleep);
+  const struct SyscallStats::Function *blocked = process.syscallStats->Get (SYSCALL_select);
+  NS_TEST_ASSERT_MSG_GT (work->cycles, 0, "no cycles");
+  NS_TEST_ASSERT_MSG_LT (blocked->cycles, work->cycles / 4, "time switched out counted");
+
+  const struct SyscallStats::Function *fork = process.syscallStats->Get (SYSCALL_fork);
+  NS_TEST_ASSERT_MSG_EQ (fork->calls, 1, "fork not counted");
+  NS_TEST_ASSERT_MSG_EQ (fork->timed, 0, "return in the child timed");
+
+  SyscallStats node;
+  node.Add (*process.syscallStats);
+  node.Add (*process.syscallStats);
+  NS_TEST_ASSERT_MSG_EQ (node.Get (SYSCALL_getpid)->calls, 20, "not added");
+  total = 0;
+  for (uint32_t i = 0; i < SyscallStats::BUCKETS; i++)
+    {
+      total += node.Get (SYSCALL_getpid)->histogram[i];
+    }
+  NS_TEST_ASSERT_MSG_EQ (total, 20, "histogram not added");
+  NS_TEST_ASSERT_MSG_EQ (node.Get (SYSCALL_read), 0, "function never called has counts");
+
+  std::ostringstream csv;
+  node.WriteCsv (csv, 0, "");
+  std::string line;
+  std::istringstream lines (csv.str ());
+  uint32_t n = 0;
+  while (std::getline (lines, line))
+    {
+      n++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (n, 4, "one line per function called");
+  NS_TEST_ASSERT_MSG_NE (csv.str ().find ("0,,getpid,20,20,"), std::string::npos, "wrong line");
+
+  std::ostringstream quoted;
+  node.WriteCsv (quoted, 1, "a,\"b\"");
+  NS_TEST_ASSERT_MSG_NE (quoted.str ().find ("1,\"a,\"\"b\"\"\",getpid,20,"), std::string::npos,
+                         "process name not quoted");
+
+  std::ostringstream name;
+  SyscallStats::WriteJsonString (name, "a\"\\\n\x01");
+  NS_TEST_ASSERT_MSG_EQ (name.str (), "\"a\\\"\\\\\\u000a\\u0001\"", "string not escaped");
+
+  std::ostringstream json;
+  node.WriteJson (json);
+  NS_TEST_ASSERT_MSG_NE (json.str ().find ("\"fork\": {\"calls\": 2, \"timed\": 0, \"cycles\": 0, \"histogram\": []}"),
+                         std::string::npos, "wrong json");
+
+  delete process.syscallStats;
+}
+
+static class SyscallStatsTestSuite : public TestSuite
+{
+public:
+  SyscallStatsTestSuite ();
+} g_syscallStatsTests;
+
+SyscallStatsTestSuite::SyscallStatsTestSuite ()
+  : TestSuite ("dce-syscall-stats", UNIT)
+{
+  AddTestCase (new SyscallStatsTestCase (), TestCase::QUICK);
+}
+
+} // namespace ns3
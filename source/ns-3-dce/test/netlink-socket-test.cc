@@ -79,12 +79,14 @@ private:
   void TestInterfaceAddressMessage ();
   void TestInferfaceInfoMessage ();
   void TestRouteMessage ();
+  void TestRouteBatch ();
   void TestBroadcastMessage ();
 
   void ReceiveUnicastPacket (Ptr<Socket> socket);
   void ReceiveMulticastPacket (Ptr<Socket> socket);
   void SendCmdToKernel (uint16_t type);
   void SendNetlinkMessage (NetlinkMessage nlmsg);
+  void SendNetlinkMessage (MultipartNetlinkMessage nlmsg);
   void MonitorKernelChanges ();
   Ptr<SocketFactory> CreateNetlinkFactory (void);
 
@@ -354,6 +356,69 @@ NetlinkSocketTestCase::TestRouteMessage ()
   NS_TEST_ASSERT_MSG_EQ (CheckIsEqual (dump1, dump3), true, "msg should be same");
 }
 
+void
+NetlinkSocketTestCase::TestRouteBatch ()
+{
+  MultipartNetlinkMessage dump1, dump2, batch;
+
+  //dump route entry
+  SendNetlinkMessage (BuildGetMessage (NETLINK_RTM_GETROUTE, 0));
+  NS_TEST_ASSERT_MSG_EQ (m_unicastList.size (), 1, "queue size should be 1 (RTM_GETROUTE)");
+  dump1 = m_unicastList.front ();
+  m_unicastList.pop_front ();
+
+  //add and del a route entry, in one buffer as a routing daemon
+  //batching its changes sends them
+  batch.AppendMessage (BuildRouteMessage (NETLINK_RTM_NEWROUTE, 0));
+  batch.AppendMessage (BuildRouteMessage (NETLINK_RTM_DELROUTE, 0));
+  SendNetlinkMessage (batch);
+  NS_TEST_ASSERT_MSG_EQ (m_unicastList.size (), 2, "queue size should be 2 (RTM_NEWROUTE, RTM_DELROUTE)");
+  NS_TEST_ASSERT_MSG_EQ (CheckIsAck (m_unicastList.front ().GetMessage (0)), true, "msg should be Ack");
+  m_unicastList.pop_front ();
+  NS_TEST_ASSERT_MSG_EQ (CheckIsAck (m_unicastList.front ().GetMessage (0)), true, "msg should be Ack");
+  m_unicastList.pop_front ();
+
+  //dump route entry
+  SendNetlinkMessage (BuildGetMessage (NETLINK_RTM_GETROUTE, 0));
+  NS_TEST_ASSERT_MSG_EQ (m_unicastList.size (), 1, "queue size should be 1 (RTM_GETROUTE)");
+  dump2 = m_unicastList.front ();
+  m_unicastList.pop_front ();
+
+  NS_TEST_ASSERT_MSG_EQ (CheckIsEqual (dump1, dump2), true, "msg should be same");
+
+  //two deletes of a route which is not there, then an add and a del
+  //which work: each failure is answered, not only the last message
+  MultipartNetlinkMessage failing;
+  uint16_t types[] = { NETLINK_RTM_DELROUTE, NETLINK_RTM_DELROUTE,
+                       NETLINK_RTM_NEWROUTE, NETLINK_RTM_DELROUTE };
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NetlinkMessage nlmsg = BuildRouteMessage (types[i], 0);
+      NetlinkMessageHeader nhr = nlmsg.GetHeader ();
+      nhr.SetMsgSeq (i + 1);
+      nlmsg.SetHeader (nhr);
+      failing.AppendMessage (nlmsg);
+    }
+  SendNetlinkMessage (failing);
+  NS_TEST_ASSERT_MSG_EQ (m_unicastList.size (), 4, "queue size should be 4 (one answer per message)");
+  for (uint32_t i = 0; i < 4 && !m_unicastList.empty (); i++)
+    {
+      NetlinkMessage answer = m_unicastList.front ().GetMessage (0);
+      m_unicastList.pop_front ();
+      NS_TEST_ASSERT_MSG_EQ (answer.GetMsgType (), NETLINK_MSG_ERROR, "msg should be an answer");
+      NS_TEST_ASSERT_MSG_EQ (answer.GetHeader ().GetMsgSeq (), i + 1, "answers out of order");
+      if (i < 2)
+        {
+          NS_TEST_ASSERT_MSG_NE (answer.GetErrorMessage ().GetError (), 0, "failure " << i + 1 << " lost");
+        }
+      else
+        {
+          NS_TEST_ASSERT_MSG_EQ (CheckIsAck (answer), true, "msg should be Ack");
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_cmdSock->GetErrno (), Socket::ERROR_INVAL, "error of the first failure lost");
+}
+
 void
 NetlinkSocketTestCase::TestInferfaceInfoMessage ()
 {
@@ -410,6 +475,16 @@ NetlinkSocketTestCase::SendNetlinkMessage (NetlinkMessage nlmsg)
 
   m_cmdSock->Send (p);
 }
+
+void
+NetlinkSocketTestCase::SendNetlinkMessage (MultipartNetlinkMessage nlmsg)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (nlmsg);
+
+  m_cmdSock->Send (p);
+}
+
 void
 NetlinkSocketTestCase::SendCmdToKernel (uint16_t type)
 {
@@ -462,18 +537,25 @@ NetlinkSocketTestCase::MonitorKernelChanges ()
     {
       MultipartNetlinkMessage multinlmsg = m_multicastList.front ();
 
-      if (multinlmsg.GetNMessages () == 1)
+      //route changes come as one multipart message per buffer sent down
+      for (uint32_t i = 0; i < multinlmsg.GetNMessages (); i++)
         {
-          NetlinkMessage nlmsg = multinlmsg.GetMessage (0);
+          NetlinkMessage nlmsg = multinlmsg.GetMessage (i);
           uint16_t type;
           type = nlmsg.GetMsgType ();
-          NS_ASSERT (type == NETLINK_RTM_NEWADDR || type == NETLINK_RTM_DELADDR
-                     || type == NETLINK_RTM_NEWROUTE || type == NETLINK_RTM_DELROUTE);
-          NS_LOG_INFO ("group socket recv netlink message, type =" << type);
-        }
-      else
-        {
-          NS_LOG_WARN ("group socket recv an unwanted message");
+          if (type == NETLINK_MSG_DONE)
+            {
+              continue;
+            }
+          if (type == NETLINK_RTM_NEWADDR || type == NETLINK_RTM_DELADDR
+              || type == NETLINK_RTM_NEWROUTE || type == NETLINK_RTM_DELROUTE)
+            {
+              NS_LOG_INFO ("group socket recv netlink message, type =" << type);
+            }
+          else
+            {
+              NS_LOG_WARN ("group socket recv an unwanted message");
+            }
         }
       m_multicastList.pop_front ();
     }
@@ -584,7 +666,10 @@ NetlinkSocketTestCase::DoRun (void)
   /*test 4: for route dump/add/get message*/
   TestRouteMessage ();
 
-  /*test 5: for netlink broadcast */
+  /*test 5: for route add/del messages sent in one buffer*/
+  TestRouteBatch ();
+
+  /*test 6: for netlink broadcast */
   TestBroadcastMessage ();
 
   Simulator::Run ();
@@ -4,6 +4,8 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 #include "test-macros.h"
 
 static int g_static;
@@ -295,9 +297,43 @@ void test_fork_simple ()
     }
 }
 
+// Fork and exec a child which exits right away, iterations times, with
+// a heap of heapKB KB: what a daemon restarting a helper or a shell
+// running a command pays, which is what dce-fork-latency measures.
+static void fork_exec_bench (const char *self, int iterations, int heapKB)
+{
+  for (int i = 0; i < heapKB; i++)
+    {
+      char *block = (char *)malloc (1024);
+      memset (block, i, 1024);
+    }
+  for (int i = 0; i < iterations; i++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        {
+          static char * const args[] = { (char * const) "test-fork", (char * const) "--exit", 0 };
+          execvp (self, args);
+          exit (1);
+        }
+      int st = 0;
+      waitpid (pid, &st, 0);
+      TEST_ASSERT_EQUAL (WEXITSTATUS (st), 0);
+    }
+}
 
 int main (int argc, char *argv[])
 {
+  if (argc > 1 && strcmp (argv[1], "--exit") == 0)
+    {
+      return 0;
+    }
+  if (argc > 1 && strcmp (argv[1], "--bench") == 0)
+    {
+      fork_exec_bench (argv[0], argc > 2 ? atoi (argv[2]) : 100,
+                       argc > 3 ? atoi (argv[3]) : 4096);
+      return 0;
+    }
   printf ("main argc=%d\n",argc);
   for (int i = 0; i < argc; ++i)
     {
@@ -25,6 +25,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "prefix.h"
 #include "hash.h"
 #include "thread.h"
+#include "vector.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -160,6 +161,166 @@ bgp_adj_out_free (struct bgp_adj_out *adj)
   XFREE (MTYPE_BGP_ADJ_OUT, adj);
 }
 
+/* Peers by adj_index.  Only used to hand out free indexes.  */
+static vector adj_out_peers;
+
+#define ADJ_SHARED_WORD(I)	((I) / 32)
+#define ADJ_SHARED_BIT(I)	(1U << ((I) % 32))
+
+static int
+bgp_adj_out_shared_test (struct bgp_adj_out_shared *shared,
+			 unsigned int index)
+{
+  return (ADJ_SHARED_WORD (index) < shared->size
+	  && (shared->peers[ADJ_SHARED_WORD (index)] & ADJ_SHARED_BIT (index)));
+}
+
+static struct bgp_adj_out_shared *
+bgp_adj_out_shared_new (struct attr *attr, u_int32_t size)
+{
+  struct bgp_adj_out_shared *shared;
+
+  shared = XCALLOC (MTYPE_BGP_ADJ_OUT_SHARED,
+		    sizeof (struct bgp_adj_out_shared)
+		    + size * sizeof (u_int32_t));
+  shared->attr = attr;
+  shared->size = size;
+  return shared;
+}
+
+/* Return the link which points to the shared entry advertised to peer,
+   or NULL.  */
+static struct bgp_adj_out_shared **
+bgp_adj_out_shared_lookup (struct bgp_node *rn, struct peer *peer)
+{
+  struct bgp_adj_out_shared **link;
+
+  for (link = &rn->adj_out_shared; *link; link = &(*link)->next)
+    if (bgp_adj_out_shared_test (*link, peer->adj_index))
+      return link;
+  return NULL;
+}
+
+/* Move peer out of the shared entry into a bgp_adj_out of its own, so
+   that a new advertisement or withdraw can be queued on it.  */
+static struct bgp_adj_out *
+bgp_adj_out_unshare (struct bgp_node *rn, struct peer *peer)
+{
+  struct bgp_adj_out_shared **link;
+  struct bgp_adj_out_shared *shared;
+  struct bgp_adj_out *adj;
+
+  link = bgp_adj_out_shared_lookup (rn, peer);
+  if (link == NULL)
+    return NULL;
+  shared = *link;
+
+  /* The peer and node references held by the bit move to adj.  */
+  adj = XCALLOC (MTYPE_BGP_ADJ_OUT, sizeof (struct bgp_adj_out));
+  adj->peer = peer;
+  adj->attr = bgp_attr_intern (shared->attr);
+  BGP_ADJ_OUT_ADD (rn, adj);
+
+  shared->peers[ADJ_SHARED_WORD (peer->adj_index)]
+    &= ~ADJ_SHARED_BIT (peer->adj_index);
+  if (--shared->count == 0)
+    {
+      *link = shared->next;
+      bgp_attr_unintern (&shared->attr);
+      XFREE (MTYPE_BGP_ADJ_OUT_SHARED, shared);
+    }
+
+  return adj;
+}
+
+/* Fold an adjacency whose advertisement has been sent into the shared
+   entry for its attribute.  adj is freed.  */
+void
+bgp_adj_out_share (struct bgp_node *rn, struct bgp_adj_out *adj)
+{
+  struct bgp_adj_out_shared **link;
+  struct bgp_adj_out_shared *shared;
+  struct peer *peer = adj->peer;
+  u_int32_t word = ADJ_SHARED_WORD (peer->adj_index);
+
+  assert (adj->adv == NULL && adj->attr != NULL);
+
+  for (link = &rn->adj_out_shared; *link; link = &(*link)->next)
+    if ((*link)->attr == adj->attr)
+      break;
+
+  if (*link == NULL)
+    {
+      /* adj's attribute reference moves to the new entry.  */
+      *link = bgp_adj_out_shared_new (adj->attr, word + 1);
+      adj->attr = NULL;
+    }
+  else
+    {
+      bgp_attr_unintern (&adj->attr);
+
+      if (word >= (*link)->size)
+	{
+	  shared = bgp_adj_out_shared_new ((*link)->attr, word + 1);
+	  shared->next = (*link)->next;
+	  shared->count = (*link)->count;
+	  memcpy (shared->peers, (*link)->peers,
+		  (*link)->size * sizeof (u_int32_t));
+	  XFREE (MTYPE_BGP_ADJ_OUT_SHARED, *link);
+	  *link = shared;
+	}
+    }
+  shared = *link;
+
+  /* The peer and node references held by adj move to the bit.  */
+  shared->peers[word] |= ADJ_SHARED_BIT (peer->adj_index);
+  shared->count++;
+
+  BGP_ADJ_OUT_DEL (rn, adj);
+  XFREE (MTYPE_BGP_ADJ_OUT, adj);
+}
+
+/* Return the peer's adjacency for this node, if there is one, moving
+   it out of the shared entry if needed.  */
+struct bgp_adj_out *
+bgp_adj_out_get (struct bgp_node *rn, struct peer *peer)
+{
+  struct bgp_adj_out *adj;
+
+  for (adj = rn->adj_out; adj; adj = adj->next)
+    if (adj->peer == peer)
+      return adj;
+
+  return bgp_adj_out_unshare (rn, peer);
+}
+
+/* Return 1 when the peer has an adjacency for this node, and set attr
+   to the attribute last advertised to it, if any.  */
+int
+bgp_adj_out_advertised (struct bgp_node *rn, struct peer *peer,
+			struct attr **attr)
+{
+  struct bgp_adj_out *adj;
+  struct bgp_adj_out_shared **link;
+
+  for (adj = rn->adj_out; adj; adj = adj->next)
+    if (adj->peer == peer)
+      {
+	*attr = adj->attr;
+	return 1;
+      }
+
+  link = bgp_adj_out_shared_lookup (rn, peer);
+  if (link)
+    {
+      *attr = (*link)->attr;
+      return 1;
+    }
+
+  *attr = NULL;
+  return 0;
+}
+
 int
 bgp_adj_out_lookup (struct peer *peer, struct prefix *p,
 		    afi_t afi, safi_t safi, struct bgp_node *rn)
@@ -171,7 +332,7 @@ bgp_adj_out_lookup (struct peer *peer, struct prefix *p,
       break;
 
   if (! adj)
-    return 0;
+    return bgp_adj_out_shared_lookup (rn, peer) ? 1 : 0;
 
   return (adj->adv 
 	  ? (adj->adv->baa ? 1 : 0)
@@ -225,11 +386,7 @@ bgp_adj_out_set (struct bgp_node *rn, struct peer *peer, struct prefix *p,
 
   /* Look for adjacency information. */
   if (rn)
-    {
-      for (adj = rn->adj_out; adj; adj = adj->next)
-	if (adj->peer == peer)
-	  break;
-    }
+    adj = bgp_adj_out_get (rn, peer);
 
   if (! adj)
     {
@@ -277,10 +434,7 @@ bgp_adj_out_unset (struct bgp_node *rn, struct peer *peer, struct prefix *p,
     return;
 
   /* Lookup existing adjacency, if it is not there return immediately.  */
-  for (adj = rn->adj_out; adj; adj = adj->next)
-    if (adj->peer == peer)
-      break;
-
+  adj = bgp_adj_out_get (rn, peer);
   if (! adj)
     return;
 
@@ -395,6 +549,11 @@ bgp_sync_init (struct peer *peer)
 	peer->sync[afi][safi] = sync;
 	peer->hash[afi][safi] = hash_create (baa_hash_key, baa_hash_cmp);
       }
+
+  if (adj_out_peers == NULL)
+    adj_out_peers = vector_init (VECTOR_MIN_SIZE);
+  peer->adj_index = vector_empty_slot (adj_out_peers);
+  vector_set_index (adj_out_peers, peer->adj_index, peer);
 }
 
 void
@@ -414,4 +573,10 @@ bgp_sync_delete (struct peer *peer)
 	  hash_free (peer->hash[afi][safi]);
 	peer->hash[afi][safi] = NULL;
       }
+
+  /* Every shared entry bit holds a peer reference, so none is left
+     by now and the index can be reused.  */
+  if (adj_out_peers && vector_lookup (adj_out_peers, peer->adj_index)
+      == peer)
+    vector_unset (adj_out_peers, peer->adj_index);
 }
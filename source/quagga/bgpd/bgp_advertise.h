@@ -80,6 +80,29 @@ struct bgp_adj_out
   struct bgp_advertise *adv;
 };
 
+/* BGP adjacency out, shared by every peer which was sent the same
+   attribute.  Once an advertisement has gone out and nothing is
+   pending, the peer's bgp_adj_out is folded into this entry and the
+   peer is only a bit in the bitmap.  A set bit holds the peer and node
+   references the bgp_adj_out held.  A route server client's table is
+   its own, so there an entry never has more than the client's bit.  */
+struct bgp_adj_out_shared
+{
+  struct bgp_adj_out_shared *next;
+
+  /* Advertised attribute.  */
+  struct attr *attr;
+
+  /* Number of bits set.  */
+  u_int32_t count;
+
+  /* Size of the bitmap in words.  */
+  u_int32_t size;
+
+  /* Advertised peers, indexed by peer->adj_index.  */
+  u_int32_t peers[];
+};
+
 /* BGP adjacency in. */
 struct bgp_adj_in
 {
@@ -136,6 +159,10 @@ extern void bgp_adj_out_remove (struct bgp_node *, struct bgp_adj_out *,
 			 struct peer *, afi_t, safi_t);
 extern int bgp_adj_out_lookup (struct peer *, struct prefix *, afi_t, safi_t,
 			struct bgp_node *);
+extern struct bgp_adj_out *bgp_adj_out_get (struct bgp_node *, struct peer *);
+extern int bgp_adj_out_advertised (struct bgp_node *, struct peer *,
+				   struct attr **);
+extern void bgp_adj_out_share (struct bgp_node *, struct bgp_adj_out *);
 
 extern void bgp_adj_in_set (struct bgp_node *, struct peer *, struct attr *);
 extern void bgp_adj_in_unset (struct bgp_node *, struct peer *);
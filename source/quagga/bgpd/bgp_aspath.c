@@ -391,25 +391,6 @@ aspath_delimiter_char (u_char type, u_char which)
   return ' ';
 }
 
-/* countup asns from this segment and index onward */
-static int
-assegment_count_asns (struct assegment *seg, int from)
-{
-  int count = 0;
-  while (seg)
-    {
-      if (!from)
-        count += seg->length;
-      else
-        {
-          count += (seg->length - from);
-          from = 0;
-        }
-      seg = seg->next;
-    }
-  return count;
-}
-
 unsigned int
 aspath_count_confeds (struct aspath *aspath)
 {
@@ -503,40 +484,41 @@ aspath_has_as4 (struct aspath *aspath)
   return 0;
 }
 
-/* Convert aspath structure to string expression. */
-static char *
-aspath_make_str_count (struct aspath *as)
+/* ASN takes 5 to 10 chars plus seperator.  A segment of another type
+   than AS_SEQUENCE takes 2 more for its delimiters, then a space
+   before the next and, for the last, the final '\0'.
+
+   This was changed to 10 after the well-known BGP assertion, which
+   had hit some parts of the Internet in May of 2009.  */
+#define ASN_STR_LEN (10 + 1)
+#define SEGMENT_STR_LEN(X) (((X)->length * ASN_STR_LEN) + 2 + 1 + 1)
+
+/* Bytes the string expression of the AS path takes at most.  */
+static int
+aspath_str_size (struct aspath *as)
 {
   struct assegment *seg;
-  int str_size;
-  int len = 0;
-  char *str_buf;
+  int str_size = 1;
 
-  /* Empty aspath. */
-  if (!as->segments)
-    {
-      str_buf = XMALLOC (MTYPE_AS_STR, 1);
-      str_buf[0] = '\0';
-      return str_buf;
-    }
-  
-  seg = as->segments;
-  
-  /* ASN takes 5 to 10 chars plus seperator, see below.
-   * If there is one differing segment type, we need an additional
-   * 2 chars for segment delimiters, and the final '\0'.
-   * Hopefully this is large enough to avoid hitting the realloc
-   * code below for most common sequences.
-   *
-   * This was changed to 10 after the well-known BGP assertion, which
-   * had hit some parts of the Internet in May of 2009.
-   */
-#define ASN_STR_LEN (10 + 1)
-  str_size = MAX (assegment_count_asns (seg, 0) * ASN_STR_LEN + 2 + 1,
-                  ASPATH_STR_DEFAULT_LEN);
-  str_buf = XMALLOC (MTYPE_AS_STR, str_size);
+  for (seg = as->segments; seg; seg = seg->next)
+    str_size += SEGMENT_STR_LEN (seg);
 
-  while (seg)
+  return str_size;
+}
+
+#undef ASN_STR_LEN
+#undef SEGMENT_STR_LEN
+
+/* Write the string expression of the AS path into STR_BUF, of at least
+   aspath_str_size bytes.  Returns -1 when a segment has a type AS paths
+   cannot have.  */
+static int
+aspath_str_put (struct aspath *as, char *str_buf, int str_size)
+{
+  struct assegment *seg;
+  int len = 0;
+
+  for (seg = as->segments; seg; seg = seg->next)
     {
       int i;
       char seperator;
@@ -553,27 +535,8 @@ aspath_make_str_count (struct aspath *as)
             seperator = ' ';
             break;
           default:
-            XFREE (MTYPE_AS_STR, str_buf);
-            return NULL;
-        }
-      
-      /* We might need to increase str_buf, particularly if path has
-       * differing segments types, our initial guesstimate above will
-       * have been wrong. Need 10 chars for ASN, a seperator each and
-       * potentially two segment delimiters, plus a space between each
-       * segment and trailing zero.
-       *
-       * This definitely didn't work with the value of 5 bytes and
-       * 32-bit ASNs.
-       */
-#define SEGMENT_STR_LEN(X) (((X)->length * ASN_STR_LEN) + 2 + 1 + 1)
-      if ( (len + SEGMENT_STR_LEN(seg)) > str_size)
-        {
-          str_size = len + SEGMENT_STR_LEN(seg);
-          str_buf = XREALLOC (MTYPE_AS_STR, str_buf, str_size);
+            return -1;
         }
-#undef ASN_STR_LEN
-#undef SEGMENT_STR_LEN
       
       if (seg->type != AS_SEQUENCE)
         len += snprintf (str_buf + len, str_size - len, 
@@ -594,14 +557,39 @@ aspath_make_str_count (struct aspath *as)
                         aspath_delimiter_char (seg->type, AS_SEG_END));
       if (seg->next)
         len += snprintf (str_buf + len, str_size - len, " ");
-      
-      seg = seg->next;
     }
   
   assert (len < str_size);
   
   str_buf[len] = '\0';
 
+  return len;
+}
+
+/* Convert aspath structure to string expression. */
+static char *
+aspath_make_str_count (struct aspath *as)
+{
+  int str_size;
+  char *str_buf;
+
+  /* Empty aspath. */
+  if (!as->segments)
+    {
+      str_buf = XMALLOC (MTYPE_AS_STR, 1);
+      str_buf[0] = '\0';
+      return str_buf;
+    }
+  
+  str_size = MAX (aspath_str_size (as), ASPATH_STR_DEFAULT_LEN);
+  str_buf = XMALLOC (MTYPE_AS_STR, str_size);
+
+  if (aspath_str_put (as, str_buf, str_size) < 0)
+    {
+      XFREE (MTYPE_AS_STR, str_buf);
+      return NULL;
+    }
+
   return str_buf;
 }
 
@@ -812,6 +800,121 @@ aspath_parse (struct stream *s, size_t length, int use32bit)
   return find;
 }
 
+/* Parse an AS path as aspath_parse does, but into memory the caller
+   provides, so that it can be done off the main thread: nothing is
+   allocated, logged or interned.  SEG must have room for LENGTH / 4
+   segments, ASN for LENGTH / 2 ASes and STR for LENGTH * 7 + 1 chars.
+   The segments are normalised and the string made, as aspath_intern
+   wants them.  Returns -1 for a malformed path.  */
+int
+aspath_decode (u_char *pnt, size_t length, int use32bit, struct aspath *as,
+	       struct assegment *seg, as_t *asn, char *str)
+{
+  u_char *end = pnt + length;
+  struct assegment *prev = NULL;
+  size_t seg_size;
+  int i, tail;
+
+  memset (as, 0, sizeof (struct aspath));
+  if (length % AS16_VALUE_SIZE)
+    return -1;
+
+  while (pnt < end)
+    {
+      if (end - pnt <= AS_HEADER_SIZE)
+	return -1;
+
+      seg->type = pnt[0];
+      seg->length = pnt[1];
+      seg->next = NULL;
+      seg->as = asn;
+      pnt += AS_HEADER_SIZE;
+
+      seg_size = ASSEGMENT_DATA_SIZE (seg->length, use32bit);
+      if (pnt + seg_size > end || seg->length == 0)
+	return -1;
+
+      switch (seg->type)
+	{
+	  case AS_SEQUENCE:
+	  case AS_SET:
+	  case AS_CONFED_SEQUENCE:
+	  case AS_CONFED_SET:
+	    break;
+	  default:
+	    return -1;
+	}
+
+      for (i = 0; i < seg->length; i++)
+	{
+	  if (use32bit)
+	    {
+	      asn[i] = (as_t) pnt[0] << 24 | pnt[1] << 16 | pnt[2] << 8 | pnt[3];
+	      pnt += 4;
+	    }
+	  else
+	    {
+	      asn[i] = pnt[0] << 8 | pnt[1];
+	      pnt += 2;
+	    }
+	}
+
+      /* As assegment_normalise: sets sorted without duplicates,
+         sequences packed into the one before.  The ASes of a sequence
+         follow those of the segment before, so packing only has to
+         add up the lengths.  */
+      if (seg->type == AS_SET || seg->type == AS_CONFED_SET)
+	{
+	  qsort (seg->as, seg->length, sizeof (as_t), int_cmp);
+	  for (i = 1, tail = 0; i < seg->length; i++)
+	    if (seg->as[tail] != seg->as[i])
+	      seg->as[++tail] = seg->as[i];
+	  seg->length = tail + 1;
+	}
+
+      if (prev && ASSEGMENT_TYPES_PACKABLE (prev, seg))
+	{
+	  prev->length += seg->length;
+	  asn += seg->length;
+	  continue;
+	}
+
+      asn += seg->length;
+      if (prev)
+	prev->next = seg;
+      else
+	as->segments = seg;
+      prev = seg;
+      seg++;
+    }
+
+  if (as->segments)
+    {
+      if (aspath_str_put (as, str, aspath_str_size (as)) < 0)
+	return -1;
+    }
+  else
+    str[0] = '\0';
+  as->str = str;
+
+  return 0;
+}
+
+/* Intern an AS path made by aspath_decode.  It stays the caller's, a
+   copy of it is interned if it is not there yet.  */
+struct aspath *
+aspath_intern_decoded (struct aspath *as)
+{
+  struct aspath *find;
+
+  find = hash_get (ashash, as, aspath_hash_alloc);
+  if (! find)
+    return NULL;
+  find->refcnt++;
+
+  return find;
+}
+
 static inline void
 assegment_data_put (struct stream *s, as_t *as, int num, int use32bit)
 {
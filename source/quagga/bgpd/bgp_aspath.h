@@ -66,6 +66,9 @@ struct aspath
 extern void aspath_init (void);
 extern void aspath_finish (void);
 extern struct aspath *aspath_parse (struct stream *, size_t, int);
+extern int aspath_decode (u_char *, size_t, int, struct aspath *,
+			  struct assegment *, as_t *, char *);
+extern struct aspath *aspath_intern_decoded (struct aspath *);
 extern struct aspath *aspath_dup (struct aspath *);
 extern struct aspath *aspath_aggregate (struct aspath *, struct aspath *);
 extern struct aspath *aspath_prepend (struct aspath *, struct aspath *);
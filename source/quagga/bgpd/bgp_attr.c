@@ -38,6 +38,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_packet.h"
 #include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_pipeline.h"
 
 /* Attribute strings for logging. */
 static const struct message attr_str[] =
@@ -311,9 +312,110 @@ void bgp_attr_dup(struct attr *new, struct attr *orig)
   {
     new->extra = bgp_attr_extra_new();
     *new->extra = *orig->extra;
+    new->extra->refcnt = 0;
+  }
+}
+
+/* Extra attributes hash routines.  Many interned attributes differ only
+ * in their AS path or communities and carry the same extra attributes,
+ * the weight of the peer and the MP nexthop; those are shared.  The
+ * ecommunity, cluster and transit are interned before, so compare as
+ * pointers.
+ */
+static struct hash *attr_extra_hash;
+
+static unsigned int
+attr_extra_hash_key_make(void *p)
+{
+  struct attr_extra *attre = p;
+  uint32_t key = 0;
+
+  key = jhash_3words(attre->aggregator_as, attre->aggregator_addr.s_addr,
+                     attre->weight, key);
+  key = jhash_3words(attre->mp_nexthop_global_in.s_addr,
+                     attre->mp_nexthop_local_in.s_addr,
+                     attre->originator_id.s_addr, key);
+  key = jhash_3words((uintptr_t)attre->ecommunity, (uintptr_t)attre->cluster,
+                     (uintptr_t)attre->transit, key);
+#ifdef HAVE_IPV6
+  key = jhash_1word(attre->mp_nexthop_len, key);
+  key = jhash(attre->mp_nexthop_global.s6_addr, 16, key);
+  key = jhash(attre->mp_nexthop_local.s6_addr, 16, key);
+#endif /* HAVE_IPV6 */
+
+  return key;
+}
+
+static int
+attr_extra_hash_cmp(const void *p1, const void *p2)
+{
+  const struct attr_extra *ae1 = p1;
+  const struct attr_extra *ae2 = p2;
+
+  return ae1->aggregator_as == ae2->aggregator_as && ae1->aggregator_addr.s_addr == ae2->aggregator_addr.s_addr && ae1->weight == ae2->weight && ae1->originator_id.s_addr == ae2->originator_id.s_addr && ae1->mp_nexthop_len == ae2->mp_nexthop_len
+#ifdef HAVE_IPV6
+         && IPV6_ADDR_SAME(&ae1->mp_nexthop_global, &ae2->mp_nexthop_global) && IPV6_ADDR_SAME(&ae1->mp_nexthop_local, &ae2->mp_nexthop_local)
+#endif /* HAVE_IPV6 */
+         && IPV4_ADDR_SAME(&ae1->mp_nexthop_global_in, &ae2->mp_nexthop_global_in) && IPV4_ADDR_SAME(&ae1->mp_nexthop_local_in, &ae2->mp_nexthop_local_in) && ae1->ecommunity == ae2->ecommunity && ae1->cluster == ae2->cluster && ae1->transit == ae2->transit;
+}
+
+static void *
+attr_extra_hash_alloc(void *p)
+{
+  struct attr_extra *attre;
+
+  attre = bgp_attr_extra_new();
+  *attre = *(struct attr_extra *)p;
+  attre->refcnt = 0;
+  return attre;
+}
+
+static struct attr_extra *
+attr_extra_intern(struct attr_extra *attre)
+{
+  struct attr_extra *find;
+
+  find = hash_get(attr_extra_hash, attre, attr_extra_hash_alloc);
+  find->refcnt++;
+  return find;
+}
+
+static void
+attr_extra_unintern(struct attr_extra *attre)
+{
+  struct attr_extra *ret;
+
+  if (--attre->refcnt == 0)
+  {
+    ret = hash_release(attr_extra_hash, attre);
+    assert(ret != NULL);
+    XFREE(MTYPE_ATTR_EXTRA, attre);
   }
 }
 
+unsigned long int
+attr_extra_count(void)
+{
+  return attr_extra_hash->count;
+}
+
+static void
+attr_extra_refcount_add(struct hash_backet *backet, void *arg)
+{
+  *(unsigned long int *)arg += ((struct attr_extra *)backet->data)->refcnt;
+}
+
+/* The interned attributes with extra attributes, each of which had its
+   own copy of them before they were shared. */
+unsigned long int
+attr_extra_refcount(void)
+{
+  unsigned long int count = 0;
+
+  hash_iterate(attr_extra_hash, attr_extra_refcount_add, &count);
+  return count;
+}
+
 unsigned long int
 attr_count(void)
 {
@@ -385,6 +487,8 @@ int attrhash_cmp(const void *p1, const void *p2)
     const struct attr_extra *ae1 = attr1->extra;
     const struct attr_extra *ae2 = attr2->extra;
 
+    if (ae1 == ae2)
+      return 1;
     if (ae1 && ae2 && ae1->aggregator_as == ae2->aggregator_as && ae1->aggregator_addr.s_addr == ae2->aggregator_addr.s_addr && ae1->weight == ae2->weight
 #ifdef HAVE_IPV6
         && ae1->mp_nexthop_len == ae2->mp_nexthop_len && IPV6_ADDR_SAME(&ae1->mp_nexthop_global, &ae2->mp_nexthop_global) && IPV6_ADDR_SAME(&ae1->mp_nexthop_local, &ae2->mp_nexthop_local)
@@ -404,6 +508,7 @@ static void
 attrhash_init(void)
 {
   attrhash = hash_create(attrhash_key_make, attrhash_cmp);
+  attr_extra_hash = hash_create(attr_extra_hash_key_make, attr_extra_hash_cmp);
 }
 
 static void
@@ -411,6 +516,8 @@ attrhash_finish(void)
 {
   hash_free(attrhash);
   attrhash = NULL;
+  hash_free(attr_extra_hash);
+  attr_extra_hash = NULL;
 }
 
 static void
@@ -439,10 +546,7 @@ bgp_attr_hash_alloc(void *p)
   attr = XMALLOC(MTYPE_ATTR, sizeof(struct attr));
   *attr = *val;
   if (val->extra)
-  {
-    attr->extra = bgp_attr_extra_new();
-    *attr->extra = *val->extra;
-  }
+    attr->extra = attr_extra_intern(val->extra);
   attr->refcnt = 0;
   return attr;
 }
@@ -632,6 +736,7 @@ void bgp_attr_unintern(struct attr **attr)
 {
   struct attr *ret;
   struct attr tmp;
+  struct attr_extra tmp_extra;
 
   /* Decrement attribute reference. */
   (*attr)->refcnt--;
@@ -640,8 +745,8 @@ void bgp_attr_unintern(struct attr **attr)
 
   if ((*attr)->extra)
   {
-    tmp.extra = bgp_attr_extra_new();
-    memcpy(tmp.extra, (*attr)->extra, sizeof(struct attr_extra));
+    tmp_extra = *(*attr)->extra;
+    tmp.extra = &tmp_extra;
   }
 
   /* If reference becomes zero then free attribute object. */
@@ -649,7 +754,8 @@ void bgp_attr_unintern(struct attr **attr)
   {
     ret = hash_release(attrhash, *attr);
     assert(ret != NULL);
-    bgp_attr_extra_free(*attr);
+    if ((*attr)->extra)
+      attr_extra_unintern((*attr)->extra);
     XFREE(MTYPE_ATTR, *attr);
     *attr = NULL;
   }
@@ -794,11 +900,32 @@ bgp_attr_origin(struct peer *peer, bgp_size_t length,
   return 0;
 }
 
+/* Intern the AS path at the read pointer.  If a pipeline worker
+   decoded this very path it only has to be interned, otherwise it is
+   parsed here.  */
+static struct aspath *
+bgp_attr_aspath_decoded(struct peer *peer, bgp_size_t length, int use32bit,
+                        struct bgp_aspath_decoded *decoded)
+{
+  struct aspath *aspath;
+
+  if (!decoded || !decoded->aspath
+      || decoded->value != stream_pnt(peer->ibuf)
+      || decoded->length != length || decoded->use32bit != use32bit)
+    return aspath_parse(peer->ibuf, length, use32bit);
+
+  aspath = aspath_intern_decoded(decoded->aspath);
+  if (aspath)
+    stream_forward_getp(peer->ibuf, length);
+  return aspath;
+}
+
 /* Parse AS path information.  This function is wrapper of
    aspath_parse. */
 static int
 bgp_attr_aspath(struct peer *peer, bgp_size_t length,
-                struct attr *attr, u_char flag, u_char *startp)
+                struct attr *attr, u_char flag, u_char *startp,
+                struct bgp_update_decoded *dec)
 {
   bgp_size_t total;
 
@@ -818,8 +945,9 @@ bgp_attr_aspath(struct peer *peer, bgp_size_t length,
    * peer with AS4 => will get 4Byte ASnums
    * otherwise, will get 16 Bit
    */
-  attr->aspath = aspath_parse(peer->ibuf, length,
-                              CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV));
+  attr->aspath = bgp_attr_aspath_decoded(peer, length,
+                                         CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV),
+                                         dec ? &dec->as_path : NULL);
 
   /* In case of IBGP, length will be zero. */
   if (!attr->aspath)
@@ -894,7 +1022,7 @@ bgp_attr_aspath_check(struct peer *peer, struct attr *attr, u_char flag)
 static int
 bgp_attr_as4_path(struct peer *peer, bgp_size_t length,
                   struct attr *attr, u_char flag, u_char *startp,
-                  struct aspath **as4_path)
+                  struct aspath **as4_path, struct bgp_update_decoded *dec)
 {
   bgp_size_t total;
 
@@ -910,7 +1038,8 @@ bgp_attr_as4_path(struct peer *peer, bgp_size_t length,
                               startp, total);
   }
 
-  *as4_path = aspath_parse(peer->ibuf, length, 1);
+  *as4_path = bgp_attr_aspath_decoded(peer, length, 1,
+                                      dec ? &dec->as4_path : NULL);
 
   /* In case of IBGP, length will be zero. */
   if (!*as4_path)
@@ -1294,7 +1423,8 @@ bgp_attr_munge_as4_attrs(struct peer *peer, struct attr *attr, u_char flag,
 /* Community attribute. */
 static bgp_attr_parse_ret_t
 bgp_attr_community(struct peer *peer, bgp_size_t length,
-                   struct attr *attr, u_char flag, u_char *startp)
+                   struct attr *attr, u_char flag, u_char *startp,
+                   struct bgp_update_decoded *dec)
 {
   bgp_size_t total = length + (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN) ? 4 : 3);
 
@@ -1304,8 +1434,14 @@ bgp_attr_community(struct peer *peer, bgp_size_t length,
     return BGP_ATTR_PARSE_PROCEED;
   }
 
-  attr->community =
-      community_parse((u_int32_t *)stream_pnt(peer->ibuf), length);
+  /* Decoded already by a pipeline worker, it only has to be interned. */
+  if (dec && dec->community.community
+      && dec->community.value == stream_pnt(peer->ibuf)
+      && dec->community.length == length)
+    attr->community = community_intern_decoded(dec->community.community);
+  else
+    attr->community =
+        community_parse((u_int32_t *)stream_pnt(peer->ibuf), length);
 
   /* XXX: fix community_parse to use stream API and remove this */
   stream_forward_getp(peer->ibuf, length);
@@ -1631,10 +1767,12 @@ bgp_attr_unknown(struct peer *peer, struct attr *attr, u_char flag,
 }
 
 /* Read attribute of update packet.  This function is called from
-   bgp_update() in bgpd.c.  */
+   bgp_update() in bgpd.c.  DEC, if not NULL, holds the attributes a
+   pipeline worker decoded from the message.  */
 bgp_attr_parse_ret_t
 bgp_attr_parse(struct peer *peer, struct attr *attr, bgp_size_t size,
-               struct bgp_nlri *mp_update, struct bgp_nlri *mp_withdraw)
+               struct bgp_nlri *mp_update, struct bgp_nlri *mp_withdraw,
+               struct bgp_update_decoded *dec)
 {
   int ret;
   u_char flag = 0;
@@ -1739,10 +1877,11 @@ bgp_attr_parse(struct peer *peer, struct attr *attr, bgp_size_t size,
       ret = bgp_attr_origin(peer, length, attr, flag, startp);
       break;
     case BGP_ATTR_AS_PATH:
-      ret = bgp_attr_aspath(peer, length, attr, flag, startp);
+      ret = bgp_attr_aspath(peer, length, attr, flag, startp, dec);
       break;
     case BGP_ATTR_AS4_PATH:
-      ret = bgp_attr_as4_path(peer, length, attr, flag, startp, &as4_path);
+      ret = bgp_attr_as4_path(peer, length, attr, flag, startp, &as4_path,
+                              dec);
       break;
     case BGP_ATTR_NEXT_HOP:
       ret = bgp_attr_nexthop(peer, length, attr, flag, startp);
@@ -1765,7 +1904,7 @@ bgp_attr_parse(struct peer *peer, struct attr *attr, bgp_size_t size,
                                     &as4_aggregator_addr);
       break;
     case BGP_ATTR_COMMUNITIES:
-      ret = bgp_attr_community(peer, length, attr, flag, startp);
+      ret = bgp_attr_community(peer, length, attr, flag, startp, dec);
       break;
     case BGP_ATTR_ORIGINATOR_ID:
       ret = bgp_attr_originator_id(peer, length, attr, flag);
@@ -85,6 +85,10 @@ struct attr_extra
   
   /* MP Nexthop length */
   u_char mp_nexthop_len;
+
+  /* Reference count, the extra attributes of interned attributes are
+     interned as well and shared between them. */
+  unsigned long refcnt;
 };
 
 /* BGP core attribute structure. */
@@ -139,11 +143,13 @@ typedef enum {
 } bgp_attr_parse_ret_t;
 
 /* Prototypes. */
+struct bgp_update_decoded;
 extern void bgp_attr_init (void);
 extern void bgp_attr_finish (void);
 extern bgp_attr_parse_ret_t bgp_attr_parse (struct peer *, struct attr *,
                                            bgp_size_t, struct bgp_nlri *,
-                                           struct bgp_nlri *);
+                                           struct bgp_nlri *,
+                                           struct bgp_update_decoded *);
 extern int bgp_attr_check (struct peer *, struct attr *);
 extern struct attr_extra *bgp_attr_extra_get (struct attr *);
 extern void bgp_attr_extra_free (struct attr *);
@@ -171,6 +177,8 @@ extern unsigned int attrhash_key_make (void *);
 extern void attr_show_all (struct vty *);
 extern unsigned long int attr_count (void);
 extern unsigned long int attr_unknown_count (void);
+extern unsigned long int attr_extra_count (void);
+extern unsigned long int attr_extra_refcount (void);
 
 /* Cluster list prototypes. */
 extern int cluster_loop_check (struct cluster_list *, struct in_addr);
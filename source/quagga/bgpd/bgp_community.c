@@ -360,6 +360,56 @@ community_parse (u_int32_t *pnt, u_short length)
   return community_intern (new);
 }
 
+/* Parse communities as community_parse does, but into VAL, of at least
+   LENGTH bytes, so that it can be done off the main thread: nothing is
+   allocated or interned.  Returns -1 for a malformed attribute.  */
+int
+community_decode (u_int32_t *pnt, u_short length, struct community *com,
+		  u_int32_t *val)
+{
+  int i, tail;
+
+  memset (com, 0, sizeof (struct community));
+  if (length % 4)
+    return -1;
+
+  com->size = length / 4;
+  if (com->size == 0)
+    return 0;
+
+  memcpy (val, pnt, length);
+  qsort (val, com->size, sizeof (u_int32_t), community_compare);
+  for (i = 1, tail = 0; i < com->size; i++)
+    if (val[tail] != val[i])
+      val[++tail] = val[i];
+  com->size = tail + 1;
+  com->val = val;
+
+  return 0;
+}
+
+static void *
+community_hash_alloc_decoded (void *arg)
+{
+  return community_dup (arg);
+}
+
+/* Intern communities made by community_decode.  They stay the
+   caller's, a copy of them is interned if it is not there yet.  */
+struct community *
+community_intern_decoded (struct community *com)
+{
+  struct community *find;
+
+  find = hash_get (comhash, com, community_hash_alloc_decoded);
+  find->refcnt++;
+
+  if (! find->str)
+    find->str = community_com2str (find);
+
+  return find;
+}
+
 struct community *
 community_dup (struct community *com)
 {
@@ -57,6 +57,9 @@ extern void community_free (struct community *);
 extern struct community *community_uniq_sort (struct community *);
 extern struct community *community_parse (u_int32_t *, u_short);
 extern struct community *community_intern (struct community *);
+extern int community_decode (u_int32_t *, u_short, struct community *,
+			     u_int32_t *);
+extern struct community *community_intern_decoded (struct community *);
 extern void community_unintern (struct community **);
 extern char *community_str (struct community *);
 extern unsigned int community_hash_make (struct community *);
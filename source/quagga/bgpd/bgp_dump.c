@@ -20,6 +20,8 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 #include <zebra.h>
 
+#include <pthread.h>
+
 #include "log.h"
 #include "stream.h"
 #include "sockunion.h"
@@ -27,11 +29,14 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "prefix.h"
 #include "thread.h"
 #include "linklist.h"
+#include "memory.h"
 #include "bgpd/bgp_table.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
 #include "bgpd/bgp_dump.h"
 
 enum bgp_dump_type
@@ -192,16 +197,333 @@ bgp_dump_set_size (struct stream *s, int type)
   stream_putl_at (s, 8, stream_get_endp (s) - BGP_DUMP_HEADER_SIZE);
 }
 
+/* A routes dump is written a chunk at a time.  The table is walked from
+   a background event which encodes up to BGP_DUMP_WALK_NODES nodes into
+   a chunk buffer and hands full chunks to a writer thread, so neither
+   encoding a large table nor the disk holds up the main thread.  The
+   node the walk stopped at stays locked, and the peer index table is a
+   snapshot of locked peers: routes of peers which came up after the
+   index table was written are left out, as they have no index.  When
+   the writer has no free chunk left the walk backs off for a while
+   rather than buffering without bound.  One chunk is held from the
+   start of the walk for closing the file, so that ending the walk
+   never has to wait for the writer.  */
+#define BGP_DUMP_WALK_NODES   1000
+#define BGP_DUMP_CHUNK_SIZE   (256 * 1024)
+#define BGP_DUMP_CHUNKS       4
+#define BGP_DUMP_BACKOFF_MSEC 10
+
+struct bgp_dump_chunk
+{
+  struct bgp_dump_chunk *next;
+
+  struct stream *s;
+
+  /* File the chunk belongs to, closed after the last chunk.  */
+  FILE *fp;
+  unsigned int file;
+  int last;
+};
+
+static struct
+{
+  pthread_t thread;
+  int running;
+  int stop;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* Chunks waiting to be written, in order, and spare ones.  */
+  struct bgp_dump_chunk *head;
+  struct bgp_dump_chunk **tail;
+  struct bgp_dump_chunk *spare;
+  unsigned int pending;
+
+  /* errno of the first failed write and the number of the file it
+     was for.  */
+  int error;
+  unsigned int error_file;
+
+  /* Files started and the last one whose error was logged, main
+     thread only.  */
+  unsigned int files;
+  unsigned int reported;
+} bgp_dump_writer;
+
+static struct
+{
+  struct bgp *bgp;
+  afi_t afi;
+  struct bgp_node *rn;
+  unsigned int seq;
+
+  struct peer **peers;
+  unsigned int npeers;
+
+  FILE *fp;
+  unsigned int file;
+  struct bgp_dump_chunk *chunk;
+  struct bgp_dump_chunk *last;
+  struct stream *rec;
+
+  unsigned long bytes;
+  struct timeval started;
+} bgp_dump_walk;
+
+static void *
+bgp_dump_writer_func (void *arg)
+{
+  struct bgp_dump_chunk *chunk;
+  int error;
+
+  pthread_mutex_lock (&bgp_dump_writer.mutex);
+  while (1)
+    {
+      while (! bgp_dump_writer.head && ! bgp_dump_writer.stop)
+	pthread_cond_wait (&bgp_dump_writer.cond, &bgp_dump_writer.mutex);
+      if (! bgp_dump_writer.head)
+	break;
+
+      chunk = bgp_dump_writer.head;
+      bgp_dump_writer.head = chunk->next;
+      if (! bgp_dump_writer.head)
+	bgp_dump_writer.tail = &bgp_dump_writer.head;
+
+      /* After a failed write the rest of the file is useless, but the
+	 chunks still have to come back and the file be closed.  */
+      error = bgp_dump_writer.error_file == chunk->file
+	? bgp_dump_writer.error : 0;
+      pthread_mutex_unlock (&bgp_dump_writer.mutex);
+
+      if (! error)
+	{
+	  u_char *p = STREAM_DATA (chunk->s);
+	  size_t left = stream_get_endp (chunk->s);
+
+	  while (left > 0)
+	    {
+	      ssize_t n = write (fileno (chunk->fp), p, left);
+
+	      if (n < 0 && errno == EINTR)
+		continue;
+	      if (n <= 0)
+		{
+		  error = n < 0 ? errno : ENOSPC;
+		  break;
+		}
+	      p += n;
+	      left -= n;
+	    }
+	}
+      if (chunk->last && fclose (chunk->fp) != 0 && ! error)
+	error = errno;
+
+      pthread_mutex_lock (&bgp_dump_writer.mutex);
+      if (error)
+	{
+	  bgp_dump_writer.error = error;
+	  bgp_dump_writer.error_file = chunk->file;
+	}
+      chunk->next = bgp_dump_writer.spare;
+      bgp_dump_writer.spare = chunk;
+      bgp_dump_writer.pending--;
+    }
+  pthread_mutex_unlock (&bgp_dump_writer.mutex);
+
+  return NULL;
+}
+
+static int
+bgp_dump_writer_start (void)
+{
+  sigset_t set, oset;
+  int i, ret;
+
+  if (bgp_dump_writer.running)
+    return 0;
+
+  pthread_mutex_init (&bgp_dump_writer.mutex, NULL);
+  pthread_cond_init (&bgp_dump_writer.cond, NULL);
+  bgp_dump_writer.tail = &bgp_dump_writer.head;
+  bgp_dump_writer.stop = 0;
+
+  for (i = 0; i < BGP_DUMP_CHUNKS; i++)
+    {
+      struct bgp_dump_chunk *chunk;
+
+      chunk = XCALLOC (MTYPE_BGP_DUMP, sizeof (struct bgp_dump_chunk));
+      chunk->s = stream_new (BGP_DUMP_CHUNK_SIZE);
+      chunk->next = bgp_dump_writer.spare;
+      bgp_dump_writer.spare = chunk;
+    }
+
+  /* Signals are for the main thread only.  */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, &oset);
+  ret = pthread_create (&bgp_dump_writer.thread, NULL,
+			bgp_dump_writer_func, NULL);
+  pthread_sigmask (SIG_SETMASK, &oset, NULL);
+
+  if (ret)
+    {
+      zlog_warn ("bgp_dump: can't start writer thread: %s",
+		 safe_strerror (ret));
+      return -1;
+    }
+  bgp_dump_writer.running = 1;
+  return 0;
+}
+
+/* errno of the first failed write to file number FILE, 0 if none.  */
+static int
+bgp_dump_file_error (unsigned int file)
+{
+  int error;
+
+  pthread_mutex_lock (&bgp_dump_writer.mutex);
+  error = bgp_dump_writer.error_file == file ? bgp_dump_writer.error : 0;
+  pthread_mutex_unlock (&bgp_dump_writer.mutex);
+
+  return error;
+}
+
+/* The last chunks of a file are written after its walk ended, so a
+   failure there is only logged when the next file is started or the
+   writer stopped.  */
 static void
-bgp_dump_routes_index_table(struct bgp *bgp)
+bgp_dump_writer_report (void)
 {
+  int error;
+
+  if (bgp_dump_writer.reported == bgp_dump_writer.files)
+    return;
+
+  error = bgp_dump_file_error (bgp_dump_writer.files);
+  if (error)
+    {
+      zlog_warn ("bgp_dump: previous routes dump failed: %s",
+		 safe_strerror (error));
+      bgp_dump_writer.reported = bgp_dump_writer.files;
+    }
+}
+
+static void
+bgp_dump_writer_stop (void)
+{
+  struct bgp_dump_chunk *chunk;
+
+  if (! bgp_dump_writer.running)
+    return;
+
+  pthread_mutex_lock (&bgp_dump_writer.mutex);
+  bgp_dump_writer.stop = 1;
+  pthread_cond_signal (&bgp_dump_writer.cond);
+  pthread_mutex_unlock (&bgp_dump_writer.mutex);
+  pthread_join (bgp_dump_writer.thread, NULL);
+  bgp_dump_writer_report ();
+
+  while ((chunk = bgp_dump_writer.spare) != NULL)
+    {
+      bgp_dump_writer.spare = chunk->next;
+      stream_free (chunk->s);
+      XFREE (MTYPE_BGP_DUMP, chunk);
+    }
+  pthread_mutex_destroy (&bgp_dump_writer.mutex);
+  pthread_cond_destroy (&bgp_dump_writer.cond);
+  bgp_dump_writer.running = 0;
+}
+
+/* Take a spare chunk for FP, NULL if the writer has none to give.  */
+static struct bgp_dump_chunk *
+bgp_dump_chunk_get (FILE *fp)
+{
+  struct bgp_dump_chunk *chunk;
+
+  pthread_mutex_lock (&bgp_dump_writer.mutex);
+  chunk = bgp_dump_writer.spare;
+  if (chunk)
+    bgp_dump_writer.spare = chunk->next;
+  pthread_mutex_unlock (&bgp_dump_writer.mutex);
+
+  if (chunk)
+    {
+      /* Shrink chunks an oversized record made grow.  */
+      if (STREAM_SIZE (chunk->s) > BGP_DUMP_CHUNK_SIZE)
+	{
+	  stream_free (chunk->s);
+	  chunk->s = stream_new (BGP_DUMP_CHUNK_SIZE);
+	}
+      stream_reset (chunk->s);
+      chunk->fp = fp;
+      chunk->file = bgp_dump_walk.file;
+      chunk->last = 0;
+      chunk->next = NULL;
+    }
+  return chunk;
+}
+
+static void
+bgp_dump_chunk_put (struct bgp_dump_chunk *chunk)
+{
+  bgp_dump_walk.bytes += stream_get_endp (chunk->s);
+
+  pthread_mutex_lock (&bgp_dump_writer.mutex);
+  *bgp_dump_writer.tail = chunk;
+  bgp_dump_writer.tail = &chunk->next;
+  bgp_dump_writer.pending++;
+  pthread_cond_signal (&bgp_dump_writer.cond);
+  pthread_mutex_unlock (&bgp_dump_writer.mutex);
+}
+
+/* Append the record in REC to the walk's chunk.  Returns -1 when the
+   chunk was full and no spare one is available; the record is kept
+   and appended by the next call.  */
+static int
+bgp_dump_walk_append (struct stream *rec)
+{
+  size_t len = stream_get_endp (rec);
+
+  if (bgp_dump_walk.chunk
+      && STREAM_WRITEABLE (bgp_dump_walk.chunk->s) < len
+      && stream_get_endp (bgp_dump_walk.chunk->s) > 0)
+    {
+      bgp_dump_chunk_put (bgp_dump_walk.chunk);
+      bgp_dump_walk.chunk = NULL;
+    }
+  if (! bgp_dump_walk.chunk)
+    bgp_dump_walk.chunk = bgp_dump_chunk_get (bgp_dump_walk.fp);
+  if (! bgp_dump_walk.chunk)
+    return -1;
+
+  /* A record bigger than a whole chunk gets a chunk of its own.  */
+  if (STREAM_WRITEABLE (bgp_dump_walk.chunk->s) < len)
+    stream_resize (bgp_dump_walk.chunk->s, len);
+
+  stream_put (bgp_dump_walk.chunk->s, STREAM_DATA (rec), len);
+  stream_reset (rec);
+  return 0;
+}
+
+/* Make sure REC has room for another LEN bytes.  */
+static void
+bgp_dump_reserve (struct stream *rec, size_t len)
+{
+  if (STREAM_WRITEABLE (rec) < len)
+    stream_resize (rec, STREAM_SIZE (rec) * 2 + len);
+}
+
+static void
+bgp_dump_routes_index_table (struct stream *obuf)
+{
+  struct bgp *bgp = bgp_dump_walk.bgp;
   struct peer *peer;
   struct listnode *node;
   uint16_t peerno = 0;
-  struct stream *obuf;
 
-  obuf = bgp_dump_obuf;
-  stream_reset (obuf);
+  bgp_dump_walk.peers = XCALLOC (MTYPE_BGP_DUMP,
+				 (listcount (bgp->peer) + 1)
+				 * sizeof (struct peer *));
 
   /* MRT header */
   bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_PEER_INDEX_TABLE);
@@ -220,12 +542,13 @@ bgp_dump_routes_index_table(struct bgp *bgp)
       stream_putw(obuf, 0);
     }
 
-  /* Peer count */
-  stream_putw (obuf, listcount(bgp->peer));
+  /* Peer count, with peer_self last */
+  stream_putw (obuf, listcount(bgp->peer) + 1);
 
   /* Walk down all peers */
   for(ALL_LIST_ELEMENTS_RO (bgp->peer, node, peer))
     {
+      bgp_dump_reserve (obuf, 1 + 4 + IPV6_MAX_BYTELEN + 4);
 
       /* Peer's type */
       if (sockunion_family(&peer->su) == AF_INET)
@@ -259,127 +582,256 @@ bgp_dump_routes_index_table(struct bgp *bgp)
       /* Note that, as this is an AS4 compliant quagga, the RIB is always AS4 */
       stream_putl (obuf, peer->as);
 
-      /* Store the peer number for this peer */
+      /* Store the peer number for this peer, and keep the peer around
+         for as long as the walk may meet its routes.  */
       peer->table_dump_index = peerno;
+      bgp_dump_walk.peers[peerno] = peer_lock (peer);
       peerno++;
     }
 
-  bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
+  /* Routes of network statements, aggregates and redistribution are
+     peer_self's, which is not on the peer list.  It goes in as an IPv4
+     peer with the router ID and no address.  */
+  bgp_dump_reserve (obuf, 1 + 4 + 4 + 4);
+  stream_putc (obuf, TABLE_DUMP_V2_PEER_INDEX_TABLE_AS4+TABLE_DUMP_V2_PEER_INDEX_TABLE_IP);
+  stream_put_in_addr (obuf, &bgp->router_id);
+  stream_putl (obuf, 0);
+  stream_putl (obuf, bgp->as);
+  bgp->peer_self->table_dump_index = peerno;
+  bgp_dump_walk.peers[peerno] = peer_lock (bgp->peer_self);
+  peerno++;
+  bgp_dump_walk.npeers = peerno;
 
-  fwrite (STREAM_DATA (obuf), stream_get_endp (obuf), 1, bgp_dump_routes.fp);
-  fflush (bgp_dump_routes.fp);
+  bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
 }
 
-
-/* Runs under child process. */
-static unsigned int
-bgp_dump_routes_func (int afi, int first_run, unsigned int seq)
+/* Encode the RIB entry record for RN into REC.  Returns 0 if none of
+   its routes belongs to a peer in the index table.  */
+static int
+bgp_dump_routes_node (struct stream *obuf, struct bgp_node *rn, time_t now)
 {
-  struct stream *obuf;
   struct bgp_info *info;
-  struct bgp_node *rn;
-  struct bgp *bgp;
-  struct bgp_table *table;
+  afi_t afi = bgp_dump_walk.afi;
+  size_t sizep;
+  uint16_t entry_count = 0;
 
-  bgp = bgp_get_default ();
-  if (!bgp)
-    return seq;
+  /* MRT header */
+  if (afi == AFI_IP)
+    {
+      bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV4_UNICAST);
+    }
+#ifdef HAVE_IPV6
+  else if (afi == AFI_IP6)
+    {
+      bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV6_UNICAST);
+    }
+#endif /* HAVE_IPV6 */
 
-  if (bgp_dump_routes.fp == NULL)
-    return seq;
+  /* Sequence number */
+  stream_putl(obuf, bgp_dump_walk.seq);
 
-  /* Note that bgp_dump_routes_index_table will do ipv4 and ipv6 peers,
-     so this should only be done on the first call to bgp_dump_routes_func.
-     ( this function will be called once for ipv4 and once for ipv6 ) */
-  if(first_run)
-    bgp_dump_routes_index_table(bgp);
+  /* Prefix length */
+  stream_putc (obuf, rn->p.prefixlen);
 
-  obuf = bgp_dump_obuf;
-  stream_reset(obuf);
+  /* Prefix, only the useful bits (those not 0), but aligned on 8 bits */
+  stream_write (obuf, &rn->p.u.prefix, (rn->p.prefixlen+7)/8);
 
-  /* Walk down each BGP route. */
-  table = bgp->rib[afi][SAFI_UNICAST];
+  /* Save where we are now, so we can overwride the entry count later */
+  sizep = stream_get_endp(obuf);
+  stream_putw(obuf, 0);
 
-  for (rn = bgp_table_top (table); rn; rn = bgp_route_next (rn))
+  for (info = rn->info; info; info = info->next)
     {
-      if(!rn->info)
-        continue;
+      struct attr *attr = info->attr;
+      size_t len;
 
-      stream_reset(obuf);
+      if (info->peer->table_dump_index >= bgp_dump_walk.npeers
+	  || bgp_dump_walk.peers[info->peer->table_dump_index] != info->peer)
+	continue;
 
-      /* MRT header */
-      if (afi == AFI_IP)
-        {
-          bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV4_UNICAST);
-        }
-#ifdef HAVE_IPV6
-      else if (afi == AFI_IP6)
-        {
-          bgp_dump_header (obuf, MSG_TABLE_DUMP_V2, TABLE_DUMP_V2_RIB_IPV6_UNICAST);
-        }
-#endif /* HAVE_IPV6 */
+      /* Room for everything bgp_dump_routes_attr may write; an AS path
+         or community list can take more than a BGP message would.  */
+      len = 2 + 4 + 64 + aspath_size (attr->aspath) + 2 * IPV6_MAX_BYTELEN
+	+ (attr->community ? attr->community->size * 4 : 0);
+      bgp_dump_reserve (obuf, len);
 
-      /* Sequence number */
-      stream_putl(obuf, seq);
+      entry_count++;
 
-      /* Prefix length */
-      stream_putc (obuf, rn->p.prefixlen);
+      /* Peer index */
+      stream_putw(obuf, info->peer->table_dump_index);
 
-      /* Prefix */
-      if (afi == AFI_IP)
-        {
-          /* We'll dump only the useful bits (those not 0), but have to align on 8 bits */
-          stream_write(obuf, (u_char *)&rn->p.u.prefix4, (rn->p.prefixlen+7)/8);
-        }
-#ifdef HAVE_IPV6
-      else if (afi == AFI_IP6)
-        {
-          /* We'll dump only the useful bits (those not 0), but have to align on 8 bits */
-          stream_write (obuf, (u_char *)&rn->p.u.prefix6, (rn->p.prefixlen+7)/8);
-        }
-#endif /* HAVE_IPV6 */
+      /* Originated */
+#ifdef HAVE_CLOCK_MONOTONIC
+      stream_putl (obuf, now - (bgp_clock() - info->uptime));
+#else
+      stream_putl (obuf, info->uptime);
+#endif /* HAVE_CLOCK_MONOTONIC */
 
-      /* Save where we are now, so we can overwride the entry count later */
-      int sizep = stream_get_endp(obuf);
+      /* Dump attribute. */
+      bgp_dump_routes_attr (obuf, attr, &rn->p);
+    }
 
-      /* Entry count */
-      uint16_t entry_count = 0;
+  if (! entry_count)
+    {
+      stream_reset (obuf);
+      return 0;
+    }
 
-      /* Entry count, note that this is overwritten later */
-      stream_putw(obuf, 0);
+  /* Overwrite the entry count, now that we know the right number */
+  stream_putw_at (obuf, sizep, entry_count);
 
-      for (info = rn->info; info; info = info->next)
-        {
-          entry_count++;
+  bgp_dump_walk.seq++;
 
-          /* Peer index */
-          stream_putw(obuf, info->peer->table_dump_index);
+  bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
+  return 1;
+}
 
-          /* Originated */
-#ifdef HAVE_CLOCK_MONOTONIC
-          stream_putl (obuf, time(NULL) - (bgp_clock() - info->uptime));
-#else
-          stream_putl (obuf, info->uptime);
-#endif /* HAVE_CLOCK_MONOTONIC */
+/* Finish the walk, successfully or not: release what it holds and
+   queue the end of the file.  */
+static void
+bgp_dump_routes_done (int aborted)
+{
+  unsigned int i;
+  struct timeval now;
 
-          /* Dump attribute. */
-          /* Skip prefix & AFI/SAFI for MP_NLRI */
-          bgp_dump_routes_attr (obuf, info->attr, &rn->p);
-        }
+  if (t_bgp_dump_routes)
+    {
+      thread_cancel (t_bgp_dump_routes);
+      t_bgp_dump_routes = NULL;
+    }
+  if (bgp_dump_walk.rn)
+    bgp_unlock_node (bgp_dump_walk.rn);
+  for (i = 0; i < bgp_dump_walk.npeers; i++)
+    peer_unlock (bgp_dump_walk.peers[i]);
+  if (bgp_dump_walk.peers)
+    XFREE (MTYPE_BGP_DUMP, bgp_dump_walk.peers);
+  bgp_unlock (bgp_dump_walk.bgp);
+
+  /* The chunk held back closes the file.  Without it nothing of the
+     file went to the writer, so it is closed here.  */
+  if (bgp_dump_walk.chunk)
+    bgp_dump_chunk_put (bgp_dump_walk.chunk);
+  if (bgp_dump_walk.last)
+    {
+      bgp_dump_walk.last->last = 1;
+      bgp_dump_chunk_put (bgp_dump_walk.last);
+    }
+  else
+    fclose (bgp_dump_walk.fp);
+
+  gettimeofday (&now, NULL);
+  zlog_info ("bgp_dump: routes dump %s: %u RIB entries, %lu bytes in %ld ms",
+	     aborted ? "aborted" : "written", bgp_dump_walk.seq,
+	     bgp_dump_walk.bytes,
+	     (now.tv_sec - bgp_dump_walk.started.tv_sec) * 1000
+	     + (now.tv_usec - bgp_dump_walk.started.tv_usec) / 1000);
+
+  stream_free (bgp_dump_walk.rec);
+  memset (&bgp_dump_walk, 0, sizeof (bgp_dump_walk));
+}
+
+static int
+bgp_dump_routes_walk (struct thread *t)
+{
+  struct stream *rec = bgp_dump_walk.rec;
+  struct bgp_node *rn;
+  time_t now;
+  int nodes, error;
+
+  t_bgp_dump_routes = NULL;
+
+  error = bgp_dump_file_error (bgp_dump_walk.file);
+  if (error)
+    {
+      zlog_warn ("bgp_dump: write error: %s", safe_strerror (error));
+      bgp_dump_writer.reported = bgp_dump_walk.file;
+      bgp_dump_routes_done (1);
+      return 0;
+    }
+
+  /* The chunks of the previous file may still be with the writer.  */
+  if (! bgp_dump_walk.last)
+    {
+      bgp_dump_walk.last = bgp_dump_chunk_get (bgp_dump_walk.fp);
+      if (! bgp_dump_walk.last)
+	goto backoff;
+    }
+
+  /* A record left over from last time goes first.  */
+  if (stream_get_endp (rec) > 0 && bgp_dump_walk_append (rec) < 0)
+    goto backoff;
+
+  now = time (NULL);
+  for (nodes = 0; nodes < BGP_DUMP_WALK_NODES; nodes++)
+    {
+      rn = bgp_dump_walk.rn;
+      if (! rn)
+	{
+#ifdef HAVE_IPV6
+	  if (bgp_dump_walk.afi == AFI_IP && bgp_dump_walk.bgp->rib[AFI_IP6][SAFI_UNICAST])
+	    {
+	      bgp_dump_walk.afi = AFI_IP6;
+	      bgp_dump_walk.rn =
+		bgp_table_top (bgp_dump_walk.bgp->rib[AFI_IP6][SAFI_UNICAST]);
+	      continue;
+	    }
+#endif /* HAVE_IPV6 */
+	  bgp_dump_routes_done (0);
+	  return 0;
+	}
+
+      /* bgp_route_next moves the lock on to the next node.  */
+      bgp_dump_walk.rn = bgp_route_next (rn);
+
+      if (rn->info && bgp_dump_routes_node (rec, rn, now)
+	  && bgp_dump_walk_append (rec) < 0)
+	goto backoff;
+    }
 
-      /* Overwrite the entry count, now that we know the right number */
-      stream_putw_at (obuf, sizep, entry_count);
+  t_bgp_dump_routes = thread_add_background (master, bgp_dump_routes_walk,
+					     NULL, 0);
+  return 0;
 
-      seq++;
+ backoff:
+  t_bgp_dump_routes = thread_add_background (master, bgp_dump_routes_walk,
+					     NULL, BGP_DUMP_BACKOFF_MSEC);
+  return 0;
+}
 
-      bgp_dump_set_size(obuf, MSG_TABLE_DUMP_V2);
-      fwrite (STREAM_DATA (obuf), stream_get_endp (obuf), 1, bgp_dump_routes.fp);
+/* Start writing the default instance's RIB to BGP_DUMP's file.  */
+static void
+bgp_dump_routes_start (struct bgp_dump *bgp_dump)
+{
+  struct bgp *bgp;
 
+  bgp = bgp_get_default ();
+  if (! bgp || bgp_dump_writer_start () < 0)
+    {
+      fclose (bgp_dump->fp);
+      bgp_dump->fp = NULL;
+      return;
     }
 
-  fflush (bgp_dump_routes.fp);
+  bgp_dump_writer_report ();
+
+  /* The file now belongs to the walk and, at its end, to the writer.  */
+  memset (&bgp_dump_walk, 0, sizeof (bgp_dump_walk));
+  bgp_dump_walk.fp = bgp_dump->fp;
+  bgp_dump_walk.file = ++bgp_dump_writer.files;
+  bgp_dump->fp = NULL;
+  gettimeofday (&bgp_dump_walk.started, NULL);
 
-  return seq;
+  bgp_lock (bgp);
+  bgp_dump_walk.bgp = bgp;
+  bgp_dump_walk.afi = AFI_IP;
+  bgp_dump_walk.rn = bgp_table_top (bgp->rib[AFI_IP][SAFI_UNICAST]);
+  bgp_dump_walk.rec = stream_new (BGP_MAX_PACKET_SIZE + BGP_DUMP_HEADER_SIZE);
+
+  /* The index table covers IPv4 and IPv6 peers alike.  */
+  bgp_dump_routes_index_table (bgp_dump_walk.rec);
+
+  t_bgp_dump_routes = thread_add_event (master, bgp_dump_routes_walk,
+					NULL, 0);
 }
 
 static int
@@ -389,20 +841,20 @@ bgp_dump_interval_func (struct thread *t)
   bgp_dump = THREAD_ARG (t);
   bgp_dump->t_interval = NULL;
 
+  /* A routes dump still being written is not interrupted; this one is
+     skipped instead.  */
+  if (bgp_dump->type == BGP_DUMP_ROUTES && bgp_dump_walk.bgp)
+    zlog_warn ("bgp_dump: previous routes dump still in progress,"
+	       " skipping this one");
+
   /* Reschedule dump even if file couldn't be opened this time... */
-  if (bgp_dump_open_file (bgp_dump) != NULL)
+  else if (bgp_dump_open_file (bgp_dump) != NULL)
     {
-      /* In case of bgp_dump_routes, we need special route dump function. */
+      /* In case of bgp_dump_routes, we need special route dump function.
+       * The file is closed at the end of the dump: there's no point in
+       * leaving it open until the next scheduled dump starts. */
       if (bgp_dump->type == BGP_DUMP_ROUTES)
-	{
-	  unsigned int seq = bgp_dump_routes_func (AFI_IP, 1, 0);
-#ifdef HAVE_IPV6
-	  bgp_dump_routes_func (AFI_IP6, 0, seq);
-#endif /* HAVE_IPV6 */
-	  /* Close the file now. For a RIB dump there's no point in leaving
-	   * it open until the next scheduled dump starts. */
-	  fclose(bgp_dump->fp); bgp_dump->fp = NULL;
-	}
+	bgp_dump_routes_start (bgp_dump);
     }
 
   /* if interval is set reschedule */
@@ -641,6 +1093,10 @@ bgp_dump_set (struct vty *vty, struct bgp_dump *bgp_dump,
 static int
 bgp_dump_unset (struct vty *vty, struct bgp_dump *bgp_dump)
 {
+  /* Stop a routes dump being written.  */
+  if (bgp_dump == &bgp_dump_routes && bgp_dump_walk.bgp)
+    bgp_dump_routes_done (1);
+
   /* Set file name. */
   if (bgp_dump->filename)
     {
@@ -873,6 +1329,10 @@ bgp_dump_init (void)
 void
 bgp_dump_finish (void)
 {
+  if (bgp_dump_walk.bgp)
+    bgp_dump_routes_done (1);
+  bgp_dump_writer_stop ();
+
   stream_free (bgp_dump_obuf);
   bgp_dump_obuf = NULL;
 }
@@ -47,6 +47,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_clist.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_filter.h"
+#include "bgpd/bgp_pipeline.h"
 
 /* bgpd options, we use GNU getopt library. */
 static const struct option longopts[] = 
@@ -64,6 +65,7 @@ static const struct option longopts[] =
   { "group",       required_argument, NULL, 'g'},
   { "version",     no_argument,       NULL, 'v'},
   { "dryrun",      no_argument,       NULL, 'C'},
+  { "decode_threads", required_argument, NULL, 'T'},
   { "help",        no_argument,       NULL, 'h'},
   { 0 }
 };
@@ -159,6 +161,7 @@ redistribution between different routing protocols.\n\n\
 -g, --group        Group to run as\n\
 -v, --version      Print program version\n\
 -C, --dryrun       Check configuration for validity and exit\n\
+-T, --decode_threads Decode UPDATE messages in this many threads\n\
 -h, --help         Display this help and exit\n\
 \n\
 Report bugs to %s\n", progname, ZEBRA_BUG_ADDRESS);
@@ -226,6 +229,9 @@ bgp_exit (int status)
   /* it only makes sense for this to be called on a clean exit */
   assert (status == 0);
 
+  /* reverse bgp_pipeline_start, queued UPDATEs hold peers */
+  bgp_pipeline_finish ();
+
   /* reverse bgp_master_init */
   for (ALL_LIST_ELEMENTS (bm->bgp, node, nnode, bgp))
     bgp_delete (bgp);
@@ -316,6 +322,7 @@ main (int argc, char **argv)
   int opt;
   int daemon_mode = 0;
   int dryrun = 0;
+  int decode_threads = 0;
   char *progname;
   struct thread thread;
   int tmp_port;
@@ -335,7 +342,7 @@ main (int argc, char **argv)
   /* Command line argument treatment. */
   while (1) 
     {
-      opt = getopt_long (argc, argv, "df:i:hp:l:A:P:rnu:g:vC", longopts, 0);
+      opt = getopt_long (argc, argv, "df:i:hp:l:A:P:rnu:g:vCT:", longopts, 0);
     
       if (opt == EOF)
 	break;
@@ -397,6 +404,15 @@ main (int argc, char **argv)
 	case 'C':
 	  dryrun = 1;
 	  break;
+	case 'T':
+	  decode_threads = atoi (optarg);
+	  if (decode_threads < 0 || decode_threads > BGP_PIPELINE_THREADS_MAX)
+	    {
+	      fprintf (stderr, "decode threads must be 0 to %d\n",
+		       BGP_PIPELINE_THREADS_MAX);
+	      exit (1);
+	    }
+	  break;
 	case 'h':
 	  usage (progname, 0);
 	  break;
@@ -441,6 +457,9 @@ main (int argc, char **argv)
   /* Process ID file creation. */
   pid_output (pid_file);
 
+  /* Threads do not survive daemon(), start them now. */
+  bgp_pipeline_start (decode_threads);
+
   /* Make bgp vty socket. */
   vty_serv_sock (vty_addr, vty_port, BGP_VTYSH_PATH);
 
@@ -47,6 +47,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_pipeline.h"
 
 int stream_put_prefix (struct stream *, struct prefix *);
 
@@ -214,6 +215,9 @@ bgp_update_packet (struct peer *peer, afi_t afi, safi_t safi)
 
       adv = bgp_advertise_clean (peer, adj, afi, safi);
 
+      /* Nothing is pending for this peer any more.  */
+      bgp_adj_out_share (rn, adj);
+
       if (! (afi == AFI_IP && safi == SAFI_UNICAST))
 	break;
     }
@@ -1491,9 +1495,25 @@ bgp_open_receive (struct peer *peer, bgp_size_t size)
   return 0;
 }
 
-/* Parse BGP Update packet and make attribute object. */
+/* Hand an NLRI section to bgp_nlri_parse, or use the prefixes the
+   decode pipeline already took out of it.  */
 static int
-bgp_update_receive (struct peer *peer, bgp_size_t size)
+bgp_update_nlri (struct peer *peer, struct attr *attr,
+		 struct bgp_nlri *packet, struct bgp_update_decoded *dec)
+{
+  struct bgp_nlri_decoded *nd;
+
+  if (dec && (nd = bgp_pipeline_lookup (dec, packet)) != NULL)
+    return bgp_nlri_parse_prefix (peer, attr, packet, nd->prefix, nd->count);
+
+  return bgp_nlri_parse (peer, attr, packet);
+}
+
+/* Parse BGP Update packet and make attribute object.  DEC, when not
+   NULL, is what the decode pipeline made of the message already.  */
+int
+bgp_update_receive (struct peer *peer, bgp_size_t size,
+		    struct bgp_update_decoded *dec)
 {
   int ret;
   u_char *end;
@@ -1558,9 +1578,13 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
   /* Unfeasible Route packet format check. */
   if (withdraw_len > 0)
     {
-      ret = bgp_nlri_sanity_check (peer, AFI_IP, stream_pnt (s), withdraw_len);
-      if (ret < 0)
-	return -1;
+      if (! dec)
+	{
+	  ret = bgp_nlri_sanity_check (peer, AFI_IP, stream_pnt (s),
+				       withdraw_len);
+	  if (ret < 0)
+	    return -1;
+	}
 
       if (BGP_DEBUG (packet, PACKET_RECV))
 	zlog_debug ("%s [Update:RECV] Unfeasible NLRI received", peer->host);
@@ -1614,7 +1638,7 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
   if (attribute_len)
     {
       attr_parse_ret = bgp_attr_parse (peer, &attr, attribute_len, 
-			    &mp_update, &mp_withdraw);
+			    &mp_update, &mp_withdraw, dec);
       if (attr_parse_ret == BGP_ATTR_PARSE_ERROR)
 	return -1;
     }
@@ -1642,8 +1666,10 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
 
   if (update_len)
     {
-      /* Check NLRI packet format and prefix length. */
-      ret = bgp_nlri_sanity_check (peer, AFI_IP, stream_pnt (s), update_len);
+      /* Check NLRI packet format and prefix length, unless the
+         pipeline did already. */
+      ret = dec ? 0 : bgp_nlri_sanity_check (peer, AFI_IP, stream_pnt (s),
+                                             update_len);
       if (ret < 0)
         {
           bgp_attr_unintern_sub (&attr);
@@ -1665,7 +1691,7 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
   if (peer->afc[AFI_IP][SAFI_UNICAST])
     {
       if (withdraw.length)
-	bgp_nlri_parse (peer, NULL, &withdraw);
+	bgp_update_nlri (peer, NULL, &withdraw, dec);
 
       if (update.length)
 	{
@@ -1680,18 +1706,18 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
 	      return -1;
             }
 
-	  bgp_nlri_parse (peer, NLRI_ATTR_ARG, &update);
+	  bgp_update_nlri (peer, NLRI_ATTR_ARG, &update, dec);
 	}
 
       if (mp_update.length
 	  && mp_update.afi == AFI_IP 
 	  && mp_update.safi == SAFI_UNICAST)
-	bgp_nlri_parse (peer, NLRI_ATTR_ARG, &mp_update);
+	bgp_update_nlri (peer, NLRI_ATTR_ARG, &mp_update, dec);
 
       if (mp_withdraw.length
 	  && mp_withdraw.afi == AFI_IP 
 	  && mp_withdraw.safi == SAFI_UNICAST)
-	bgp_nlri_parse (peer, NULL, &mp_withdraw);
+	bgp_update_nlri (peer, NULL, &mp_withdraw, dec);
 
       if (! attribute_len && ! withdraw_len)
 	{
@@ -1713,12 +1739,12 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
       if (mp_update.length
 	  && mp_update.afi == AFI_IP 
 	  && mp_update.safi == SAFI_MULTICAST)
-	bgp_nlri_parse (peer, NLRI_ATTR_ARG, &mp_update);
+	bgp_update_nlri (peer, NLRI_ATTR_ARG, &mp_update, dec);
 
       if (mp_withdraw.length
 	  && mp_withdraw.afi == AFI_IP 
 	  && mp_withdraw.safi == SAFI_MULTICAST)
-	bgp_nlri_parse (peer, NULL, &mp_withdraw);
+	bgp_update_nlri (peer, NULL, &mp_withdraw, dec);
 
       if (! withdraw_len
 	  && mp_withdraw.afi == AFI_IP
@@ -1743,12 +1769,12 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
       if (mp_update.length 
 	  && mp_update.afi == AFI_IP6 
 	  && mp_update.safi == SAFI_UNICAST)
-	bgp_nlri_parse (peer, NLRI_ATTR_ARG, &mp_update);
+	bgp_update_nlri (peer, NLRI_ATTR_ARG, &mp_update, dec);
 
       if (mp_withdraw.length 
 	  && mp_withdraw.afi == AFI_IP6 
 	  && mp_withdraw.safi == SAFI_UNICAST)
-	bgp_nlri_parse (peer, NULL, &mp_withdraw);
+	bgp_update_nlri (peer, NULL, &mp_withdraw, dec);
 
       if (! withdraw_len
 	  && mp_withdraw.afi == AFI_IP6
@@ -1772,12 +1798,12 @@ bgp_update_receive (struct peer *peer, bgp_size_t size)
       if (mp_update.length 
 	  && mp_update.afi == AFI_IP6 
 	  && mp_update.safi == SAFI_MULTICAST)
-	bgp_nlri_parse (peer, NLRI_ATTR_ARG, &mp_update);
+	bgp_update_nlri (peer, NLRI_ATTR_ARG, &mp_update, dec);
 
       if (mp_withdraw.length 
 	  && mp_withdraw.afi == AFI_IP6 
 	  && mp_withdraw.safi == SAFI_MULTICAST)
-	bgp_nlri_parse (peer, NULL, &mp_withdraw);
+	bgp_update_nlri (peer, NULL, &mp_withdraw, dec);
 
       if (! withdraw_len
 	  && mp_withdraw.afi == AFI_IP6
@@ -2480,6 +2506,10 @@ bgp_read (struct thread *thread)
   
   size = (peer->packet_size - BGP_HEADER_SIZE);
 
+  /* UPDATEs still in the decode pipeline come first. */
+  if (type != BGP_MSG_UPDATE && peer->update_pipeline)
+    bgp_pipeline_flush (peer);
+
   /* Read rest of the packet and call each sort of packet routine */
   switch (type) 
     {
@@ -2489,7 +2519,8 @@ bgp_read (struct thread *thread)
       break;
     case BGP_MSG_UPDATE:
       peer->readtime = time(NULL);    /* Last read timer reset */
-      bgp_update_receive (peer, size);
+      if (bgp_pipeline_submit (peer, size) < 0)
+	bgp_update_receive (peer, size, NULL);
       break;
     case BGP_MSG_NOTIFY:
       bgp_notify_receive (peer, size);
@@ -54,4 +54,8 @@ extern void bgp_default_withdraw_send (struct peer *, afi_t, safi_t);
 
 extern int bgp_capability_receive (struct peer *, bgp_size_t);
 
+struct bgp_update_decoded;
+extern int bgp_update_receive (struct peer *, bgp_size_t,
+			       struct bgp_update_decoded *);
+
 #endif /* _QUAGGA_BGP_PACKET_H */
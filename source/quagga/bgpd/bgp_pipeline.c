@@ -0,0 +1,708 @@
+/* BGP UPDATE decode pipeline.
+
+This file is part of GNU Zebra.
+
+GNU Zebra is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; either version 2, or (at your option) any
+later version.
+
+GNU Zebra is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GNU Zebra; see the file COPYING.  If not, write to the Free
+Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+02111-1307, USA.  */
+
+/* UPDATE messages are read off the socket by bgp_read as usual, but
+   instead of being parsed there they are copied into a slot of a ring
+   and handed to a pool of worker threads.  A worker checks the framing
+   of the message and decodes its withdrawn, NLRI and MP_REACH /
+   MP_UNREACH sections into prefix arrays, and its AS_PATH, AS4_PATH
+   and COMMUNITIES attributes into their normalised form.  Completed
+   slots are applied on the main thread strictly in the order they were
+   read, through the ordinary bgp_update_receive path, which then only
+   has to look the prefixes up and intern the attributes.
+
+   Everything a worker touches lives in its slot: interning, the RIB,
+   logging and memory statistics stay on the main thread.  A message or
+   attribute the worker could not decode is parsed on the main thread
+   from scratch, so errors are reported exactly as before.
+
+   The ring is single producer: only the main thread publishes slots.
+   Workers claim them with an atomic counter, one semaphore token per
+   published slot, and hand them back by setting the slot state; the
+   first worker to finish after the main thread last looked writes a
+   byte to a pipe to wake it.  A slot the main thread needs before any
+   worker got to it is decoded by the main thread itself; the worker
+   which later draws its token finds it taken and skips it.  A slot it
+   needs while a worker is still at it is waited for on a condition
+   variable.  */
+
+#include <zebra.h>
+
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "prefix.h"
+#include "stream.h"
+#include "thread.h"
+#include "command.h"
+#include "memory.h"
+#include "log.h"
+#include "network.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_pipeline.h"
+
+enum bgp_pipeline_state
+{
+  BGP_PIPELINE_FREE,
+  BGP_PIPELINE_QUEUED,
+  BGP_PIPELINE_BUSY,
+  BGP_PIPELINE_DONE
+};
+
+struct bgp_pipeline_job
+{
+  volatile int state;
+
+  /* Owner of the message and the session it was read in.  */
+  struct peer *peer;
+  u_int32_t established;
+
+  /* Copy of the UPDATE body, and whether the peer sends 4 byte ASes.  */
+  struct stream *s;
+  bgp_size_t size;
+  int as4;
+
+  /* Set by the worker when DEC is usable.  */
+  int decoded;
+  struct bgp_update_decoded dec;
+
+  /* What the attributes in DEC point to.  */
+  struct aspath as_path;
+  struct aspath as4_path;
+  struct community community;
+
+  /* Scratch for a body of up to ROOM bytes.  Every prefix takes at
+     least one byte of the message, so there are never more than ROOM
+     prefixes.  The AS paths take at most what aspath_decode asks for
+     their length, and both together are never longer than the body.  */
+  bgp_size_t room;
+  struct prefix *prefix;
+  struct assegment *seg;
+  as_t *asn;
+  char *str;
+  u_int32_t *val;
+};
+
+static struct
+{
+  int nthreads;
+  pthread_t thread[BGP_PIPELINE_THREADS_MAX];
+
+  struct bgp_pipeline_job job[BGP_PIPELINE_DEPTH];
+
+  /* Next slot to apply and next slot to publish, main thread only.  */
+  unsigned long head;
+  unsigned long tail;
+
+  /* Next slot to decode, shared by the workers.  */
+  unsigned long claim;
+
+  sem_t work;
+  volatile int stop;
+
+  /* Signalled when a slot is done, for the main thread to wait on.  */
+  pthread_mutex_t mutex;
+  pthread_cond_t done;
+
+  /* Wakeup pipe and whether a wakeup is already outstanding.  */
+  int pipe[2];
+  int wake;
+  struct thread *t_read;
+
+  /* Statistics.  */
+  unsigned long submitted;
+  unsigned long applied;
+  unsigned long undecoded;
+  unsigned long dropped;
+  unsigned long stalls;
+  unsigned long stolen;
+  unsigned long flushes;
+  unsigned long prefixes;
+} pipeline;
+
+#define BGP_PIPELINE_GETW(p)  ((u_int16_t) ((p)[0] << 8 | (p)[1]))
+
+/* Scratch aspath_decode needs for an attribute of LENGTH bytes.  */
+#define BGP_PIPELINE_SEGS(length)  ((length) / 4)
+#define BGP_PIPELINE_ASNS(length)  ((length) / 2)
+#define BGP_PIPELINE_STR(length)   ((length) * 7 + 1)
+
+/* Decode one NLRI section.  Same checks as bgp_nlri_sanity_check, but
+   without logging or notifying: failure only means the main thread
+   will look at the message itself.  */
+static int
+bgp_pipeline_nlri (struct bgp_nlri_decoded *nd, afi_t afi, safi_t safi,
+		   u_char *pnt, bgp_size_t length, struct prefix *prefix)
+{
+  u_char *end = pnt + length;
+  int psize;
+
+  nd->afi = afi;
+  nd->safi = safi;
+  nd->nlri = pnt;
+  nd->length = length;
+  nd->prefix = prefix;
+  nd->count = 0;
+
+  while (pnt < end)
+    {
+      struct prefix *p = &prefix[nd->count];
+
+      memset (p, 0, sizeof (struct prefix));
+      p->family = afi2family (afi);
+      p->prefixlen = *pnt++;
+
+      if ((afi == AFI_IP && p->prefixlen > 32)
+	  || (afi == AFI_IP6 && p->prefixlen > 128))
+	return -1;
+
+      psize = PSIZE (p->prefixlen);
+      if (pnt + psize > end)
+	return -1;
+
+      memcpy (&p->u.prefix, pnt, psize);
+      pnt += psize;
+      nd->count++;
+    }
+
+  return 0;
+}
+
+/* Only plain prefix encodings are decoded; VPNv4 NLRI carries labels
+   and route distinguishers and is left to bgp_nlri_parse_vpnv4.  */
+static int
+bgp_pipeline_afi_safi (afi_t afi, safi_t safi)
+{
+  return (afi == AFI_IP || afi == AFI_IP6)
+    && (safi == SAFI_UNICAST || safi == SAFI_MULTICAST);
+}
+
+/* Decode an AS path attribute into the scratch at SEG, ASN and STR,
+   which are moved past what it may take.  A path which does not decode
+   is left for the main thread to parse.  */
+static void
+bgp_pipeline_aspath (struct bgp_aspath_decoded *ad, struct aspath *as,
+		     u_char *val, bgp_size_t length, int use32bit,
+		     struct assegment **seg, as_t **asn, char **str)
+{
+  if (aspath_decode (val, length, use32bit, as, *seg, *asn, *str) < 0)
+    return;
+
+  ad->value = val;
+  ad->length = length;
+  ad->use32bit = use32bit;
+  ad->aspath = as;
+
+  *seg += BGP_PIPELINE_SEGS (length);
+  *asn += BGP_PIPELINE_ASNS (length);
+  *str += BGP_PIPELINE_STR (length);
+}
+
+/* Worker side: decode the message in JOB.  Only JOB is written.  */
+static void
+bgp_pipeline_decode (struct bgp_pipeline_job *job)
+{
+  struct bgp_update_decoded *dec = &job->dec;
+  struct prefix *prefix = job->prefix;
+  struct assegment *seg = job->seg;
+  as_t *asn = job->asn;
+  char *str = job->str;
+  u_char *pnt = STREAM_DATA (job->s);
+  u_char *end = pnt + job->size;
+  u_char *attr_end;
+  bgp_size_t length;
+
+  memset (dec, 0, sizeof (struct bgp_update_decoded));
+  job->decoded = 0;
+
+  /* Withdrawn routes.  */
+  if (pnt + 2 > end)
+    return;
+  length = BGP_PIPELINE_GETW (pnt);
+  pnt += 2;
+  if (pnt + length > end)
+    return;
+  if (length)
+    {
+      if (bgp_pipeline_nlri (&dec->withdraw, AFI_IP, SAFI_UNICAST,
+			     pnt, length, prefix) < 0)
+	return;
+      prefix += dec->withdraw.count;
+      pnt += length;
+    }
+
+  /* Path attributes, of which the multiprotocol ones, the AS paths and
+     the communities are looked into.  */
+  if (pnt + 2 > end)
+    return;
+  length = BGP_PIPELINE_GETW (pnt);
+  pnt += 2;
+  if (pnt + length > end)
+    return;
+  attr_end = pnt + length;
+
+  while (pnt < attr_end)
+    {
+      u_char flag, type;
+      u_char *val;
+      afi_t afi;
+      safi_t safi;
+
+      if (pnt + 3 > attr_end)
+	return;
+      flag = *pnt++;
+      type = *pnt++;
+      if (CHECK_FLAG (flag, BGP_ATTR_FLAG_EXTLEN))
+	{
+	  if (pnt + 2 > attr_end)
+	    return;
+	  length = BGP_PIPELINE_GETW (pnt);
+	  pnt += 2;
+	}
+      else
+	length = *pnt++;
+      if (pnt + length > attr_end)
+	return;
+      val = pnt;
+      pnt += length;
+
+      if (type == BGP_ATTR_MP_REACH_NLRI)
+	{
+	  /* AFI, SAFI, nexthop length, nexthop, reserved octet.  */
+	  if (length < 5)
+	    return;
+	  afi = BGP_PIPELINE_GETW (val);
+	  safi = val[2];
+	  val += 4 + val[3];
+	  if (val + 1 > pnt)
+	    return;
+	  val++;
+	  if (bgp_pipeline_afi_safi (afi, safi))
+	    {
+	      if (bgp_pipeline_nlri (&dec->mp_update, afi, safi,
+				     val, pnt - val, prefix) < 0)
+		return;
+	      prefix += dec->mp_update.count;
+	    }
+	}
+      else if (type == BGP_ATTR_MP_UNREACH_NLRI)
+	{
+	  if (length < 3)
+	    return;
+	  afi = BGP_PIPELINE_GETW (val);
+	  safi = val[2];
+	  val += 3;
+	  if (bgp_pipeline_afi_safi (afi, safi))
+	    {
+	      if (bgp_pipeline_nlri (&dec->mp_withdraw, afi, safi,
+				     val, pnt - val, prefix) < 0)
+		return;
+	      prefix += dec->mp_withdraw.count;
+	    }
+	}
+      else if (type == BGP_ATTR_AS_PATH)
+	bgp_pipeline_aspath (&dec->as_path, &job->as_path, val, length,
+			     job->as4, &seg, &asn, &str);
+      else if (type == BGP_ATTR_AS4_PATH)
+	bgp_pipeline_aspath (&dec->as4_path, &job->as4_path, val, length,
+			     1, &seg, &asn, &str);
+      else if (type == BGP_ATTR_COMMUNITIES && length)
+	{
+	  if (community_decode ((u_int32_t *) val, length, &job->community,
+				job->val) == 0)
+	    {
+	      dec->community.value = val;
+	      dec->community.length = length;
+	      dec->community.community = &job->community;
+	    }
+	}
+    }
+
+  /* Network layer reachability information.  */
+  if (pnt < end)
+    if (bgp_pipeline_nlri (&dec->update, AFI_IP, SAFI_UNICAST,
+			   pnt, end - pnt, prefix) < 0)
+      return;
+
+  job->decoded = 1;
+}
+
+static void *
+bgp_pipeline_worker (void *arg)
+{
+  struct bgp_pipeline_job *job;
+  unsigned long n;
+
+  while (1)
+    {
+      while (sem_wait (&pipeline.work) < 0)
+	;
+      if (pipeline.stop)
+	break;
+
+      /* The main thread may have decoded this one itself already.  */
+      n = __sync_fetch_and_add (&pipeline.claim, 1);
+      job = &pipeline.job[n % BGP_PIPELINE_DEPTH];
+      if (! __sync_bool_compare_and_swap (&job->state, BGP_PIPELINE_QUEUED,
+					  BGP_PIPELINE_BUSY))
+	continue;
+
+      bgp_pipeline_decode (job);
+
+      pthread_mutex_lock (&pipeline.mutex);
+      job->state = BGP_PIPELINE_DONE;
+      pthread_cond_signal (&pipeline.done);
+      pthread_mutex_unlock (&pipeline.mutex);
+
+      if (__sync_lock_test_and_set (&pipeline.wake, 1) == 0)
+	if (write (pipeline.pipe[1], "", 1) < 0)
+	  {
+	    /* EAGAIN: the pipe is full, the main thread is awake anyway.  */
+	  }
+    }
+
+  return NULL;
+}
+
+/* Apply the oldest slot.  If no worker has picked it up yet, it is
+   decoded here rather than waited for, otherwise the worker at it is
+   waited for.  */
+static void
+bgp_pipeline_apply (void)
+{
+  struct bgp_pipeline_job *job;
+  struct peer *peer;
+
+  job = &pipeline.job[pipeline.head % BGP_PIPELINE_DEPTH];
+  if (__sync_bool_compare_and_swap (&job->state, BGP_PIPELINE_QUEUED,
+				    BGP_PIPELINE_BUSY))
+    {
+      pipeline.stolen++;
+      bgp_pipeline_decode (job);
+    }
+  else
+    {
+      pthread_mutex_lock (&pipeline.mutex);
+      while (job->state != BGP_PIPELINE_DONE)
+	pthread_cond_wait (&pipeline.done, &pipeline.mutex);
+      pthread_mutex_unlock (&pipeline.mutex);
+    }
+  __sync_synchronize ();
+
+  peer = job->peer;
+  if (peer->status == Established
+      && peer->established == job->established
+      && peer->ibuf)
+    {
+      struct stream *ibuf = peer->ibuf;
+
+      if (! job->decoded)
+	pipeline.undecoded++;
+      else
+	pipeline.prefixes += job->dec.withdraw.count + job->dec.update.count
+	  + job->dec.mp_update.count + job->dec.mp_withdraw.count;
+
+      /* The parser reads from the peer's input stream.  */
+      peer->ibuf = job->s;
+      bgp_update_receive (peer, job->size, job->decoded ? &job->dec : NULL);
+      peer->ibuf = ibuf;
+      pipeline.applied++;
+    }
+  else
+    pipeline.dropped++;
+
+  job->state = BGP_PIPELINE_FREE;
+  job->peer = NULL;
+  pipeline.head++;
+
+  peer->update_pipeline--;
+  peer_unlock (peer);
+}
+
+/* Apply every slot at the head of the ring which is already done.  */
+static int
+bgp_pipeline_read (struct thread *thread)
+{
+  char buf[64];
+
+  pipeline.t_read = thread_add_read (bm->master, bgp_pipeline_read, NULL,
+				     pipeline.pipe[0]);
+
+  __sync_lock_release (&pipeline.wake);
+  __sync_synchronize ();
+  while (read (pipeline.pipe[0], buf, sizeof (buf)) > 0)
+    ;
+
+  while (pipeline.head != pipeline.tail
+	 && pipeline.job[pipeline.head % BGP_PIPELINE_DEPTH].state
+	    == BGP_PIPELINE_DONE)
+    bgp_pipeline_apply ();
+
+  return 0;
+}
+
+/* Queue the UPDATE body at the read pointer of PEER's input stream.
+   Returns -1 when the caller has to process it synchronously.  */
+int
+bgp_pipeline_submit (struct peer *peer, bgp_size_t size)
+{
+  struct bgp_pipeline_job *job;
+
+  if (! pipeline.nthreads || peer->status != Established)
+    return -1;
+
+  if (pipeline.tail - pipeline.head == BGP_PIPELINE_DEPTH)
+    {
+      pipeline.stalls++;
+      bgp_pipeline_apply ();
+    }
+
+  job = &pipeline.job[pipeline.tail % BGP_PIPELINE_DEPTH];
+  assert (job->state == BGP_PIPELINE_FREE);
+
+  if (job->room < size)
+    {
+      job->prefix = XREALLOC (MTYPE_BGP_PIPELINE, job->prefix,
+			      size * sizeof (struct prefix));
+      job->seg = XREALLOC (MTYPE_BGP_PIPELINE, job->seg,
+			   BGP_PIPELINE_SEGS (size) * sizeof (struct assegment));
+      job->asn = XREALLOC (MTYPE_BGP_PIPELINE, job->asn,
+			   BGP_PIPELINE_ASNS (size) * sizeof (as_t));
+      job->str = XREALLOC (MTYPE_BGP_PIPELINE, job->str,
+			   BGP_PIPELINE_STR (size) + 1);
+      job->val = XREALLOC (MTYPE_BGP_PIPELINE, job->val, size);
+      job->room = size;
+    }
+
+  stream_reset (job->s);
+  stream_put (job->s, stream_pnt (peer->ibuf), size);
+  job->size = size;
+  job->as4 = CHECK_FLAG (peer->cap, PEER_CAP_AS4_RCV);
+  job->peer = peer_lock (peer);
+  job->established = peer->established;
+  job->state = BGP_PIPELINE_QUEUED;
+  peer->update_pipeline++;
+
+  __sync_synchronize ();
+  pipeline.tail++;
+  pipeline.submitted++;
+  sem_post (&pipeline.work);
+
+  return 0;
+}
+
+/* Apply everything read from PEER so far, before a message which has
+   to be seen after its UPDATEs is processed.  */
+void
+bgp_pipeline_flush (struct peer *peer)
+{
+  if (! peer->update_pipeline)
+    return;
+
+  pipeline.flushes++;
+  while (peer->update_pipeline)
+    bgp_pipeline_apply ();
+}
+
+void
+bgp_pipeline_drain (void)
+{
+  while (pipeline.head != pipeline.tail)
+    bgp_pipeline_apply ();
+}
+
+/* Find the decoded prefixes for the section the parser found.  */
+struct bgp_nlri_decoded *
+bgp_pipeline_lookup (struct bgp_update_decoded *dec, struct bgp_nlri *packet)
+{
+  struct bgp_nlri_decoded *nd;
+
+  if (packet->nlri == dec->withdraw.nlri)
+    nd = &dec->withdraw;
+  else if (packet->nlri == dec->update.nlri)
+    nd = &dec->update;
+  else if (packet->nlri == dec->mp_update.nlri)
+    nd = &dec->mp_update;
+  else if (packet->nlri == dec->mp_withdraw.nlri)
+    nd = &dec->mp_withdraw;
+  else
+    return NULL;
+
+  if (nd->nlri == NULL
+      || nd->length != packet->length
+      || nd->afi != packet->afi
+      || nd->safi != packet->safi)
+    return NULL;
+
+  return nd;
+}
+
+/* Start NTHREADS decode workers.  Must be called after daemon(), as
+   threads do not survive the fork.  */
+int
+bgp_pipeline_start (int nthreads)
+{
+  sigset_t set, oset;
+  int i;
+
+  if (nthreads <= 0)
+    return 0;
+  if (nthreads > BGP_PIPELINE_THREADS_MAX)
+    nthreads = BGP_PIPELINE_THREADS_MAX;
+
+  if (pipe (pipeline.pipe) < 0)
+    {
+      zlog_err ("bgp_pipeline_start: pipe: %s", safe_strerror (errno));
+      return -1;
+    }
+  set_nonblocking (pipeline.pipe[0]);
+  set_nonblocking (pipeline.pipe[1]);
+
+  if (sem_init (&pipeline.work, 0, 0) < 0)
+    {
+      zlog_err ("bgp_pipeline_start: sem_init: %s", safe_strerror (errno));
+      close (pipeline.pipe[0]);
+      close (pipeline.pipe[1]);
+      return -1;
+    }
+  pthread_mutex_init (&pipeline.mutex, NULL);
+  pthread_cond_init (&pipeline.done, NULL);
+
+  for (i = 0; i < BGP_PIPELINE_DEPTH; i++)
+    pipeline.job[i].s = stream_new (BGP_MAX_PACKET_SIZE);
+
+  memory_threaded ();
+
+  /* Signals are for the main thread only.  */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, &oset);
+  for (i = 0; i < nthreads; i++)
+    {
+      if (pthread_create (&pipeline.thread[i], NULL,
+			  bgp_pipeline_worker, NULL) != 0)
+	{
+	  zlog_err ("bgp_pipeline_start: could only start %d of %d threads",
+		    i, nthreads);
+	  break;
+	}
+    }
+  pthread_sigmask (SIG_SETMASK, &oset, NULL);
+  pipeline.nthreads = i;
+
+  if (pipeline.nthreads)
+    pipeline.t_read = thread_add_read (bm->master, bgp_pipeline_read, NULL,
+				       pipeline.pipe[0]);
+
+  zlog_info ("UPDATE decode pipeline started with %d threads",
+	     pipeline.nthreads);
+
+  return pipeline.nthreads;
+}
+
+/* Stop the workers and drop whatever is still queued.  */
+void
+bgp_pipeline_finish (void)
+{
+  struct bgp_pipeline_job *job;
+  int i;
+
+  if (! pipeline.nthreads)
+    return;
+
+  pipeline.stop = 1;
+  for (i = 0; i < pipeline.nthreads; i++)
+    sem_post (&pipeline.work);
+  for (i = 0; i < pipeline.nthreads; i++)
+    pthread_join (pipeline.thread[i], NULL);
+  pipeline.nthreads = 0;
+
+  for (; pipeline.head != pipeline.tail; pipeline.head++)
+    {
+      job = &pipeline.job[pipeline.head % BGP_PIPELINE_DEPTH];
+      job->peer->update_pipeline--;
+      peer_unlock (job->peer);
+      job->peer = NULL;
+      job->state = BGP_PIPELINE_FREE;
+    }
+
+  for (i = 0; i < BGP_PIPELINE_DEPTH; i++)
+    {
+      job = &pipeline.job[i];
+      stream_free (job->s);
+      job->s = NULL;
+      if (job->prefix)
+	XFREE (MTYPE_BGP_PIPELINE, job->prefix);
+      if (job->seg)
+	XFREE (MTYPE_BGP_PIPELINE, job->seg);
+      if (job->asn)
+	XFREE (MTYPE_BGP_PIPELINE, job->asn);
+      if (job->str)
+	XFREE (MTYPE_BGP_PIPELINE, job->str);
+      if (job->val)
+	XFREE (MTYPE_BGP_PIPELINE, job->val);
+      job->room = 0;
+    }
+
+  THREAD_OFF (pipeline.t_read);
+  close (pipeline.pipe[0]);
+  close (pipeline.pipe[1]);
+  sem_destroy (&pipeline.work);
+  pthread_cond_destroy (&pipeline.done);
+  pthread_mutex_destroy (&pipeline.mutex);
+}
+
+DEFUN (show_bgp_pipeline,
+       show_bgp_pipeline_cmd,
+       "show bgp pipeline",
+       SHOW_STR
+       BGP_STR
+       "UPDATE decode pipeline statistics\n")
+{
+  if (! pipeline.nthreads)
+    {
+      vty_out (vty, "UPDATE decode pipeline is not running%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  vty_out (vty, "UPDATE decode pipeline: %d threads, %lu of %d slots in use%s",
+	   pipeline.nthreads, pipeline.tail - pipeline.head,
+	   BGP_PIPELINE_DEPTH, VTY_NEWLINE);
+  vty_out (vty, "  %lu messages queued, %lu applied, %lu dropped%s",
+	   pipeline.submitted, pipeline.applied, pipeline.dropped,
+	   VTY_NEWLINE);
+  vty_out (vty, "  %lu prefixes decoded, %lu messages parsed on main thread%s",
+	   pipeline.prefixes, pipeline.undecoded, VTY_NEWLINE);
+  vty_out (vty, "  %lu ring full stalls, %lu peer flushes,"
+	   " %lu messages decoded on main thread%s",
+	   pipeline.stalls, pipeline.flushes, pipeline.stolen, VTY_NEWLINE);
+
+  return CMD_SUCCESS;
+}
+
+void
+bgp_pipeline_init (void)
+{
+  install_element (VIEW_NODE, &show_bgp_pipeline_cmd);
+  install_element (ENABLE_NODE, &show_bgp_pipeline_cmd);
+}
@@ -0,0 +1,86 @@
+/* BGP UPDATE decode pipeline.
+
+This file is part of GNU Zebra.
+
+GNU Zebra is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; either version 2, or (at your option) any
+later version.
+
+GNU Zebra is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GNU Zebra; see the file COPYING.  If not, write to the Free
+Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+02111-1307, USA.  */
+
+#ifndef _QUAGGA_BGP_PIPELINE_H
+#define _QUAGGA_BGP_PIPELINE_H
+
+/* Maximum number of decode worker threads.  */
+#define BGP_PIPELINE_THREADS_MAX  32
+
+/* Number of UPDATE messages which may be in flight at once.  */
+#define BGP_PIPELINE_DEPTH        64
+
+/* One NLRI section of an UPDATE, decoded into prefixes.  NLRI points
+   at the section inside the message the prefixes were taken from so
+   that the receiver can tell the decode applies to what it parsed.  */
+struct bgp_nlri_decoded
+{
+  afi_t afi;
+  safi_t safi;
+  u_char *nlri;
+  bgp_size_t length;
+
+  struct prefix *prefix;
+  unsigned int count;
+};
+
+/* An AS_PATH or AS4_PATH attribute, parsed and normalised but not
+   interned.  VALUE and LENGTH are those of the attribute in the
+   message, USE32BIT the AS size it was parsed with.  */
+struct bgp_aspath_decoded
+{
+  u_char *value;
+  bgp_size_t length;
+  int use32bit;
+
+  struct aspath *aspath;
+};
+
+/* A COMMUNITIES attribute, sorted and uniqued but not interned.  */
+struct bgp_community_decoded
+{
+  u_char *value;
+  bgp_size_t length;
+
+  struct community *community;
+};
+
+/* Result of decoding one UPDATE message off the main thread.  */
+struct bgp_update_decoded
+{
+  struct bgp_nlri_decoded withdraw;
+  struct bgp_nlri_decoded update;
+  struct bgp_nlri_decoded mp_update;
+  struct bgp_nlri_decoded mp_withdraw;
+
+  struct bgp_aspath_decoded as_path;
+  struct bgp_aspath_decoded as4_path;
+  struct bgp_community_decoded community;
+};
+
+extern void bgp_pipeline_init (void);
+extern int bgp_pipeline_start (int);
+extern void bgp_pipeline_finish (void);
+extern int bgp_pipeline_submit (struct peer *, bgp_size_t);
+extern void bgp_pipeline_flush (struct peer *);
+extern void bgp_pipeline_drain (void);
+extern struct bgp_nlri_decoded *bgp_pipeline_lookup (struct bgp_update_decoded *,
+						     struct bgp_nlri *);
+
+#endif /* _QUAGGA_BGP_PIPELINE_H */
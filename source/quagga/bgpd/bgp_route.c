@@ -89,13 +89,98 @@ bgp_afi_node_get(struct bgp_table *table, afi_t afi, safi_t safi, struct prefix
   return rn;
 }
 
+/* Paths and their extra information are carved from blocks of
+ * BGP_INFO_BLOCK, saving the malloc header of each; a full table from
+ * many peers makes for millions of them.  Free entries are chained
+ * through their first word.  The blocks are only given back once all
+ * entries of the pool are free.
+ */
+#define BGP_INFO_BLOCK 1024
+
+struct bgp_info_pool
+{
+  int mtype;
+  size_t size;
+  void *free;
+  void *blocks;
+  unsigned long count;
+};
+
+/* Blocks are chained through their first word too, which is padded to
+ * keep the entries aligned. */
+#define BGP_INFO_BLOCK_HEAD 16
+
+static struct bgp_info_pool bgp_info_pool =
+    {MTYPE_BGP_ROUTE, sizeof(struct bgp_info), NULL, NULL, 0};
+static struct bgp_info_pool bgp_info_extra_pool =
+    {MTYPE_BGP_ROUTE_EXTRA, sizeof(struct bgp_info_extra), NULL, NULL, 0};
+
+static void *
+bgp_info_pool_get(struct bgp_info_pool *pool)
+{
+  void *entry;
+
+  if (!pool->free)
+  {
+    char *block;
+    int i;
+
+    block = XMALLOC(pool->mtype,
+                    BGP_INFO_BLOCK_HEAD + BGP_INFO_BLOCK * pool->size);
+    *(void **)block = pool->blocks;
+    pool->blocks = block;
+    for (i = BGP_INFO_BLOCK - 1; i >= 0; i--)
+    {
+      entry = block + BGP_INFO_BLOCK_HEAD + i * pool->size;
+      *(void **)entry = pool->free;
+      pool->free = entry;
+    }
+  }
+
+  entry = pool->free;
+  pool->free = *(void **)entry;
+  pool->count++;
+
+  memset(entry, 0, pool->size);
+  return entry;
+}
+
+static void
+bgp_info_pool_put(struct bgp_info_pool *pool, void *entry)
+{
+  *(void **)entry = pool->free;
+  pool->free = entry;
+
+  if (--pool->count == 0)
+  {
+    while (pool->blocks)
+    {
+      void *block = pool->blocks;
+
+      pool->blocks = *(void **)block;
+      XFREE(pool->mtype, block);
+    }
+    pool->free = NULL;
+  }
+}
+
+unsigned long
+bgp_info_count(void)
+{
+  return bgp_info_pool.count;
+}
+
+unsigned long
+bgp_info_extra_count(void)
+{
+  return bgp_info_extra_pool.count;
+}
+
 /* Allocate bgp_info_extra */
 static struct bgp_info_extra *
 bgp_info_extra_new(void)
 {
-  struct bgp_info_extra *new;
-  new = XCALLOC(MTYPE_BGP_ROUTE_EXTRA, sizeof(struct bgp_info_extra));
-  return new;
+  return bgp_info_pool_get(&bgp_info_extra_pool);
 }
 
 static void
@@ -108,7 +193,7 @@ bgp_info_extra_free(struct bgp_info_extra **extra)
 
     (*extra)->damp_info = NULL;
 
-    XFREE(MTYPE_BGP_ROUTE_EXTRA, *extra);
+    bgp_info_pool_put(&bgp_info_extra_pool, *extra);
 
     *extra = NULL;
   }
@@ -129,7 +214,7 @@ bgp_info_extra_get(struct bgp_info *ri)
 static struct bgp_info *
 bgp_info_new(void)
 {
-  return XCALLOC(MTYPE_BGP_ROUTE, sizeof(struct bgp_info));
+  return bgp_info_pool_get(&bgp_info_pool);
 }
 
 /* Free bgp route information. */
@@ -143,7 +228,7 @@ bgp_info_free(struct bgp_info *binfo)
 
   peer_unlock(binfo->peer); /* bgp_info peer reference */
 
-  XFREE(MTYPE_BGP_ROUTE, binfo);
+  bgp_info_pool_put(&bgp_info_pool, binfo);
 }
 
 struct bgp_info *
@@ -186,10 +271,7 @@ void bgp_info_add(struct bgp_node *rn, struct bgp_info *ri)
 
   top = rn->info;
 
-  ri->next = rn->info;
-  ri->prev = NULL;
-  if (top)
-    top->prev = ri;
+  ri->next = top;
   rn->info = ri;
 
   bgp_info_lock(ri);
@@ -202,12 +284,12 @@ void bgp_info_add(struct bgp_node *rn, struct bgp_info *ri)
 static void
 bgp_info_reap(struct bgp_node *rn, struct bgp_info *ri)
 {
-  if (ri->next)
-    ri->next->prev = ri->prev;
-  if (ri->prev)
-    ri->prev->next = ri->next;
-  else
-    rn->info = ri->next;
+  struct bgp_info **prev;
+
+  for (prev = (struct bgp_info **)&rn->info; *prev != ri;
+       prev = &(*prev)->next)
+    assert(*prev);
+  *prev = ri->next;
 
   bgp_info_unlock(ri);
   bgp_unlock_node(rn);
@@ -2675,13 +2757,14 @@ bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
         bgp_unlock_node(rn);
         break;
       }
-    for (aout = rn->adj_out; aout; aout = aout->next)
-      if (aout->peer == peer || purpose == BGP_CLEAR_ROUTE_MY_RSCLIENT)
-      {
-        bgp_adj_out_remove(rn, aout, peer, afi, safi);
-        bgp_unlock_node(rn);
-        break;
-      }
+    aout = bgp_adj_out_get(rn, peer);
+    if (aout == NULL && purpose == BGP_CLEAR_ROUTE_MY_RSCLIENT)
+      aout = rn->adj_out;
+    if (aout)
+    {
+      bgp_adj_out_remove(rn, aout, peer, afi, safi);
+      bgp_unlock_node(rn);
+    }
   }
   return;
 }
@@ -2844,6 +2927,57 @@ void bgp_reset(void)
   prefix_list_reset();
 }
 
+/* Install or withdraw one prefix taken from PACKET.  Withdraw is
+   recognized by NULL attr value. */
+static int bgp_nlri_prefix(struct peer *peer, struct attr *attr,
+                           struct bgp_nlri *packet, struct prefix *p)
+{
+  /* Check address. */
+  if (packet->afi == AFI_IP && packet->safi == SAFI_UNICAST)
+  {
+    if (IN_CLASSD(ntohl(p->u.prefix4.s_addr)))
+    {
+      /* 
+       * From draft-ietf-idr-bgp4-22, Section 6.3: 
+       * If a BGP router receives an UPDATE message with a
+       * semantically incorrect NLRI field, in which a prefix is
+       * semantically incorrect (eg. an unexpected multicast IP
+       * address), it should ignore the prefix.
+       */
+      zlog(peer->log, LOG_ERR,
+           "IPv4 unicast NLRI is multicast address %s",
+           inet_ntoa(p->u.prefix4));
+
+      return -1;
+    }
+  }
+
+#ifdef HAVE_IPV6
+  /* Check address. */
+  if (packet->afi == AFI_IP6 && packet->safi == SAFI_UNICAST)
+  {
+    if (IN6_IS_ADDR_LINKLOCAL(&p->u.prefix6))
+    {
+      char buf[BUFSIZ];
+
+      zlog(peer->log, LOG_WARNING,
+           "IPv6 link-local NLRI received %s ignore this NLRI",
+           inet_ntop(AF_INET6, &p->u.prefix6, buf, BUFSIZ));
+
+      return 0;
+    }
+  }
+#endif /* HAVE_IPV6 */
+
+  /* Normal process. */
+  if (attr)
+    return bgp_update(peer, p, attr, packet->afi, packet->safi,
+                      ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL, 0);
+  else
+    return bgp_withdraw(peer, p, attr, packet->afi, packet->safi,
+                        ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL);
+}
+
 /* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
    value. */
 int bgp_nlri_parse(struct peer *peer, struct attr *attr, struct bgp_nlri *packet)
@@ -2852,7 +2986,6 @@ int bgp_nlri_parse(struct peer *peer, struct attr *attr, struct bgp_nlri *packet
   u_char *lim;
   struct prefix p;
   int psize;
-  int ret;
 
   /* Check peer status. */
   if (peer->status != Established)
@@ -2885,54 +3018,9 @@ int bgp_nlri_parse(struct peer *peer, struct attr *attr, struct bgp_nlri *packet
     /* Fetch prefix from NLRI packet. */
     memcpy(&p.u.prefix, pnt, psize);
 
-    /* Check address. */
-    if (packet->afi == AFI_IP && packet->safi == SAFI_UNICAST)
-    {
-      if (IN_CLASSD(ntohl(p.u.prefix4.s_addr)))
-      {
-        /* 
- 	      * From draft-ietf-idr-bgp4-22, Section 6.3: 
-	      * If a BGP router receives an UPDATE message with a
-	      * semantically incorrect NLRI field, in which a prefix is
-	      * semantically incorrect (eg. an unexpected multicast IP
-	      * address), it should ignore the prefix.
-	      */
-        zlog(peer->log, LOG_ERR,
-             "IPv4 unicast NLRI is multicast address %s",
-             inet_ntoa(p.u.prefix4));
-
-        return -1;
-      }
-    }
-
-#ifdef HAVE_IPV6
-    /* Check address. */
-    if (packet->afi == AFI_IP6 && packet->safi == SAFI_UNICAST)
-    {
-      if (IN6_IS_ADDR_LINKLOCAL(&p.u.prefix6))
-      {
-        char buf[BUFSIZ];
-
-        zlog(peer->log, LOG_WARNING,
-             "IPv6 link-local NLRI received %s ignore this NLRI",
-             inet_ntop(AF_INET6, &p.u.prefix6, buf, BUFSIZ));
-
-        continue;
-      }
-    }
-#endif /* HAVE_IPV6 */
-
-    /* Normal process. */
-    if (attr)
-      ret = bgp_update(peer, &p, attr, packet->afi, packet->safi,
-                       ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL, 0);
-    else
-      ret = bgp_withdraw(peer, &p, attr, packet->afi, packet->safi,
-                         ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL, NULL, NULL);
-
     /* Address family configuration mismatch or maximum-prefix count
          overflow. */
-    if (ret < 0)
+    if (bgp_nlri_prefix(peer, attr, packet, &p) < 0)
       return -1;
   }
 
@@ -2943,6 +3031,25 @@ int bgp_nlri_parse(struct peer *peer, struct attr *attr, struct bgp_nlri *packet
   return 0;
 }
 
+/* Same as bgp_nlri_parse, for an NLRI section the UPDATE decode
+   pipeline has already split into COUNT prefixes. */
+int bgp_nlri_parse_prefix(struct peer *peer, struct attr *attr,
+                          struct bgp_nlri *packet, struct prefix *prefix,
+                          unsigned int count)
+{
+  unsigned int i;
+
+  /* Check peer status. */
+  if (peer->status != Established)
+    return 0;
+
+  for (i = 0; i < count; i++)
+    if (bgp_nlri_prefix(peer, attr, packet, &prefix[i]) < 0)
+      return -1;
+
+  return 0;
+}
+
 /* NLRI encode syntax check routine. */
 int bgp_nlri_sanity_check(struct peer *peer, int afi, u_char *pnt,
                           bgp_size_t length)
@@ -9488,7 +9595,7 @@ show_adj_route(struct vty *vty, struct peer *peer, afi_t afi, safi_t safi,
 {
   struct bgp_table *table;
   struct bgp_adj_in *ain;
-  struct bgp_adj_out *adj;
+  struct attr *attr;
   unsigned long output_count;
   struct bgp_node *rn;
   int header1 = 1;
@@ -9543,27 +9650,26 @@ show_adj_route(struct vty *vty, struct peer *peer, afi_t afi, safi_t safi,
     }
     else
     {
-      for (adj = rn->adj_out; adj; adj = adj->next)
-        if (adj->peer == peer)
+      if (bgp_adj_out_advertised(rn, peer, &attr))
+      {
+        if (header1)
         {
-          if (header1)
-          {
-            vty_out(vty, "BGP table version is 0, local router ID is %s%s", inet_ntoa(bgp->router_id), VTY_NEWLINE);
-            vty_out(vty, BGP_SHOW_SCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
-            vty_out(vty, BGP_SHOW_OCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
-            header1 = 0;
-          }
-          if (header2)
-          {
-            vty_out(vty, BGP_SHOW_HEADER, VTY_NEWLINE);
-            header2 = 0;
-          }
-          if (adj->attr)
-          {
-            route_vty_out_tmp(vty, &rn->p, adj->attr, safi);
-            output_count++;
-          }
+          vty_out(vty, "BGP table version is 0, local router ID is %s%s", inet_ntoa(bgp->router_id), VTY_NEWLINE);
+          vty_out(vty, BGP_SHOW_SCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
+          vty_out(vty, BGP_SHOW_OCODE_HEADER, VTY_NEWLINE, VTY_NEWLINE);
+          header1 = 0;
+        }
+        if (header2)
+        {
+          vty_out(vty, BGP_SHOW_HEADER, VTY_NEWLINE);
+          header2 = 0;
         }
+        if (attr)
+        {
+          route_vty_out_tmp(vty, &rn->p, attr, safi);
+          output_count++;
+        }
+      }
     }
 
   if (output_count != 0)
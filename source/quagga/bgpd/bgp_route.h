@@ -44,9 +44,9 @@ struct bgp_info_extra
 
 struct bgp_info
 {
-  /* For linked list. */
+  /* For linked list.  Singly linked, as a node has few paths and they
+     are taken off the list only by bgp_info_reap. */
   struct bgp_info *next;
-  struct bgp_info *prev;
   
   /* Peer structure.  */
   struct peer *peer;
@@ -184,11 +184,15 @@ extern struct bgp_info *bgp_info_unlock (struct bgp_info *);
 extern void bgp_info_add (struct bgp_node *rn, struct bgp_info *ri);
 extern void bgp_info_delete (struct bgp_node *rn, struct bgp_info *ri);
 extern struct bgp_info_extra *bgp_info_extra_get (struct bgp_info *);
+extern unsigned long bgp_info_count (void);
+extern unsigned long bgp_info_extra_count (void);
 extern void bgp_info_set_flag (struct bgp_node *, struct bgp_info *, u_int32_t);
 extern void bgp_info_unset_flag (struct bgp_node *, struct bgp_info *, u_int32_t);
 
 extern int bgp_nlri_sanity_check (struct peer *, int, u_char *, bgp_size_t);
 extern int bgp_nlri_parse (struct peer *, struct attr *, struct bgp_nlri *);
+extern int bgp_nlri_parse_prefix (struct peer *, struct attr *, struct bgp_nlri *,
+				  struct prefix *, unsigned int);
 
 extern int bgp_maximum_prefix_overflow (struct peer *, afi_t, safi_t, int);
 
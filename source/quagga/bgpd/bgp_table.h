@@ -59,6 +59,8 @@ struct bgp_node
 
   struct bgp_adj_out *adj_out;
 
+  struct bgp_adj_out_shared *adj_out_shared;
+
   struct bgp_adj_in *adj_in;
 
   struct bgp_node *prn;
@@ -6603,12 +6603,12 @@ DEFUN (show_bgp_memory,
                          count * sizeof (struct bgp_node)),
            VTY_NEWLINE);
   
-  count = mtype_stats_alloc (MTYPE_BGP_ROUTE);
+  count = bgp_info_count ();
   vty_out (vty, "%ld BGP routes, using %s of memory%s", count,
            mtype_memstr (memstrbuf, sizeof (memstrbuf),
                          count * sizeof (struct bgp_info)),
            VTY_NEWLINE);
-  if ((count = mtype_stats_alloc (MTYPE_BGP_ROUTE_EXTRA)))
+  if ((count = bgp_info_extra_count ()))
     vty_out (vty, "%ld BGP route ancillaries, using %s of memory%s", count,
              mtype_memstr (memstrbuf, sizeof (memstrbuf),
                            count * sizeof (struct bgp_info_extra)),
@@ -6631,6 +6631,11 @@ DEFUN (show_bgp_memory,
              mtype_memstr (memstrbuf, sizeof (memstrbuf),
                            count * sizeof (struct bgp_adj_out)),
              VTY_NEWLINE);
+  if ((count = mtype_stats_alloc (MTYPE_BGP_ADJ_OUT_SHARED)))
+    vty_out (vty, "%ld Shared Adj-Out entries, using %s of memory%s", count,
+             mtype_memstr (memstrbuf, sizeof (memstrbuf),
+                           count * sizeof (struct bgp_adj_out_shared)),
+             VTY_NEWLINE);
   
   if ((count = mtype_stats_alloc (MTYPE_BGP_NEXTHOP_CACHE)))
     vty_out (vty, "%ld Nexthop cache entries, using %s of memory%s", count,
@@ -6650,7 +6655,7 @@ DEFUN (show_bgp_memory,
            mtype_memstr (memstrbuf, sizeof (memstrbuf), 
                          count * sizeof(struct attr)), 
            VTY_NEWLINE);
-  if ((count = mtype_stats_alloc (MTYPE_ATTR_EXTRA)))
+  if ((count = attr_extra_count ()))
     vty_out (vty, "%ld BGP extra attributes, using %s of memory%s", count, 
              mtype_memstr (memstrbuf, sizeof (memstrbuf), 
                            count * sizeof(struct attr_extra)), 
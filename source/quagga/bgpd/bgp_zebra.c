@@ -1041,6 +1041,9 @@ bgp_zebra_init (void)
   zclient->ipv6_route_delete = zebra_read_ipv6;
 #endif /* HAVE_IPV6 */
 
+  /* Full tables are pushed to zebra, many routes per message. */
+  zclient->route_batch = 1;
+
   /* Interface related init. */
   if_init ();
 }
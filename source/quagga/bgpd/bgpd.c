@@ -57,6 +57,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_vty.h"
+#include "bgpd/bgp_pipeline.h"
 #ifdef HAVE_SNMP
 #include "bgpd/bgp_snmp.h"
 #endif /* HAVE_SNMP */
@@ -5342,6 +5343,7 @@ bgp_init (void)
   bgp_attr_init ();
   bgp_debug_init ();
   bgp_dump_init ();
+  bgp_pipeline_init ();
   bgp_route_init ();
   bgp_route_map_init ();
   bgp_scan_init ();
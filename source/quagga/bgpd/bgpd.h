@@ -485,6 +485,12 @@ struct peer
   /* Announcement attribute hash.  */
   struct hash *hash[AFI_MAX][SAFI_MAX];
 
+  /* Bit index of this peer in shared Adj-RIB-Out entries.  */
+  unsigned int adj_index;
+
+  /* UPDATE messages handed to the decode pipeline, not yet applied. */
+  unsigned int update_pipeline;
+
   /* Notify data. */
   struct bgp_notify notify;
 
@@ -23,6 +23,8 @@
 
 #include <zebra.h>
 
+#include <pthread.h>
+
 #include "thread.h"
 #include "linklist.h"
 #include "vty.h"
@@ -31,6 +33,8 @@
 #include "memory.h"
 #include "prefix.h"
 #include "hash.h"
+#include "jhash.h"
+#include "pqueue.h"
 #include "if.h"
 #include "table.h"
 
@@ -55,6 +59,10 @@ extern struct host host;
 
 int isis_run_spf_l1 (struct thread *thread);
 int isis_run_spf_l2 (struct thread *thread);
+#ifdef HAVE_IPV6
+static int isis_run_spf6_l1 (struct thread *thread);
+static int isis_run_spf6_l2 (struct thread *thread);
+#endif
 
 /* 7.2.7 */
 static void
@@ -188,6 +196,68 @@ vid2string (struct isis_vertex *vertex, u_char * buff)
 }
 #endif /* EXTREME_DEBUG */
 
+/* TENT is kept in order of distance and, for equal distances, of vertex
+   type, so that pseudonodes and systems come out before the prefixes
+   and end systems behind them.  Systems at the same distance come out
+   by system id, which keeps PATHS in the same order from run to run.  */
+static int
+isis_vertex_cmp (void *a, void *b)
+{
+  struct isis_vertex *va = a;
+  struct isis_vertex *vb = b;
+
+  if (va->d_N != vb->d_N)
+    return va->d_N < vb->d_N ? -1 : 1;
+  if (va->type != vb->type)
+    return va->type < vb->type ? -1 : 1;
+  if (va->type <= VTYPE_ES)
+    return memcmp (va->N.id, vb->N.id, ISIS_SYS_ID_LEN + 1);
+  return 0;
+}
+
+static void
+isis_vertex_update_index (void *node, int index)
+{
+  struct isis_vertex *vertex = node;
+
+  vertex->tent_index = index;
+}
+
+/* Vertices are known by type and system id, or type and prefix.  Only
+   the bytes isis_vertex_new copies in take part.  */
+static unsigned int
+isis_vertex_hash_key (void *data)
+{
+  struct isis_vertex *vertex = data;
+  struct prefix *p;
+
+  if (vertex->type <= VTYPE_ES)
+    return jhash (vertex->N.id, ISIS_SYS_ID_LEN + 1, vertex->type);
+
+  p = &vertex->N.prefix;
+  return jhash (&p->u.prefix, PSIZE (p->prefixlen),
+		(vertex->type << 16) | (p->family << 8) | p->prefixlen);
+}
+
+static int
+isis_vertex_hash_cmp (const void *a, const void *b)
+{
+  const struct isis_vertex *va = a;
+  const struct isis_vertex *vb = b;
+  const struct prefix *p1, *p2;
+
+  if (va->type != vb->type)
+    return 0;
+  if (va->type <= VTYPE_ES)
+    return memcmp (va->N.id, vb->N.id, ISIS_SYS_ID_LEN + 1) == 0;
+
+  p1 = &va->N.prefix;
+  p2 = &vb->N.prefix;
+  return (p1->family == p2->family && p1->prefixlen == p2->prefixlen
+	  && memcmp (&p1->u.prefix, &p2->u.prefix,
+		     PSIZE (p1->prefixlen)) == 0);
+}
+
 static struct isis_spftree *
 isis_spftree_new ()
 {
@@ -200,7 +270,10 @@ isis_spftree_new ()
       return NULL;
     }
 
-  tree->tents = list_new ();
+  tree->tents = pqueue_create ();
+  tree->tents->cmp = isis_vertex_cmp;
+  tree->tents->update = isis_vertex_update_index;
+  tree->vertices = hash_create (isis_vertex_hash_key, isis_vertex_hash_cmp);
   tree->paths = list_new ();
   return tree;
 }
@@ -219,11 +292,10 @@ isis_vertex_del (struct isis_vertex *vertex)
 static void
 isis_spftree_del (struct isis_spftree *spftree)
 {
-  spftree->tents->del = (void (*)(void *)) isis_vertex_del;
-  list_delete (spftree->tents);
-
-  spftree->paths->del = (void (*)(void *)) isis_vertex_del;
+  pqueue_delete (spftree->tents);
   list_delete (spftree->paths);
+  hash_clean (spftree->vertices, (void (*)(void *)) isis_vertex_del);
+  hash_free (spftree->vertices);
 
   XFREE (MTYPE_ISIS_SPFTREE, spftree);
 
@@ -258,18 +330,10 @@ spftree_area_init (struct isis_area *area)
   return;
 }
 
-static struct isis_vertex *
-isis_vertex_new (void *id, enum vertextype vtype)
+static void
+isis_vertex_id_init (struct isis_vertex *vertex, void *id,
+		     enum vertextype vtype)
 {
-  struct isis_vertex *vertex;
-
-  vertex = XCALLOC (MTYPE_ISIS_VERTEX, sizeof (struct isis_vertex));
-  if (vertex == NULL)
-    {
-      zlog_err ("isis_vertex_new Out of memory!");
-      return NULL;
-    }
-
   vertex->type = vtype;
   switch (vtype)
     {
@@ -295,12 +359,75 @@ isis_vertex_new (void *id, enum vertextype vtype)
     default:
       zlog_err ("WTF!");
     }
+}
+
+static struct isis_vertex *
+isis_vertex_new (void *id, enum vertextype vtype)
+{
+  struct isis_vertex *vertex;
+
+  vertex = XCALLOC (MTYPE_ISIS_VERTEX, sizeof (struct isis_vertex));
+  if (vertex == NULL)
+    {
+      zlog_err ("isis_vertex_new Out of memory!");
+      return NULL;
+    }
 
+  isis_vertex_id_init (vertex, id, vtype);
   vertex->Adj_N = list_new ();
+  vertex->tent_index = -1;
 
   return vertex;
 }
 
+/* A message logged while a level is computed.  The level computed off
+   the main thread keeps its messages in its tree until the main thread
+   logs them, zlog not being for threads.  */
+struct isis_spf_msg
+{
+  int priority;
+  char text[];
+};
+
+static void
+isis_spf_zlog (struct isis_spftree *spftree, int priority,
+	       const char *format, ...)
+{
+  struct isis_spf_msg *msg;
+  char buf[256];
+  va_list args;
+
+  va_start (args, format);
+  vsnprintf (buf, sizeof (buf), format, args);
+  va_end (args);
+
+  if (spftree->msgs == NULL)
+    {
+      zlog (NULL, priority, "%s", buf);
+      return;
+    }
+
+  msg = XMALLOC (MTYPE_TMP, sizeof (*msg) + strlen (buf) + 1);
+  msg->priority = priority;
+  strcpy (msg->text, buf);
+  listnode_add (spftree->msgs, msg);
+}
+
+static void
+isis_spf_zlog_held (struct isis_spftree *spftree)
+{
+  struct listnode *node;
+  struct isis_spf_msg *msg;
+
+  for (ALL_LIST_ELEMENTS_RO (spftree->msgs, node, msg))
+    {
+      zlog (NULL, msg->priority, "%s", msg->text);
+      XFREE (MTYPE_TMP, msg);
+    }
+  list_delete (spftree->msgs);
+  spftree->msgs = NULL;
+}
+
 /*
  * Add this IS to the root of SPT
  */
@@ -321,7 +448,8 @@ isis_spf_add_self (struct isis_spftree *spftree, struct isis_area *area,
   lsp = lsp_search (lspid, area->lspdb[level - 1]);
 
   if (lsp == NULL)
-    zlog_warn ("ISIS-Spf: could not find own l%d LSP!", level);
+    isis_spf_zlog (spftree, LOG_WARNING,
+		   "ISIS-Spf: could not find own l%d LSP!", level);
 
   if (!area->oldmetric)
     vertex = isis_vertex_new (isis->sysid, VTYPE_NONPSEUDO_TE_IS);
@@ -330,6 +458,7 @@ isis_spf_add_self (struct isis_spftree *spftree, struct isis_area *area,
 
   vertex->lsp = lsp;
 
+  hash_get (spftree->vertices, vertex, hash_alloc_intern);
   listnode_add (spftree->paths, vertex);
 
 #ifdef EXTREME_DEBUG
@@ -341,60 +470,28 @@ isis_spf_add_self (struct isis_spftree *spftree, struct isis_area *area,
   return;
 }
 
+/* Look a vertex up in TENT or PATHS, tent_index tells which.  */
 static struct isis_vertex *
-isis_find_vertex (struct list *list, void *id, enum vertextype vtype)
+isis_find_vertex (struct isis_spftree *spftree, void *id,
+		  enum vertextype vtype)
 {
-  struct listnode *node;
-  struct isis_vertex *vertex;
-  struct prefix *p1, *p2;
+  struct isis_vertex key;
 
-  for (ALL_LIST_ELEMENTS_RO (list, node, vertex))
-    {
-      if (vertex->type != vtype)
-	continue;
-      switch (vtype)
-	{
-	case VTYPE_ES:
-	case VTYPE_NONPSEUDO_IS:
-	case VTYPE_NONPSEUDO_TE_IS:
-	  if (memcmp ((u_char *) id, vertex->N.id, ISIS_SYS_ID_LEN) == 0)
-	    return vertex;
-	  break;
-	case VTYPE_PSEUDO_IS:
-	case VTYPE_PSEUDO_TE_IS:
-	  if (memcmp ((u_char *) id, vertex->N.id, ISIS_SYS_ID_LEN + 1) == 0)
-	    return vertex;
-	  break;
-	case VTYPE_IPREACH_INTERNAL:
-	case VTYPE_IPREACH_EXTERNAL:
-	case VTYPE_IPREACH_TE:
-#ifdef HAVE_IPV6
-	case VTYPE_IP6REACH_INTERNAL:
-	case VTYPE_IP6REACH_EXTERNAL:
-#endif /* HAVE_IPV6 */
-	  p1 = (struct prefix *) id;
-	  p2 = (struct prefix *) &vertex->N.id;
-	  if (p1->family == p2->family && p1->prefixlen == p2->prefixlen &&
-	      memcmp (&p1->u.prefix, &p2->u.prefix,
-		      PSIZE (p1->prefixlen)) == 0)
-	    return vertex;
-	  break;
-	}
-    }
+  memset (&key, 0, sizeof (key));
+  isis_vertex_id_init (&key, id, vtype);
 
-  return NULL;
+  return hash_lookup (spftree->vertices, &key);
 }
 
 /*
- * Add a vertex to TENT sorted by cost and by vertextype on tie break situation
+ * Add a vertex to TENT, ordered by cost and by vertextype on tie break
  */
 static struct isis_vertex *
 isis_spf_add2tent (struct isis_spftree *spftree, enum vertextype vtype,
 		   void *id, struct isis_adjacency *adj, u_int32_t cost,
 		   int depth, int family)
 {
-  struct isis_vertex *vertex, *v;
-  struct listnode *node;
+  struct isis_vertex *vertex;
 #ifdef EXTREME_DEBUG
   u_char buff[BUFSIZ];
 #endif
@@ -410,47 +507,27 @@ isis_spf_add2tent (struct isis_spftree *spftree, enum vertextype vtype,
 	      vtype2string (vertex->type), vid2string (vertex, buff),
 	      vertex->depth, vertex->d_N);
 #endif /* EXTREME_DEBUG */
-  listnode_add (spftree->tents, vertex);
-  if (list_isempty (spftree->tents))
-    {
-      listnode_add (spftree->tents, vertex);
-      return vertex;
-    }
-  
-  /* XXX: This cant use the standard ALL_LIST_ELEMENT macro */
-  for (node = listhead (spftree->tents); node; node = listnextnode (node))
-    {
-      v = listgetdata (node);
-      if (v->d_N > vertex->d_N)
-	{
-	  list_add_node_prev (spftree->tents, node, vertex);
-	  break;
-	}
-      else if (v->d_N == vertex->d_N)
-	{
-	  /*  Tie break, add according to type */
-	  while (v && v->d_N == vertex->d_N && v->type > vertex->type)
-	    {
-	      if (v->type > vertex->type)
-		{
-		  break;
-		}
-              /* XXX: this seems dubious, node is the loop iterator */
-	      node = listnextnode (node);
-	      (node) ? (v = listgetdata (node)) : (v = NULL);
-	    }
-	  list_add_node_prev (spftree->tents, node, vertex);
-	  break;
-	}
-      else if (node->next == NULL)
-	{
-	  list_add_node_next (spftree->tents, node, vertex);
-	  break;
-	}
-    }
+  hash_get (spftree->vertices, vertex, hash_alloc_intern);
+  pqueue_enqueue (vertex, spftree->tents);
+
   return vertex;
 }
 
+/* A shorter path to a vertex in TENT: it replaces the vertex's
+   adjacencies, and the vertex moves up the heap.  */
+static void
+isis_spf_tent_decrease (struct isis_spftree *spftree,
+			struct isis_vertex *vertex, struct isis_adjacency *adj,
+			u_int32_t cost, int depth)
+{
+  vertex->d_N = cost;
+  vertex->depth = depth;
+  list_delete_all_node (vertex->Adj_N);
+  if (adj)
+    listnode_add (vertex->Adj_N, adj);
+  trickle_up (vertex->tent_index, spftree->tents);
+}
+
 static struct isis_vertex *
 isis_spf_add_local (struct isis_spftree *spftree, enum vertextype vtype,
 		    void *id, struct isis_adjacency *adj, u_int32_t cost,
@@ -458,8 +535,10 @@ isis_spf_add_local (struct isis_spftree *spftree, enum vertextype vtype,
 {
   struct isis_vertex *vertex;
 
-  vertex = isis_find_vertex (spftree->tents, id, vtype);
+  vertex = isis_find_vertex (spftree, id, vtype);
 
+  if (vertex && vertex->tent_index < 0)
+    return vertex;
   if (vertex)
     {
       /* C.2.5   c) */
@@ -473,15 +552,11 @@ isis_spf_add_local (struct isis_spftree *spftree, enum vertextype vtype,
 	}
       /*         f) */
       else if (vertex->d_N > cost)
-	{
-	  listnode_delete (spftree->tents, vertex);
-	  goto add2tent;
-	}
+	isis_spf_tent_decrease (spftree, vertex, adj, cost, 1);
       /*       e) do nothing */
       return vertex;
     }
 
-add2tent:
   return isis_spf_add2tent (spftree, vtype, id, adj, cost, 1, family);
 }
 
@@ -498,9 +573,9 @@ process_N (struct isis_spftree *spftree, enum vertextype vtype, void *id,
   /* C.2.6 b)    */
   if (dist > MAX_PATH_METRIC)
     return;
+  vertex = isis_find_vertex (spftree, id, vtype);
   /*       c)    */
-  vertex = isis_find_vertex (spftree->paths, id, vtype);
-  if (vertex)
+  if (vertex && vertex->tent_index < 0)
     {
 #ifdef EXTREME_DEBUG
       zlog_debug ("ISIS-Spf: process_N  %s %s dist %d already found from PATH",
@@ -510,7 +585,6 @@ process_N (struct isis_spftree *spftree, enum vertextype vtype, void *id,
       return;
     }
 
-  vertex = isis_find_vertex (spftree->tents, id, vtype);
   /*       d)    */
   if (vertex)
     {
@@ -536,7 +610,8 @@ process_N (struct isis_spftree *spftree, enum vertextype vtype, void *id,
 	}
       else
 	{
-	  listnode_delete (spftree->tents, vertex);
+	  isis_spf_tent_decrease (spftree, vertex, adj, dist, depth);
+	  return;
 	}
     }
 
@@ -572,8 +647,9 @@ isis_spf_process_lsp (struct isis_spftree *spftree, struct isis_lsp *lsp,
 lspfragloop:
   if (lsp->lsp_header->seq_num == 0)
     {
-      zlog_warn ("isis_spf_process_lsp(): lsp with 0 seq_num"
-		 " - do not process");
+      isis_spf_zlog (spftree, LOG_WARNING,
+		     "isis_spf_process_lsp(): lsp with 0 seq_num"
+		     " - do not process");
       return ISIS_WARNING;
     }
 
@@ -702,8 +778,9 @@ pseudofragloop:
 
   if (lsp->lsp_header->seq_num == 0)
     {
-      zlog_warn ("isis_spf_process_pseudo_lsp(): lsp with 0 seq_num"
-		 " - do not process");
+      isis_spf_zlog (spftree, LOG_WARNING,
+		     "isis_spf_process_pseudo_lsp(): lsp with 0 seq_num"
+		     " - do not process");
       return ISIS_WARNING;
     }
 
@@ -715,10 +792,8 @@ pseudofragloop:
 	/* Two way connectivity */
 	if (!memcmp (is_neigh->neigh_id, isis->sysid, ISIS_SYS_ID_LEN))
 	  continue;
-	if (isis_find_vertex
-	    (spftree->tents, (void *) is_neigh->neigh_id, vtype) == NULL
-	    && isis_find_vertex (spftree->paths, (void *) is_neigh->neigh_id,
-			       vtype) == NULL)
+	if (isis_find_vertex (spftree, (void *) is_neigh->neigh_id,
+			      vtype) == NULL)
 	  {
 	    /* C.2.5 i) */
 	    isis_spf_add2tent (spftree, vtype, is_neigh->neigh_id, lsp->adj,
@@ -733,10 +808,8 @@ pseudofragloop:
 	/* Two way connectivity */
 	if (!memcmp (te_is_neigh->neigh_id, isis->sysid, ISIS_SYS_ID_LEN))
 	  continue;
-	if (isis_find_vertex
-	    (spftree->tents, (void *) te_is_neigh->neigh_id, vtype) == NULL
-	    && isis_find_vertex (spftree->paths, (void *) te_is_neigh->neigh_id,
-				 vtype) == NULL)
+	if (isis_find_vertex (spftree, (void *) te_is_neigh->neigh_id,
+			      vtype) == NULL)
 	  {
 	    /* C.2.5 i) */
 	    isis_spf_add2tent (spftree, vtype, te_is_neigh->neigh_id, lsp->adj,
@@ -828,8 +901,9 @@ isis_spf_preload_tent (struct isis_spftree *spftree,
 	    {
 	      list_delete (adj_list);
 	      if (isis->debugs & DEBUG_SPF_EVENTS)
-		zlog_debug ("ISIS-Spf: no L%d adjacencies on circuit %s",
-			    level, circuit->interface->name);
+		isis_spf_zlog (spftree, LOG_DEBUG,
+			       "ISIS-Spf: no L%d adjacencies on circuit %s",
+			       level, circuit->interface->name);
 	      continue;
 	    }
 	  anode = listhead (adj_list);
@@ -859,14 +933,16 @@ isis_spf_preload_tent (struct isis_spftree *spftree,
 		  LSP_FRAGMENT (lsp_id) = 0;
 		  lsp = lsp_search (lsp_id, area->lspdb[level - 1]);
 		  if (!lsp)
-		    zlog_warn ("No lsp found for IS adjacency");
+		    isis_spf_zlog (spftree, LOG_WARNING,
+				   "No lsp found for IS adjacency");
 		  /*          else {
 		     isis_spf_process_lsp (spftree, lsp, vertex->d_N, 1, family);
 		     } */
 		  break;
 		case ISIS_SYSTYPE_UNKNOWN:
 		default:
-		  zlog_warn ("isis_spf_preload_tent unknow adj type");
+		  isis_spf_zlog (spftree, LOG_WARNING,
+				 "isis_spf_preload_tent unknow adj type");
 		}
 	      anode = listnextnode (anode);
 	    }
@@ -883,11 +959,13 @@ isis_spf_preload_tent (struct isis_spftree *spftree,
 	  /* if no adj, we are the dis or error */
 	  if (!adj && !circuit->u.bc.is_dr[level - 1])
 	    {
-	      zlog_warn ("ISIS-Spf: No adjacency found for DR");
+	      isis_spf_zlog (spftree, LOG_WARNING,
+			     "ISIS-Spf: No adjacency found for DR");
 	    }
 	  if (lsp == NULL || lsp->lsp_header->rem_lifetime == 0)
 	    {
-	      zlog_warn ("ISIS-Spf: No lsp found for DR");
+	      isis_spf_zlog (spftree, LOG_WARNING,
+			     "ISIS-Spf: No lsp found for DR");
 	    }
 	  else
 	    {
@@ -917,13 +995,15 @@ isis_spf_preload_tent (struct isis_spftree *spftree,
 	      break;
 	    case ISIS_SYSTYPE_UNKNOWN:
 	    default:
-	      zlog_warn ("isis_spf_preload_tent unknow adj type");
+	      isis_spf_zlog (spftree, LOG_WARNING,
+			     "isis_spf_preload_tent unknow adj type");
 	      break;
 	    }
 	}
       else
 	{
-	  zlog_warn ("isis_spf_preload_tent unsupported media");
+	  isis_spf_zlog (spftree, LOG_WARNING,
+			 "isis_spf_preload_tent unsupported media");
 	  retval = ISIS_WARNING;
 	}
 
@@ -937,8 +1017,7 @@ isis_spf_preload_tent (struct isis_spftree *spftree,
  * now we just put the child pointer(s) in place
  */
 static void
-add_to_paths (struct isis_spftree *spftree, struct isis_vertex *vertex,
-	      struct isis_area *area, int level)
+add_to_paths (struct isis_spftree *spftree, struct isis_vertex *vertex)
 {
 #ifdef EXTREME_DEBUG
   u_char buff[BUFSIZ];
@@ -950,14 +1029,6 @@ add_to_paths (struct isis_spftree *spftree, struct isis_vertex *vertex,
 	      vtype2string (vertex->type), vid2string (vertex, buff),
 	      vertex->depth, vertex->d_N);
 #endif /* EXTREME_DEBUG */
-  if (vertex->type > VTYPE_ES)
-    {
-      if (listcount (vertex->Adj_N) > 0)
-	isis_route_create ((struct prefix *) &vertex->N.prefix, vertex->d_N,
-			   vertex->depth, vertex->Adj_N, area, level);
-      else if (isis->debugs & DEBUG_SPF_EVENTS)
-	zlog_debug ("ISIS-Spf: no adjacencies do not install route");
-    }
 
   return;
 }
@@ -965,53 +1036,39 @@ add_to_paths (struct isis_spftree *spftree, struct isis_vertex *vertex,
 static void
 init_spt (struct isis_spftree *spftree)
 {
-  spftree->tents->del = spftree->paths->del = (void (*)(void *)) isis_vertex_del;
-  list_delete_all_node (spftree->tents);
+  spftree->tents->size = 0;
   list_delete_all_node (spftree->paths);
-  spftree->tents->del = spftree->paths->del = NULL;
+  hash_clean (spftree->vertices, (void (*)(void *)) isis_vertex_del);
 
   return;
 }
 
+static struct isis_spftree *
+isis_spftree_get (struct isis_area *area, int level, int family)
+{
+#ifdef HAVE_IPV6
+  if (family == AF_INET6)
+    return area->spftree6[level - 1];
+#endif
+  return area->spftree[level - 1];
+}
+
+/*
+ * Compute the SPT of one level.  Nothing outside the tree is changed, so
+ * that with "spf-parallel" both levels can be computed at the same time.
+ */
 static int
-isis_run_spf (struct isis_area *area, int level, int family)
+isis_spf_compute (struct isis_area *area, int level, int family)
 {
   int retval = ISIS_OK;
-  struct listnode *node;
   struct isis_vertex *vertex;
-  struct isis_spftree *spftree = NULL;
+  struct isis_spftree *spftree;
   u_char lsp_id[ISIS_SYS_ID_LEN + 2];
   struct isis_lsp *lsp;
-  struct route_table *table = NULL;
-  struct route_node *rode;
-  struct isis_route_info *rinfo;
-
-  if (family == AF_INET)
-    spftree = area->spftree[level - 1];
-#ifdef HAVE_IPV6
-  else if (family == AF_INET6)
-    spftree = area->spftree6[level - 1];
-#endif
 
+  spftree = isis_spftree_get (area, level, family);
   assert (spftree);
 
-  /* Make all routes in current route table inactive. */
-  if (family == AF_INET)
-    table = area->route_table[level - 1];
-#ifdef HAVE_IPV6
-  else if (family == AF_INET6)
-    table = area->route_table6[level - 1];
-#endif
-
-  for (rode = route_top (table); rode; rode = route_next (rode))
-    {
-      if (rode->info == NULL)
-        continue;
-      rinfo = rode->info;
-
-      UNSET_FLAG (rinfo->flag, ISIS_ROUTE_FLAG_ACTIVE);
-    }
-
   /*
    * C.2.5 Step 0
    */
@@ -1024,21 +1081,18 @@ isis_run_spf (struct isis_area *area, int level, int family)
   /*
    * C.2.7 Step 2
    */
-  if (listcount (spftree->tents) == 0)
+  if (spftree->tents->size == 0)
     {
-      zlog_warn ("ISIS-Spf: TENT is empty");
-      goto out;
+      isis_spf_zlog (spftree, LOG_WARNING, "ISIS-Spf: TENT is empty");
+      return retval;
     }
 
-  while (listcount (spftree->tents) > 0)
+  while (spftree->tents->size > 0)
     {
-      node = listhead (spftree->tents);
-      vertex = listgetdata (node);
       /* Remove from tent list */
-      list_delete_node (spftree->tents, node);
-      if (isis_find_vertex (spftree->paths, vertex->N.id, vertex->type))
-	continue;
-      add_to_paths (spftree, vertex, area, level);
+      vertex = pqueue_dequeue (spftree->tents);
+      vertex->tent_index = -1;
+      add_to_paths (spftree, vertex);
       if (vertex->type == VTYPE_PSEUDO_IS ||
 	  vertex->type == VTYPE_NONPSEUDO_IS)
 	{
@@ -1061,20 +1115,212 @@ isis_run_spf (struct isis_area *area, int level, int family)
 	    }
 	  else
 	    {
-	      zlog_warn ("ISIS-Spf: No LSP found for %s",
-			 rawlspid_print (lsp_id));
+	      /* Not rawlspid_print, its buffer is shared.  */
+	      isis_spf_zlog (spftree, LOG_WARNING, "ISIS-Spf: No LSP found for "
+			     "%02x%02x.%02x%02x.%02x%02x.%02x-%02x",
+			     lsp_id[0], lsp_id[1], lsp_id[2], lsp_id[3],
+			     lsp_id[4], lsp_id[5], LSP_PSEUDO_ID (lsp_id),
+			     LSP_FRAGMENT (lsp_id));
 	    }
 	}
     }
 
-out:
-  thread_add_event (master, isis_route_validate, area, 0);
+  return retval;
+}
+
+/*
+ * Replace the routes of one level by those to the vertices in PATHS.
+ */
+static void
+isis_spf_install (struct isis_area *area, int level, int family)
+{
+  struct isis_spftree *spftree;
+  struct route_table *table = NULL;
+  struct route_node *rode;
+  struct isis_route_info *rinfo;
+  struct listnode *node;
+  struct isis_vertex *vertex;
+
+  spftree = isis_spftree_get (area, level, family);
+
+  /* Make all routes in current route table inactive. */
+  if (family == AF_INET)
+    table = area->route_table[level - 1];
+#ifdef HAVE_IPV6
+  else if (family == AF_INET6)
+    table = area->route_table6[level - 1];
+#endif
+
+  for (rode = route_top (table); rode; rode = route_next (rode))
+    {
+      if (rode->info == NULL)
+        continue;
+      rinfo = rode->info;
+
+      UNSET_FLAG (rinfo->flag, ISIS_ROUTE_FLAG_ACTIVE);
+    }
+
+  for (ALL_LIST_ELEMENTS_RO (spftree->paths, node, vertex))
+    {
+      if (vertex->type <= VTYPE_ES)
+	continue;
+      if (listcount (vertex->Adj_N) > 0)
+	isis_route_create ((struct prefix *) &vertex->N.prefix, vertex->d_N,
+			   vertex->depth, vertex->Adj_N, area, level);
+      else if (isis->debugs & DEBUG_SPF_EVENTS)
+	zlog_debug ("ISIS-Spf: no adjacencies do not install route");
+    }
+
   spftree->lastrun = time (NULL);
   spftree->pending = 0;
+}
+
+struct isis_spf_run
+{
+  struct isis_area *area;
+  int level;
+  int family;
+  int retval;
+  unsigned long usec;
+};
+
+static void
+isis_spf_run_timed (struct isis_spf_run *run)
+{
+  struct timeval start, stop;
+
+  gettimeofday (&start, NULL);
+  run->retval = isis_spf_compute (run->area, run->level, run->family);
+  gettimeofday (&stop, NULL);
+
+  run->usec = (stop.tv_sec - start.tv_sec) * 1000000L
+    + (stop.tv_usec - start.tv_usec);
+}
+
+static void
+isis_spf_log (struct isis_spf_run *run, int parallel)
+{
+  struct isis_spftree *spftree;
+
+  spftree = isis_spftree_get (run->area, run->level, run->family);
+  spftree->timerun = run->usec;
+  spftree->runcount++;
+
+  if (isis->debugs & DEBUG_SPF_STATS)
+    zlog_debug ("ISIS-Spf (%s) L%d %s SPF took %lu usec, %d paths%s",
+		run->area->area_tag, run->level,
+		run->family == AF_INET ? "IP" : "IPv6", run->usec,
+		listcount (spftree->paths),
+		parallel ? ", alongside the other level" : "");
+}
+
+/* Restart the periodic SPF of a level that was computed before it was
+   due.  */
+static void
+isis_spf_rearm (struct isis_area *area, int level, int family)
+{
+  struct isis_spftree *spftree;
+  int (*func) (struct thread *);
+
+  spftree = isis_spftree_get (area, level, family);
+  func = level == 1 ? isis_run_spf_l1 : isis_run_spf_l2;
+#ifdef HAVE_IPV6
+  if (family == AF_INET6)
+    func = level == 1 ? isis_run_spf6_l1 : isis_run_spf6_l2;
+#endif
+
+  THREAD_TIMER_OFF (spftree->t_spf);
+  THREAD_TIMER_ON (master, spftree->t_spf, func, area,
+		   isis_jitter (PERIODIC_SPF_INTERVAL, 10));
+}
+
+static void *
+isis_spf_worker (void *arg)
+{
+  isis_spf_run_timed (arg);
+  return NULL;
+}
+
+/*
+ * Compute both levels of an L1L2 area, the other level on a thread of its
+ * own, then install their routes in turn.  A level run like this is not
+ * run again before its next periodic run.
+ */
+static int
+isis_run_spf_parallel (struct isis_area *area, int level, int family)
+{
+  struct isis_spf_run run[ISIS_LEVELS];
+  struct isis_spftree *worker;
+  pthread_t thread;
+  sigset_t set, oset;
+  int i, threaded, retval = ISIS_OK;
+
+  for (i = 0; i < ISIS_LEVELS; i++)
+    {
+      run[i].area = area;
+      run[i].level = i + 1;
+      run[i].family = family;
+    }
+
+  memory_threaded ();
+  worker = isis_spftree_get (area, run[1].level, family);
+  worker->msgs = list_new ();
+
+  /* Signals are for the main thread only.  */
+  sigfillset (&set);
+  pthread_sigmask (SIG_BLOCK, &set, &oset);
+#ifdef EXTREME_DEBUG
+  /* Its debugs use the static buffers of isis_misc.c.  */
+  threaded = 0;
+#else
+  threaded = (pthread_create (&thread, NULL, isis_spf_worker, &run[1]) == 0);
+#endif /* EXTREME_DEBUG */
+  pthread_sigmask (SIG_SETMASK, &oset, NULL);
+
+  isis_spf_run_timed (&run[0]);
+  if (threaded)
+    pthread_join (thread, NULL);
+  else
+    isis_spf_run_timed (&run[1]);
+  isis_spf_zlog_held (worker);
+
+  for (i = 0; i < ISIS_LEVELS; i++)
+    {
+      isis_spf_install (area, run[i].level, family);
+      isis_spf_log (&run[i], threaded);
+      if (run[i].level != level)
+	isis_spf_rearm (area, run[i].level, family);
+      if (run[i].retval != ISIS_OK)
+	retval = run[i].retval;
+    }
+
+  thread_add_event (master, isis_route_validate, area, 0);
 
   return retval;
 }
 
+static int
+isis_run_spf (struct isis_area *area, int level, int family)
+{
+  struct isis_spf_run run;
+
+  if (area->spf_parallel && area->is_type == IS_LEVEL_1_AND_2
+      && isis_spftree_get (area, 1, family)
+      && isis_spftree_get (area, 2, family))
+    return isis_run_spf_parallel (area, level, family);
+
+  run.area = area;
+  run.level = level;
+  run.family = family;
+  isis_spf_run_timed (&run);
+  isis_spf_install (area, level, family);
+  isis_spf_log (&run, 0);
+
+  thread_add_event (master, isis_route_validate, area, 0);
+
+  return run.retval;
+}
+
 int
 isis_run_spf_l1 (struct thread *thread)
 {
@@ -59,6 +59,8 @@ struct isis_vertex
   u_int16_t depth;		/* The depth in the imaginary tree */
 
   struct list *Adj_N;		/* {Adj(N)}  */
+
+  int tent_index;		/* Position in TENT, -1 once in PATHS */
 };
 
 struct isis_spftree
@@ -67,9 +69,12 @@ struct isis_spftree
   time_t lastrun;		/* for scheduling */
   int pending;			/* already scheduled */
   struct list *paths;		/* the SPT */
-  struct list *tents;		/* TENT */
+  struct pqueue *tents;		/* TENT, a heap on d(N) and vertex type */
+  struct hash *vertices;	/* Everything in TENT and PATHS, by id */
+  struct list *msgs;		/* logged once back on the main thread */
 
-  u_int32_t timerun;		/* statistics */
+  u_int32_t timerun;		/* statistics: usecs taken by the last run */
+  u_int32_t runcount;		/* and the number of runs */
 };
 
 void spftree_area_init (struct isis_area *area);
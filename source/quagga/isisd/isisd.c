@@ -1591,6 +1591,33 @@ ALIAS (no_spf_interval,
        "Set interval for level 2 only\n"
        "Minimum interval between consecutive SPFs in seconds\n")
 
+DEFUN (spf_parallel,
+       spf_parallel_cmd,
+       "spf-parallel",
+       "Compute the level-1 and level-2 SPF together, on separate threads\n")
+{
+  struct isis_area *area;
+
+  area = vty->index;
+  area->spf_parallel = 1;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_spf_parallel,
+       no_spf_parallel_cmd,
+       "no spf-parallel",
+       NO_STR
+       "Compute the level-1 and level-2 SPF together, on separate threads\n")
+{
+  struct isis_area *area;
+
+  area = vty->index;
+  area->spf_parallel = 0;
+
+  return CMD_SUCCESS;
+}
+
 #ifdef TOPOLOGY_GENERATE
 DEFUN (topology_generate_grid,
        topology_generate_grid_cmd,
@@ -2029,6 +2056,11 @@ isis_config_write (struct vty *vty)
 		write++;
 	      }
 	  }
+	if (area->spf_parallel)
+	  {
+	    vty_out (vty, " spf-parallel%s", VTY_NEWLINE);
+	    write++;
+	  }
 	/* Authentication passwords. */
 	if (area->area_passwd.len > 0)
 	  {
@@ -2204,6 +2236,8 @@ isis_init ()
   install_element (ISIS_NODE, &spf_interval_l2_cmd);
   install_element (ISIS_NODE, &no_spf_interval_l2_cmd);
   install_element (ISIS_NODE, &no_spf_interval_l2_arg_cmd);
+  install_element (ISIS_NODE, &spf_parallel_cmd);
+  install_element (ISIS_NODE, &no_spf_parallel_cmd);
 
   install_element (ISIS_NODE, &lsp_lifetime_cmd);
   install_element (ISIS_NODE, &no_lsp_lifetime_cmd);
@@ -119,6 +119,8 @@ struct isis_area
   u_int16_t lsp_gen_interval[ISIS_LEVELS];
   /* min interval between between consequtive SPFs */
   u_int16_t min_spf_interval[ISIS_LEVELS];
+  /* compute the SPTs of both levels at once, on two threads */
+  char spf_parallel;
   /* the percentage of LSP mtu size used, before generating a new frag */
   int lsp_frag_threshold;
   int ip_circuits;
@@ -3648,6 +3648,9 @@ cmd_init (int terminal)
       install_element (VIEW_NODE, &show_thread_cpu_cmd);
       install_element (ENABLE_NODE, &show_thread_cpu_cmd);
       install_element (RESTRICTED_NODE, &show_thread_cpu_cmd);
+      install_element (VIEW_NODE, &show_thread_timers_cmd);
+      install_element (ENABLE_NODE, &show_thread_timers_cmd);
+      install_element (RESTRICTED_NODE, &show_thread_timers_cmd);
       
       install_element (ENABLE_NODE, &clear_thread_cpu_cmd);
       install_element (VIEW_NODE, &show_work_queues_cmd);
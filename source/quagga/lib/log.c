@@ -864,6 +864,8 @@ static const struct zebra_desc_table command_types[] = {
   DESC_ENTRY	(ZEBRA_ROUTER_ID_ADD),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_DELETE),
   DESC_ENTRY	(ZEBRA_ROUTER_ID_UPDATE),
+  DESC_ENTRY	(ZEBRA_IPV4_ROUTE_BATCH),
+  DESC_ENTRY	(ZEBRA_IPV4_ROUTE_BATCH_ACK),
 };
 #undef DESC_ENTRY
 
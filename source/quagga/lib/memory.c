@@ -29,8 +29,44 @@
 #include "log.h"
 #include "memory.h"
 
-static void alloc_inc (int);
-static void alloc_dec (int);
+/* The size malloc really gave, so that what is freed can be taken
+   off the byte counts again without a header on every block. */
+#ifdef __GLIBC__
+#define MEMORY_SIZE(ptr)  malloc_usable_size (ptr)
+#define MEMORY_SIZE_KNOWN 1
+#else
+#define MEMORY_SIZE(ptr)  0
+#define MEMORY_SIZE_KNOWN 0
+#endif /* __GLIBC__ */
+
+/* Allocations are counted by requested size in powers of two, from
+   16 bytes or less up to more than 4KiB. */
+#define MEMORY_SIZE_CLASSES 10
+
+static struct
+{
+  long alloc;			/* outstanding */
+  long alloc_max;
+  unsigned long bytes;		/* outstanding, as malloc sized them */
+  unsigned long bytes_max;
+  unsigned long total;		/* allocations ever made */
+  unsigned long total_shown;	/* total at the last show memory detail */
+  unsigned long sizes[MEMORY_SIZE_CLASSES];
+#ifdef MEMORY_LOG
+  unsigned long t_malloc;
+  unsigned long c_malloc;
+  unsigned long t_calloc;
+  unsigned long c_calloc;
+  unsigned long t_realloc;
+  unsigned long t_free;
+  unsigned long c_strdup;
+#endif /* MEMORY_LOG */
+} mstat [MTYPE_MAX];
+
+static inline void alloc_inc (int, void *, size_t)
+  __attribute__ ((always_inline));
+static void alloc_resize (int, size_t, size_t);
+static void alloc_dec (int, void *);
 static void log_memstats(int log_priority);
 
 static const struct message mstr [] =
@@ -73,7 +109,7 @@ zmalloc (int type, size_t size)
   if (memory == NULL)
     zerror ("malloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, memory, size);
 
   return memory;
 }
@@ -91,7 +127,7 @@ zcalloc (int type, size_t size)
   if (memory == NULL)
     zerror ("calloc", type, size);
 
-  alloc_inc (type);
+  alloc_inc (type, memory, size);
 
   return memory;
 }
@@ -107,12 +143,17 @@ void *
 zrealloc (int type, void *ptr, size_t size)
 {
   void *memory;
+  size_t before = 0;
 
+  if (ptr != NULL)
+    before = MEMORY_SIZE (ptr);
   memory = realloc (ptr, size);
   if (memory == NULL)
     zerror ("realloc", type, size);
   if (ptr == NULL)
-    alloc_inc (type);
+    alloc_inc (type, memory, size);
+  else
+    alloc_resize (type, before, MEMORY_SIZE (memory));
 
   return memory;
 }
@@ -128,7 +169,7 @@ zfree (int type, void *ptr)
 {
   if (ptr != NULL)
     {
-      alloc_dec (type);
+      alloc_dec (type, ptr);
       free (ptr);
     }
 }
@@ -147,24 +188,11 @@ zstrdup (int type, const char *str)
   dup = strdup (str);
   if (dup == NULL)
     zerror ("strdup", type, strlen (str));
-  alloc_inc (type);
+  alloc_inc (type, dup, strlen (str) + 1);
   return dup;
 }
 
 #ifdef MEMORY_LOG
-static struct 
-{
-  const char *name;
-  long alloc;
-  unsigned long t_malloc;
-  unsigned long c_malloc;
-  unsigned long t_calloc;
-  unsigned long c_calloc;
-  unsigned long t_realloc;
-  unsigned long t_free;
-  unsigned long c_strdup;
-} mstat [MTYPE_MAX];
-
 static void
 mtype_log (char *func, void *memory, const char *file, int line, int type)
 {
@@ -238,32 +266,174 @@ mtype_zstrdup (const char *file, int line, int type, const char *str)
 
   return memory;
 }
-#else
-static struct 
+#endif /* MEMORY_LOG */
+
+static void memory_sample (int, size_t) __attribute__ ((noinline));
+
+/* Set once a daemon allocates from more than one thread, from then on
+   the counts are kept atomically. */
+static int mstat_atomic;
+
+#define MSTAT_ADD(field, n) \
+  (mstat_atomic ? __sync_add_and_fetch (&(field), (n)) : ((field) += (n)))
+#define MSTAT_SUB(field, n) \
+  (mstat_atomic ? __sync_sub_and_fetch (&(field), (n)) : ((field) -= (n)))
+
+/* Allocation sampling, one in sample_every allocations, 0 for off. */
+#define MEMORY_SAMPLE_DEFAULT 1000
+static unsigned long sample_every;
+static unsigned long sample_shown_every;
+static unsigned long sample_countdown;
+
+static int
+memory_size_class (size_t size)
+{
+  int class;
+
+  if (size <= 16)
+    return 0;
+  class = sizeof (unsigned long) * 8 - __builtin_clzl (size - 1) - 4;
+  return (class < MEMORY_SIZE_CLASSES ? class : MEMORY_SIZE_CLASSES - 1);
+}
+
+/* Increment allocation counters.  Only the outstanding count and bytes
+   need be exact, the peaks, totals and sizes are statistics and a lost
+   update there between threads does no harm. */
+static inline void
+alloc_inc (int type, void *memory, size_t size)
 {
-  char *name;
   long alloc;
-} mstat [MTYPE_MAX];
-#endif /* MEMORY_LOG */
+  unsigned long bytes;
+
+  alloc = MSTAT_ADD (mstat[type].alloc, 1);
+  if (alloc > mstat[type].alloc_max)
+    mstat[type].alloc_max = alloc;
+  bytes = MSTAT_ADD (mstat[type].bytes, MEMORY_SIZE (memory));
+  if (bytes > mstat[type].bytes_max)
+    mstat[type].bytes_max = bytes;
+  mstat[type].total++;
+  mstat[type].sizes[memory_size_class (size)]++;
+
+  if (sample_every && MSTAT_SUB (sample_countdown, 1) == 0)
+    {
+      sample_countdown = sample_every;
+      memory_sample (type, size);
+    }
+}
 
-/* Increment allocation counter. */
+/* Move the byte count of a reallocated block to its new size. */
 static void
-alloc_inc (int type)
+alloc_resize (int type, size_t before, size_t after)
 {
-  mstat[type].alloc++;
+  unsigned long bytes;
+
+  if (after < before)
+    {
+      MSTAT_SUB (mstat[type].bytes, before - after);
+      return;
+    }
+  bytes = MSTAT_ADD (mstat[type].bytes, after - before);
+  if (bytes > mstat[type].bytes_max)
+    mstat[type].bytes_max = bytes;
 }
 
-/* Decrement allocation counter. */
+/* Decrement allocation counters. */
 static void
-alloc_dec (int type)
+alloc_dec (int type, void *memory)
 {
-  mstat[type].alloc--;
+  MSTAT_SUB (mstat[type].alloc, 1);
+  MSTAT_SUB (mstat[type].bytes, MEMORY_SIZE (memory));
 }
 
+/* To be called before a daemon starts another thread that allocates,
+   e.g. isisd with spf-parallel. */
+void
+memory_threaded (void)
+{
+  mstat_atomic = 1;
+}
+
 /* Looking up memory status from vty interface. */
 #include "vector.h"
 #include "vty.h"
 #include "command.h"
+#include "thread.h"
+
+#ifdef HAVE_GLIBC_BACKTRACE
+/* Sampled allocations are counted by type and call stack.  The first
+   frames are memory_sample itself and the z*alloc that called it,
+   alloc_inc being inlined. */
+#define MEMORY_SAMPLE_SKIP   2
+#define MEMORY_SAMPLE_DEPTH  8
+#define MEMORY_SAMPLE_SITES  512
+#define MEMORY_SAMPLE_SHOWN  20
+
+struct memory_site
+{
+  int type;
+  int depth;
+  void *pc[MEMORY_SAMPLE_DEPTH];
+  unsigned long count;
+  unsigned long bytes;
+};
+
+static struct memory_site sample_sites[MEMORY_SAMPLE_SITES];
+static unsigned long sample_lost;
+static int sample_lock;
+
+static void
+memory_sample (int type, size_t size)
+{
+  void *pc[MEMORY_SAMPLE_SKIP + MEMORY_SAMPLE_DEPTH];
+  struct memory_site *site = NULL;
+  unsigned long hash;
+  int depth, i;
+
+  /* Another thread is sampling, let this one go. */
+  if (__sync_lock_test_and_set (&sample_lock, 1))
+    return;
+
+  depth = backtrace (pc, MEMORY_SAMPLE_SKIP + MEMORY_SAMPLE_DEPTH)
+	  - MEMORY_SAMPLE_SKIP;
+  if (depth < 0)
+    depth = 0;
+
+  hash = type;
+  for (i = 0; i < depth; i++)
+    hash = hash * 31 + (unsigned long) pc[MEMORY_SAMPLE_SKIP + i];
+
+  for (i = 0; i < MEMORY_SAMPLE_SITES; i++)
+    {
+      site = &sample_sites[(hash + i) % MEMORY_SAMPLE_SITES];
+      if (site->count == 0)
+	{
+	  site->type = type;
+	  site->depth = depth;
+	  memcpy (site->pc, pc + MEMORY_SAMPLE_SKIP, depth * sizeof (void *));
+	  break;
+	}
+      if (site->type == type && site->depth == depth
+	  && ! memcmp (site->pc, pc + MEMORY_SAMPLE_SKIP,
+		       depth * sizeof (void *)))
+	break;
+    }
+
+  if (i == MEMORY_SAMPLE_SITES)
+    sample_lost++;
+  else
+    {
+      site->count++;
+      site->bytes += size;
+    }
+
+  __sync_lock_release (&sample_lock);
+}
+#else
+static void
+memory_sample (int type, size_t size)
+{
+}
+#endif /* HAVE_GLIBC_BACKTRACE */
 
 static void
 log_memstats(int pri)
@@ -510,9 +680,232 @@ DEFUN (show_memory_isis,
   return CMD_SUCCESS;
 }
 
+static const char *
+mtype_name (int type)
+{
+  struct mlist *ml;
+  struct memory_list *m;
+
+  for (ml = mlists; ml->list; ml++)
+    for (m = ml->list; m->index >= 0; m++)
+      if (m->index == type)
+	return m->format;
+  return "unknown";
+}
+
+/* When show memory detail last worked out the allocation rates. */
+static struct timeval shown_time;
+
+static void
+show_memory_detail_vty (struct vty *vty, struct mlist *ml, double elapsed)
+{
+  struct memory_list *m;
+  char buf[4][MTYPE_MEMSTR_LEN];
+  int i;
+
+  vty_out (vty, "Memory utilization in module %s:%s", ml->name, VTY_NEWLINE);
+  vty_out (vty, "%-30s %9s %9s %9s %9s %10s %8s%s", "Type", "Count", "Peak",
+	   "Bytes", "Peak", "Allocs", "Allocs/s", VTY_NEWLINE);
+  for (m = ml->list; m->index >= 0; m++)
+    if (m->index && mstat[m->index].total)
+      vty_out (vty, "%-30s %9ld %9ld %9s %9s %10lu %8.0f%s", m->format,
+	       mstat[m->index].alloc, mstat[m->index].alloc_max,
+	       MEMORY_SIZE_KNOWN
+	       ? mtype_memstr (buf[0], MTYPE_MEMSTR_LEN, mstat[m->index].bytes)
+	       : "-",
+	       MEMORY_SIZE_KNOWN
+	       ? mtype_memstr (buf[1], MTYPE_MEMSTR_LEN,
+			       mstat[m->index].bytes_max)
+	       : "-",
+	       mstat[m->index].total,
+	       (mstat[m->index].total - mstat[m->index].total_shown) / elapsed,
+	       VTY_NEWLINE);
+
+  vty_out (vty, "Allocations by size in module %s:%s", ml->name, VTY_NEWLINE);
+  vty_out (vty, "%-30s", "Type");
+  for (i = 0; i < MEMORY_SIZE_CLASSES - 1; i++)
+    {
+      snprintf (buf[2], MTYPE_MEMSTR_LEN, "<=%d", 16 << i);
+      vty_out (vty, " %7s", buf[2]);
+    }
+  snprintf (buf[3], MTYPE_MEMSTR_LEN, ">%d", 16 << (MEMORY_SIZE_CLASSES - 2));
+  vty_out (vty, " %7s%s", buf[3], VTY_NEWLINE);
+  for (m = ml->list; m->index >= 0; m++)
+    if (m->index && mstat[m->index].total)
+      {
+	vty_out (vty, "%-30s", m->format);
+	for (i = 0; i < MEMORY_SIZE_CLASSES; i++)
+	  vty_out (vty, " %7lu", mstat[m->index].sizes[i]);
+	vty_out (vty, "%s", VTY_NEWLINE);
+      }
+}
+
+#ifdef HAVE_GLIBC_BACKTRACE
+static int
+memory_site_cmp (const void *a, const void *b)
+{
+  const struct memory_site *sa = a, *sb = b;
+
+  if (sa->count != sb->count)
+    return (sa->count < sb->count ? 1 : -1);
+  return 0;
+}
+
+static void
+show_memory_sample_vty (struct vty *vty)
+{
+  struct memory_site *sites;
+  unsigned long lost;
+  char **symbols;
+  int i, j, n;
+
+  /* Copy the sites out, so as not to hold up allocating threads while
+     looking up symbols. */
+  sites = XMALLOC (MTYPE_TMP, sizeof (sample_sites));
+  while (__sync_lock_test_and_set (&sample_lock, 1))
+    ;
+  for (i = n = 0; i < MEMORY_SAMPLE_SITES; i++)
+    if (sample_sites[i].count)
+      sites[n++] = sample_sites[i];
+  lost = sample_lost;
+  __sync_lock_release (&sample_lock);
+
+  if (n == 0)
+    {
+      XFREE (MTYPE_TMP, sites);
+      return;
+    }
+
+  qsort (sites, n, sizeof (struct memory_site), memory_site_cmp);
+
+  vty_out (vty, "Allocation sites, %s one in %lu allocations:%s",
+	   sample_every ? "sampling" : "sampled", sample_every
+	   ? sample_every : sample_shown_every, VTY_NEWLINE);
+  if (lost)
+    vty_out (vty, "  (%lu samples lost, more than %d sites)%s", lost,
+	     MEMORY_SAMPLE_SITES, VTY_NEWLINE);
+  for (i = 0; i < n && i < MEMORY_SAMPLE_SHOWN; i++)
+    {
+      vty_out (vty, "%-30s %8lu samples, %lu bytes requested%s",
+	       mtype_name (sites[i].type), sites[i].count, sites[i].bytes,
+	       VTY_NEWLINE);
+      symbols = backtrace_symbols (sites[i].pc, sites[i].depth);
+      for (j = 0; j < sites[i].depth; j++)
+	if (symbols)
+	  vty_out (vty, "    %s%s", symbols[j], VTY_NEWLINE);
+	else
+	  vty_out (vty, "    %p%s", sites[i].pc[j], VTY_NEWLINE);
+      /* Allocated by backtrace_symbols with plain malloc. */
+      free (symbols);
+    }
+
+  XFREE (MTYPE_TMP, sites);
+}
+#endif /* HAVE_GLIBC_BACKTRACE */
+
+DEFUN (show_memory_detail,
+       show_memory_detail_cmd,
+       "show memory detail",
+       SHOW_STR
+       "Memory statistics\n"
+       "Counts, bytes, peaks and allocation sizes by type\n")
+{
+  struct mlist *ml;
+  struct timeval now;
+  double elapsed;
+  int i;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - shown_time.tv_sec)
+	    + (now.tv_usec - shown_time.tv_usec) / 1000000.0;
+  if (elapsed <= 0)
+    elapsed = 1;
+
+  if (! MEMORY_SIZE_KNOWN)
+    vty_out (vty, "(allocation sizes not known on this platform)%s",
+	     VTY_NEWLINE);
+  vty_out (vty, "Allocation rates over the last %.0f seconds%s", elapsed,
+	   VTY_NEWLINE);
+  for (ml = mlists; ml->list; ml++)
+    {
+      show_separator (vty);
+      show_memory_detail_vty (vty, ml, elapsed);
+    }
+
+  for (i = 0; i < MTYPE_MAX; i++)
+    mstat[i].total_shown = mstat[i].total;
+  shown_time = now;
+
+#ifdef HAVE_GLIBC_BACKTRACE
+  show_separator (vty);
+  show_memory_sample_vty (vty);
+#endif /* HAVE_GLIBC_BACKTRACE */
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (debug_memory_sample,
+       debug_memory_sample_cmd,
+       "debug memory sample <1-1000000>",
+       DEBUG_STR
+       "Memory allocation\n"
+       "Sample where allocations are made, see show memory detail\n"
+       "Sample one in this many allocations\n")
+{
+#ifdef HAVE_GLIBC_BACKTRACE
+  unsigned long every = MEMORY_SAMPLE_DEFAULT;
+  void *pc[1];
+
+  if (argc)
+    VTY_GET_INTEGER_RANGE ("sample interval", every, argv[0], 1, 1000000);
+
+  /* The first backtrace may load libgcc, best not in the middle of
+     an allocation. */
+  backtrace (pc, 1);
+
+  sample_every = 0;
+  while (__sync_lock_test_and_set (&sample_lock, 1))
+    ;
+  memset (sample_sites, 0, sizeof (sample_sites));
+  sample_lost = 0;
+  __sync_lock_release (&sample_lock);
+
+  sample_countdown = every;
+  sample_shown_every = every;
+  sample_every = every;
+  return CMD_SUCCESS;
+#else
+  vty_out (vty, "Allocation sampling is not available on this platform%s",
+	   VTY_NEWLINE);
+  return CMD_WARNING;
+#endif /* HAVE_GLIBC_BACKTRACE */
+}
+
+ALIAS (debug_memory_sample,
+       debug_memory_sample_default_cmd,
+       "debug memory sample",
+       DEBUG_STR
+       "Memory allocation\n"
+       "Sample where allocations are made, see show memory detail\n")
+
+DEFUN (no_debug_memory_sample,
+       no_debug_memory_sample_cmd,
+       "no debug memory sample",
+       NO_STR
+       DEBUG_STR
+       "Memory allocation\n"
+       "Sample where allocations are made, see show memory detail\n")
+{
+  /* The sites are kept, to be looked at with show memory detail. */
+  sample_every = 0;
+  return CMD_SUCCESS;
+}
+
 void
 memory_init (void)
 {
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &shown_time);
+
   install_element (RESTRICTED_NODE, &show_memory_cmd);
   install_element (RESTRICTED_NODE, &show_memory_all_cmd);
   install_element (RESTRICTED_NODE, &show_memory_lib_cmd);
@@ -522,6 +915,7 @@ memory_init (void)
   install_element (RESTRICTED_NODE, &show_memory_ospf_cmd);
   install_element (RESTRICTED_NODE, &show_memory_ospf6_cmd);
   install_element (RESTRICTED_NODE, &show_memory_isis_cmd);
+  install_element (RESTRICTED_NODE, &show_memory_detail_cmd);
 
   install_element (VIEW_NODE, &show_memory_cmd);
   install_element (VIEW_NODE, &show_memory_all_cmd);
@@ -532,6 +926,7 @@ memory_init (void)
   install_element (VIEW_NODE, &show_memory_ospf_cmd);
   install_element (VIEW_NODE, &show_memory_ospf6_cmd);
   install_element (VIEW_NODE, &show_memory_isis_cmd);
+  install_element (VIEW_NODE, &show_memory_detail_cmd);
 
   install_element (ENABLE_NODE, &show_memory_cmd);
   install_element (ENABLE_NODE, &show_memory_all_cmd);
@@ -543,6 +938,11 @@ memory_init (void)
   install_element (ENABLE_NODE, &show_memory_ospf_cmd);
   install_element (ENABLE_NODE, &show_memory_ospf6_cmd);
   install_element (ENABLE_NODE, &show_memory_isis_cmd);
+  install_element (ENABLE_NODE, &show_memory_detail_cmd);
+
+  install_element (ENABLE_NODE, &debug_memory_sample_cmd);
+  install_element (ENABLE_NODE, &debug_memory_sample_default_cmd);
+  install_element (ENABLE_NODE, &no_debug_memory_sample_cmd);
 }
 
 /* Stats querying from users */
@@ -613,3 +1013,9 @@ mtype_stats_alloc (int type)
 {
   return mstat[type].alloc;
 }
+
+unsigned long
+mtype_stats_bytes (int type)
+{
+  return mstat[type].bytes;
+}
@@ -83,10 +83,13 @@ extern void mtype_zfree (const char *file, int line, int type,
 extern char *mtype_zstrdup (const char *file, int line, int type,
 		            const char *str);
 extern void memory_init (void);
+extern void memory_threaded (void);
 extern void log_memstats_stderr (const char *);
 
 /* return number of allocations outstanding for the type */
 extern unsigned long mtype_stats_alloc (int);
+/* and the bytes they take, as malloc sized them */
+extern unsigned long mtype_stats_bytes (int);
 
 /* Human friendly string for given byte count */
 #define MTYPE_MEMSTR_LEN 20
@@ -81,6 +81,7 @@ struct memory_list memory_list_zebra[] =
   { MTYPE_NEXTHOP,		"Nexthop"			},
   { MTYPE_RIB,			"RIB"				},
   { MTYPE_RIB_QUEUE,		"RIB process work queue"	},
+  { MTYPE_FIB_UPDATE,		"FIB update"			},
   { MTYPE_STATIC_IPV4,		"Static IPv4 route"		},
   { MTYPE_STATIC_IPV6,		"Static IPv6 route"		},
   { -1, NULL },
@@ -113,6 +114,9 @@ struct memory_list memory_list_bgp[] =
   { MTYPE_BGP_SYNCHRONISE,	"BGP synchronise"		},
   { MTYPE_BGP_ADJ_IN,		"BGP adj in"			},
   { MTYPE_BGP_ADJ_OUT,		"BGP adj out"			},
+  { MTYPE_BGP_ADJ_OUT_SHARED,	"BGP adj out shared"		},
+  { MTYPE_BGP_PIPELINE,		"BGP decode pipeline"		},
+  { MTYPE_BGP_DUMP,		"BGP MRT dump"			},
   { 0, NULL },
   { MTYPE_AS_LIST,		"BGP AS list"			},
   { MTYPE_AS_FILTER,		"BGP AS filter"			},
@@ -160,6 +164,7 @@ struct memory_list memory_list_rip[] =
   { MTYPE_RIP_PEER,           "RIP peer"			},
   { MTYPE_RIP_OFFSET_LIST,    "RIP offset list"			},
   { MTYPE_RIP_DISTANCE,       "RIP distance"			},
+  { MTYPE_RIP_UPDATE_CACHE,   "RIP update cache"		},
   { -1, NULL }
 };
 
@@ -188,11 +193,13 @@ struct memory_list memory_list_ospf[] =
   { MTYPE_OSPF_LSA,           "OSPF LSA"			},
   { MTYPE_OSPF_LSA_DATA,      "OSPF LSA data"			},
   { MTYPE_OSPF_LSDB,          "OSPF LSDB"			},
+  { MTYPE_OSPF_LS_RXMT,       "OSPF LS retransmit"		},
   { MTYPE_OSPF_PACKET,        "OSPF packet"			},
   { MTYPE_OSPF_FIFO,          "OSPF FIFO queue"			},
   { MTYPE_OSPF_VERTEX,        "OSPF vertex"			},
   { MTYPE_OSPF_VERTEX_PARENT, "OSPF vertex parent",		},
   { MTYPE_OSPF_NEXTHOP,       "OSPF nexthop"			},
+  { MTYPE_OSPF_SPF_CHANGE,    "OSPF SPF change"		},
   { MTYPE_OSPF_PATH,	      "OSPF path"			},
   { MTYPE_OSPF_VL_DATA,       "OSPF VL data"			},
   { MTYPE_OSPF_CRYPT_KEY,     "OSPF crypt key"			},
@@ -70,6 +70,7 @@ enum
   MTYPE_NEXTHOP,
   MTYPE_RIB,
   MTYPE_RIB_QUEUE,
+  MTYPE_FIB_UPDATE,
   MTYPE_STATIC_IPV4,
   MTYPE_STATIC_IPV6,
   MTYPE_BGP,
@@ -96,6 +97,9 @@ enum
   MTYPE_BGP_SYNCHRONISE,
   MTYPE_BGP_ADJ_IN,
   MTYPE_BGP_ADJ_OUT,
+  MTYPE_BGP_ADJ_OUT_SHARED,
+  MTYPE_BGP_PIPELINE,
+  MTYPE_BGP_DUMP,
   MTYPE_AS_LIST,
   MTYPE_AS_FILTER,
   MTYPE_AS_FILTER_STR,
@@ -130,6 +134,7 @@ enum
   MTYPE_RIP_PEER,
   MTYPE_RIP_OFFSET_LIST,
   MTYPE_RIP_DISTANCE,
+  MTYPE_RIP_UPDATE_CACHE,
   MTYPE_RIPNG,
   MTYPE_RIPNG_ROUTE,
   MTYPE_RIPNG_AGGREGATE,
@@ -148,11 +153,13 @@ enum
   MTYPE_OSPF_LSA,
   MTYPE_OSPF_LSA_DATA,
   MTYPE_OSPF_LSDB,
+  MTYPE_OSPF_LS_RXMT,
   MTYPE_OSPF_PACKET,
   MTYPE_OSPF_FIFO,
   MTYPE_OSPF_VERTEX,
   MTYPE_OSPF_VERTEX_PARENT,
   MTYPE_OSPF_NEXTHOP,
+  MTYPE_OSPF_SPF_CHANGE,
   MTYPE_OSPF_PATH,
   MTYPE_OSPF_VL_DATA,
   MTYPE_OSPF_CRYPT_KEY,
@@ -29,6 +29,7 @@
 #include "buffer.h"
 #include "stream.h"
 #include "log.h"
+#include "table.h"
 
 /* Each prefix-list's entry. */
 struct prefix_list_entry
@@ -46,8 +47,14 @@ struct prefix_list_entry
   unsigned long refcnt;
   unsigned long hitcnt;
 
+  /* Hits not yet folded into the refcnt of the following entries. */
+  unsigned long hitpend;
+
   struct prefix_list_entry *next;
   struct prefix_list_entry *prev;
+
+  /* Next entry with the same trie node, ordered by seq. */
+  struct prefix_list_entry *trie_next;
 };
 
 /* List of struct prefix_list. */
@@ -180,6 +187,134 @@ prefix_list_entry_free (struct prefix_list_entry *pentry)
   XFREE (MTYPE_PREFIX_LIST_ENTRY, pentry);
 }
 
+/* Return index of the per-family trie which holds prefix P, or -1
+   when the family is not indexed. */
+static int
+prefix_list_trie_index (const struct prefix *p)
+{
+  if (p->family == AF_INET)
+    return 0;
+#ifdef HAVE_IPV6
+  if (p->family == AF_INET6)
+    return 1;
+#endif /* HAVE_IPV6 */
+  return -1;
+}
+
+/* Lookup the trie node whose entries have the same prefix as P.  The
+   node is returned unlocked. */
+static struct route_node *
+prefix_list_trie_lookup (struct prefix_list *plist, struct prefix *p)
+{
+  struct route_node *rn;
+  struct prefix key;
+  int idx;
+
+  idx = prefix_list_trie_index (p);
+  if (idx < 0 || plist->trie[idx] == NULL)
+    return NULL;
+
+  prefix_copy (&key, p);
+  apply_mask (&key);
+
+  rn = route_node_lookup (plist->trie[idx], &key);
+  if (rn)
+    route_unlock_node (rn);
+  return rn;
+}
+
+/* Link entry into the trie.  Entries sharing a prefix hang off the
+   same node, ordered by sequence number.  The node keeps one lock for
+   as long as it has entries. */
+static void
+prefix_list_trie_add (struct prefix_list *plist,
+		      struct prefix_list_entry *pentry)
+{
+  struct route_node *rn;
+  struct prefix_list_entry *point;
+  struct prefix key;
+  int idx;
+
+  idx = prefix_list_trie_index (&pentry->prefix);
+  if (idx < 0)
+    return;
+
+  if (plist->trie[idx] == NULL)
+    plist->trie[idx] = route_table_init ();
+
+  prefix_copy (&key, &pentry->prefix);
+  apply_mask (&key);
+
+  rn = route_node_get (plist->trie[idx], &key);
+  if (rn->info)
+    route_unlock_node (rn);
+
+  point = rn->info;
+  if (point == NULL || point->seq > pentry->seq)
+    {
+      pentry->trie_next = point;
+      rn->info = pentry;
+      return;
+    }
+
+  while (point->trie_next && point->trie_next->seq < pentry->seq)
+    point = point->trie_next;
+
+  pentry->trie_next = point->trie_next;
+  point->trie_next = pentry;
+}
+
+/* Unlink entry from the trie. */
+static void
+prefix_list_trie_delete (struct prefix_list *plist,
+			 struct prefix_list_entry *pentry)
+{
+  struct route_node *rn;
+  struct prefix_list_entry *point;
+
+  rn = prefix_list_trie_lookup (plist, &pentry->prefix);
+  if (rn == NULL)
+    return;
+
+  point = rn->info;
+  if (point == pentry)
+    rn->info = pentry->trie_next;
+  else
+    {
+      while (point && point->trie_next != pentry)
+	point = point->trie_next;
+      if (point)
+	point->trie_next = pentry->trie_next;
+    }
+  pentry->trie_next = NULL;
+
+  if (rn->info == NULL)
+    route_unlock_node (rn);
+}
+
+/* prefix_list_apply () does not touch every entry it would have
+   walked past, it only counts the lookup in plist->applied and the hit
+   in the matched entry's hitpend.  Fold those into refcnt so that it
+   reads exactly as if the list had been walked linearly. */
+static void
+prefix_list_refcnt_sync (struct prefix_list *plist)
+{
+  struct prefix_list_entry *pentry;
+  unsigned long applied;
+
+  if (plist->applied == 0)
+    return;
+
+  applied = plist->applied;
+  for (pentry = plist->head; pentry; pentry = pentry->next)
+    {
+      pentry->refcnt += applied;
+      applied -= pentry->hitpend;
+      pentry->hitpend = 0;
+    }
+  plist->applied = 0;
+}
+
 /* Insert new prefix list to list of prefix_list.  Each prefix_list
    is sorted by the name. */
 static struct prefix_list *
@@ -292,6 +427,7 @@ prefix_list_delete (struct prefix_list *plist)
   struct prefix_master *master;
   struct prefix_list_entry *pentry;
   struct prefix_list_entry *next;
+  unsigned int i;
 
   /* If prefix-list contain prefix_list_entry free all of it. */
   for (pentry = plist->head; pentry; pentry = next)
@@ -301,6 +437,10 @@ prefix_list_delete (struct prefix_list *plist)
       plist->count--;
     }
 
+  for (i = 0; i < sizeof (plist->trie) / sizeof (plist->trie[0]); i++)
+    if (plist->trie[i])
+      route_table_finish (plist->trie[i]);
+
   master = plist->master;
 
   if (plist->type == PREFIX_TYPE_NUMBER)
@@ -380,15 +520,12 @@ prefix_new_seq_get (struct prefix_list *plist)
 {
   int maxseq;
   int newseq;
-  struct prefix_list_entry *pentry;
 
   maxseq = newseq = 0;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
-    {
-      if (maxseq < pentry->seq)
-	maxseq = pentry->seq;
-    }
+  /* Entries are kept sorted by seq. */
+  if (plist->tail && maxseq < plist->tail->seq)
+    maxseq = plist->tail->seq;
 
   newseq = ((maxseq / 5) * 5) + 5;
   
@@ -401,6 +538,9 @@ prefix_seq_check (struct prefix_list *plist, int seq)
 {
   struct prefix_list_entry *pentry;
 
+  if (plist->tail == NULL || plist->tail->seq < seq)
+    return NULL;
+
   for (pentry = plist->head; pentry; pentry = pentry->next)
     if (pentry->seq == seq)
       return pentry;
@@ -412,8 +552,20 @@ prefix_list_entry_lookup (struct prefix_list *plist, struct prefix *prefix,
 			  enum prefix_list_type type, int seq, int le, int ge)
 {
   struct prefix_list_entry *pentry;
+  struct route_node *rn;
+  int indexed;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  /* Entries with the same prefix all hang off one trie node. */
+  indexed = (prefix_list_trie_index (prefix) >= 0);
+  if (indexed)
+    {
+      rn = prefix_list_trie_lookup (plist, prefix);
+      pentry = rn ? rn->info : NULL;
+    }
+  else
+    pentry = plist->head;
+
+  for (; pentry; pentry = indexed ? pentry->trie_next : pentry->next)
     if (prefix_same (&pentry->prefix, prefix) && pentry->type == type)
       {
 	if (seq >= 0 && pentry->seq != seq)
@@ -437,6 +589,10 @@ prefix_list_entry_delete (struct prefix_list *plist,
 {
   if (plist == NULL || pentry == NULL)
     return;
+
+  prefix_list_refcnt_sync (plist);
+  prefix_list_trie_delete (plist, pentry);
+
   if (pentry->prev)
     pentry->prev->next = pentry->next;
   else
@@ -478,10 +634,15 @@ prefix_list_entry_add (struct prefix_list *plist,
   if (replace)
     prefix_list_entry_delete (plist, replace, 0);
 
+  prefix_list_refcnt_sync (plist);
+
   /* Check insert point. */
-  for (point = plist->head; point; point = point->next)
-    if (point->seq >= pentry->seq)
-      break;
+  if (plist->tail && plist->tail->seq < pentry->seq)
+    point = NULL;
+  else
+    for (point = plist->head; point; point = point->next)
+      if (point->seq >= pentry->seq)
+	break;
 
   /* In case of this is the first element of the list. */
   pentry->next = point;
@@ -507,6 +668,8 @@ prefix_list_entry_add (struct prefix_list *plist,
       plist->tail = pentry;
     }
 
+  prefix_list_trie_add (plist, pentry);
+
   /* Increment count. */
   plist->count++;
 
@@ -532,15 +695,12 @@ prefix_list_type_str (struct prefix_list_entry *pentry)
     }
 }
 
+/* Check P's length against the entry's ge/le range.  The caller has
+   already checked that the entry's prefix covers P. */
 static int
-prefix_list_entry_match (struct prefix_list_entry *pentry, struct prefix *p)
+prefix_list_entry_len_match (struct prefix_list_entry *pentry,
+			     struct prefix *p)
 {
-  int ret;
-
-  ret = prefix_match (&pentry->prefix, p);
-  if (! ret)
-    return 0;
-  
   /* In case of le nor ge is specified, exact match is performed. */
   if (! pentry->le && ! pentry->ge)
     {
@@ -560,11 +720,60 @@ prefix_list_entry_match (struct prefix_list_entry *pentry, struct prefix *p)
   return 1;
 }
 
+static int
+prefix_list_entry_match (struct prefix_list_entry *pentry, struct prefix *p)
+{
+  int ret;
+
+  ret = prefix_match (&pentry->prefix, p);
+  if (! ret)
+    return 0;
+
+  return prefix_list_entry_len_match (pentry, p);
+}
+
+/* Find the first entry, in seq order, which matches P.  Every entry
+   whose prefix covers P sits on the trie path down to P, so only
+   O(prefix length) nodes are visited. */
+static struct prefix_list_entry *
+prefix_list_trie_match (struct route_table *table, struct prefix *p)
+{
+  struct route_node *node;
+  struct prefix_list_entry *pentry;
+  struct prefix_list_entry *match;
+
+  match = NULL;
+  node = table->top;
+
+  while (node && node->p.prefixlen <= p->prefixlen &&
+	 prefix_match (&node->p, p))
+    {
+      for (pentry = node->info; pentry; pentry = pentry->trie_next)
+	{
+	  if (match && pentry->seq >= match->seq)
+	    break;
+	  if (prefix_list_entry_len_match (pentry, p))
+	    {
+	      match = pentry;
+	      break;
+	    }
+	}
+
+      if (node->p.prefixlen == p->prefixlen)
+	break;
+
+      node = node->link[prefix_bit (&p->u.prefix, node->p.prefixlen)];
+    }
+
+  return match;
+}
+
 enum prefix_list_type
 prefix_list_apply (struct prefix_list *plist, void *object)
 {
   struct prefix_list_entry *pentry;
   struct prefix *p;
+  int idx;
 
   p = (struct prefix *) object;
 
@@ -574,6 +783,25 @@ prefix_list_apply (struct prefix_list *plist, void *object)
   if (plist->count == 0)
     return PREFIX_PERMIT;
 
+  idx = prefix_list_trie_index (p);
+  if (idx >= 0)
+    {
+      plist->applied++;
+
+      if (plist->trie[idx] == NULL)
+	return PREFIX_DENY;
+
+      pentry = prefix_list_trie_match (plist->trie[idx], p);
+      if (pentry == NULL)
+	return PREFIX_DENY;
+
+      pentry->hitcnt++;
+      pentry->hitpend++;
+      return pentry->type;
+    }
+
+  prefix_list_refcnt_sync (plist);
+
   for (pentry = plist->head; pentry; pentry = pentry->next)
     {
       pentry->refcnt++;
@@ -628,14 +856,25 @@ prefix_entry_dup_check (struct prefix_list *plist,
 			struct prefix_list_entry *new)
 {
   struct prefix_list_entry *pentry;
+  struct route_node *rn;
   int seq = 0;
+  int indexed;
 
   if (new->seq == -1)
     seq = prefix_new_seq_get (plist);
   else
     seq = new->seq;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  indexed = (prefix_list_trie_index (&new->prefix) >= 0);
+  if (indexed)
+    {
+      rn = prefix_list_trie_lookup (plist, &new->prefix);
+      pentry = rn ? rn->info : NULL;
+    }
+  else
+    pentry = plist->head;
+
+  for (; pentry; pentry = indexed ? pentry->trie_next : pentry->next)
     {
       if (prefix_same (&pentry->prefix, &new->prefix)
 	  && pentry->type == new->type
@@ -955,6 +1194,8 @@ vty_show_prefix_entry (struct vty *vty, afi_t afi, struct prefix_list *plist,
 
   if (dtype != summary_display)
     {
+      prefix_list_refcnt_sync (plist);
+
       for (pentry = plist->head; pentry; pentry = pentry->next)
 	{
 	  if (dtype == sequential_display && pentry->seq != seqnum)
@@ -1061,6 +1302,8 @@ vty_show_prefix_list_prefix (struct vty *vty, afi_t afi, const char *name,
       return CMD_WARNING;
     }
 
+  prefix_list_refcnt_sync (plist);
+
   for (pentry = plist->head; pentry; pentry = pentry->next)
     {
       match = 0;
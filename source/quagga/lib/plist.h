@@ -25,6 +25,8 @@
 
 #define AFI_ORF_PREFIX 65535
 
+struct route_table;
+
 enum prefix_list_type 
 {
   PREFIX_DENY,
@@ -52,6 +54,12 @@ struct prefix_list
   struct prefix_list_entry *head;
   struct prefix_list_entry *tail;
 
+  /* Per-family trie index of the entries, keyed by entry prefix. */
+  struct route_table *trie[2];
+
+  /* Lookups since refcnt was last folded into the entries. */
+  unsigned long applied;
+
   struct prefix_list *next;
   struct prefix_list *prev;
 };
@@ -30,6 +30,39 @@
 void route_node_delete (struct route_node *);
 void route_table_free (struct route_table *);
 
+/* Nodes are allocated from blocks owned by their table, which hand
+   out IPv4 nodes trimmed after the struct prefix_ipv4 part of p and
+   all other nodes at full size.  Blocks start small, as most tables
+   hold a handful of routes, and double up to ROUTE_BLOCK_NODES_MAX
+   nodes.  Freed nodes go back on their class's free list, chained
+   through the parent pointer, and the blocks are given back when the
+   table empties or is finished. */
+struct route_node_block
+{
+  struct route_node_block *next;
+  size_t size;
+};
+
+#define ROUTE_NODE_IPV4		0
+#define ROUTE_NODE_FULL		1
+
+#define ROUTE_NODE_SIZE_IPV4 \
+  (offsetof (struct route_node, p) + sizeof (struct prefix_ipv4))
+#define ROUTE_NODE_SIZE_FULL	sizeof (struct route_node)
+
+#define ROUTE_BLOCK_NODES_MIN	4
+#define ROUTE_BLOCK_NODES_MAX	256
+
+/* A block's nodes come after its header, rounded up to the size of a
+   struct prefix_ipv4, which is as aligned as a node has to be.  The
+   tail is padded so that a struct prefix read whole from the last
+   IPv4 node stays inside the block. */
+#define ROUTE_BLOCK_HEAD \
+  ((sizeof (struct route_node_block) + sizeof (struct prefix_ipv4) - 1) \
+   / sizeof (struct prefix_ipv4) * sizeof (struct prefix_ipv4))
+#define ROUTE_BLOCK_PAD \
+  (sizeof (struct prefix) - sizeof (struct prefix_ipv4))
+
 struct route_table *
 route_table_init (void)
 {
@@ -45,12 +78,77 @@ route_table_finish (struct route_table *rt)
   route_table_free (rt);
 }
 
-/* Allocate new route node. */
+static size_t
+route_node_size (int class)
+{
+  return class == ROUTE_NODE_IPV4 ? ROUTE_NODE_SIZE_IPV4
+				  : ROUTE_NODE_SIZE_FULL;
+}
+
+/* Carve a new block into nodes of the given class. */
+static void
+route_block_new (struct route_table *table, int class)
+{
+  struct route_node_block *block;
+  struct route_node *node;
+  size_t size = route_node_size (class);
+  unsigned int i;
+  u_char *p;
+
+  if (table->block_nodes < ROUTE_BLOCK_NODES_MIN)
+    table->block_nodes = ROUTE_BLOCK_NODES_MIN;
+
+  block = XMALLOC (MTYPE_ROUTE_NODE, ROUTE_BLOCK_HEAD
+		   + table->block_nodes * size + ROUTE_BLOCK_PAD);
+  block->next = table->blocks;
+  block->size = table->block_nodes * size;
+  table->blocks = block;
+
+  /* Chain them so that they are handed out in address order. */
+  p = (u_char *) block + ROUTE_BLOCK_HEAD + block->size;
+  for (i = 0; i < table->block_nodes; i++)
+    {
+      p -= size;
+      node = (struct route_node *) p;
+      node->parent = table->free[class];
+      table->free[class] = node;
+    }
+
+  if (table->block_nodes < ROUTE_BLOCK_NODES_MAX)
+    table->block_nodes *= 2;
+}
+
+static void
+route_block_free_all (struct route_table *table)
+{
+  struct route_node_block *block;
+
+  while ((block = table->blocks) != NULL)
+    {
+      table->blocks = block->next;
+      XFREE (MTYPE_ROUTE_NODE, block);
+    }
+  table->free[ROUTE_NODE_IPV4] = table->free[ROUTE_NODE_FULL] = NULL;
+  table->block_nodes = 0;
+}
+
+/* Allocate new route node for a prefix of the given family. */
 static struct route_node *
-route_node_new (void)
+route_node_new (struct route_table *table, u_char family)
 {
   struct route_node *node;
-  node = XCALLOC (MTYPE_ROUTE_NODE, sizeof (struct route_node));
+  int class = (family == AF_INET ? ROUTE_NODE_IPV4 : ROUTE_NODE_FULL);
+
+  if (table->free[class] == NULL)
+    route_block_new (table, class);
+
+  node = table->free[class];
+  table->free[class] = node->parent;
+  memset (node, 0, route_node_size (class));
+
+  node->p.family = family;
+  node->table = table;
+  table->count++;
   return node;
 }
 
@@ -60,10 +158,9 @@ route_node_set (struct route_table *table, struct prefix *prefix)
 {
   struct route_node *node;
   
-  node = route_node_new ();
+  node = route_node_new (table, prefix->family);
 
   prefix_copy (&node->p, prefix);
-  node->table = table;
 
   return node;
 }
@@ -72,54 +169,25 @@ route_node_set (struct route_table *table, struct prefix *prefix)
 static void
 route_node_free (struct route_node *node)
 {
-  XFREE (MTYPE_ROUTE_NODE, node);
+  struct route_table *table = node->table;
+  int class = (node->p.family == AF_INET ? ROUTE_NODE_IPV4
+					 : ROUTE_NODE_FULL);
+
+  node->parent = table->free[class];
+  table->free[class] = node;
+
+  if (--table->count == 0)
+    route_block_free_all (table);
 }
 
 /* Free route table. */
 void
 route_table_free (struct route_table *rt)
 {
-  struct route_node *tmp_node;
-  struct route_node *node;
- 
   if (rt == NULL)
     return;
 
-  node = rt->top;
-
-  while (node)
-    {
-      if (node->l_left)
-	{
-	  node = node->l_left;
-	  continue;
-	}
-
-      if (node->l_right)
-	{
-	  node = node->l_right;
-	  continue;
-	}
-
-      tmp_node = node;
-      node = node->parent;
-
-      if (node != NULL)
-	{
-	  if (node->l_left == tmp_node)
-	    node->l_left = NULL;
-	  else
-	    node->l_right = NULL;
-
-	  route_node_free (tmp_node);
-	}
-      else
-	{
-	  route_node_free (tmp_node);
-	  break;
-	}
-    }
- 
+  route_block_free_all (rt);
   XFREE (MTYPE_ROUTE_TABLE, rt);
   return;
 }
@@ -165,6 +233,50 @@ route_common (struct prefix *n, struct prefix *p, struct prefix *new)
     }
 }
 
+/* IPv4 keys are walked as host order words: a node matches when the
+   bits its prefix length covers are equal, and the branch taken below
+   it is the key's next bit.  Lengths are those of nodes above the key,
+   so shorter than 32 when shifted by. */
+#define ROUTE_ADDR4(P)	ntohl ((P)->u.prefix4.s_addr)
+
+static inline int
+route_match4 (const struct route_node *node, u_int32_t addr)
+{
+  if (node->p.prefixlen == 0)
+    return 1;
+  return ((ROUTE_ADDR4 (&node->p) ^ addr)
+	  >> (IPV4_MAX_BITLEN - node->p.prefixlen)) == 0;
+}
+
+#define ROUTE_BIT4(A,LEN) \
+  (((A) >> (IPV4_MAX_BITLEN - 1 - (LEN))) & 1)
+
+/* route_common() for IPv4 keys. */
+static void
+route_common4 (struct prefix *n, struct prefix *p, struct prefix *new)
+{
+  u_int32_t diff = ROUTE_ADDR4 (n) ^ ROUTE_ADDR4 (p);
+  u_char len = 0;
+
+  if (diff == 0)
+    len = IPV4_MAX_BITLEN;
+  else
+    {
+      if (!(diff & 0xffff0000)) { len += 16; diff <<= 16; }
+      if (!(diff & 0xff000000)) { len += 8; diff <<= 8; }
+      if (!(diff & 0xf0000000)) { len += 4; diff <<= 4; }
+      if (!(diff & 0xc0000000)) { len += 2; diff <<= 2; }
+      if (!(diff & 0x80000000)) { len += 1; }
+    }
+  if (len > p->prefixlen)
+    len = p->prefixlen;
+
+  new->prefixlen = len;
+  new->u.prefix4.s_addr = len ? htonl (ROUTE_ADDR4 (n)
+				       & (0xffffffff << (IPV4_MAX_BITLEN - len)))
+			      : 0;
+}
+
 static void
 set_link (struct route_node *node, struct route_node *new)
 {
@@ -202,6 +314,24 @@ route_node_match (const struct route_table *table, const struct prefix *p)
   matched = NULL;
   node = table->top;
 
+  if (p->family == AF_INET)
+    {
+      u_int32_t addr = ROUTE_ADDR4 (p);
+
+      while (node && node->p.prefixlen <= p->prefixlen
+	     && route_match4 (node, addr))
+	{
+	  if (node->info)
+	    matched = node;
+
+	  if (node->p.prefixlen == p->prefixlen)
+	    break;
+
+	  node = node->link[ROUTE_BIT4 (addr, node->p.prefixlen)];
+	}
+      return matched ? route_lock_node (matched) : NULL;
+    }
+
   /* Walk down tree.  If there is matched route then store it to
      matched. */
   while (node && node->p.prefixlen <= p->prefixlen && 
@@ -261,6 +391,21 @@ route_node_lookup (struct route_table *table, struct prefix *p)
 
   node = table->top;
 
+  if (p->family == AF_INET)
+    {
+      u_int32_t addr = ROUTE_ADDR4 (p);
+
+      while (node && node->p.prefixlen <= p->prefixlen
+	     && route_match4 (node, addr))
+	{
+	  if (node->p.prefixlen == p->prefixlen)
+	    return node->info ? route_lock_node (node) : NULL;
+
+	  node = node->link[ROUTE_BIT4 (addr, node->p.prefixlen)];
+	}
+      return NULL;
+    }
+
   while (node && node->p.prefixlen <= p->prefixlen && 
 	 prefix_match (&node->p, p))
     {
@@ -283,15 +428,30 @@ route_node_get (struct route_table *table, struct prefix *p)
 
   match = NULL;
   node = table->top;
-  while (node && node->p.prefixlen <= p->prefixlen && 
-	 prefix_match (&node->p, p))
+  if (p->family == AF_INET)
     {
-      if (node->p.prefixlen == p->prefixlen)
-        return route_lock_node (node);
-      
-      match = node;
-      node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
+      u_int32_t addr = ROUTE_ADDR4 (p);
+
+      while (node && node->p.prefixlen <= p->prefixlen
+	     && route_match4 (node, addr))
+	{
+	  if (node->p.prefixlen == p->prefixlen)
+	    return route_lock_node (node);
+
+	  match = node;
+	  node = node->link[ROUTE_BIT4 (addr, node->p.prefixlen)];
+	}
     }
+  else
+    while (node && node->p.prefixlen <= p->prefixlen && 
+	   prefix_match (&node->p, p))
+      {
+	if (node->p.prefixlen == p->prefixlen)
+	  return route_lock_node (node);
+
+	match = node;
+	node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
+      }
 
   if (node == NULL)
     {
@@ -303,10 +463,11 @@ route_node_get (struct route_table *table, struct prefix *p)
     }
   else
     {
-      new = route_node_new ();
-      route_common (&node->p, p, &new->p);
-      new->p.family = p->family;
-      new->table = table;
+      new = route_node_new (table, p->family);
+      if (p->family == AF_INET)
+	route_common4 (&node->p, p, &new->p);
+      else
+	route_common (&node->p, p, &new->p);
       set_link (new, node);
 
       if (match)
@@ -27,29 +27,43 @@
 struct route_table
 {
   struct route_node *top;
+
+  /* Nodes are carved out of blocks the table owns, one free list for
+     IPv4 nodes and one for the rest.  See route_node_new(). */
+  struct route_node_block *blocks;
+  struct route_node *free[2];
+  unsigned int block_nodes;
+
+  /* Number of nodes in the tree. */
+  unsigned long count;
 };
 
 /* Each routing entry. */
 struct route_node
 {
-  /* Actual prefix of this radix. */
-  struct prefix p;
-
   /* Tree link. */
   struct route_table *table;
   struct route_node *parent;
-  struct route_node *link[2];
-#define l_left   link[0]
-#define l_right  link[1]
 
   /* Lock of this radix */
   unsigned int lock;
 
+  /* Aggregation. */
+  void *aggregate;
+
   /* Each node of route. */
   void *info;
 
-  /* Aggregation. */
-  void *aggregate;
+  /* Child links and prefix last and together, as a walk down the tree
+     reads only those (and info, just ahead). */
+  struct route_node *link[2];
+#define l_left   link[0]
+#define l_right  link[1]
+
+  /* Actual prefix of this radix.  Kept last: an AF_INET node is
+     allocated with only the struct prefix_ipv4 part of it, so the
+     bytes after p.u.prefix4 must never be looked at for those. */
+  struct prefix p;
 };
 
 /* Prototypes. */
@@ -40,6 +40,20 @@ static struct timeval relative_time_base;
 static unsigned short timers_inited;
 
 static struct hash *cpu_record = NULL;
+
+/* Timer operation counts, for show thread timers.  */
+static struct timer_stats
+{
+  unsigned long added;
+  unsigned long cancelled;
+  unsigned long expired;
+  unsigned long cascaded;
+  unsigned long pending;
+  unsigned long max_pending;
+} timer_stats[2];
+
+#define TIMER_STATS(type) \
+  (&timer_stats[(type) == THREAD_TIMER ? 0 : 1])
 
 /* Struct timeval's tv_usec one second value.  */
 #define TIMER_SECOND_MICRO 1000000L
@@ -466,6 +480,33 @@ DEFUN(clear_thread_cpu,
   return CMD_SUCCESS;
 }
 
+DEFUN(show_thread_timers,
+      show_thread_timers_cmd,
+      "show thread timers",
+      SHOW_STR
+      "Thread information\n"
+      "Timer operations\n")
+{
+  struct timer_stats *t = TIMER_STATS (THREAD_TIMER);
+  struct timer_stats *b = TIMER_STATS (THREAD_BACKGROUND);
+
+  vty_out (vty, "%-12s %12s %12s%s", "", "Timer", "Background",
+	   VTY_NEWLINE);
+  vty_out (vty, "%-12s %12lu %12lu%s", "Added",
+	   t->added, b->added, VTY_NEWLINE);
+  vty_out (vty, "%-12s %12lu %12lu%s", "Cancelled",
+	   t->cancelled, b->cancelled, VTY_NEWLINE);
+  vty_out (vty, "%-12s %12lu %12lu%s", "Expired",
+	   t->expired, b->expired, VTY_NEWLINE);
+  vty_out (vty, "%-12s %12lu %12lu%s", "Cascaded",
+	   t->cascaded, b->cascaded, VTY_NEWLINE);
+  vty_out (vty, "%-12s %12lu %12lu%s", "Pending",
+	   t->pending, b->pending, VTY_NEWLINE);
+  vty_out (vty, "%-12s %12lu %12lu%s", "Max pending",
+	   t->max_pending, b->max_pending, VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
 /* List allocation and head/tail print out. */
 static void
 thread_list_debug (struct thread_list *list)
@@ -483,14 +524,12 @@ thread_master_debug (struct thread_master *m)
   thread_list_debug (&m->read);
   printf ("writelist : ");
   thread_list_debug (&m->write);
-  printf ("timerlist : ");
-  thread_list_debug (&m->timer);
+  printf ("timerlist : count [%d]\n", m->timer.count);
   printf ("eventlist : ");
   thread_list_debug (&m->event);
   printf ("unuselist : ");
   thread_list_debug (&m->unuse);
-  printf ("bgndlist : ");
-  thread_list_debug (&m->background);
+  printf ("bgndlist : count [%d]\n", m->background.count);
   printf ("total alloc: [%ld]\n", m->alloc);
   printf ("-----------\n");
 }
@@ -522,22 +561,6 @@ thread_list_add (struct thread_list *list, struct thread *thread)
   list->count++;
 }
 
-/* Add a new thread just before the point.  */
-static void
-thread_list_add_before (struct thread_list *list, 
-			struct thread *point, 
-			struct thread *thread)
-{
-  thread->next = point;
-  thread->prev = point->prev;
-  if (point->prev)
-    point->prev->next = thread;
-  else
-    list->head = thread;
-  point->prev = thread;
-  list->count++;
-}
-
 /* Delete a thread from the list. */
 static struct thread *
 thread_list_delete (struct thread_list *list, struct thread *thread)
@@ -555,6 +578,134 @@ thread_list_delete (struct thread_list *list, struct thread *thread)
   return thread;
 }
 
+/* Millisecond tick at which a timer expiring at TV is due: rounded up,
+   so that it never fires early. */
+static uint64_t
+timeval_tick (struct timeval tv)
+{
+  return (uint64_t) tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+}
+
+/* First slot at or after FROM in use on level MAP, -1 if none. */
+static int
+timer_wheel_next_slot (uint32_t *map, int from)
+{
+  int i = from / 32;
+  uint32_t bits = map[i] & (0xffffffffU << (from % 32));
+
+  while (1)
+    {
+      if (bits)
+	return i * 32 + __builtin_ctz (bits);
+      if (++i == TIMER_WHEEL_SLOTS / 32)
+	return -1;
+      bits = map[i];
+    }
+}
+
+static void
+timer_wheel_add (struct timer_wheel *w, struct thread *thread)
+{
+  struct thread_list *list;
+  uint64_t tick = timeval_tick (thread->u.sands);
+  uint64_t delta;
+  int level, idx;
+
+  /* Due already, e.g. a background thread with no delay: it runs on
+     the next fetch, not when the wheel comes to the next tick. */
+  if (tick < w->tick || timeval_cmp (thread->u.sands, relative_time) <= 0)
+    list = &w->expired;
+  else
+    {
+      delta = tick - w->tick;
+      for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+	if (delta >> (TIMER_WHEEL_BITS * (level + 1)) == 0)
+	  break;
+
+      /* Beyond the wheel: park it in the farthest slot, it is put
+         back when that comes round. */
+      if (delta >> (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+	tick = w->tick + ((uint64_t) 1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+      idx = (tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+      list = &w->slot[level][idx];
+      w->map[level][idx / 32] |= 1U << (idx % 32);
+    }
+
+  thread->slot = list;
+  thread_list_add (list, thread);
+  w->count++;
+}
+
+static void
+timer_wheel_delete (struct timer_wheel *w, struct thread *thread)
+{
+  struct thread_list *list = thread->slot;
+
+  thread_list_delete (list, thread);
+  thread->slot = NULL;
+  w->count--;
+
+  if (list != &w->expired && list->head == NULL)
+    {
+      int off = list - &w->slot[0][0];
+      int level = off / TIMER_WHEEL_SLOTS;
+      int idx = off % TIMER_WHEEL_SLOTS;
+
+      w->map[level][idx / 32] &= ~(1U << (idx % 32));
+    }
+}
+
+/* Move the timers of a slot of level LEVEL to where they belong now. */
+static void
+timer_wheel_cascade (struct timer_wheel *w, int level, int idx)
+{
+  struct thread_list *list = &w->slot[level][idx];
+  struct thread *thread;
+
+  while ((thread = list->head) != NULL)
+    {
+      timer_wheel_delete (w, thread);
+      timer_wheel_add (w, thread);
+      TIMER_STATS (thread->type)->cascaded++;
+    }
+}
+
+/* Next tick anything on the wheel needs attention at.  For a higher
+   level slot that is when it comes round and its timers move down. */
+static uint64_t
+timer_wheel_next_tick (struct timer_wheel *w)
+{
+  uint64_t next = UINT64_MAX, t;
+  int level, cur, idx;
+
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+      int shift = TIMER_WHEEL_BITS * level;
+      uint64_t base = w->tick >> shift;
+
+      /* The current slot of a higher level has moved down already,
+         unless the tick is where that happens and is yet to be run. */
+      cur = base & TIMER_WHEEL_MASK;
+      if (level == 0 || (w->tick & (((uint64_t) 1 << shift) - 1)) == 0)
+	idx = timer_wheel_next_slot (w->map[level], cur);
+      else
+	idx = cur == TIMER_WHEEL_MASK ? -1
+	  : timer_wheel_next_slot (w->map[level], cur + 1);
+      if (idx < 0)
+	{
+	  idx = timer_wheel_next_slot (w->map[level], 0);
+	  if (idx < 0)
+	    continue;
+	  idx += TIMER_WHEEL_SLOTS;
+	}
+      t = (base - cur + idx) << shift;
+      if (t < next)
+	next = t;
+    }
+  return next;
+}
+
 /* Move thread to unuse list. */
 static void
 thread_add_unuse (struct thread_master *m, struct thread *thread)
@@ -585,17 +736,30 @@ thread_list_free (struct thread_master *m, struct thread_list *list)
     }
 }
 
+static void
+timer_wheel_free (struct thread_master *m, struct timer_wheel *w,
+		  struct timer_stats *stats)
+{
+  int level, idx;
+
+  stats->pending -= w->count;
+  thread_list_free (m, &w->expired);
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    for (idx = 0; idx < TIMER_WHEEL_SLOTS; idx++)
+      thread_list_free (m, &w->slot[level][idx]);
+}
+
 /* Stop thread scheduler. */
 void
 thread_master_free (struct thread_master *m)
 {
   thread_list_free (m, &m->read);
   thread_list_free (m, &m->write);
-  thread_list_free (m, &m->timer);
+  timer_wheel_free (m, &m->timer, TIMER_STATS (THREAD_TIMER));
   thread_list_free (m, &m->event);
   thread_list_free (m, &m->ready);
   thread_list_free (m, &m->unuse);
-  thread_list_free (m, &m->background);
+  timer_wheel_free (m, &m->background, TIMER_STATS (THREAD_BACKGROUND));
   
   XFREE (MTYPE_THREAD_MASTER, m);
 
@@ -746,16 +910,16 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
                                   const char* funcname)
 {
   struct thread *thread;
-  struct thread_list *list;
+  struct timer_wheel *wheel;
+  struct timer_stats *stats;
   struct timeval alarm_time;
-  struct thread *tt;
 
   assert (m != NULL);
 
   assert (type == THREAD_TIMER || type == THREAD_BACKGROUND);
   assert (time_relative);
   
-  list = ((type == THREAD_TIMER) ? &m->timer : &m->background);
+  wheel = ((type == THREAD_TIMER) ? &m->timer : &m->background);
   thread = thread_get (m, type, func, arg, funcname);
 
   /* Do we need jitter here? */
@@ -764,15 +928,16 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   alarm_time.tv_usec = relative_time.tv_usec + time_relative->tv_usec;
   thread->u.sands = timeval_adjust(alarm_time);
 
-  /* Sort by timeval. */
-  for (tt = list->head; tt; tt = tt->next)
-    if (timeval_cmp (thread->u.sands, tt->u.sands) <= 0)
-      break;
+  /* An empty wheel can start turning from now. */
+  if (wheel->count == 0)
+    wheel->tick = (uint64_t) relative_time.tv_sec * 1000
+                  + relative_time.tv_usec / 1000;
+  timer_wheel_add (wheel, thread);
 
-  if (tt)
-    thread_list_add_before (list, tt, thread);
-  else
-    thread_list_add (list, thread);
+  stats = TIMER_STATS (type);
+  stats->added++;
+  if (++stats->pending > stats->max_pending)
+    stats->max_pending = stats->pending;
 
   return thread;
 }
@@ -873,7 +1038,8 @@ thread_cancel (struct thread *thread)
       list = &thread->master->write;
       break;
     case THREAD_TIMER:
-      list = &thread->master->timer;
+      timer_wheel_delete (&thread->master->timer, thread);
+      list = NULL;
       break;
     case THREAD_EVENT:
       list = &thread->master->event;
@@ -882,13 +1048,20 @@ thread_cancel (struct thread *thread)
       list = &thread->master->ready;
       break;
     case THREAD_BACKGROUND:
-      list = &thread->master->background;
+      timer_wheel_delete (&thread->master->background, thread);
+      list = NULL;
       break;
     default:
       return;
       break;
     }
-  thread_list_delete (list, thread);
+  if (list)
+    thread_list_delete (list, thread);
+  else
+    {
+      TIMER_STATS (thread->type)->cancelled++;
+      TIMER_STATS (thread->type)->pending--;
+    }
   thread->type = THREAD_UNUSED;
   thread_add_unuse (thread->master, thread);
 }
@@ -920,14 +1093,24 @@ thread_cancel_event (struct thread_master *m, void *arg)
 }
 
 static struct timeval *
-thread_timer_wait (struct thread_list *tlist, struct timeval *timer_val)
+thread_timer_wait (struct timer_wheel *w, struct timeval *timer_val)
 {
-  if (!thread_empty (tlist))
+  uint64_t next;
+
+  if (w->count == 0)
+    return NULL;
+
+  if (!thread_empty (&w->expired))
     {
-      *timer_val = timeval_subtract (tlist->head->u.sands, relative_time);
+      timer_val->tv_sec = timer_val->tv_usec = 0;
       return timer_val;
     }
-  return NULL;
+
+  next = timer_wheel_next_tick (w);
+  timer_val->tv_sec = next / 1000;
+  timer_val->tv_usec = (next % 1000) * 1000;
+  *timer_val = timeval_subtract (*timer_val, relative_time);
+  return timer_val;
 }
 
 static struct thread *
@@ -967,22 +1150,76 @@ thread_process_fd (struct thread_list *list, fd_set *fdset, fd_set *mfdset)
   return ready;
 }
 
+static void
+thread_timer_ready (struct timer_wheel *w, struct thread *thread)
+{
+  struct timer_stats *stats = TIMER_STATS (thread->type);
+
+  timer_wheel_delete (w, thread);
+  stats->expired++;
+  stats->pending--;
+  thread->type = THREAD_READY;
+  thread_list_add (&thread->master->ready, thread);
+}
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int
-thread_timer_process (struct thread_list *list, struct timeval *timenow)
+thread_timer_process (struct timer_wheel *w, struct timeval *timenow)
 {
   struct thread *thread;
   unsigned int ready = 0;
-  
-  for (thread = list->head; thread; thread = thread->next)
+  uint64_t limit, t;
+  int idx, next, level;
+
+  while ((thread = w->expired.head) != NULL)
     {
-      if (timeval_cmp (*timenow, thread->u.sands) < 0)
-        return ready;
-      thread_list_delete (list, thread);
-      thread->type = THREAD_READY;
-      thread_list_add (&thread->master->ready, thread);
+      thread_timer_ready (w, thread);
       ready++;
     }
+
+  /* Ticks are whole milliseconds: those up to now are due. */
+  limit = (uint64_t) timenow->tv_sec * 1000 + timenow->tv_usec / 1000;
+
+  while (w->tick <= limit)
+    {
+      if (w->count == 0)
+	{
+	  w->tick = limit + 1;
+	  break;
+	}
+
+      idx = w->tick & TIMER_WHEEL_MASK;
+
+      /* Level 0 starts a new turn: the slots of the higher levels
+         which come round with it move down, highest first. */
+      if (idx == 0)
+	{
+	  for (level = 1; level < TIMER_WHEEL_LEVELS - 1; level++)
+	    if ((w->tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK)
+	      break;
+	  for (; level > 0; level--)
+	    timer_wheel_cascade (w, level,
+				 (w->tick >> (TIMER_WHEEL_BITS * level))
+				 & TIMER_WHEEL_MASK);
+	}
+
+      /* Skip ahead to the next slot in use in this turn. */
+      next = timer_wheel_next_slot (w->map[0], idx);
+      if (next != idx)
+	{
+	  t = (next < 0 ? (w->tick | TIMER_WHEEL_MASK) + 1
+	       : w->tick - idx + next);
+	  w->tick = (t < limit + 1 ? t : limit + 1);
+	  continue;
+	}
+
+      while ((thread = w->slot[0][idx].head) != NULL)
+	{
+	  thread_timer_ready (w, thread);
+	  ready++;
+	}
+      w->tick++;
+    }
   return ready;
 }
 
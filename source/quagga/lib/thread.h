@@ -41,16 +41,37 @@ struct thread_list
   int count;
 };
 
+/* Hierarchical timing wheel.  Level 0 has a slot per millisecond,
+   each further level a slot per turn of the level below.  A timer is
+   kept in the slot of the level its expiry falls into and moves down
+   as that slot comes round, so adding and cancelling are O(1).  */
+#define TIMER_WHEEL_BITS   8
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK   (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4
+
+struct timer_wheel
+{
+  /* Next tick (millisecond of relative time) to process. */
+  uint64_t tick;
+  int count;
+  /* Timers already due when they were added. */
+  struct thread_list expired;
+  struct thread_list slot[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  /* Which slots are in use. */
+  uint32_t map[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS / 32];
+};
+
 /* Master of the theads. */
 struct thread_master
 {
   struct thread_list read;
   struct thread_list write;
-  struct thread_list timer;
+  struct timer_wheel timer;
   struct thread_list event;
   struct thread_list ready;
   struct thread_list unuse;
-  struct thread_list background;
+  struct timer_wheel background;
   fd_set readfd;
   fd_set writefd;
   fd_set exceptfd;
@@ -67,6 +88,7 @@ struct thread
   struct thread *next;		/* next pointer of the thread */   
   struct thread *prev;		/* previous pointer of the thread */
   struct thread_master *master;	/* pointer to the struct thread_master. */
+  struct thread_list *slot;	/* timer wheel slot of a timer */
   int (*func) (struct thread *); /* event function */
   void *arg;			/* event argument */
   union {
@@ -198,6 +220,7 @@ extern int thread_should_yield (struct thread *);
 extern void thread_getrusage (RUSAGE_T *);
 extern struct cmd_element show_thread_cpu_cmd;
 extern struct cmd_element clear_thread_cpu_cmd;
+extern struct cmd_element show_thread_timers_cmd;
 
 /* replacements for the system gettimeofday(), clock_gettime() and
  * time() functions, providing support for non-decrementing clock on
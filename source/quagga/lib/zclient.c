@@ -38,11 +38,15 @@ enum event {ZCLIENT_SCHEDULE, ZCLIENT_READ, ZCLIENT_CONNECT};
 
 /* Prototype for event manager. */
 static void zclient_event (enum event, struct zclient *);
+static void zclient_batch_probe (struct zclient *);
 
 extern struct thread_master *master;
 
 /* This file local debug flag. */
 int zclient_debug = 0;
+
+/* Unix socket path to zebra, when not the default one. */
+static char *zclient_serv_path = NULL;
 
 /* Allocate zclient structure. */
 struct zclient *
@@ -54,6 +58,8 @@ zclient_new ()
   zclient->ibuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
   zclient->obuf = stream_new (ZEBRA_MAX_PACKET_SIZ);
   zclient->wb = buffer_new(0);
+  zclient->batch = stream_new (ZEBRA_MAX_PACKET_SIZ);
+  zclient->batch_held = stream_fifo_new ();
 
   return zclient;
 }
@@ -72,6 +78,10 @@ zclient_free (struct zclient *zclient)
     stream_free(zclient->obuf);
   if (zclient->wb)
     buffer_free(zclient->wb);
+  if (zclient->batch)
+    stream_free (zclient->batch);
+  if (zclient->batch_held)
+    stream_fifo_free (zclient->batch_held);
 
   XFREE (MTYPE_ZCLIENT, zclient);
 }
@@ -119,6 +129,8 @@ zclient_stop (struct zclient *zclient)
   THREAD_OFF(zclient->t_read);
   THREAD_OFF(zclient->t_connect);
   THREAD_OFF(zclient->t_write);
+  THREAD_OFF(zclient->t_batch);
+  THREAD_OFF(zclient->t_batch_probe);
 
   /* Reset streams. */
   stream_reset(zclient->ibuf);
@@ -127,6 +139,12 @@ zclient_stop (struct zclient *zclient)
   /* Empty the write buffer. */
   buffer_reset(zclient->wb);
 
+  /* Drop batched routes, zebra forgets the window with the socket. */
+  stream_reset(zclient->batch);
+  stream_fifo_clean(zclient->batch_held);
+  zclient->batch_seq = zclient->batch_sent = zclient->batch_ack = 0;
+  zclient->batch_state = ZCLIENT_BATCH_UNKNOWN;
+
   /* Close socket. */
   if (zclient->sock >= 0)
     {
@@ -208,6 +226,15 @@ zclient_socket_un (const char *path)
   return sock;
 }
 
+void
+zclient_serv_path_set (const char *path)
+{
+  if (zclient_serv_path)
+    XFREE (MTYPE_TMP, zclient_serv_path);
+  if (path)
+    zclient_serv_path = XSTRDUP (MTYPE_TMP, path);
+}
+
 static int
 zclient_failed(struct zclient *zclient)
 {
@@ -242,13 +269,11 @@ zclient_flush_data(struct thread *thread)
   return 0;
 }
 
-int
-zclient_send_message(struct zclient *zclient)
+static int
+zclient_write_message (struct zclient *zclient, struct stream *s)
 {
-  if (zclient->sock < 0)
-    return -1;
-  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(zclient->obuf),
-		       stream_get_endp(zclient->obuf)))
+  switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+		       stream_get_endp(s)))
     {
     case BUFFER_ERROR:
       zlog_warn("%s: buffer_write failed to zclient fd %d, closing",
@@ -266,6 +291,109 @@ zclient_send_message(struct zclient *zclient)
   return 0;
 }
 
+static int
+zclient_batch_window_closed (struct zclient *zclient)
+{
+  return (zclient->batch_sent - zclient->batch_ack
+	  >= ZAPI_IPV4_BATCH_WINDOW);
+}
+
+static int
+zclient_is_batch (struct stream *s)
+{
+  return stream_getw_from (s, 4) == ZEBRA_IPV4_ROUTE_BATCH;
+}
+
+/* Send the messages held back, in order, while the window lets frames
+   through, or all of them if force is set. */
+static int
+zclient_batch_release (struct zclient *zclient, int force)
+{
+  struct stream *s;
+  int ret;
+
+  while ((s = stream_fifo_head (zclient->batch_held)) != NULL)
+    {
+      if (zclient_is_batch (s))
+	{
+	  if (! force && zclient_batch_window_closed (zclient))
+	    break;
+	  zclient->batch_sent = stream_getl_from (s, ZEBRA_HEADER_SIZE);
+	}
+
+      stream_fifo_pop (zclient->batch_held);
+      ret = zclient_write_message (zclient, s);
+      stream_free (s);
+      if (ret < 0)
+	return ret;
+    }
+  return 0;
+}
+
+/* Send a message unless the batch window holds it back, in which case
+   it waits behind the frames already held. */
+static int
+zclient_send_stream (struct zclient *zclient, struct stream *s)
+{
+  int ret;
+
+  if (zclient->sock < 0)
+    return -1;
+
+  if (stream_fifo_head (zclient->batch_held)
+      || (zclient_is_batch (s) && zclient_batch_window_closed (zclient)))
+    {
+      if (zclient->batch_held->count < ZAPI_IPV4_BATCH_HELD_MAX)
+	{
+	  if (zclient_is_batch (s))
+	    zclient->batch_stalls++;
+	  stream_fifo_push (zclient->batch_held, stream_dup (s));
+	  return 0;
+	}
+
+      /* Zebra is that far behind: rather than hold more, let the socket
+	 buffer take it all, as it does without batching. */
+      if (zclient->batch_overruns++ == 0)
+	zlog_warn ("%s: %d messages held back by the batch window, "
+		   "sending them on", __func__, ZAPI_IPV4_BATCH_HELD_MAX);
+      if ((ret = zclient_batch_release (zclient, 1)) < 0)
+	return ret;
+    }
+
+  if (zclient_is_batch (s))
+    zclient->batch_sent = stream_getl_from (s, ZEBRA_HEADER_SIZE);
+
+  return zclient_write_message (zclient, s);
+}
+
+int
+zclient_send_message(struct zclient *zclient)
+{
+  /* Routes batched so far go first. */
+  if (stream_get_endp (zclient->batch))
+    zclient_batch_flush (zclient);
+
+  return zclient_send_stream (zclient, zclient->obuf);
+}
+
+/* Zebra processed a batch frame, let held messages through. */
+static void
+zclient_batch_ack (struct zclient *zclient)
+{
+  zclient->batch_ack = stream_getl (zclient->ibuf);
+
+  /* The empty frame sent on connection: zebra takes batches. */
+  if (zclient->batch_state == ZCLIENT_BATCH_UNKNOWN)
+    {
+      THREAD_OFF (zclient->t_batch_probe);
+      zclient->batch_state = ZCLIENT_BATCH_ON;
+      if (zclient_debug)
+	zlog_debug ("zclient: zebra takes batched routes");
+    }
+
+  zclient_batch_release (zclient, 0);
+}
+
 void
 zclient_create_header (struct stream *s, uint16_t command)
 {
@@ -315,9 +443,13 @@ zclient_start (struct zclient *zclient)
 
   /* Make socket. */
 #ifdef HAVE_TCP_ZEBRA
-  zclient->sock = zclient_socket ();
+  if (zclient_serv_path)
+    zclient->sock = zclient_socket_un (zclient_serv_path);
+  else
+    zclient->sock = zclient_socket ();
 #else
-  zclient->sock = zclient_socket_un (ZEBRA_SERV_PATH);
+  zclient->sock = zclient_socket_un (zclient_serv_path ? zclient_serv_path
+					       : ZEBRA_SERV_PATH);
 #endif /* HAVE_TCP_ZEBRA */
   if (zclient->sock < 0)
     {
@@ -339,6 +471,10 @@ zclient_start (struct zclient *zclient)
   /* Create read thread. */
   zclient_event (ZCLIENT_READ, zclient);
 
+  /* Find out whether zebra takes batched routes. */
+  if (zclient->route_batch)
+    zclient_batch_probe (zclient);
+
   /* We need router-id information. */
   zebra_message_send (zclient, ZEBRA_ROUTER_ID_ADD);
 
@@ -373,6 +509,142 @@ zclient_connect (struct thread *t)
   return zclient_start (zclient);
 }
 
+/* Send the ZEBRA_IPV4_ROUTE_BATCH frame being filled, if any. */
+int
+zclient_batch_flush (struct zclient *zclient)
+{
+  struct stream *s = zclient->batch;
+  int ret;
+
+  THREAD_OFF (zclient->t_batch);
+
+  if (stream_get_endp (s) == 0)
+    return 0;
+
+  stream_putw_at (s, 0, stream_get_endp (s));
+  zclient->batch_frames++;
+
+  ret = zclient_send_stream (zclient, s);
+  stream_reset (s);
+
+  return ret;
+}
+
+static int
+zclient_batch_event (struct thread *thread)
+{
+  struct zclient *zclient = THREAD_ARG (thread);
+
+  zclient->t_batch = NULL;
+
+  return zclient_batch_flush (zclient);
+}
+
+/* Start a ZEBRA_IPV4_ROUTE_BATCH frame, with no entries yet. */
+static void
+zclient_batch_start (struct zclient *zclient)
+{
+  struct stream *s = zclient->batch;
+
+  zclient_create_header (s, ZEBRA_IPV4_ROUTE_BATCH);
+  stream_putl (s, ++zclient->batch_seq);
+  stream_putw (s, 0);
+}
+
+static int
+zclient_batch_probe_timeout (struct thread *thread)
+{
+  struct zclient *zclient = THREAD_ARG (thread);
+
+  zclient->t_batch_probe = NULL;
+
+  if (zclient->batch_state == ZCLIENT_BATCH_UNKNOWN)
+    {
+      zlog_warn ("zclient: zebra did not acknowledge a batch of routes "
+		 "in %d seconds, sending routes one by one",
+		 ZAPI_IPV4_BATCH_PROBE_TIMEOUT);
+      zclient->batch_state = ZCLIENT_BATCH_OFF;
+    }
+  return 0;
+}
+
+/* Send an empty frame: only a zebra which knows batches acknowledges
+   it.  Routes go one by one until it does. */
+static void
+zclient_batch_probe (struct zclient *zclient)
+{
+  zclient->batch_state = ZCLIENT_BATCH_UNKNOWN;
+  zclient_batch_start (zclient);
+  zclient_batch_flush (zclient);
+  THREAD_TIMER_ON (master, zclient->t_batch_probe,
+		   zclient_batch_probe_timeout, zclient,
+		   ZAPI_IPV4_BATCH_PROBE_TIMEOUT);
+}
+
+/* Add a route to the ZEBRA_IPV4_ROUTE_BATCH frame being filled.  A
+   full frame goes out right away, a partial one once the daemon is
+   done with the current thread, or before any other message. */
+static int
+zclient_batch_add (u_char cmd, struct zclient *zclient,
+		   struct prefix_ipv4 *p, struct zapi_ipv4 *api)
+{
+  struct stream *s = zclient->batch;
+  struct zapi_ipv4_batch_entry e;
+  u_int16_t count;
+
+  if (zclient->sock < 0)
+    return -1;
+
+  if (stream_get_endp (s) == 0)
+    {
+      zclient_batch_start (zclient);
+
+      if (! zclient->t_batch)
+	zclient->t_batch = thread_add_event (master, zclient_batch_event,
+					     zclient, 0);
+    }
+
+  memset (&e, 0, sizeof (e));
+  e.command = cmd;
+  e.type = api->type;
+  e.flags = api->flags;
+  e.message = api->message;
+  e.prefixlen = p->prefixlen;
+  e.prefix = p->prefix;
+
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_NEXTHOP))
+    {
+      if (CHECK_FLAG (api->flags, ZEBRA_FLAG_BLACKHOLE))
+	e.nexthop_type = ZEBRA_NEXTHOP_BLACKHOLE;
+      else if (api->nexthop_num)
+	{
+	  e.nexthop_type = ZEBRA_NEXTHOP_IPV4;
+	  e.nexthop = *api->nexthop[0];
+	}
+      else if (api->ifindex_num)
+	{
+	  e.nexthop_type = ZEBRA_NEXTHOP_IFINDEX;
+	  e.ifindex = htonl (api->ifindex[0]);
+	}
+    }
+
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_DISTANCE))
+    e.distance = api->distance;
+  if (CHECK_FLAG (api->message, ZAPI_MESSAGE_METRIC))
+    e.metric = htonl (api->metric);
+
+  stream_put (s, &e, sizeof (e));
+
+  count = stream_getw_from (s, ZEBRA_HEADER_SIZE + 4) + 1;
+  stream_putw_at (s, ZEBRA_HEADER_SIZE + 4, count);
+  zclient->batch_routes++;
+
+  if (count == ZAPI_IPV4_BATCH_MAX)
+    return zclient_batch_flush (zclient);
+
+  return 0;
+}
+
  /* 
   * "xdr_encode"-like interface that allows daemon (client) to send
   * a message to zebra server for a route that needs to be
@@ -425,6 +697,11 @@ zapi_ipv4_route (u_char cmd, struct zclient *zclient, struct prefix_ipv4 *p,
   int psize;
   struct stream *s;
 
+  if (zclient->route_batch && zclient->batch_state == ZCLIENT_BATCH_ON
+      && (cmd == ZEBRA_IPV4_ROUTE_ADD || cmd == ZEBRA_IPV4_ROUTE_DELETE)
+      && api->nexthop_num + api->ifindex_num <= 1)
+    return zclient_batch_add (cmd, zclient, p, api);
+
   /* Reset stream. */
   s = zclient->obuf;
   stream_reset (s);
@@ -933,6 +1210,9 @@ zclient_read (struct thread *thread)
       if (zclient->ipv6_route_delete)
 	ret = (*zclient->ipv6_route_delete) (command, zclient, length);
       break;
+    case ZEBRA_IPV4_ROUTE_BATCH_ACK:
+      zclient_batch_ack (zclient);
+      break;
     default:
       break;
     }
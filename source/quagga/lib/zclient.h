@@ -60,6 +60,31 @@ struct zclient
   /* Thread to write buffered data to zebra. */
   struct thread *t_write;
 
+  /* IPv4 routes are sent to zebra in ZEBRA_IPV4_ROUTE_BATCH frames
+     when the daemon sets this, see zapi_ipv4_route(), once zebra has
+     acknowledged the empty frame sent on connection. */
+  int route_batch;
+  int batch_state;		/* ZCLIENT_BATCH_* */
+  struct thread *t_batch_probe;
+
+  /* Frame being filled, and the event sending it when partial. */
+  struct stream *batch;
+  struct thread *t_batch;
+
+  /* Last frame numbered, sent and acknowledged.  Once
+     ZAPI_IPV4_BATCH_WINDOW frames are unacknowledged, further messages
+     are held back, in order, until zebra catches up. */
+  u_int32_t batch_seq;
+  u_int32_t batch_sent;
+  u_int32_t batch_ack;
+  struct stream_fifo *batch_held;
+
+  /* Batching statistics. */
+  unsigned long batch_routes;
+  unsigned long batch_frames;
+  unsigned long batch_stalls;
+  unsigned long batch_overruns;
+
   /* Redistribute information. */
   u_char redist_default;
   u_char redist[ZEBRA_ROUTE_MAX];
@@ -119,6 +144,55 @@ struct zapi_ipv4
   u_int32_t metric;
 };
 
+/* Batched IPv4 route message API.
+ *
+ * A ZEBRA_IPV4_ROUTE_BATCH message carries a 4 byte frame sequence
+ * number and a 2 byte entry count, then that many fixed-size entries,
+ * each the equivalent of a ZEBRA_IPV4_ROUTE_ADD or _DELETE for a route
+ * with at most one nexthop.  Every field is naturally aligned at the
+ * offset the entries start at, so zebra decodes them in place.  Zebra
+ * answers each frame with a ZEBRA_IPV4_ROUTE_BATCH_ACK carrying its
+ * sequence number once it has been processed.
+ */
+struct zapi_ipv4_batch_entry
+{
+  u_char command;		/* ZEBRA_IPV4_ROUTE_ADD or _DELETE. */
+  u_char type;
+  u_char flags;
+  u_char message;		/* ZAPI_MESSAGE_* */
+  u_char prefixlen;
+  u_char distance;
+  u_char nexthop_type;		/* ZEBRA_NEXTHOP_*, 0 for none. */
+  u_char pad;
+  struct in_addr prefix;
+  struct in_addr nexthop;	/* ZEBRA_NEXTHOP_IPV4 */
+  u_int32_t ifindex;		/* ZEBRA_NEXTHOP_IFINDEX, network order. */
+  u_int32_t metric;		/* Network order. */
+};
+
+#define ZAPI_IPV4_BATCH_HEADER_SIZE   6
+#define ZAPI_IPV4_BATCH_ENTRY_SIZE    sizeof (struct zapi_ipv4_batch_entry)
+#define ZAPI_IPV4_BATCH_MAX \
+  ((ZEBRA_MAX_PACKET_SIZ - ZEBRA_HEADER_SIZE - ZAPI_IPV4_BATCH_HEADER_SIZE) \
+   / ZAPI_IPV4_BATCH_ENTRY_SIZE)
+
+/* Frames a client may have sent without acknowledgment. */
+#define ZAPI_IPV4_BATCH_WINDOW        8
+
+/* Older zebras ignore batch frames.  A client sends an empty frame on
+ * connection and sends routes one by one until zebra acknowledges it,
+ * or for good if zebra does not within ZAPI_IPV4_BATCH_PROBE_TIMEOUT
+ * seconds.
+ */
+#define ZCLIENT_BATCH_UNKNOWN         0
+#define ZCLIENT_BATCH_ON              1
+#define ZCLIENT_BATCH_OFF             2
+#define ZAPI_IPV4_BATCH_PROBE_TIMEOUT 5
+
+/* Messages a closed window may hold back.  Past that, they are all
+   sent on without waiting for zebra. */
+#define ZAPI_IPV4_BATCH_HELD_MAX      1024
+
 /* Prototypes of zebra client service functions. */
 extern struct zclient *zclient_new (void);
 extern void zclient_init (struct zclient *, int);
@@ -133,6 +207,9 @@ extern int zclient_socket (void);
 /* Get unix stream socket connection to zebra daemon at given path. */
 extern int zclient_socket_un (const char *);
 
+/* Connect to zebra at this unix socket path instead of the default. */
+extern void zclient_serv_path_set (const char *);
+
 /* Send redistribute command to zebra daemon. Do not update zclient state. */
 extern int zebra_redistribute_send (int command, struct zclient *, int type);
 
@@ -156,6 +233,7 @@ extern void zebra_interface_if_set_value (struct stream *, struct interface *);
 extern void zebra_router_id_update_read (struct stream *s, struct prefix *rid);
 extern int zapi_ipv4_route (u_char, struct zclient *, struct prefix_ipv4 *, 
                             struct zapi_ipv4 *);
+extern int zclient_batch_flush (struct zclient *);
 
 #ifdef HAVE_IPV6
 /* IPv6 prefix add and delete function prototype. */
@@ -123,6 +123,7 @@ unsigned long conf_debug_ospf_nsm = 0;
 unsigned long conf_debug_ospf_lsa = 0;
 unsigned long conf_debug_ospf_zebra = 0;
 unsigned long conf_debug_ospf_nssa = 0;
+unsigned long conf_debug_ospf_spf = 0;
 
 /* Enable debug option variables -- valid only session. */
 unsigned long term_debug_ospf_packet[5] = {0, 0, 0, 0, 0};
@@ -132,6 +133,7 @@ unsigned long term_debug_ospf_nsm = 0;
 unsigned long term_debug_ospf_lsa = 0;
 unsigned long term_debug_ospf_zebra = 0;
 unsigned long term_debug_ospf_nssa = 0;
+unsigned long term_debug_ospf_spf = 0;
 
 
 
@@ -1410,6 +1412,33 @@ DEFUN (no_debug_ospf_nssa,
   return CMD_SUCCESS;
 }
 
+DEFUN (debug_ospf_spf,
+       debug_ospf_spf_cmd,
+       "debug ospf spf",
+       DEBUG_STR
+       OSPF_STR
+       "OSPF SPF calculation, checked against a full SPF\n")
+{
+  if (vty->node == CONFIG_NODE)
+    CONF_DEBUG_ON (spf, SPF);
+  TERM_DEBUG_ON (spf, SPF);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_debug_ospf_spf,
+       no_debug_ospf_spf_cmd,
+       "no debug ospf spf",
+       NO_STR
+       DEBUG_STR
+       OSPF_STR
+       "OSPF SPF calculation, checked against a full SPF\n")
+{
+  if (vty->node == CONFIG_NODE)
+    CONF_DEBUG_OFF (spf, SPF);
+  TERM_DEBUG_OFF (spf, SPF);
+  return CMD_SUCCESS;
+}
+
 
 DEFUN (show_debugging_ospf,
        show_debugging_ospf_cmd,
@@ -1505,6 +1534,10 @@ DEFUN (show_debugging_ospf,
   if (IS_DEBUG_OSPF (nssa, NSSA) == OSPF_DEBUG_NSSA)
     vty_out (vty, "  OSPF NSSA debugging is on%s", VTY_NEWLINE);
 
+  /* Show debug status for SPF. */
+  if (IS_DEBUG_OSPF (spf, SPF) == OSPF_DEBUG_SPF)
+    vty_out (vty, "  OSPF SPF debugging is on%s", VTY_NEWLINE);
+
   return CMD_SUCCESS;
 }
 
@@ -1595,6 +1628,13 @@ config_write_debug (struct vty *vty)
       vty_out (vty, "debug ospf nssa%s", VTY_NEWLINE);
       write = 1;
     }
+
+  /* debug ospf spf. */
+  if (IS_CONF_DEBUG_OSPF (spf, SPF) == OSPF_DEBUG_SPF)
+    {
+      vty_out (vty, "debug ospf spf%s", VTY_NEWLINE);
+      write = 1;
+    }
   
   /* debug ospf packet all detail. */
   r = OSPF_DEBUG_SEND_RECV|OSPF_DEBUG_DETAIL;
@@ -1657,6 +1697,7 @@ debug_init ()
   install_element (ENABLE_NODE, &debug_ospf_zebra_cmd);
   install_element (ENABLE_NODE, &debug_ospf_event_cmd);
   install_element (ENABLE_NODE, &debug_ospf_nssa_cmd);
+  install_element (ENABLE_NODE, &debug_ospf_spf_cmd);
   install_element (ENABLE_NODE, &no_debug_ospf_packet_send_recv_detail_cmd);
   install_element (ENABLE_NODE, &no_debug_ospf_packet_send_recv_cmd);
   install_element (ENABLE_NODE, &no_debug_ospf_packet_all_cmd);
@@ -1670,6 +1711,7 @@ debug_init ()
   install_element (ENABLE_NODE, &no_debug_ospf_zebra_cmd);
   install_element (ENABLE_NODE, &no_debug_ospf_event_cmd);
   install_element (ENABLE_NODE, &no_debug_ospf_nssa_cmd);
+  install_element (ENABLE_NODE, &no_debug_ospf_spf_cmd);
 
   install_element (CONFIG_NODE, &debug_ospf_packet_send_recv_detail_cmd);
   install_element (CONFIG_NODE, &debug_ospf_packet_send_recv_cmd);
@@ -1684,6 +1726,7 @@ debug_init ()
   install_element (CONFIG_NODE, &debug_ospf_zebra_cmd);
   install_element (CONFIG_NODE, &debug_ospf_event_cmd);
   install_element (CONFIG_NODE, &debug_ospf_nssa_cmd);
+  install_element (CONFIG_NODE, &debug_ospf_spf_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_packet_send_recv_detail_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_packet_send_recv_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_packet_all_cmd);
@@ -1697,4 +1740,5 @@ debug_init ()
   install_element (CONFIG_NODE, &no_debug_ospf_zebra_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_event_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_nssa_cmd);
+  install_element (CONFIG_NODE, &no_debug_ospf_spf_cmd);
 }
@@ -31,6 +31,8 @@
 #include "memory.h"
 #include "log.h"
 #include "zclient.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_interface.h"
@@ -836,41 +838,323 @@ ospf_ls_request_new (struct lsa_header *lsah)
 }
 
 
-/* Management functions for neighbor's ls-retransmit list. */
+/* Management functions for neighbor's ls-retransmit list.
+
+   The lists of all the neighbors on an interface are kept together in
+   one hash on the interface, so that flooding an LSA to N adjacencies
+   costs a single entry holding N bits rather than N LSDB nodes.  An
+   entry stands for one instance of an LSA; while neighbors still wait
+   for different instances of it, the other ones are chained behind. */
+struct ospf_ls_rxmt
+{
+  struct ospf_lsa *lsa;
+  struct ospf_ls_rxmt *next;	/* Other instances of the same LSA. */
+  unsigned int count;		/* Number of bits set. */
+  unsigned int words;
+  u_int32_t *bits;		/* Indexed by nbr->ls_rxmt_index. */
+};
+
+#define LS_RXMT_WORD(I)		((unsigned int) (I) / 32)
+#define LS_RXMT_BIT(I)		(1U << ((unsigned int) (I) % 32))
+
+static unsigned int
+ospf_ls_rxmt_hash_key (void *data)
+{
+  struct lsa_header *lsah = ((struct ospf_ls_rxmt *) data)->lsa->data;
+
+  return jhash_3words (lsah->type, lsah->id.s_addr,
+		       lsah->adv_router.s_addr, 0);
+}
+
+static int
+ospf_ls_rxmt_hash_cmp (const void *d1, const void *d2)
+{
+  const struct lsa_header *l1 = ((const struct ospf_ls_rxmt *) d1)->lsa->data;
+  const struct lsa_header *l2 = ((const struct ospf_ls_rxmt *) d2)->lsa->data;
+
+  return (l1->type == l2->type
+	  && l1->id.s_addr == l2->id.s_addr
+	  && l1->adv_router.s_addr == l2->adv_router.s_addr);
+}
+
+static void *
+ospf_ls_rxmt_new (void *arg)
+{
+  struct ospf_ls_rxmt *e;
+
+  e = XCALLOC (MTYPE_OSPF_LS_RXMT, sizeof (struct ospf_ls_rxmt));
+  e->lsa = ospf_lsa_lock (((struct ospf_ls_rxmt *) arg)->lsa);
+
+  return e;
+}
+
+static int
+ospf_ls_rxmt_isset (struct ospf_ls_rxmt *e, int index)
+{
+  return (index >= 0 && LS_RXMT_WORD (index) < e->words
+	  && (e->bits[LS_RXMT_WORD (index)] & LS_RXMT_BIT (index)));
+}
+
+static struct ospf_ls_rxmt *
+ospf_ls_rxmt_lookup (struct ospf_interface *oi, struct ospf_lsa *lsa)
+{
+  struct ospf_ls_rxmt tmp;
+
+  tmp.lsa = lsa;
+  return hash_lookup (oi->ls_rxmt, &tmp);
+}
+
+/* Find the instance of the LSA the neighbor is waiting for. */
+static struct ospf_ls_rxmt *
+ospf_ls_rxmt_find (struct ospf_neighbor *nbr, struct ospf_lsa *lsa,
+		   struct ospf_ls_rxmt **headp)
+{
+  struct ospf_ls_rxmt *e;
+
+  if (nbr->ls_rxmt_count == 0)
+    return NULL;
+
+  for (e = *headp = ospf_ls_rxmt_lookup (nbr->oi, lsa); e; e = e->next)
+    if (ospf_ls_rxmt_isset (e, nbr->ls_rxmt_index))
+      return e;
+
+  return NULL;
+}
+
+/* Give the neighbor a bit in the retransmit entries of its interface. */
+static int
+ospf_ls_rxmt_index (struct ospf_neighbor *nbr)
+{
+  struct ospf_interface *oi = nbr->oi;
+  int i;
+
+  if (nbr->ls_rxmt_index >= 0)
+    return nbr->ls_rxmt_index;
+
+  for (i = 0; i < oi->ls_rxmt_nbrs_max; i++)
+    if (oi->ls_rxmt_nbrs[i] == NULL)
+      break;
+
+  if (i == oi->ls_rxmt_nbrs_max)
+    {
+      int max = oi->ls_rxmt_nbrs_max ? oi->ls_rxmt_nbrs_max * 2 : 32;
+
+      oi->ls_rxmt_nbrs = XREALLOC (MTYPE_OSPF_LS_RXMT, oi->ls_rxmt_nbrs,
+				   max * sizeof (struct ospf_neighbor *));
+      memset (oi->ls_rxmt_nbrs + i, 0,
+	      (max - i) * sizeof (struct ospf_neighbor *));
+      oi->ls_rxmt_nbrs_max = max;
+    }
+
+  oi->ls_rxmt_nbrs[i] = nbr;
+  nbr->ls_rxmt_index = i;
+
+  return i;
+}
+
+static void
+ospf_ls_rxmt_set (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
+{
+  struct ospf_interface *oi = nbr->oi;
+  struct ospf_ls_rxmt tmp;
+  struct ospf_ls_rxmt *head, *e;
+  int index;
+  unsigned int w;
+
+  index = ospf_ls_rxmt_index (nbr);
+  w = LS_RXMT_WORD (index);
+
+  tmp.lsa = lsa;
+  head = hash_get (oi->ls_rxmt, &tmp, ospf_ls_rxmt_new);
+
+  for (e = head; e; e = e->next)
+    if (e->lsa == lsa)
+      break;
+
+  if (e == NULL)
+    {
+      e = ospf_ls_rxmt_new (&tmp);
+      e->next = head->next;
+      head->next = e;
+    }
+
+  if (ospf_ls_rxmt_isset (e, index))
+    return;
+
+  if (e->count == 0)
+    oi->ospf->ls_rxmt_entries++;
+
+  if (w >= e->words)
+    {
+      e->bits = XREALLOC (MTYPE_OSPF_LS_RXMT, e->bits,
+			  (w + 1) * sizeof (u_int32_t));
+      memset (e->bits + e->words, 0, (w + 1 - e->words) * sizeof (u_int32_t));
+      e->words = w + 1;
+    }
+
+  e->bits[w] |= LS_RXMT_BIT (index);
+  e->count++;
+  nbr->ls_rxmt_count++;
+  oi->ospf->ls_rxmt_pairs++;
+  lsa->retransmit_counter++;
+}
+
+/* Clear the neighbor's bit in entry E of the chain starting at HEAD,
+   freeing E once no neighbor is waiting for it any more. */
+static void
+ospf_ls_rxmt_unset (struct ospf_neighbor *nbr, struct ospf_ls_rxmt *head,
+		    struct ospf_ls_rxmt *e)
+{
+  struct ospf_interface *oi = nbr->oi;
+  struct ospf_ls_rxmt *prev;
+  int index = nbr->ls_rxmt_index;
+
+  e->bits[LS_RXMT_WORD (index)] &= ~LS_RXMT_BIT (index);
+  e->count--;
+  nbr->ls_rxmt_count--;
+  e->lsa->retransmit_counter--;
+
+  if (e->count > 0)
+    return;
+
+  if (e != head)
+    {
+      for (prev = head; prev->next != e; prev = prev->next)
+	;
+      prev->next = e->next;
+    }
+  else if (head->next)
+    {
+      /* Keep the hashed entry, it is the bucket's data. */
+      e = head->next;
+      ospf_lsa_unlock (&head->lsa);
+      XFREE (MTYPE_OSPF_LS_RXMT, head->bits);
+      *head = *e;
+      XFREE (MTYPE_OSPF_LS_RXMT, e);
+      return;
+    }
+  else
+    hash_release (oi->ls_rxmt, head);
+
+  ospf_lsa_unlock (&e->lsa);
+  XFREE (MTYPE_OSPF_LS_RXMT, e->bits);
+  XFREE (MTYPE_OSPF_LS_RXMT, e);
+}
+
+void
+ospf_ls_retransmit_init (struct ospf_interface *oi)
+{
+  oi->ls_rxmt = hash_create (ospf_ls_rxmt_hash_key, ospf_ls_rxmt_hash_cmp);
+  oi->ls_rxmt_nbrs = NULL;
+  oi->ls_rxmt_nbrs_max = 0;
+}
+
+void
+ospf_ls_retransmit_finish (struct ospf_interface *oi)
+{
+  /* Neighbors have emptied their lists when they were deleted. */
+  assert (oi->ls_rxmt->count == 0);
+
+  hash_free (oi->ls_rxmt);
+  oi->ls_rxmt = NULL;
+
+  if (oi->ls_rxmt_nbrs)
+    XFREE (MTYPE_OSPF_LS_RXMT, oi->ls_rxmt_nbrs);
+  oi->ls_rxmt_nbrs_max = 0;
+}
+
 unsigned long
 ospf_ls_retransmit_count (struct ospf_neighbor *nbr)
 {
-  return ospf_lsdb_count_all (&nbr->ls_rxmt);
+  return nbr->ls_rxmt_count;
+}
+
+struct ospf_ls_rxmt_walk
+{
+  struct ospf_neighbor *nbr;
+  void (*func) (struct ospf_lsa *, void *);
+  void *arg;
+};
+
+static void
+ospf_ls_rxmt_walk_entry (struct hash_backet *backet, void *arg)
+{
+  struct ospf_ls_rxmt_walk *walk = arg;
+  struct ospf_ls_rxmt *e;
+
+  /* A neighbor waits for one instance of an LSA at most. */
+  for (e = backet->data; e; e = e->next)
+    if (ospf_ls_rxmt_isset (e, walk->nbr->ls_rxmt_index))
+      {
+	(*walk->func) (e->lsa, walk->arg);
+	return;
+      }
+}
+
+/* Call FUNC for each LSA on the neighbor's ls-retransmit list. */
+void
+ospf_ls_retransmit_iterate (struct ospf_neighbor *nbr,
+			    void (*func) (struct ospf_lsa *, void *),
+			    void *arg)
+{
+  struct ospf_ls_rxmt_walk walk;
+
+  if (nbr->ls_rxmt_count == 0)
+    return;
+
+  walk.nbr = nbr;
+  walk.func = func;
+  walk.arg = arg;
+
+  hash_iterate (nbr->oi->ls_rxmt, ospf_ls_rxmt_walk_entry, &walk);
+}
+
+struct ospf_ls_rxmt_self
+{
+  int lsa_type;
+  unsigned long count;
+};
+
+static void
+ospf_ls_rxmt_count_self (struct ospf_lsa *lsa, void *arg)
+{
+  struct ospf_ls_rxmt_self *self = arg;
+
+  if (lsa->data->type == self->lsa_type && IS_LSA_SELF (lsa))
+    self->count++;
 }
 
 unsigned long
 ospf_ls_retransmit_count_self (struct ospf_neighbor *nbr, int lsa_type)
 {
-  return ospf_lsdb_count_self (&nbr->ls_rxmt, lsa_type);
+  struct ospf_ls_rxmt_self self;
+
+  self.lsa_type = lsa_type;
+  self.count = 0;
+
+  ospf_ls_retransmit_iterate (nbr, ospf_ls_rxmt_count_self, &self);
+
+  return self.count;
 }
 
 int
 ospf_ls_retransmit_isempty (struct ospf_neighbor *nbr)
 {
-  return ospf_lsdb_isempty (&nbr->ls_rxmt);
+  return nbr->ls_rxmt_count == 0;
 }
 
 /* Add LSA to be retransmitted to neighbor's ls-retransmit list. */
 void
 ospf_ls_retransmit_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
-  struct ospf_lsa *old;
+  struct ospf_ls_rxmt *head, *e;
 
-  old = ospf_ls_retransmit_lookup (nbr, lsa);
+  e = ospf_ls_rxmt_find (nbr, lsa, &head);
 
-  if (ospf_lsa_more_recent (old, lsa) < 0)
+  if (ospf_lsa_more_recent (e ? e->lsa : NULL, lsa) < 0)
     {
-      if (old)
-	{
-	  old->retransmit_counter--;
-	  ospf_lsdb_delete (&nbr->ls_rxmt, old);
-	}
-      lsa->retransmit_counter++;
+      if (e)
+	ospf_ls_rxmt_unset (nbr, head, e);
       /*
        * We cannot make use of the newly introduced callback function
        * "lsdb->new_lsa_hook" to replace debug output below, just because
@@ -881,7 +1165,7 @@ ospf_ls_retransmit_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 	  zlog_debug ("RXmtL(%lu)++, NBR(%s), LSA[%s]",
                      ospf_ls_retransmit_count (nbr),
 		     inet_ntoa (nbr->router_id), dump_lsa_key (lsa));
-      ospf_lsdb_add (&nbr->ls_rxmt, lsa);
+      ospf_ls_rxmt_set (nbr, lsa);
     }
 }
 
@@ -889,35 +1173,48 @@ ospf_ls_retransmit_add (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 void
 ospf_ls_retransmit_delete (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
-  if (ospf_ls_retransmit_lookup (nbr, lsa))
+  struct ospf_ls_rxmt *head, *e;
+
+  e = ospf_ls_rxmt_find (nbr, lsa, &head);
+
+  if (e && e->lsa == lsa)
     {
-      lsa->retransmit_counter--;  
       if (IS_DEBUG_OSPF (lsa, LSA_FLOODING))		/* -- endo. */
 	  zlog_debug ("RXmtL(%lu)--, NBR(%s), LSA[%s]",
                      ospf_ls_retransmit_count (nbr),
 		     inet_ntoa (nbr->router_id), dump_lsa_key (lsa));
-      ospf_lsdb_delete (&nbr->ls_rxmt, lsa);
+      ospf_ls_rxmt_unset (nbr, head, e);
     }
 }
 
+static void
+ospf_ls_rxmt_clear_entry (struct hash_backet *backet, void *arg)
+{
+  struct ospf_neighbor *nbr = arg;
+  struct ospf_ls_rxmt *e;
+
+  for (e = backet->data; e; e = e->next)
+    if (ospf_ls_rxmt_isset (e, nbr->ls_rxmt_index))
+      {
+	ospf_ls_rxmt_unset (nbr, backet->data, e);
+	return;
+      }
+}
+
 /* Clear neighbor's ls-retransmit list. */
 void
 ospf_ls_retransmit_clear (struct ospf_neighbor *nbr)
 {
-  struct ospf_lsdb *lsdb;
-  int i;
+  struct ospf_interface *oi = nbr->oi;
 
-  lsdb = &nbr->ls_rxmt;
+  if (nbr->ls_rxmt_count)
+    hash_iterate (oi->ls_rxmt, ospf_ls_rxmt_clear_entry, nbr);
 
-  for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
+  /* Hand the bit over to the next neighbor. */
+  if (nbr->ls_rxmt_index >= 0)
     {
-      struct route_table *table = lsdb->type[i].db;
-      struct route_node *rn;
-      struct ospf_lsa *lsa;
-
-      for (rn = route_top (table); rn; rn = route_next (rn))
-	if ((lsa = rn->info) != NULL)
-	  ospf_ls_retransmit_delete (nbr, lsa);
+      oi->ls_rxmt_nbrs[nbr->ls_rxmt_index] = NULL;
+      nbr->ls_rxmt_index = -1;
     }
 
   ospf_lsa_unlock (&nbr->ls_req_last);
@@ -928,28 +1225,37 @@ ospf_ls_retransmit_clear (struct ospf_neighbor *nbr)
 struct ospf_lsa *
 ospf_ls_retransmit_lookup (struct ospf_neighbor *nbr, struct ospf_lsa *lsa)
 {
-  return ospf_lsdb_lookup (&nbr->ls_rxmt, lsa);
+  struct ospf_ls_rxmt *head, *e;
+
+  e = ospf_ls_rxmt_find (nbr, lsa, &head);
+
+  return e ? e->lsa : NULL;
 }
 
 static void
 ospf_ls_retransmit_delete_nbr_if (struct ospf_interface *oi,
 				  struct ospf_lsa *lsa)
 {
-  struct route_node *rn;
-  struct ospf_neighbor *nbr;
-  struct ospf_lsa *lsr;
+  struct ospf_ls_rxmt *head, *e;
+  int i;
 
-  if (ospf_if_is_enable (oi))
-    for (rn = route_top (oi->nbrs); rn; rn = route_next (rn))
-      /* If LSA find in LS-retransmit list, then remove it. */
-      if ((nbr = rn->info) != NULL)
-	{
-	  lsr = ospf_ls_retransmit_lookup (nbr, lsa);
-	     
-	  /* If LSA find in ls-retransmit list, remove it. */
-	  if (lsr != NULL && lsr->data->ls_seqnum == lsa->data->ls_seqnum)
-	    ospf_ls_retransmit_delete (nbr, lsr);
-	}
+  if (!ospf_if_is_enable (oi))
+    return;
+
+  /* Every neighbor waiting for this very instance gets it removed,
+     a bit at a time as the entry may go away with the last one. */
+  while ((head = ospf_ls_rxmt_lookup (oi, lsa)) != NULL)
+    {
+      for (e = head; e; e = e->next)
+	if (e->lsa->data->ls_seqnum == lsa->data->ls_seqnum)
+	  break;
+      if (e == NULL)
+	break;
+
+      for (i = 0; !ospf_ls_rxmt_isset (e, i); i++)
+	;
+      ospf_ls_retransmit_delete (oi->ls_rxmt_nbrs[i], e->lsa);
+    }
 }
 
 void
@@ -44,10 +44,15 @@ extern void ospf_ls_request_delete_all (struct ospf_neighbor *);
 extern struct ospf_lsa *ospf_ls_request_lookup (struct ospf_neighbor *,
 						struct ospf_lsa *);
 
+extern void ospf_ls_retransmit_init (struct ospf_interface *);
+extern void ospf_ls_retransmit_finish (struct ospf_interface *);
 extern unsigned long ospf_ls_retransmit_count (struct ospf_neighbor *);
 extern unsigned long ospf_ls_retransmit_count_self (struct ospf_neighbor *,
 						    int);
 extern int ospf_ls_retransmit_isempty (struct ospf_neighbor *);
+extern void ospf_ls_retransmit_iterate (struct ospf_neighbor *,
+					void (*) (struct ospf_lsa *, void *),
+					void *);
 extern void ospf_ls_retransmit_add (struct ospf_neighbor *,
 				    struct ospf_lsa *);
 extern void ospf_ls_retransmit_delete (struct ospf_neighbor *,
@@ -42,6 +42,7 @@
 #include "ospfd/ospf_neighbor.h"
 #include "ospfd/ospf_nsm.h"
 #include "ospfd/ospf_packet.h"
+#include "ospfd/ospf_flood.h"
 #include "ospfd/ospf_abr.h"
 #include "ospfd/ospf_network.h"
 #include "ospfd/ospf_dump.h"
@@ -232,6 +233,9 @@ ospf_if_new (struct ospf *ospf, struct interface *ifp, struct prefix *p)
   /* Set default values. */
   ospf_if_reset_variables (oi);
 
+  /* Initialize shared ls-retransmit lists. */
+  ospf_ls_retransmit_init (oi);
+
   /* Add pseudo neighbor. */
   oi->nbr_self = ospf_nbr_new (oi);
 
@@ -316,6 +320,7 @@ ospf_if_free (struct ospf_interface *oi)
   
   route_table_finish (oi->nbrs);
   route_table_finish (oi->ls_upd_queue);
+  ospf_ls_retransmit_finish (oi);
   
   /* Free any lists that should be freed */
   list_free (oi->nbr_nbma);
@@ -325,6 +330,9 @@ ospf_if_free (struct ospf_interface *oi)
   
   ospf_delete_from_if (oi->ifp, oi);
 
+  /* Nexthops on the SPF trees kept for i-SPF may go out this way. */
+  ospf_spf_calculate_schedule (oi->ospf);
+
   listnode_delete (oi->ospf->oiflist, oi);
   listnode_delete (oi->area->oiflist, oi);
 
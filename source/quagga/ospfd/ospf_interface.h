@@ -192,6 +192,13 @@ struct ospf_interface
 #endif /* HAVE_OPAQUE_LSA */
 
   struct route_table *ls_upd_queue;
+  struct timeval ls_upd_last;		/* Last LS Update burst sent. */
+
+  /* LSAs waiting for acknowledgment, shared by all the neighbors on
+     the interface.  Each entry has a bit per neighbor. */
+  struct hash *ls_rxmt;
+  struct ospf_neighbor **ls_rxmt_nbrs;	/* Neighbor by bit number. */
+  int ls_rxmt_nbrs_max;
 
   struct list *ls_ack;			/* Link State Acknowledgment list. */
   
@@ -209,7 +216,7 @@ struct ospf_interface
   struct thread *t_wait;                /* timer */
   struct thread *t_ls_ack;              /* timer */
   struct thread *t_ls_ack_direct;       /* event */
-  struct thread *t_ls_upd_event;        /* event */
+  struct thread *t_ls_upd_event;        /* event or pacing timer */
 #ifdef HAVE_OPAQUE_LSA
   struct thread *t_opaque_lsa_self;     /* Type-9 Opaque-LSAs */
 #endif /* HAVE_OPAQUE_LSA */
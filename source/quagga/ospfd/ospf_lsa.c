@@ -2389,9 +2389,8 @@ ospf_router_lsa_install (struct ospf *ospf, struct ospf_lsa *new,
 
       ospf_refresher_register_lsa (ospf, new);
     }
-  if (rt_recalc)
-    ospf_spf_calculate_schedule (ospf);
 
+  /* The routing table calculation is scheduled by ospf_lsa_install. */
   return new;
 }
 
@@ -2424,8 +2423,6 @@ ospf_network_lsa_install (struct ospf *ospf,
       oi->network_lsa_self = ospf_lsa_lock (new);
       ospf_refresher_register_lsa (ospf, new);
     }
-  if (rt_recalc)
-    ospf_spf_calculate_schedule (ospf);
 
   return new;
 }
@@ -2444,13 +2441,8 @@ ospf_summary_lsa_install (struct ospf *ospf, struct ospf_lsa *new,
 	 necessary to re-examine all the AS-external-LSAs.
       */
 
-#if 0
-      /* This doesn't exist yet... */
-      ospf_summary_incremental_update(new); */
-#else /* #if 0 */
-      ospf_spf_calculate_schedule (ospf);
-#endif /* #if 0 */
- 
+      /* Done by the partial route calculation ospf_lsa_install
+         has scheduled, without SPF. */
       if (IS_DEBUG_OSPF (lsa, LSA_INSTALL))
 	zlog_debug ("ospf_summary_lsa_install(): SPF scheduled");
     }
@@ -2474,15 +2466,8 @@ ospf_summary_asbr_lsa_install (struct ospf *ospf, struct ospf_lsa *new,
 	 destination is an AS boundary router, it may also be
 	 necessary to re-examine all the AS-external-LSAs.
       */
-#if 0
-      /* These don't exist yet... */
-      ospf_summary_incremental_update(new);
-      /* Isn't this done by the above call? 
-	 - RFC 2328 Section 16.5 implies it should be */
-      /* ospf_ase_calculate_schedule(); */
-#else  /* #if 0 */
-      ospf_spf_calculate_schedule (ospf);
-#endif /* #if 0 */
+      /* Done by the partial route calculation ospf_lsa_install
+         has scheduled, which goes on to the AS-external routes. */
     }
 
   /* register LSA to refresh-list. */
@@ -2687,6 +2672,11 @@ ospf_lsa_install (struct ospf *ospf, struct ospf_interface *oi,
         }
     }
 
+  /* Let the routing table calculation know, while the old instance is
+     still there to compare with. */
+  if (rt_recalc)
+    ospf_spf_lsa_changed (ospf, old, lsa);
+
   /* discard old LSA from LSDB */
   if (old != NULL)
     ospf_discard_from_db (ospf, lsdb, lsa);
@@ -2953,7 +2943,7 @@ ospf_lsa_maxage_walker_remover (struct ospf *ospf, struct ospf_lsa *lsa)
 	    ospf_ase_incremental_update (ospf, lsa);
             break;
           default:
-	    ospf_spf_calculate_schedule (ospf);
+	    ospf_spf_lsa_changed (ospf, NULL, lsa);
             break;
           }
 	ospf_lsa_maxage (ospf, lsa);
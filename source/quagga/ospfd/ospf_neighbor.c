@@ -93,9 +93,11 @@ ospf_nbr_new (struct ospf_interface *oi)
   nbr->nbr_nbma = NULL;
 
   ospf_lsdb_init (&nbr->db_sum);
-  ospf_lsdb_init (&nbr->ls_rxmt);
   ospf_lsdb_init (&nbr->ls_req);
 
+  /* No bit in the interface's retransmit entries until needed. */
+  nbr->ls_rxmt_index = -1;
+
   nbr->crypt_seqnum = 0;
 
   return nbr;
@@ -114,13 +116,11 @@ ospf_nbr_free (struct ospf_neighbor *nbr)
     ospf_ls_request_delete_all (nbr);
 
   /* Free retransmit list. */
-  if (ospf_ls_retransmit_count (nbr))
-    ospf_ls_retransmit_clear (nbr);
+  ospf_ls_retransmit_clear (nbr);
 
   /* Cleanup LSDBs. */
   ospf_lsdb_cleanup (&nbr->db_sum);
   ospf_lsdb_cleanup (&nbr->ls_req);
-  ospf_lsdb_cleanup (&nbr->ls_rxmt);
   
   /* Clear last send packet. */
   if (nbr->last_send)
@@ -60,7 +60,8 @@ struct ospf_neighbor
   } last_recv;
 
   /* LSA data. */
-  struct ospf_lsdb ls_rxmt;
+  int ls_rxmt_index;			/* Bit in oi->ls_rxmt entries. */
+  unsigned long ls_rxmt_count;		/* LSAs awaiting our ack. */
   struct ospf_lsdb db_sum;
   struct ospf_lsdb ls_req;
   struct ospf_lsa *ls_req_last;
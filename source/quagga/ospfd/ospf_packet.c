@@ -60,6 +60,9 @@ const char *ospf_packet_type_str[] =
   "Link State Acknowledgment",
 };
 
+static struct list *ospf_ls_upd_queue_get (struct ospf_neighbor *, int);
+static void ospf_ls_upd_schedule (struct ospf_interface *);
+
 /* OSPF authentication checking function */
 static int
 ospf_auth_type (struct ospf_interface *oi)
@@ -444,6 +447,29 @@ ospf_ls_req_event (struct ospf_neighbor *nbr)
   nbr->t_ls_req = thread_add_event (master, ospf_ls_req_timer, nbr, 0);
 }
 
+struct ospf_ls_upd_rxmt
+{
+  struct list *update;
+  int retransmit_interval;
+};
+
+static void
+ospf_ls_upd_rxmt_lsa (struct ospf_lsa *lsa, void *arg)
+{
+  struct ospf_ls_upd_rxmt *rxmt = arg;
+
+  /* Don't retransmit an LSA if we received it within
+     the last RxmtInterval seconds - this is to allow the
+     neighbour a chance to acknowledge the LSA as it may
+     have ben just received before the retransmit timer
+     fired.  This is a small tweak to what is in the RFC,
+     but it will cut out out a lot of retransmit traffic
+     - MAG */
+  if (tv_cmp (tv_sub (recent_relative_time (), lsa->tv_recv), 
+	      int2tv (rxmt->retransmit_interval)) >= 0)
+    listnode_add (rxmt->update, lsa);
+}
+
 /* Cyclic timer function.  Fist registered in ospf_nbr_new () in
    ospf_neighbor.c  */
 int
@@ -457,42 +483,19 @@ ospf_ls_upd_timer (struct thread *thread)
   /* Send Link State Update. */
   if (ospf_ls_retransmit_count (nbr) > 0)
     {
-      struct list *update;
-      struct ospf_lsdb *lsdb;
-      int i;
-      int retransmit_interval;
+      struct ospf_ls_upd_rxmt rxmt;
 
-      retransmit_interval = OSPF_IF_PARAM (nbr->oi, retransmit_interval);
+      rxmt.retransmit_interval = OSPF_IF_PARAM (nbr->oi, retransmit_interval);
+      rxmt.update = list_new ();
 
-      lsdb = &nbr->ls_rxmt;
-      update = list_new ();
+      ospf_ls_retransmit_iterate (nbr, ospf_ls_upd_rxmt_lsa, &rxmt);
 
-      for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
+      if (listcount (rxmt.update) > 0)
 	{
-	  struct route_table *table = lsdb->type[i].db;
-	  struct route_node *rn;
-	  
-	  for (rn = route_top (table); rn; rn = route_next (rn))
-	    {
-	      struct ospf_lsa *lsa;
-	      
-	      if ((lsa = rn->info) != NULL)
-		/* Don't retransmit an LSA if we received it within
-		  the last RxmtInterval seconds - this is to allow the
-		  neighbour a chance to acknowledge the LSA as it may
-		  have ben just received before the retransmit timer
-		  fired.  This is a small tweak to what is in the RFC,
-		  but it will cut out out a lot of retransmit traffic
-		  - MAG */
-		if (tv_cmp (tv_sub (recent_relative_time (), lsa->tv_recv), 
-			    int2tv (retransmit_interval)) >= 0)
-		  listnode_add (update, rn->info);
-	    }
+	  nbr->oi->ospf->ls_rxmt_lsas += listcount (rxmt.update);
+	  ospf_ls_upd_send (nbr, rxmt.update, OSPF_SEND_PACKET_DIRECT);
 	}
-
-      if (listcount (update) > 0)
-	ospf_ls_upd_send (nbr, update, OSPF_SEND_PACKET_DIRECT);
-      list_delete (update);
+      list_delete (rxmt.update);
     }
 
   /* Set LS Update retransmission timer. */
@@ -3292,14 +3295,9 @@ void
 ospf_ls_upd_send_lsa (struct ospf_neighbor *nbr, struct ospf_lsa *lsa,
 		      int flag)
 {
-  struct list *update;
-
-  update = list_new ();
-
-  listnode_add (update, lsa);
-  ospf_ls_upd_send (nbr, update, flag);
-
-  list_delete (update);
+  listnode_add (ospf_ls_upd_queue_get (nbr, flag),
+		ospf_lsa_lock (lsa)); /* oi->ls_upd_queue */
+  ospf_ls_upd_schedule (nbr->oi);
 }
 
 /* Determine size for packet. Must be at least big enough to accomodate next
@@ -3378,11 +3376,14 @@ ospf_ls_upd_queue_send (struct ospf_interface *oi, struct list *update,
 {
   struct ospf_packet *op;
   u_int16_t length = OSPF_HEADER_SIZE;
+  unsigned int count;
 
   if (IS_DEBUG_OSPF_EVENT)
     zlog_debug ("listcount = %d, dst %s", listcount (update), inet_ntoa(addr));
   
   op = ospf_ls_upd_packet_new (update, oi);
+  if (op == NULL)
+    return;
 
   /* Prepare OSPF common header. */
   ospf_make_header (OSPF_MSG_LS_UPD, oi, op->s);
@@ -3390,8 +3391,12 @@ ospf_ls_upd_queue_send (struct ospf_interface *oi, struct list *update,
   /* Prepare OSPF Link State Update body.
    * Includes Type-7 translation. 
    */
+  count = listcount (update);
   length += ospf_make_ls_upd (oi, update, op->s);
 
+  oi->ospf->ls_upd_packets++;
+  oi->ospf->ls_upd_lsas += count - listcount (update);
+
   /* Fill OSPF header. */
   ospf_fill_header (oi, op->s, length);
 
@@ -3419,6 +3424,7 @@ ospf_ls_upd_send_queue_event (struct thread *thread)
   struct route_node *rnext;
   struct list *update;
   char again = 0;
+  int i;
   
   oi->t_ls_upd_event = NULL;
 
@@ -3434,7 +3440,9 @@ ospf_ls_upd_send_queue_event (struct thread *thread)
       
       update = (struct list *)rn->info;
 
-      ospf_ls_upd_queue_send (oi, update, rn->p.u.prefix4);
+      /* Pack as many LSAs as fit into each packet, a burst at a time. */
+      for (i = 0; i < OSPF_LS_UPD_BURST && listcount (update) > 0; i++)
+        ospf_ls_upd_queue_send (oi, update, rn->p.u.prefix4);
       
       /* list might not be empty. */
       if (listcount(update) == 0)
@@ -3447,13 +3455,14 @@ ospf_ls_upd_send_queue_event (struct thread *thread)
         again = 1;
     }
 
+  oi->ls_upd_last = recent_relative_time ();
+
   if (again != 0)
     {
       if (IS_DEBUG_OSPF_EVENT)
         zlog_debug ("ospf_ls_upd_send_queue: update lists not cleared,"
                    " %d nodes to try again, raising new event", again);
-      oi->t_ls_upd_event = 
-        thread_add_event (master, ospf_ls_upd_send_queue_event, oi, 0);
+      ospf_ls_upd_schedule (oi);
     }
 
   if (IS_DEBUG_OSPF_EVENT)
@@ -3462,14 +3471,40 @@ ospf_ls_upd_send_queue_event (struct thread *thread)
   return 0;
 }
 
-void
-ospf_ls_upd_send (struct ospf_neighbor *nbr, struct list *update, int flag)
+/* Send whatever is queued on the interface as soon as the flooding
+   pace allows: right away if the last burst went out long enough ago,
+   otherwise once the rest of the pacing interval has passed. */
+static void
+ospf_ls_upd_schedule (struct ospf_interface *oi)
+{
+  struct timeval since;
+  unsigned long msec;
+
+  if (oi->t_ls_upd_event != NULL)
+    return;
+
+  since = tv_sub (recent_relative_time (), oi->ls_upd_last);
+  msec = since.tv_sec * 1000 + since.tv_usec / 1000;
+
+  if (msec >= oi->ospf->flood_pacing)
+    oi->t_ls_upd_event =
+      thread_add_event (master, ospf_ls_upd_send_queue_event, oi, 0);
+  else
+    {
+      oi->ospf->ls_upd_paced++;
+      oi->t_ls_upd_event =
+	thread_add_timer_msec (master, ospf_ls_upd_send_queue_event, oi,
+			       oi->ospf->flood_pacing - msec);
+    }
+}
+
+/* Return the update queue of the destination to send to NBR. */
+static struct list *
+ospf_ls_upd_queue_get (struct ospf_neighbor *nbr, int flag)
 {
   struct ospf_interface *oi;
-  struct ospf_lsa *lsa;
   struct prefix_ipv4 p;
   struct route_node *rn;
-  struct listnode *node;
   
   oi = nbr->oi;
 
@@ -3502,13 +3537,25 @@ ospf_ls_upd_send (struct ospf_neighbor *nbr, struct list *update, int flag)
 
   if (rn->info == NULL)
     rn->info = list_new ();
+  else
+    route_unlock_node (rn);
+
+  return rn->info;
+}
+
+void
+ospf_ls_upd_send (struct ospf_neighbor *nbr, struct list *update, int flag)
+{
+  struct list *queue;
+  struct ospf_lsa *lsa;
+  struct listnode *node;
+
+  queue = ospf_ls_upd_queue_get (nbr, flag);
 
   for (ALL_LIST_ELEMENTS_RO (update, node, lsa))
-    listnode_add (rn->info, ospf_lsa_lock (lsa)); /* oi->ls_upd_queue */
+    listnode_add (queue, ospf_lsa_lock (lsa)); /* oi->ls_upd_queue */
 
-  if (oi->t_ls_upd_event == NULL)
-    oi->t_ls_upd_event =
-      thread_add_event (master, ospf_ls_upd_send_queue_event, oi, 0);
+  ospf_ls_upd_schedule (nbr->oi);
 }
 
 static void
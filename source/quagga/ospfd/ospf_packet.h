@@ -46,6 +46,9 @@
 
 #define OSPF_HELLO_REPLY_DELAY          1
 
+/* LS Updates sent to a destination per paced burst. */
+#define OSPF_LS_UPD_BURST               8
+
 struct ospf_packet
 {
   struct ospf_packet *next;
@@ -47,7 +47,9 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "ospfd/ospf_dump.h"
 
 static void ospf_vertex_free (void *);
-/* List of allocated vertices, to simplify cleanup of SPF.
+/* List of vertices allocated by the calculation under way.  Those that
+ * end up on the tree move to the area's vertex table at the end, to be
+ * kept until the next run, the others are freed.
  * Not thread-safe obviously. If it ever needs to be, it'd have to be
  * dynamically allocated at begin of ospf_spf_calculate
  */
@@ -103,40 +105,8 @@ vertex_nexthop_free (struct vertex_nexthop *nh)
   XFREE (MTYPE_OSPF_NEXTHOP, nh);
 }
 
-/* Free the canonical nexthop objects for an area, ie the nexthop objects
- * attached to the first-hop router vertices, and any intervening network
- * vertices.
- */
-static void
-ospf_canonical_nexthops_free (struct vertex *root)
-{
-  struct listnode *node, *nnode;
-  struct vertex *child;
-  
-  for (ALL_LIST_ELEMENTS (root->children, node, nnode, child))
-    {
-      struct listnode *n2, *nn2;
-      struct vertex_parent *vp;
-      
-      /* router vertices through an attached network each
-       * have a distinct (canonical / not inherited) nexthop
-       * which must be freed.
-       *
-       * A network vertex can only have router vertices as its
-       * children, so only one level of recursion is possible.
-       */
-      if (child->type == OSPF_VERTEX_NETWORK)
-        ospf_canonical_nexthops_free (child);
-      
-      /* Free child nexthops pointing back to this root vertex */
-      for (ALL_LIST_ELEMENTS (child->parents, n2, nn2, vp))
-        if (vp->parent == root && vp->nexthop)
-          vertex_nexthop_free (vp->nexthop);
-    }
-}      
-
 /* TODO: Parent list should be excised, in favour of maintaining only
- * vertex_nexthop, with refcounts.
+ * vertex_nexthop.
  */
 static struct vertex_parent *
 vertex_parent_new (struct vertex *v, int backlink, struct vertex_nexthop *hop)
@@ -151,12 +121,21 @@ vertex_parent_new (struct vertex *v, int backlink, struct vertex_nexthop *hop)
   new->parent = v;
   new->backlink = backlink;
   new->nexthop = hop;
+  hop->lock++;
   return new;
 }
 
+/* A nexthop is shared by the parents it was handed down to, and goes
+ * with the last of them.  Trees are kept between runs and i-SPF takes
+ * subtrees off them, so no one vertex can be said to own it.
+ */
 static void
 vertex_parent_free (void *p)
 {
+  struct vertex_parent *vp = p;
+
+  if (vp->nexthop && --vp->nexthop->lock == 0)
+    vertex_nexthop_free (vp->nexthop);
   XFREE (MTYPE_OSPF_VERTEX_PARENT, p);
 }
 
@@ -172,6 +151,7 @@ ospf_vertex_new (struct ospf_lsa *lsa)
   new->type = lsa->data->type;
   new->id = lsa->data->id;
   new->lsa = lsa->data;
+  new->lsa_p = ospf_lsa_lock (lsa);
   new->children = list_new ();
   new->parents = list_new ();
   new->parents->del = vertex_parent_free;
@@ -210,10 +190,96 @@ ospf_vertex_free (void *data)
   v->parents = NULL;
   
   v->lsa = NULL;
+  ospf_lsa_unlock (&v->lsa_p);
   
   XFREE (MTYPE_OSPF_VERTEX, v);
 }
 
+/* The vertices on an area's tree, by LSA type and ID. */
+static unsigned int
+ospf_vertex_hash_key (void *data)
+{
+  struct vertex *v = data;
+
+  return v->id.s_addr ^ v->type;
+}
+
+static int
+ospf_vertex_hash_cmp (const void *a, const void *b)
+{
+  const struct vertex *v1 = a, *v2 = b;
+
+  return v1->type == v2->type && IPV4_ADDR_SAME (&v1->id, &v2->id);
+}
+
+static struct vertex *
+ospf_vertex_lookup (struct ospf_area *area, u_char type, struct in_addr id)
+{
+  struct vertex key;
+
+  if (area->spf_vertices == NULL)
+    return NULL;
+
+  key.type = type;
+  key.id = id;
+  return hash_lookup (area->spf_vertices, &key);
+}
+
+static void
+ospf_spf_changes_free (struct ospf_area *area)
+{
+  struct listnode *node, *nnode;
+  struct vertex *key;
+
+  if (area->spf_changes)
+    for (ALL_LIST_ELEMENTS (area->spf_changes, node, nnode, key))
+      {
+        XFREE (MTYPE_OSPF_SPF_CHANGE, key);
+        list_delete_node (area->spf_changes, node);
+      }
+}
+
+/* Free the tree kept for an area and the changes noted against it. */
+void
+ospf_spf_tree_free (struct ospf_area *area)
+{
+  if (area->spf_vertices)
+    {
+      hash_clean (area->spf_vertices, ospf_vertex_free);
+      hash_free (area->spf_vertices);
+      area->spf_vertices = NULL;
+    }
+  area->spf = NULL;
+
+  ospf_spf_changes_free (area);
+  if (area->spf_changes)
+    list_free (area->spf_changes);
+  area->spf_changes = NULL;
+}
+
+/* Keep the vertices of the calculation just done that made it onto the
+ * tree, and free the rest.
+ */
+static void
+ospf_spf_tree_keep (struct ospf_area *area)
+{
+  struct listnode *node, *nnode;
+  struct vertex *v;
+
+  if (area->spf_vertices == NULL)
+    area->spf_vertices = hash_create (ospf_vertex_hash_key,
+                                      ospf_vertex_hash_cmp);
+
+  for (ALL_LIST_ELEMENTS (&vertex_list, node, nnode, v))
+    {
+      list_delete_node (&vertex_list, node);
+      if (CHECK_FLAG (v->flags, OSPF_VERTEX_SPFTREE))
+        hash_get (area->spf_vertices, v, hash_alloc_intern);
+      else
+        ospf_vertex_free (v);
+    }
+}
+
 static void
 ospf_vertex_dump(const char *msg, struct vertex *v,
 		 int print_parents, int print_children)
@@ -713,10 +779,14 @@ ospf_nexthop_calculation (struct ospf_area *area, struct vertex *v,
  * v is on the SPF tree.  Examine the links in v's LSA.  Update the list
  * of candidates with any vertices not already on the list.  If a lower-cost
  * path is found to a vertex already on the candidate list, store the new cost.
+ *
+ * For i-SPF, INCREMENTAL is set when V is being recalculated: vertices
+ * kept on the tree stay as they are, so if V offers one of them a path
+ * as short as it has, that does not hold and -1 is returned.
  */
-static void
+static int
 ospf_spf_next (struct vertex *v, struct ospf_area *area,
-	       struct pqueue * candidate)
+	       struct pqueue * candidate, int incremental)
 {
   struct ospf_lsa *w_lsa = NULL;
   u_char *p;
@@ -845,15 +915,6 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
           continue;
         }
 
-      /* (c) If vertex W is already on the shortest-path tree, examine
-         the next link in the LSA. */
-      if (w_lsa->stat == LSA_SPF_IN_SPFTREE)
-	{
-	  if (IS_DEBUG_OSPF_EVENT)
-	    zlog_debug ("The LSA is already in SPF");
-	  continue;
-	}
-
       /* (d) Calculate the link state cost D of the resulting path
          from the root to vertex W.  D is equal to the sum of the link
          state cost of the (already calculated) shortest path to
@@ -866,6 +927,22 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
       else /* v is not a Router-LSA */
 	distance = v->distance;
 
+      /* (c) If vertex W is already on the shortest-path tree, examine
+         the next link in the LSA. */
+      if (w_lsa->stat == LSA_SPF_IN_SPFTREE)
+	{
+	  if (IS_DEBUG_OSPF_EVENT)
+	    zlog_debug ("The LSA is already in SPF");
+	  if (incremental)
+	    {
+	      w = ospf_vertex_lookup (area, w_lsa->data->type,
+				      w_lsa->data->id);
+	      if (w && distance <= w->distance)
+		return -1;
+	    }
+	  continue;
+	}
+
       /* Is there already vertex W in candidate list? */
       if (w_lsa->stat == LSA_SPF_NOT_EXPLORED)
 	{
@@ -913,6 +990,8 @@ ospf_spf_next (struct vertex *v, struct ospf_area *area,
             }
         } /* end W is already on the candidate list */
     } /* end loop over the links in V's LSA */
+
+  return 0;
 }
 
 static void
@@ -1117,6 +1196,9 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
                  inet_ntoa (area->area_id));
     }
 
+  /* Start over, with whatever was kept from the last run out of the way. */
+  ospf_spf_tree_free (area);
+
   /* Check router-lsa-self.  If self-router-lsa is not yet allocated,
      return this area's calculation. */
   if (!area->router_lsa_self)
@@ -1146,6 +1228,7 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
   /* Set LSA position to LSA_SPF_IN_SPFTREE. This vertex is the root of the
    * spanning tree. */
   *(v->stat) = LSA_SPF_IN_SPFTREE;
+  SET_FLAG (v->flags, OSPF_VERTEX_SPFTREE);
 
   /* Set Area A's TransitCapability to FALSE. */
   area->transit = OSPF_TRANSIT_FALSE;
@@ -1154,7 +1237,7 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
   for (;;)
     {
       /* RFC2328 16.1. (2). */
-      ospf_spf_next (v, area, candidate);
+      ospf_spf_next (v, area, candidate, 0);
 
       /* RFC2328 16.1. (3). */
       /* If at this step the candidate list is empty, the shortest-
@@ -1171,6 +1254,7 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
       v = (struct vertex *) pqueue_dequeue (candidate);
       /* Update stat field in vertex. */
       *(v->stat) = LSA_SPF_IN_SPFTREE;
+      SET_FLAG (v->flags, OSPF_VERTEX_SPFTREE);
 
       ospf_vertex_add_parent (v);
 
@@ -1198,16 +1282,9 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
   pqueue_delete (candidate);
   
   ospf_vertex_dump (__func__, area->spf, 0, 1);
-  /* Free nexthop information, canonical versions of which are attached
-   * the first level of router vertices attached to the root vertex, see
-   * ospf_nexthop_calculation.
-   */
-  ospf_canonical_nexthops_free (area->spf);
-  
-  /* Free SPF vertices, but not the list. List has ospf_vertex_free
-   * as deconstructor.
-   */
-  list_delete_all_node (&vertex_list);
+
+  /* Keep the tree for i-SPF next time. */
+  ospf_spf_tree_keep (area);
   
   /* Increment SPF Calculation Counter. */
   area->spf_calculation++;
@@ -1219,6 +1296,515 @@ ospf_spf_calculate (struct ospf_area *area, struct route_table *new_table,
                 mtype_stats_alloc(MTYPE_OSPF_VERTEX));
 }
 
+/* Mark V and the subtree below it as to be recalculated. */
+static void
+ospf_spf_mark_affected (struct vertex *v, struct list *affected)
+{
+  struct listnode *node;
+  struct vertex *child;
+
+  if (CHECK_FLAG (v->flags, OSPF_VERTEX_AFFECTED))
+    return;
+
+  SET_FLAG (v->flags, OSPF_VERTEX_AFFECTED);
+  listnode_add (affected, v);
+
+  for (ALL_LIST_ELEMENTS_RO (v->children, node, child))
+    ospf_spf_mark_affected (child, affected);
+}
+
+/* Add the vertices the links of LSA lead to, which stay on the tree, to
+ * the boundary i-SPF starts from.  A vertex recalculated can only have
+ * them or other vertices recalculated as its parents: it must have a
+ * link back to its parent.
+ */
+static void
+ospf_spf_mark_boundary (struct ospf_area *area, struct lsa_header *lsa,
+                        struct list *boundary)
+{
+  u_char *p, *lim;
+  struct router_lsa_link *l;
+  struct vertex *w;
+
+  p = ((u_char *) lsa) + OSPF_LSA_HEADER_SIZE + 4;
+  lim = ((u_char *) lsa) + ntohs (lsa->length);
+
+  while (p < lim)
+    {
+      if (lsa->type == OSPF_ROUTER_LSA)
+        {
+          l = (struct router_lsa_link *) p;
+
+          p += (OSPF_ROUTER_LSA_LINK_SIZE +
+                (l->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE));
+
+          switch (l->m[0].type)
+            {
+            case LSA_LINK_TYPE_POINTOPOINT:
+            case LSA_LINK_TYPE_VIRTUALLINK:
+              w = ospf_vertex_lookup (area, OSPF_VERTEX_ROUTER, l->link_id);
+              break;
+            case LSA_LINK_TYPE_TRANSIT:
+              w = ospf_vertex_lookup (area, OSPF_VERTEX_NETWORK, l->link_id);
+              break;
+            default:
+              continue;
+            }
+        }
+      else
+        {
+          w = ospf_vertex_lookup (area, OSPF_VERTEX_ROUTER,
+                                  *(struct in_addr *) p);
+          p += sizeof (struct in_addr);
+        }
+
+      if (w && ! CHECK_FLAG (w->flags, OSPF_VERTEX_AFFECTED
+                                       | OSPF_VERTEX_BOUNDARY))
+        {
+          SET_FLAG (w->flags, OSPF_VERTEX_BOUNDARY);
+          listnode_add (boundary, w);
+        }
+    }
+}
+
+struct ospf_spf_walk
+{
+  struct ospf_area *area;
+  struct vertex **vertices;
+  unsigned int count;
+  int stale;
+};
+
+/* Point a vertex staying on the tree at the current instance of its LSA,
+ * which may have been refreshed or had its stub links changed, and mark
+ * that as on the tree for ospf_spf_next.
+ */
+static void
+ospf_spf_refresh_vertex (struct hash_backet *backet, void *arg)
+{
+  struct ospf_spf_walk *walk = arg;
+  struct vertex *v = backet->data;
+  struct ospf_lsa *lsa;
+
+  UNSET_FLAG (v->flags, OSPF_VERTEX_PROCESSED);
+  if (CHECK_FLAG (v->flags, OSPF_VERTEX_AFFECTED))
+    return;
+
+  lsa = ospf_lsdb_lookup_by_id (walk->area->lsdb, v->type, v->id,
+                                v->lsa->adv_router);
+  if (lsa == NULL || IS_LSA_MAXAGE (lsa))
+    {
+      walk->stale = 1;
+      return;
+    }
+
+  if (lsa != v->lsa_p)
+    {
+      ospf_lsa_unlock (&v->lsa_p);
+      v->lsa_p = ospf_lsa_lock (lsa);
+      v->lsa = lsa->data;
+      v->stat = &lsa->stat;
+    }
+  lsa->stat = LSA_SPF_IN_SPFTREE;
+}
+
+/* i-SPF.  Recalculate only the parts of an area's tree the topology
+ * changes noted since the last run can have moved: the subtrees below
+ * the vertices whose LSAs changed.  Dijkstra is run for them alone,
+ * seeded from the vertices next to them which stay.  Should one of
+ * those get a path as short as it has through a vertex recalculated,
+ * more of the tree moves than was taken off, and it is left to a full
+ * SPF.
+ *
+ * Returns OSPF_SPF_INCREMENTAL, or OSPF_SPF_PRC if there was no change
+ * to the tree, or -1 if a full SPF is needed.
+ */
+static int
+ospf_spf_incremental (struct ospf_area *area)
+{
+  struct ospf_spf_walk walk;
+  struct list *affected, *boundary;
+  struct listnode *node, *nnode;
+  struct vertex *v, *vp_parent, *key;
+  struct vertex_parent *vp;
+  struct ospf_lsa *lsa;
+  struct pqueue *candidate = NULL;
+  int ret;
+
+  if (area->spf == NULL || area->router_lsa_self == NULL)
+    return -1;
+
+  ret = (area->spf_changes && listcount (area->spf_changes))
+        ? OSPF_SPF_INCREMENTAL : OSPF_SPF_PRC;
+
+  affected = list_new ();
+  boundary = list_new ();
+
+  if (area->spf_changes)
+    for (ALL_LIST_ELEMENTS_RO (area->spf_changes, node, key))
+      if ((v = ospf_vertex_lookup (area, key->type, key->id)) != NULL)
+        ospf_spf_mark_affected (v, affected);
+
+  /* A change to our own links, or to much of the tree, is best left to
+     Dijkstra from the start. */
+  if (CHECK_FLAG (area->spf->flags, OSPF_VERTEX_AFFECTED)
+      || listcount (affected) * 2 > area->spf_vertices->count)
+    goto fallback;
+
+  memset (&walk, 0, sizeof (walk));
+  walk.area = area;
+  ospf_lsdb_clean_stat (area->lsdb);
+  hash_iterate (area->spf_vertices, ospf_spf_refresh_vertex, &walk);
+  if (walk.stale)
+    goto fallback;
+
+  /* Where to start from: the neighbours of the vertices recalculated
+     and of those changed which were not on the tree before. */
+  for (ALL_LIST_ELEMENTS_RO (affected, node, v))
+    {
+      lsa = ospf_lsa_lookup_by_id (area, v->type, v->id);
+      if (lsa && ! IS_LSA_MAXAGE (lsa))
+        ospf_spf_mark_boundary (area, lsa->data, boundary);
+    }
+  if (area->spf_changes)
+    for (ALL_LIST_ELEMENTS_RO (area->spf_changes, node, key))
+      if (ospf_vertex_lookup (area, key->type, key->id) == NULL)
+        {
+          lsa = ospf_lsa_lookup_by_id (area, key->type, key->id);
+          if (lsa && ! IS_LSA_MAXAGE (lsa))
+            ospf_spf_mark_boundary (area, lsa->data, boundary);
+        }
+
+  /* Take the vertices recalculated off the tree. */
+  for (ALL_LIST_ELEMENTS_RO (affected, node, v))
+    {
+      struct listnode *pnode;
+
+      for (ALL_LIST_ELEMENTS_RO (v->parents, pnode, vp))
+        {
+          vp_parent = vp->parent;
+          if (! CHECK_FLAG (vp_parent->flags, OSPF_VERTEX_AFFECTED))
+            listnode_delete (vp_parent->children, v);
+        }
+      hash_release (area->spf_vertices, v);
+    }
+  for (ALL_LIST_ELEMENTS (affected, node, nnode, v))
+    {
+      list_delete_node (affected, node);
+      ospf_vertex_free (v);
+    }
+
+  candidate = pqueue_create ();
+  candidate->cmp = cmp;
+  candidate->update = update_stat;
+
+  for (ALL_LIST_ELEMENTS_RO (boundary, node, v))
+    {
+      UNSET_FLAG (v->flags, OSPF_VERTEX_BOUNDARY);
+      ospf_spf_next (v, area, candidate, 0);
+    }
+
+  while (candidate->size > 0)
+    {
+      v = (struct vertex *) pqueue_dequeue (candidate);
+      *(v->stat) = LSA_SPF_IN_SPFTREE;
+      SET_FLAG (v->flags, OSPF_VERTEX_SPFTREE);
+
+      ospf_vertex_add_parent (v);
+
+      if (ospf_spf_next (v, area, candidate, 1) < 0)
+        goto fallback;
+    }
+
+  pqueue_delete (candidate);
+  list_delete (affected);
+  list_delete (boundary);
+
+  ospf_spf_tree_keep (area);
+  ospf_spf_changes_free (area);
+
+  if (IS_DEBUG_OSPF_EVENT)
+    zlog_debug ("%s: area %s, %lu vertices on the tree", __func__,
+                inet_ntoa (area->area_id), area->spf_vertices->count);
+  return ret;
+
+ fallback:
+  if (IS_DEBUG_OSPF_EVENT)
+    zlog_debug ("%s: area %s needs a full SPF", __func__,
+                inet_ntoa (area->area_id));
+
+  area->ospf->spf_fallback++;
+  if (candidate)
+    pqueue_delete (candidate);
+  list_delete_all_node (&vertex_list);
+  list_delete (affected);
+  list_delete (boundary);
+  return -1;
+}
+
+static int
+ospf_vertex_sort_cmp (const void *a, const void *b)
+{
+  return cmp (*(struct vertex * const *) a, *(struct vertex * const *) b);
+}
+
+static void
+ospf_spf_collect_vertex (struct hash_backet *backet, void *arg)
+{
+  struct ospf_spf_walk *walk = arg;
+
+  walk->vertices[walk->count++] = backet->data;
+}
+
+/* Partial route calculation.  Make the routes of an area from the tree
+ * kept, as the full calculation does on the way, without Dijkstra: the
+ * routers and transit networks in the order they would have come off
+ * the candidate list, then the stubs.
+ */
+static void
+ospf_spf_replay (struct ospf_area *area, struct route_table *new_table,
+                 struct route_table *new_rtrs)
+{
+  struct ospf_spf_walk walk;
+  struct vertex *v;
+  unsigned int i;
+
+  area->transit = OSPF_TRANSIT_FALSE;
+  area->shortcut_capability = 1;
+  area->abr_count = 0;
+  area->asbr_count = 0;
+
+  memset (&walk, 0, sizeof (walk));
+  walk.vertices = XMALLOC (MTYPE_TMP, area->spf_vertices->count
+                                      * sizeof (struct vertex *));
+  hash_iterate (area->spf_vertices, ospf_spf_collect_vertex, &walk);
+  qsort (walk.vertices, walk.count, sizeof (struct vertex *),
+         ospf_vertex_sort_cmp);
+
+  for (i = 0; i < walk.count; i++)
+    {
+      v = walk.vertices[i];
+      UNSET_FLAG (v->flags, OSPF_VERTEX_PROCESSED);
+
+      if (v->type == OSPF_VERTEX_ROUTER
+          && IS_ROUTER_LSA_VIRTUAL ((struct router_lsa *) v->lsa))
+        area->transit = OSPF_TRANSIT_TRUE;
+
+      if (v == area->spf)
+        continue;
+      if (v->type == OSPF_VERTEX_ROUTER)
+        ospf_intra_add_router (new_rtrs, v, area);
+      else
+        ospf_intra_add_transit (new_table, v, area);
+    }
+  XFREE (MTYPE_TMP, walk.vertices);
+
+  ospf_spf_process_stubs (area, area->spf, new_table, 0);
+}
+
+/* Calculate an area's part of the routing table, from the tree kept
+ * since the last run where that will do.  Returns the kind of
+ * calculation done, or TYPE if that was a more thorough one.
+ */
+static int
+ospf_spf_area (struct ospf_area *area, struct route_table *new_table,
+               struct route_table *new_rtrs, int full, int type)
+{
+  int done = -1;
+
+  if (! full)
+    done = ospf_spf_incremental (area);
+
+  if (done < 0)
+    {
+      ospf_spf_calculate (area, new_table, new_rtrs);
+      return OSPF_SPF_FULL;
+    }
+
+  ospf_spf_replay (area, new_table, new_rtrs);
+  if (done == OSPF_SPF_INCREMENTAL)
+    area->spf_calculation++;
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &area->ospf->ts_spf);
+
+  return done < type ? done : type;
+}
+
+/* Whether two routes to the same destination agree, their paths taken
+ * in any order.
+ */
+static int
+ospf_spf_route_same (struct ospf_route *a, struct ospf_route *b)
+{
+  struct listnode *node;
+  struct ospf_path *path;
+
+  if (a->type != b->type || a->path_type != b->path_type
+      || a->cost != b->cost
+      || ! IPV4_ADDR_SAME (&a->u.std.area_id, &b->u.std.area_id)
+      || a->u.std.flags != b->u.std.flags
+      || listcount (a->paths) != listcount (b->paths))
+    return 0;
+
+  for (ALL_LIST_ELEMENTS_RO (a->paths, node, path))
+    if (ospf_path_lookup (b->paths, path) == NULL)
+      return 0;
+  return 1;
+}
+
+/* Log and count the destinations of table A that table B does not have
+ * the same routes for, or, with PRESENCE, has no routes for at all.
+ * Router tables hold a list of routes per destination, one per area.
+ */
+static unsigned int
+ospf_spf_table_diff (struct route_table *a, struct route_table *b,
+                     int rtrs, int presence)
+{
+  struct route_node *rn, *rn2;
+  struct listnode *node, *node2;
+  struct ospf_route *or, *or2;
+  unsigned int diffs = 0;
+  int same;
+  char buf[INET_ADDRSTRLEN];
+
+  for (rn = route_top (a); rn; rn = route_next (rn))
+    {
+      if (rn->info == NULL)
+        continue;
+
+      rn2 = route_node_lookup (b, &rn->p);
+      if (rn2)
+        route_unlock_node (rn2);
+
+      same = rn2 && rn2->info;
+      if (same && ! presence && ! rtrs)
+        same = ospf_spf_route_same (rn->info, rn2->info);
+      else if (same && ! presence)
+        {
+          same = listcount ((struct list *) rn->info)
+                 == listcount ((struct list *) rn2->info);
+          for (ALL_LIST_ELEMENTS_RO ((struct list *) rn->info, node, or))
+            {
+              for (ALL_LIST_ELEMENTS_RO ((struct list *) rn2->info, node2,
+                                         or2))
+                if (ospf_spf_route_same (or, or2))
+                  break;
+              if (node2 == NULL)
+                same = 0;
+            }
+        }
+
+      if (! same)
+        {
+          zlog_warn ("SPF: %s %s/%d differs from full SPF",
+                     rtrs ? "router" : "network",
+                     inet_ntop (AF_INET, &rn->p.u.prefix4, buf, sizeof (buf)),
+                     rn->p.prefixlen);
+          diffs++;
+        }
+    }
+  return diffs;
+}
+
+/* Run a full SPF for AREA into TABLE and RTRS on the side, leaving the
+ * tree kept for the area as it is, and compare what the area has from
+ * the calculation just done with it.
+ */
+static unsigned int
+ospf_spf_check_area (struct ospf_area *area, struct route_table *table,
+                     struct route_table *rtrs)
+{
+  struct ospf_area kept = *area;
+  unsigned int diffs = 0;
+
+  area->spf = NULL;
+  area->spf_vertices = NULL;
+  area->spf_changes = NULL;
+
+  ospf_spf_calculate (area, table, rtrs);
+  if (area->transit != kept.transit
+      || area->shortcut_capability != kept.shortcut_capability
+      || area->abr_count != kept.abr_count
+      || area->asbr_count != kept.asbr_count)
+    {
+      zlog_warn ("SPF: area %s differs from full SPF: transit %d/%d, "
+                 "shortcut %d/%d, %u/%u ABRs, %u/%u ASBRs",
+                 inet_ntoa (area->area_id), kept.transit, area->transit,
+                 kept.shortcut_capability, area->shortcut_capability,
+                 kept.abr_count, area->abr_count,
+                 kept.asbr_count, area->asbr_count);
+      diffs++;
+    }
+  ospf_spf_tree_free (area);
+
+  area->spf = kept.spf;
+  area->spf_vertices = kept.spf_vertices;
+  area->spf_changes = kept.spf_changes;
+  area->spf_calculation = kept.spf_calculation;
+  area->transit = kept.transit;
+  area->shortcut_capability = kept.shortcut_capability;
+  area->abr_count = kept.abr_count;
+  area->asbr_count = kept.asbr_count;
+  return diffs;
+}
+
+/* With "debug ospf spf", check the intra-area routes a run which did
+ * not go full has made from the kept trees against those of a full SPF.
+ * The kept trees stay, so any drift over runs shows.
+ */
+static void
+ospf_spf_check (struct ospf *ospf, struct route_table *new_table,
+                struct route_table *new_rtrs)
+{
+  struct route_table *table, *rtrs;
+  struct ospf_area *area;
+  struct listnode *node;
+  unsigned int diffs = 0;
+
+  table = route_table_init ();
+  rtrs = route_table_init ();
+
+  /* In the order ospf_spf_calculate_timer goes in. */
+  for (ALL_LIST_ELEMENTS_RO (ospf->areas, node, area))
+    if (area != ospf->backbone)
+      diffs += ospf_spf_check_area (area, table, rtrs);
+  if (ospf->backbone)
+    diffs += ospf_spf_check_area (ospf->backbone, table, rtrs);
+
+  diffs += ospf_spf_table_diff (new_table, table, 0, 0);
+  diffs += ospf_spf_table_diff (table, new_table, 0, 1);
+  diffs += ospf_spf_table_diff (new_rtrs, rtrs, 1, 0);
+  diffs += ospf_spf_table_diff (rtrs, new_rtrs, 1, 1);
+
+  ospf->spf_checks++;
+  if (diffs)
+    ospf->spf_check_fails++;
+  zlog_debug ("SPF: checked against full SPF, %u differences", diffs);
+
+  ospf_route_table_free (table);
+  ospf_rtrs_free (rtrs);
+}
+
+const char *ospf_spf_type_str[OSPF_SPF_TYPE_MAX] =
+{
+  "full SPF",
+  "incremental SPF",
+  "partial route",
+};
+
+static void
+ospf_spf_stats_add (struct ospf *ospf, int type, struct timeval t)
+{
+  struct ospf_spf_stats *stats = &ospf->spf_stats[type];
+  unsigned long usec = t.tv_sec * 1000000UL + t.tv_usec;
+
+  stats->runs++;
+  stats->last = usec;
+  stats->total += usec;
+  if (usec > stats->max)
+    stats->max = usec;
+  ospf->spf_last_type = type;
+}
+
 /* Timer for SPF calculation. */
 static int
 ospf_spf_calculate_timer (struct thread *thread)
@@ -1227,12 +1813,21 @@ ospf_spf_calculate_timer (struct thread *thread)
   struct route_table *new_table, *new_rtrs;
   struct ospf_area *area;
   struct listnode *node, *nnode;
+  struct timeval start, stop;
+  int full, type = OSPF_SPF_PRC;
 
   if (IS_DEBUG_OSPF_EVENT)
     zlog_debug ("SPF: Timer (SPF calculation expire)");
 
   ospf->t_spf_calc = NULL;
 
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+
+  /* Virtual links take their nexthops from the trees of the transit
+     areas, which i-SPF does not follow up on. */
+  full = ospf->spf_full || listcount (ospf->vlinks) > 0;
+  ospf->spf_full = 0;
+
   /* Allocate new table tree. */
   new_table = route_table_init ();
   new_rtrs = route_table_init ();
@@ -1248,12 +1843,15 @@ ospf_spf_calculate_timer (struct thread *thread)
       if (ospf->backbone && ospf->backbone == area)
         continue;
       
-      ospf_spf_calculate (area, new_table, new_rtrs);
+      type = ospf_spf_area (area, new_table, new_rtrs, full, type);
     }
   
   /* SPF for backbone, if required */
   if (ospf->backbone)
-    ospf_spf_calculate (ospf->backbone, new_table, new_rtrs);
+    type = ospf_spf_area (ospf->backbone, new_table, new_rtrs, full, type);
+
+  if (IS_DEBUG_OSPF_SPF && ! full)
+    ospf_spf_check (ospf, new_table, new_rtrs);
   
   ospf_vl_shut_unapproved (ospf);
 
@@ -1288,16 +1886,20 @@ ospf_spf_calculate_timer (struct thread *thread)
   if (IS_OSPF_ABR (ospf))
     ospf_abr_task (ospf);
 
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &stop);
+  ospf_spf_stats_add (ospf, type, tv_sub (stop, start));
+
   if (IS_DEBUG_OSPF_EVENT)
-    zlog_debug ("SPF: calculation complete");
+    zlog_debug ("SPF: %s calculation complete in %lu usec",
+                ospf_spf_type_str[type], ospf->spf_stats[type].last);
 
   return 0;
 }
 
 /* Add schedule for SPF calculation.  To avoid frequenst SPF calc, we
    set timer for SPF calc. */
-void
-ospf_spf_calculate_schedule (struct ospf *ospf)
+static void
+ospf_spf_schedule (struct ospf *ospf)
 {
   unsigned long delay, elapsed, ht;
   struct timeval result;
@@ -1356,3 +1958,125 @@ ospf_spf_calculate_schedule (struct ospf *ospf)
   ospf->t_spf_calc =
     thread_add_timer_msec (master, ospf_spf_calculate_timer, ospf, delay);
 }
+
+/* Schedule a full SPF calculation, for changes other than to LSAs. */
+void
+ospf_spf_calculate_schedule (struct ospf *ospf)
+{
+  if (ospf == NULL)
+    return;
+
+  ospf->spf_full = 1;
+  ospf_spf_schedule (ospf);
+}
+
+/* The next link of a router-LSA from P on, other than to a stub. */
+static struct router_lsa_link *
+ospf_router_lsa_next_transit (u_char **p, u_char *lim)
+{
+  struct router_lsa_link *l;
+
+  while (*p < lim)
+    {
+      l = (struct router_lsa_link *) *p;
+      *p += (OSPF_ROUTER_LSA_LINK_SIZE +
+             (l->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE));
+      if (l->m[0].type != LSA_LINK_TYPE_STUB)
+        return l;
+    }
+  return NULL;
+}
+
+/* Whether two instances of a router-LSA have the same links other than
+   to stubs, in the same order and at the same cost.  The tree does not
+   change then, only routes to stubs may. */
+static int
+ospf_router_lsa_same_transit (struct ospf_lsa *old, struct ospf_lsa *new)
+{
+  u_char *p1, *p2, *lim1, *lim2;
+  struct router_lsa_link *l1, *l2;
+
+  if (IS_LSA_MAXAGE (old) || IS_LSA_MAXAGE (new))
+    return 0;
+
+  p1 = ((u_char *) old->data) + OSPF_LSA_HEADER_SIZE + 4;
+  lim1 = ((u_char *) old->data) + ntohs (old->data->length);
+  p2 = ((u_char *) new->data) + OSPF_LSA_HEADER_SIZE + 4;
+  lim2 = ((u_char *) new->data) + ntohs (new->data->length);
+
+  for (;;)
+    {
+      l1 = ospf_router_lsa_next_transit (&p1, lim1);
+      l2 = ospf_router_lsa_next_transit (&p2, lim2);
+      if (l1 == NULL || l2 == NULL)
+        return l1 == l2;
+      if (l1->m[0].tos_count != l2->m[0].tos_count
+          || memcmp (l1, l2, OSPF_ROUTER_LSA_LINK_SIZE
+                             + l1->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE))
+        return 0;
+    }
+}
+
+/* An LSA the routing table is calculated from changed, NEW replacing
+ * OLD, if there was one: note what the next run has to do about it, and
+ * schedule that.  A network-LSA, or a router-LSA whose links to routers
+ * and networks changed, moves vertices on the tree and is kept for
+ * i-SPF.  Changes to stubs or summary-LSAs need the routes done again
+ * but not the tree.
+ */
+void
+ospf_spf_lsa_changed (struct ospf *ospf, struct ospf_lsa *old,
+                      struct ospf_lsa *new)
+{
+  struct ospf_area *area = new->area;
+  struct listnode *node;
+  struct vertex *key;
+
+  switch (new->data->type)
+    {
+    case OSPF_ROUTER_LSA:
+    case OSPF_NETWORK_LSA:
+      /* Our own LSA received back is not used, see
+         ospf_router_lsa_install. */
+      if (IS_LSA_SELF (new) && CHECK_FLAG (new->flags, OSPF_LSA_RECEIVED))
+        return;
+
+      if (new->data->type == OSPF_ROUTER_LSA && old
+          && ospf_router_lsa_same_transit (old, new))
+        break;
+
+      if (area->spf_changes == NULL)
+        area->spf_changes = list_new ();
+
+      for (ALL_LIST_ELEMENTS_RO (area->spf_changes, node, key))
+        if (key->type == new->data->type
+            && IPV4_ADDR_SAME (&key->id, &new->data->id))
+          break;
+      if (node)
+        break;
+
+      if (listcount (area->spf_changes) >= OSPF_SPF_CHANGES_MAX)
+        {
+          ospf->spf_full = 1;
+          break;
+        }
+
+      /* Kept as the key of the vertex the LSA is for. */
+      key = XCALLOC (MTYPE_OSPF_SPF_CHANGE, sizeof (struct vertex));
+      key->type = new->data->type;
+      key->id = new->data->id;
+      listnode_add (area->spf_changes, key);
+      break;
+
+    case OSPF_SUMMARY_LSA:
+    case OSPF_ASBR_SUMMARY_LSA:
+      if (IS_LSA_SELF (new))
+        return;
+      break;
+
+    default:
+      return;
+    }
+
+  ospf_spf_schedule (ospf);
+}
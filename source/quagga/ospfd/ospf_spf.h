@@ -29,6 +29,9 @@
 
 /* values for vertex->flags */
 #define OSPF_VERTEX_PROCESSED      0x01
+#define OSPF_VERTEX_SPFTREE        0x02  /* settled on the tree */
+#define OSPF_VERTEX_AFFECTED       0x04  /* recalculated by i-SPF */
+#define OSPF_VERTEX_BOUNDARY       0x08  /* i-SPF restarts from it */
 
 /* The "root" is the node running the SPF calculation */
 
@@ -39,6 +42,7 @@ struct vertex
   u_char type;		/* copied from LSA header */
   struct in_addr id;	/* copied from LSA header */
   struct lsa_header *lsa; /* Router or Network LSA */
+  struct ospf_lsa *lsa_p; /* the LSA itself, locked while on the tree */
   int *stat;		/* Link to LSA status. */
   u_int32_t distance;	/* from root to this vertex */  
   struct list *parents;		/* list of parents in SPF tree */
@@ -50,6 +54,7 @@ struct vertex_nexthop
 {
   struct ospf_interface *oi;	/* output intf on root node */
   struct in_addr router;	/* router address to send to */
+  unsigned int lock;		/* parents sharing it */
 };
 
 struct vertex_parent
@@ -59,7 +64,15 @@ struct vertex_parent
   int backlink;			/* index back to parent for router-lsa's */
 };
 
+/* Most LSA changes seen between two SPF runs which i-SPF takes on. */
+#define OSPF_SPF_CHANGES_MAX 32
+
+extern const char *ospf_spf_type_str[];
+
 extern void ospf_spf_calculate_schedule (struct ospf *);
+extern void ospf_spf_lsa_changed (struct ospf *, struct ospf_lsa *,
+				  struct ospf_lsa *);
+extern void ospf_spf_tree_free (struct ospf_area *);
 extern void ospf_rtrs_free (struct route_table *);
 
 /* void ospf_spf_calculate_timer_add (); */
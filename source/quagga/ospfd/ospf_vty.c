@@ -2319,6 +2319,39 @@ ALIAS_DEPRECATED (no_ospf_timers_throttle_spf,
                   "Adjust routing timers\n"
                   "OSPF SPF timers\n")
 
+DEFUN (ospf_timers_pacing_flood,
+       ospf_timers_pacing_flood_cmd,
+       "timers pacing flood <0-100>",
+       "Adjust routing timers\n"
+       "Pacing timers\n"
+       "OSPF flooding pacing timer\n"
+       "Minimum interval (msec) between LS Update bursts on an interface\n")
+{
+  struct ospf *ospf = vty->index;
+  unsigned int pacing;
+
+  VTY_GET_INTEGER_RANGE ("flood pacing timer", pacing, argv[0], 0, 100);
+
+  ospf->flood_pacing = pacing;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf_timers_pacing_flood,
+       no_ospf_timers_pacing_flood_cmd,
+       "no timers pacing flood",
+       NO_STR
+       "Adjust routing timers\n"
+       "Pacing timers\n"
+       "OSPF flooding pacing timer\n")
+{
+  struct ospf *ospf = vty->index;
+
+  ospf->flood_pacing = OSPF_FLOOD_PACING_DEFAULT;
+
+  return CMD_SUCCESS;
+}
+
 DEFUN (ospf_neighbor,
        ospf_neighbor_cmd,
        "neighbor A.B.C.D",
@@ -2774,10 +2807,42 @@ DEFUN (show_ip_ospf,
     }
   else
     vty_out (vty, "has not been run%s", VTY_NEWLINE);
+  if (ospf->ts_spf.tv_sec || ospf->ts_spf.tv_usec)
+    {
+      int i;
+
+      vty_out (vty, " Last calculation was %s, took %lu usec%s",
+               ospf_spf_type_str[ospf->spf_last_type],
+               ospf->spf_stats[ospf->spf_last_type].last, VTY_NEWLINE);
+      for (i = 0; i < OSPF_SPF_TYPE_MAX; i++)
+        if (ospf->spf_stats[i].runs)
+          vty_out (vty, "   %s: %u runs, average %llu usec, maximum %lu usec%s",
+                   ospf_spf_type_str[i], ospf->spf_stats[i].runs,
+                   ospf->spf_stats[i].total / ospf->spf_stats[i].runs,
+                   ospf->spf_stats[i].max, VTY_NEWLINE);
+      if (ospf->spf_fallback)
+        vty_out (vty, "   incremental SPF fell back to full SPF %u times%s",
+                 ospf->spf_fallback, VTY_NEWLINE);
+      if (ospf->spf_checks)
+        vty_out (vty, "   checked against full SPF %u times, %u differed%s",
+                 ospf->spf_checks, ospf->spf_check_fails, VTY_NEWLINE);
+    }
   vty_out (vty, " SPF timer %s%s%s",
            (ospf->t_spf_calc ? "due in " : "is "),
            ospf_timer_dump (ospf->t_spf_calc, timebuf, sizeof (timebuf)),
            VTY_NEWLINE);
+
+  /* Show flooding pace and statistics. */
+  vty_out (vty, " Minimum interval between LS Update bursts %u millisec(s)%s",
+           ospf->flood_pacing, VTY_NEWLINE);
+  vty_out (vty, "   %lu LS Updates sent carrying %lu LSAs,"
+           " %lu bursts held back by pacing%s",
+           ospf->ls_upd_packets, ospf->ls_upd_lsas, ospf->ls_upd_paced,
+           VTY_NEWLINE);
+  vty_out (vty, "   %lu LSAs retransmitted, %lu neighbor retransmissions"
+           " queued in %lu shared entries%s",
+           ospf->ls_rxmt_lsas, ospf->ls_rxmt_pairs, ospf->ls_rxmt_entries,
+           VTY_NEWLINE);
   
   /* Show refresh parameters. */
   vty_out (vty, " Refresh timer %d secs%s",
@@ -8028,6 +8093,11 @@ ospf_config_write (struct vty *vty)
 	vty_out (vty, " timers throttle spf %d %d %d%s",
 		 ospf->spf_delay, ospf->spf_holdtime,
 		 ospf->spf_max_holdtime, VTY_NEWLINE);
+
+      /* Flood pacing print. */
+      if (ospf->flood_pacing != OSPF_FLOOD_PACING_DEFAULT)
+	vty_out (vty, " timers pacing flood %u%s",
+		 ospf->flood_pacing, VTY_NEWLINE);
       
       /* Max-metric router-lsa print */
       config_write_stub_router (vty, ospf);
@@ -8500,6 +8570,8 @@ ospf_vty_init (void)
   install_element (OSPF_NODE, &ospf_timers_spf_cmd);
   install_element (OSPF_NODE, &no_ospf_timers_spf_cmd);
   install_element (OSPF_NODE, &ospf_timers_throttle_spf_cmd);
+  install_element (OSPF_NODE, &ospf_timers_pacing_flood_cmd);
+  install_element (OSPF_NODE, &no_ospf_timers_pacing_flood_cmd);
   install_element (OSPF_NODE, &no_ospf_timers_throttle_spf_cmd);
   
   /* refresh timer commands */
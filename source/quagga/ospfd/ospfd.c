@@ -198,6 +198,8 @@ ospf_new (void)
   new->spf_max_holdtime = OSPF_SPF_MAX_HOLDTIME_DEFAULT;
   new->spf_hold_multiplier = 1;
 
+  new->flood_pacing = OSPF_FLOOD_PACING_DEFAULT;
+
   /* MaxAge init. */
   new->maxage_delay = OSFP_LSA_MAXAGE_REMOVE_DELAY_DEFAULT;
   new->maxage_lsa = list_new ();
@@ -597,6 +599,8 @@ ospf_area_free (struct ospf_area *area)
   struct route_node *rn;
   struct ospf_lsa *lsa;
 
+  ospf_spf_tree_free (area);
+
   /* Free LSDBs. */
   LSDB_LOOP (ROUTER_LSDB (area), rn, lsa)
     ospf_discard_from_db (area->ospf, area->lsdb, lsa);
@@ -90,6 +90,9 @@
 #define OSPF_SPF_HOLDTIME_DEFAULT           1000
 #define OSPF_SPF_MAX_HOLDTIME_DEFAULT	    10000
 
+/* OSPF flooding pace, msec between LS Update bursts on an interface. */
+#define OSPF_FLOOD_PACING_DEFAULT            33
+
 /* OSPF interface default values. */
 #define OSPF_OUTPUT_COST_DEFAULT           10
 #define OSPF_OUTPUT_COST_INFINITE	   UINT16_MAX
@@ -151,6 +154,21 @@ struct ospf_master
 #define OSPF_MASTER_SHUTDOWN (1 << 0) /* deferred-shutdown */  
 };
 
+/* Kinds of routing table calculation, see ospf_spf.c. */
+#define OSPF_SPF_FULL           0  /* Dijkstra from scratch */
+#define OSPF_SPF_INCREMENTAL    1  /* i-SPF of the subtrees changed */
+#define OSPF_SPF_PRC            2  /* partial route calculation only */
+#define OSPF_SPF_TYPE_MAX       3
+
+/* Statistics of one kind of calculation, times in microseconds. */
+struct ospf_spf_stats
+{
+  u_int32_t runs;
+  unsigned long last;
+  unsigned long max;
+  unsigned long long total;
+};
+
 /* OSPF instance structure. */
 struct ospf
 {
@@ -201,6 +219,8 @@ struct ospf
   unsigned int spf_holdtime;		/* SPF hold time. */
   unsigned int spf_max_holdtime;	/* SPF maximum-holdtime */
   unsigned int spf_hold_multiplier;	/* Adaptive multiplier for hold time */
+
+  unsigned int flood_pacing;		/* msec between LS Update bursts. */
   
   int default_originate;		/* Default information originate. */
 #define DEFAULT_ORIGINATE_NONE		0
@@ -243,6 +263,22 @@ struct ospf
   /* Time stamps. */
   struct timeval ts_spf;		/* SPF calculation time stamp. */
 
+  /* SPF calculation kind and statistics. */
+  int spf_full;				/* Next run must be a full SPF. */
+  int spf_last_type;			/* Kind of the last run. */
+  struct ospf_spf_stats spf_stats[OSPF_SPF_TYPE_MAX];
+  u_int32_t spf_fallback;		/* i-SPF runs that went full. */
+  u_int32_t spf_checks;			/* Runs checked by "debug ospf spf", */
+  u_int32_t spf_check_fails;		/* and those found to differ. */
+
+  /* Flooding statistics. */
+  unsigned long ls_upd_packets;		/* LS Updates sent. */
+  unsigned long ls_upd_lsas;		/* LSAs packed into them. */
+  unsigned long ls_upd_paced;		/* Bursts held back by pacing. */
+  unsigned long ls_rxmt_lsas;		/* LSAs retransmitted. */
+  unsigned long ls_rxmt_pairs;		/* Neighbor/LSA retransmit pairs. */
+  unsigned long ls_rxmt_entries;	/* Shared entries holding them. */
+
   struct list *maxage_lsa;              /* List of MaxAge LSA for deletion. */
   int redistribute;                     /* Num of redistributed protocols. */
 
@@ -429,8 +465,10 @@ struct ospf_area
 #define PREFIX_LIST_OUT(A)  (A)->plist_out.list
 #define PREFIX_NAME_OUT(A)  (A)->plist_out.name
 
-  /* Shortest Path Tree. */
+  /* Shortest Path Tree, kept between runs for i-SPF. */
   struct vertex *spf;
+  struct hash *spf_vertices;		/* Vertices on the tree. */
+  struct list *spf_changes;		/* Topology changes since. */
 
   /* Threads. */
   struct thread *t_stub_router;    /* Stub-router timer */
@@ -748,6 +748,8 @@ rip_interface_address_delete (int command, struct zclient *zclient,
 
 	}
 
+      /* Updates cached for the address go with it. */
+      rip_update_cache_flush (ifc->ifp->info);
       connected_free (ifc);
 
     }
@@ -2067,6 +2069,7 @@ rip_interface_new_hook (struct interface *ifp)
 static int
 rip_interface_delete_hook (struct interface *ifp)
 {
+  rip_update_cache_flush (ifp->info);
   XFREE (MTYPE_RIP_INTERFACE, ifp->info);
   ifp->info = NULL;
   return 0;
@@ -137,6 +137,7 @@ rip_offset_list_set (struct vty *vty, const char *alist, const char *direct_str,
     free (offset->direct[direct].alist_name);
   offset->direct[direct].alist_name = strdup (alist);
   offset->direct[direct].metric = metric;
+  rip_update_invalidate ();
 
   return CMD_SUCCESS;
 }
@@ -177,6 +178,7 @@ rip_offset_list_unset (struct vty *vty, const char *alist,
       if (offset->direct[direct].alist_name)
 	free (offset->direct[direct].alist_name);
       offset->direct[direct].alist_name = NULL;
+      rip_update_invalidate ();
 
       if (offset->direct[RIP_OFFSET_LIST_IN].alist_name == NULL &&
 	  offset->direct[RIP_OFFSET_LIST_OUT].alist_name == NULL)
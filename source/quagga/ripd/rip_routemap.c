@@ -158,8 +158,17 @@ rip_route_map_update (const char *notused)
 	    rip->route_map[i].map = 
 	      route_map_lookup_by_name (rip->route_map[i].name);
 	}
+      rip_update_invalidate ();
     }
 }
+
+/* Hook function for changes within a route-map: updates may come out
+   differently. */
+static void
+rip_route_map_event (route_map_event_t event, const char *name)
+{
+  rip_update_invalidate ();
+}
 
 /* `match metric METRIC' */
 /* Match function return 1 if match is success else return zero. */
@@ -1096,6 +1105,7 @@ rip_route_map_init ()
   route_map_init_vty ();
   route_map_add_hook (rip_route_map_update);
   route_map_delete_hook (rip_route_map_update);
+  route_map_event_hook (rip_route_map_event);
 
   route_map_install_match (&route_match_metric_cmd);
   route_map_install_match (&route_match_interface_cmd);
@@ -44,8 +44,10 @@
 #include "ripd/ripd.h"
 #include "ripd/rip_debug.h"
 
-/* UDP receive buffer size */
-#define RIP_UDP_RCV_BUF 41600
+/* UDP receive buffer size.  Room for a few thousand packets, as a
+   neighbour sending its update out of the cache writes a large table
+   back to back. */
+#define RIP_UDP_RCV_BUF (1024 * 1024)
 
 /* privileges global */
 extern struct zebra_privs_t ripd_privs;
@@ -121,6 +123,28 @@ rip_info_free (struct rip_info *rinfo)
   XFREE (MTYPE_RIP_INFO, rinfo);
 }
 
+/* Anything that may change the contents of an update, routes or
+   configuration, must call this so cached packets are built again. */
+void
+rip_update_invalidate (void)
+{
+  if (rip)
+    rip->update_gen++;
+}
+
+/* Set the route change flag, and note the route for the triggered
+   update so that it need not look through the whole table. */
+static void
+rip_route_changed (struct rip_info *rinfo)
+{
+  rip_update_invalidate ();
+
+  if (CHECK_FLAG (rinfo->flags, RIP_RTF_CHANGED))
+    return;
+  SET_FLAG (rinfo->flags, RIP_RTF_CHANGED);
+  listnode_add (rip->changed, route_lock_node (rinfo->rp));
+}
+
 /* RIP route garbage collect timer. */
 static int
 rip_garbage_collect (struct thread *t)
@@ -144,6 +168,8 @@ rip_garbage_collect (struct thread *t)
   /* Free RIP routing information. */
   rip_info_free (rinfo);
 
+  rip_update_invalidate ();
+
   return 0;
 }
 
@@ -172,7 +198,7 @@ rip_timeout (struct thread *t)
 
   /* - The route change flag is to indicate that this entry has been
      changed. */
-  rinfo->flags |= RIP_RTF_CHANGED;
+  rip_route_changed (rinfo);
 
   /* - The output process is signalled to trigger a response. */
   rip_event (RIP_TRIGGERED_UPDATE, 0);
@@ -542,7 +568,7 @@ rip_rte_process (struct rte *rte, struct sockaddr_in *from,
           rip_timeout_update (rinfo);
 
           /* - Set the route change flag. */
-          rinfo->flags |= RIP_RTF_CHANGED;
+          rip_route_changed (rinfo);
 
           /* - Signal the output process to trigger an update (see section
              2.5). */
@@ -648,7 +674,7 @@ rip_rte_process (struct rte *rte, struct sockaddr_in *from,
 
           /* - Set the route change flag and signal the output process
              to trigger an update. */
-          rinfo->flags |= RIP_RTF_CHANGED;
+          rip_route_changed (rinfo);
           rip_event (RIP_TRIGGERED_UPDATE, 0);
 
           /* - If the new metric is infinity, start the deletion
@@ -1401,6 +1427,52 @@ rip_create_socket (struct sockaddr_in *from)
   return sock;
 }
 
+/* Socket for multicast sends from an interface address.  We have to
+ * open one per source address because this is the most portable way
+ * to bind to a different source ipv4 address for each packet.
+ */
+static int
+rip_multicast_socket (struct connected *ifc)
+{
+  struct sockaddr_in from;
+  int sock;
+
+  /* multicast send should bind to local interface address */
+  memset (&from, 0, sizeof (struct sockaddr_in));
+  from.sin_family = AF_INET;
+  from.sin_port = htons (RIP_PORT_DEFAULT);
+  from.sin_addr = ifc->address->u.prefix4;
+#ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
+  from.sin_len = sizeof (struct sockaddr_in);
+#endif /* HAVE_STRUCT_SOCKADDR_IN_SIN_LEN */
+
+  if ( (sock = rip_create_socket (&from)) < 0)
+    return -1;
+  rip_interface_multicast_set (sock, ifc);
+  return sock;
+}
+
+/* While an update goes out on an interface its multicast socket is
+   held open, rather than opened and closed again for every packet. */
+static int rip_send_sock = -1;
+static struct connected *rip_send_sock_ifc;
+
+static void
+rip_send_sock_hold (struct connected *ifc)
+{
+  rip_send_sock = rip_multicast_socket (ifc);
+  rip_send_sock_ifc = ifc;
+}
+
+static void
+rip_send_sock_release (void)
+{
+  if (rip_send_sock >= 0)
+    close (rip_send_sock);
+  rip_send_sock = -1;
+  rip_send_sock_ifc = NULL;
+}
+
 /* RIP packet send to destination address, on interface denoted by
  * by connected argument. NULL to argument denotes destination should be
  * should be RIP multicast group
@@ -1469,30 +1541,16 @@ rip_send_packet (u_char * buf, int size, struct sockaddr_in *to,
     }
   else
     {
-      struct sockaddr_in from;
-      
       sin.sin_port = htons (RIP_PORT_DEFAULT);
       sin.sin_addr.s_addr = htonl (INADDR_RIP_GROUP);
       
-      /* multicast send should bind to local interface address */
-      from.sin_family = AF_INET;
-      from.sin_port = htons (RIP_PORT_DEFAULT);
-      from.sin_addr = ifc->address->u.prefix4;
-#ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
-      from.sin_len = sizeof (struct sockaddr_in);
-#endif /* HAVE_STRUCT_SOCKADDR_IN_SIN_LEN */
-      
-      /*
-       * we have to open a new socket for each packet because this
-       * is the most portable way to bind to a different source
-       * ipv4 address for each packet. 
-       */
-      if ( (send_sock = rip_create_socket (&from)) < 0)
+      if (rip_send_sock >= 0 && rip_send_sock_ifc == ifc)
+        send_sock = rip_send_sock;
+      else if ( (send_sock = rip_multicast_socket (ifc)) < 0)
         {
           zlog_warn("rip_send_packet could not create socket.");
           return -1;
         }
-      rip_interface_multicast_set (send_sock, ifc);
     }
 
   ret = sendto (send_sock, buf, size, 0, (struct sockaddr *)&sin,
@@ -1505,7 +1563,7 @@ rip_send_packet (u_char * buf, int size, struct sockaddr_in *to,
   if (ret < 0)
     zlog_warn ("can't send packet : %s", safe_strerror (errno));
 
-  if (!to)
+  if (!to && send_sock != rip_send_sock)
     close(send_sock);
 
   return ret;
@@ -1581,7 +1639,7 @@ rip_redistribute_add (int type, int sub_type, struct prefix_ipv4 *p,
   rinfo->flags |= RIP_RTF_FIB;
   rp->info = rinfo;
 
-  rinfo->flags |= RIP_RTF_CHANGED;
+  rip_route_changed (rinfo);
 
   if (IS_RIP_DEBUG_EVENT) {
     if (!nexthop)
@@ -1626,7 +1684,7 @@ rip_redistribute_delete (int type, int sub_type, struct prefix_ipv4 *p,
 	  RIP_TIMER_ON (rinfo->t_garbage_collect, 
 			rip_garbage_collect, rip->garbage_time);
 	  RIP_TIMER_OFF (rinfo->t_timeout);
-	  rinfo->flags |= RIP_RTF_CHANGED;
+	  rip_route_changed (rinfo);
 
           if (IS_RIP_DEBUG_EVENT)
             zlog_debug ("Poisone %s/%d on the interface %s with an infinity metric [delete]",
@@ -2130,6 +2188,83 @@ rip_write_rte (int num, struct stream *s, struct prefix_ipv4 *p,
   return ++num;
 }
 
+/* Drop the cached update packets of an interface. */
+void
+rip_update_cache_flush (struct rip_interface *ri)
+{
+  struct listnode *node, *nnode;
+  struct rip_update_cache *cache;
+
+  if (! ri->update_cache)
+    return;
+
+  for (ALL_LIST_ELEMENTS (ri->update_cache, node, nnode, cache))
+    {
+      list_delete (cache->packets);
+      XFREE (MTYPE_RIP_UPDATE_CACHE, cache);
+    }
+  list_delete (ri->update_cache);
+  ri->update_cache = NULL;
+}
+
+static struct rip_update_cache *
+rip_update_cache_get (struct rip_interface *ri, struct connected *ifc,
+		      u_char version)
+{
+  struct listnode *node;
+  struct rip_update_cache *cache;
+
+  if (! ri->update_cache)
+    ri->update_cache = list_new ();
+
+  for (ALL_LIST_ELEMENTS_RO (ri->update_cache, node, cache))
+    if (cache->ifc == ifc && cache->version == version)
+      return cache;
+
+  cache = XCALLOC (MTYPE_RIP_UPDATE_CACHE, sizeof (struct rip_update_cache));
+  cache->ifc = ifc;
+  cache->version = version;
+  cache->packets = list_new ();
+  cache->packets->del = (void (*) (void *)) stream_free;
+  listnode_add (ri->update_cache, cache);
+  return cache;
+}
+
+/* Whether the packets were built for the routes and settings of now. */
+static int
+rip_update_cache_valid (struct rip_update_cache *cache,
+			struct rip_interface *ri, struct connected *ifc)
+{
+  return (cache->update_gen == rip->update_gen
+	  && cache->ifindex == ifc->ifp->ifindex
+	  && cache->split_horizon == ri->split_horizon
+	  && prefix_same (&cache->address, ifc->address));
+}
+
+static void
+rip_update_cache_reset (struct rip_update_cache *cache,
+			struct rip_interface *ri, struct connected *ifc)
+{
+  list_delete_all_node (cache->packets);
+  cache->update_gen = rip->update_gen;
+  cache->ifindex = ifc->ifp->ifindex;
+  cache->split_horizon = ri->split_horizon;
+  prefix_copy (&cache->address, ifc->address);
+}
+
+/* Next route an update goes through: the next in the table for a
+   full update, the next in the journal for a triggered one. */
+static struct route_node *
+rip_output_next (struct route_node *rp, int route_type,
+		 struct listnode **jnode)
+{
+  if (route_type != rip_changed_route)
+    return route_next (rp);
+
+  *jnode = listnextnode (*jnode);
+  return *jnode ? listgetdata (*jnode) : NULL;
+}
+
 /* Send update to the ifp or spcified neighbor. */
 void
 rip_output_process (struct connected *ifc, struct sockaddr_in *to, 
@@ -2151,6 +2286,10 @@ rip_output_process (struct connected *ifc, struct sockaddr_in *to,
   int num = 0;
   int rtemax;
   int subnetted = 0;
+  struct rip_update_cache *cache = NULL;
+  struct listnode *jnode = NULL;
+  int stats = (route_type == rip_changed_route ? RIP_UPDATE_TRIGGERED
+						: RIP_UPDATE_PERIODIC);
 
   /* Logging output event. */
   if (IS_RIP_DEBUG_EVENT)
@@ -2171,6 +2310,36 @@ rip_output_process (struct connected *ifc, struct sockaddr_in *to,
 
   /* Get RIP interface. */
   ri = ifc->ifp->info;
+
+  /* Multicast packets of the update all go out on one socket. */
+  if (to == NULL && ! CHECK_FLAG (ifc->flags, ZEBRA_IFA_SECONDARY)
+      && (route_type == rip_all_route || listcount (rip->changed)))
+    rip_send_sock_hold (ifc);
+
+  /* Send the full update as built last time, if nothing it depends
+     on changed since. */
+  if (route_type == rip_all_route && ri->auth_type == RIP_NO_AUTH)
+    {
+      cache = rip_update_cache_get (ri, ifc, version);
+      if (rip_update_cache_valid (cache, ri, ifc))
+	{
+	  struct listnode *node;
+
+	  for (ALL_LIST_ELEMENTS_RO (cache->packets, node, s))
+	    {
+	      ret = rip_send_packet (STREAM_DATA (s), stream_get_endp (s),
+				     to, ifc);
+	      if (ret >= 0 && IS_RIP_DEBUG_SEND)
+		rip_packet_dump ((struct rip_packet *)STREAM_DATA (s),
+				 stream_get_endp (s), "SEND");
+	      rip->update_stats[stats].cached++;
+	    }
+	  rip_send_sock_release ();
+	  ri->sent_updates++;
+	  return;
+	}
+      rip_update_cache_reset (cache, ri, ifc);
+    }
     
   /* If output interface is in simple password authentication mode, we
      need space for authentication data.  */
@@ -2207,9 +2376,19 @@ rip_output_process (struct connected *ifc, struct sockaddr_in *to,
         subnetted = 1;
     }
 
-  for (rp = route_top (rip->table); rp; rp = route_next (rp))
+  if (route_type == rip_changed_route)
+    {
+      jnode = listhead (rip->changed);
+      rp = jnode ? listgetdata (jnode) : NULL;
+    }
+  else
+    rp = route_top (rip->table);
+
+  for (; rp; rp = rip_output_next (rp, route_type, &jnode))
     if ((rinfo = rp->info) != NULL)
       {
+	rip->update_stats[stats].routes++;
+
 	/* For RIPv1, if we are subnetted, output subnets in our network    */
 	/* that have the same mask as the output "interface". For other     */
 	/* networks, only the classfull version is output.                  */
@@ -2249,11 +2428,6 @@ rip_output_process (struct connected *ifc, struct sockaddr_in *to,
 	if (ret < 0)
 	  continue;
 
-	/* Changed route only output. */
-	if (route_type == rip_changed_route &&
-	    (! (rinfo->flags & RIP_RTF_CHANGED)))
-	  continue;
-
 	/* Split horizon. */
 	/* if (split_horizon == rip_split_horizon) */
 	if (ri->split_horizon == RIP_SPLIT_HORIZON)
@@ -2400,6 +2574,9 @@ rip_output_process (struct connected *ifc, struct sockaddr_in *to,
 	    if (ret >= 0 && IS_RIP_DEBUG_SEND)
 	      rip_packet_dump ((struct rip_packet *)STREAM_DATA (s),
 			       stream_get_endp(s), "SEND");
+	    if (cache)
+	      listnode_add (cache->packets, stream_dup (s));
+	    rip->update_stats[stats].built++;
 	    num = 0;
 	    stream_reset (s);
 	  }
@@ -2416,9 +2593,13 @@ rip_output_process (struct connected *ifc, struct sockaddr_in *to,
       if (ret >= 0 && IS_RIP_DEBUG_SEND)
 	rip_packet_dump ((struct rip_packet *)STREAM_DATA (s),
 			 stream_get_endp (s), "SEND");
+      if (cache)
+	listnode_add (cache->packets, stream_dup (s));
+      rip->update_stats[stats].built++;
       num = 0;
       stream_reset (s);
     }
+  rip_send_sock_release ();
 
   /* Statistics updates. */
   ri->sent_updates++;
@@ -2470,6 +2651,19 @@ rip_update_interface (struct connected *ifc, u_char version, int route_type)
     }
 }
 
+static void
+rip_update_stats_add (int type, struct timeval start, struct timeval stop)
+{
+  unsigned long usec;
+
+  usec = (stop.tv_sec - start.tv_sec) * 1000000UL
+	 + stop.tv_usec - start.tv_usec;
+  rip->update_stats[type].runs++;
+  rip->update_stats[type].usec += usec;
+  if (usec > rip->update_stats[type].usec_max)
+    rip->update_stats[type].usec_max = usec;
+}
+
 /* Update send to all interface and neighbor. */
 static void
 rip_update_process (int route_type)
@@ -2482,6 +2676,9 @@ rip_update_process (int route_type)
   struct route_node *rp;
   struct sockaddr_in to;
   struct prefix_ipv4 *p;
+  struct timeval start, stop;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
 
   /* Send RIP update to each interface. */
   for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
@@ -2556,6 +2753,11 @@ rip_update_process (int route_type)
 	/* RIP version is rip's configuration. */
 	rip_output_process (connected, &to, route_type, rip->version_send);
       }
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &stop);
+  rip_update_stats_add (route_type == rip_changed_route ?
+			RIP_UPDATE_TRIGGERED : RIP_UPDATE_PERIODIC,
+			start, stop);
 }
 
 /* RIP's periodical timer. */
@@ -2586,17 +2788,41 @@ rip_update (struct thread *t)
   return 0;
 }
 
-/* Walk down the RIP routing table then clear changed flag. */
+/* Reduce the journal to the routes a triggered update is to carry:
+   those still in the table and flagged changed, once each.  The flags
+   are cleared as the routes are taken, as the update is going out. */
 static void
-rip_clear_changed_flag (void)
+rip_changed_collect (void)
 {
+  struct listnode *node, *nnode;
   struct route_node *rp;
   struct rip_info *rinfo;
 
-  for (rp = route_top (rip->table); rp; rp = route_next (rp))
-    if ((rinfo = rp->info) != NULL)
-      if (rinfo->flags & RIP_RTF_CHANGED)
-	rinfo->flags &= ~RIP_RTF_CHANGED;
+  for (ALL_LIST_ELEMENTS (rip->changed, node, nnode, rp))
+    {
+      rinfo = rp->info;
+      if (rinfo && CHECK_FLAG (rinfo->flags, RIP_RTF_CHANGED))
+	{
+	  UNSET_FLAG (rinfo->flags, RIP_RTF_CHANGED);
+	  continue;
+	}
+      list_delete_node (rip->changed, node);
+      route_unlock_node (rp);
+    }
+}
+
+/* Empty the journal. */
+static void
+rip_changed_clear (void)
+{
+  struct listnode *node, *nnode;
+  struct route_node *rp;
+
+  for (ALL_LIST_ELEMENTS (rip->changed, node, nnode, rp))
+    {
+      list_delete_node (rip->changed, node);
+      route_unlock_node (rp);
+    }
 }
 
 /* Triggered update interval timer. */
@@ -2638,11 +2864,13 @@ rip_triggered_update (struct thread *t)
 
   /* Split Horizon processing is done when generating triggered
      updates as well as normal updates (see section 2.6). */
+  rip_changed_collect ();
   rip_update_process (rip_changed_route);
 
   /* Once all of the triggered updates have been generated, the route
-     change flags should be cleared. */
-  rip_clear_changed_flag ();
+     change flags should be cleared.  They were as the journal was
+     collected. */
+  rip_changed_clear ();
 
   /* After a triggered update is sent, a timer should be set for a
    random interval between 1 and 5 seconds.  If other changes that
@@ -2677,7 +2905,7 @@ rip_redistribute_withdraw (int type)
 	    RIP_TIMER_ON (rinfo->t_garbage_collect, 
 			  rip_garbage_collect, rip->garbage_time);
 	    RIP_TIMER_OFF (rinfo->t_timeout);
-	    rinfo->flags |= RIP_RTF_CHANGED;
+	    rip_route_changed (rinfo);
 
 	    if (IS_RIP_DEBUG_EVENT) {
               struct prefix_ipv4 *p = (struct prefix_ipv4 *) &rp->p;
@@ -2714,6 +2942,11 @@ rip_create (void)
   /* Make output stream. */
   rip->obuf = stream_new (1500);
 
+  /* Changed route journal.  Cached update packets are of generation
+     0, older than any. */
+  rip->changed = list_new ();
+  rip->update_gen = 1;
+
   /* Make socket. */
   rip->sock = rip_create_socket (NULL);
   if (rip->sock < 0)
@@ -2999,7 +3232,7 @@ DEFUN (rip_default_metric,
   if (rip)
     {
       rip->default_metric = atoi (argv[0]);
-      /* rip_update_default_metric (); */
+      rip_update_invalidate ();
     }
   return CMD_SUCCESS;
 }
@@ -3014,7 +3247,7 @@ DEFUN (no_rip_default_metric,
   if (rip)
     {
       rip->default_metric = RIP_DEFAULT_METRIC_DEFAULT;
-      /* rip_update_default_metric (); */
+      rip_update_invalidate ();
     }
   return CMD_SUCCESS;
 }
@@ -3509,6 +3742,7 @@ DEFUN (show_ip_rip_status,
   extern const struct message ri_version_msg[];
   const char *send_version;
   const char *receive_version;
+  int i;
 
   if (! rip)
     return CMD_SUCCESS;
@@ -3543,6 +3777,21 @@ DEFUN (show_ip_rip_status,
     vty_out (vty, " receive version %s %s",
 	     lookup(ri_version_msg,rip->version_recv), VTY_NEWLINE);
 
+  /* Update output statistics. */
+  for (i = RIP_UPDATE_PERIODIC; i <= RIP_UPDATE_TRIGGERED; i++)
+    {
+      unsigned long runs = rip->update_stats[i].runs;
+
+      vty_out (vty, "  %s updates: %lu, %lu usec average, %lu usec max,%s",
+	       i == RIP_UPDATE_PERIODIC ? "Periodic" : "Triggered", runs,
+	       runs ? rip->update_stats[i].usec / runs : 0,
+	       rip->update_stats[i].usec_max, VTY_NEWLINE);
+      vty_out (vty, "    %lu routes looked at, %lu packets built,"
+	       " %lu sent from cache%s",
+	       rip->update_stats[i].routes, rip->update_stats[i].built,
+	       rip->update_stats[i].cached, VTY_NEWLINE);
+    }
+
   vty_out (vty, "    Interface        Send  Recv   Key-chain%s", VTY_NEWLINE);
 
   for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
@@ -3704,6 +3953,8 @@ rip_distribute_update (struct distribute *dist)
   struct access_list *alist;
   struct prefix_list *plist;
 
+  rip_update_invalidate ();
+
   if (! dist->ifname)
     return;
 
@@ -3776,6 +4027,8 @@ rip_distribute_update_all (struct prefix_list *notused)
   struct interface *ifp;
   struct listnode *node, *nnode;
 
+  rip_update_invalidate ();
+
   for (ALL_LIST_ELEMENTS (iflist, node, nnode, ifp))
     rip_distribute_update_interface (ifp);
 }
@@ -3793,9 +4046,17 @@ rip_clean (void)
   int i;
   struct route_node *rp;
   struct rip_info *rinfo;
+  struct listnode *node;
+  struct interface *ifp;
 
   if (rip)
     {
+      /* Release the changed route journal and the update packets. */
+      rip_changed_clear ();
+      list_delete (rip->changed);
+      for (ALL_LIST_ELEMENTS_RO (iflist, node, ifp))
+	rip_update_cache_flush (ifp->info);
+
       /* Clear RIP routes */
       for (rp = route_top (rip->table); rp; rp = route_next (rp))
 	if ((rinfo = rp->info) != NULL)
@@ -3905,6 +4166,8 @@ rip_if_rmap_update (struct if_rmap *if_rmap)
   struct rip_interface *ri;
   struct route_map *rmap;
 
+  rip_update_invalidate ();
+
   ifp = if_lookup_by_name (if_rmap->ifname);
   if (ifp == NULL)
     return;
@@ -3967,6 +4230,8 @@ rip_routemap_update (const char *notused)
   struct interface *ifp;
   struct listnode *node, *nnode;
 
+  rip_update_invalidate ();
+
   for (ALL_LIST_ELEMENTS (iflist, node, nnode, ifp))
     rip_if_rmap_update_interface (ifp);
 
@@ -151,6 +151,27 @@ struct rip
     int metric_config;
     u_int32_t metric;
   } route_map[ZEBRA_ROUTE_MAX];
+
+  /* Routes changed since the last triggered update, each node locked
+     once.  The triggered update sends just these. */
+  struct list *changed;
+
+  /* Bumped whenever what an update carries may have changed, which
+     makes the interfaces' cached update packets stale. */
+  unsigned long update_gen;
+
+  /* Output statistics, periodic and triggered. */
+#define RIP_UPDATE_PERIODIC  0
+#define RIP_UPDATE_TRIGGERED 1
+  struct
+  {
+    unsigned long runs;
+    unsigned long usec;
+    unsigned long usec_max;
+    unsigned long routes;
+    unsigned long built;
+    unsigned long cached;
+  } update_stats[2];
 };
 
 /* RIP routing table entry which belong to rip_packet. */
@@ -293,6 +314,28 @@ struct rip_interface
 
   /* Passive interface. */
   int passive;
+
+  /* Encoded periodic update packets, struct rip_update_cache. */
+  struct list *update_cache;
+};
+
+/* The packets of a periodic update as last built for a connected
+   address and RIP version.  They are sent again as they are while
+   rip->update_gen and the interface settings they depend on are
+   unchanged.  Only kept for interfaces without authentication, whose
+   packets would carry a sequence number or a key of the moment. */
+struct rip_update_cache
+{
+  struct connected *ifc;
+  u_char version;
+
+  unsigned long update_gen;
+  unsigned int ifindex;
+  split_horizon_policy_t split_horizon;
+  struct prefix address;
+
+  /* struct stream *, one per packet. */
+  struct list *packets;
 };
 
 /* RIP peer information. */
@@ -424,6 +467,8 @@ extern int rip_offset_list_apply_out (struct prefix_ipv4 *, struct interface *,
 extern void rip_offset_clean (void);
 
 extern void rip_info_free (struct rip_info *);
+extern void rip_update_invalidate (void);
+extern void rip_update_cache_flush (struct rip_interface *);
 extern u_char rip_distance_apply (struct rip_info *);
 extern void rip_redistribute_clean (void);
 extern void rip_ifaddr_add (struct interface *, struct connected *);
@@ -1213,7 +1213,7 @@ handle_attr_test (struct aspath_tests *t)
   stream_write (peer.ibuf, t->attrheader, t->len);
   datalen = aspath_put (peer.ibuf, asp, t->as4 == AS4_DATA);
   
-  ret = bgp_attr_parse (&peer, &attr, t->len + datalen, NULL, NULL);
+  ret = bgp_attr_parse (&peer, &attr, t->len + datalen, NULL, NULL, NULL);
   
   if (ret != t->result)
     {
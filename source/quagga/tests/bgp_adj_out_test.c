@@ -0,0 +1,540 @@
+/*
+ * BGP Adj-RIB-Out sharing test.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* One eBGP peer sends a number of IPv4 prefixes (by default 1000)
+ * through bgp_update_receive, and they are announced to three more
+ * eBGP peers, each with a socketpair for a socket.  The first two are
+ * sent the same attribute, the third another next hop.  The sockets
+ * are only written by send_updates, as if they were full until then,
+ * so that what is pending can be looked at.
+ *
+ * Once sent, the adjacencies of the first two must be folded into one
+ * shared entry per prefix, and those of the third into one of its own.
+ * A new path for half of the prefixes must move them back out until
+ * it is sent, and a withdraw of a quarter must take them out for good.
+ * Clearing a peer must take only its bits, and once every peer is
+ * cleared no adjacency nor any peer reference must be left.
+ *
+ * Route server clients are not covered: an RS-client table is its
+ * client's alone, so a node there never has another peer to share
+ * with.
+ *
+ * usage: testbgpadjout [prefixes]
+ */
+#include <zebra.h>
+
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "prefix.h"
+#include "thread.h"
+#include "workqueue.h"
+#include "if.h"
+#include "sockunion.h"
+#include "network.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_fsm.h"
+
+/* need these to link in libbgp; bgp_get opens the listen socket */
+struct zebra_privs_t bgpd_privs;
+struct thread_master *master = NULL;
+
+static as_t asn = 100;
+
+#define PREFIXES_PER_PATH 4
+#define PREFIXES_PER_WITHDRAW 500
+
+#define RECEIVERS 3
+
+static struct peer *source;
+static struct peer *receivers[RECEIVERS];
+static int sinks[RECEIVERS];
+
+static int failed;
+
+#define CHECK(C, ...) \
+  do { \
+    if (! (C)) \
+      { \
+	printf ("FAILED %s:%d: ", __FILE__, __LINE__); \
+	printf (__VA_ARGS__); \
+	printf ("\n"); \
+	failed++; \
+      } \
+  } while (0)
+
+/* Adjacencies of the table: private ones, shared entries and the bits
+   set in them.  */
+struct adj_count
+{
+  unsigned long adj;
+  unsigned long shared;
+  unsigned long bits;
+};
+
+static void
+put_prefix (struct stream *s, int n)
+{
+  stream_putc (s, 24);
+  stream_putc (s, 16 + (n >> 16));
+  stream_putc (s, n >> 8);
+  stream_putc (s, n);
+}
+
+/* One UPDATE from the source for prefixes first to first + count - 1,
+   with the second AS of the path telling which generation it is.  */
+static void
+build_update (struct stream *s, int gen, int first, int count)
+{
+  size_t apos;
+  int n;
+
+  stream_reset (s);
+
+  /* No withdrawn routes.  */
+  stream_putw (s, 0);
+
+  apos = stream_get_endp (s);
+  stream_putw (s, 0);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_ORIGIN);
+  stream_putc (s, 1);
+  stream_putc (s, BGP_ORIGIN_IGP);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_AS_PATH);
+  stream_putc (s, 8);
+  stream_putc (s, AS_SEQUENCE);
+  stream_putc (s, 3);
+  stream_putw (s, 200);
+  stream_putw (s, 5000 + gen);
+  stream_putw (s, 20000 + first / PREFIXES_PER_PATH);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_NEXT_HOP);
+  stream_putc (s, 4);
+  stream_putl (s, 0xc0000201);
+
+  /* This tree insists on MED and LOCAL_PREF, see bgp_attr_check.  */
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_MULTI_EXIT_DISC);
+  stream_putc (s, 4);
+  stream_putl (s, 0);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_LOCAL_PREF);
+  stream_putc (s, 4);
+  stream_putl (s, 100);
+
+  stream_putw_at (s, apos, stream_get_endp (s) - apos - 2);
+
+  for (n = first; n < first + count; n++)
+    put_prefix (s, n);
+}
+
+static void
+build_withdraw (struct stream *s, int first, int count)
+{
+  int n;
+
+  stream_reset (s);
+  stream_putw (s, count * 4);
+  for (n = first; n < first + count; n++)
+    put_prefix (s, n);
+  stream_putw (s, 0);
+}
+
+static int
+queued (struct work_queue *wq)
+{
+  return wq && listcount (wq->items);
+}
+
+/* Let bgp_process and the clearing of peers run over everything
+   queued, without writing to the receivers.  */
+static void
+settle (void)
+{
+  struct thread thread;
+  int r, busy;
+
+  for (;;)
+    {
+      busy = queued (bm->process_main_queue) | queued (source->clear_node_queue);
+      for (r = 0; r < RECEIVERS; r++)
+	{
+	  BGP_WRITE_OFF (receivers[r]->t_write);
+	  busy |= queued (receivers[r]->clear_node_queue);
+	}
+      if (! busy || ! thread_fetch (master, &thread))
+	break;
+      thread_call (&thread);
+    }
+  for (r = 0; r < RECEIVERS; r++)
+    BGP_WRITE_OFF (receivers[r]->t_write);
+}
+
+static void
+receive (void)
+{
+  struct thread thread;
+
+  bgp_update_receive (source, stream_get_endp (source->ibuf), NULL);
+
+  /* The Receive_UPDATE_message event, as the daemon would run it
+     straight away.  */
+  while (master->event.count && thread_fetch (master, &thread))
+    thread_call (&thread);
+}
+
+static void
+announce (int gen, int first, int count)
+{
+  int n;
+
+  for (n = first; n < first + count; n += PREFIXES_PER_PATH)
+    {
+      build_update (source->ibuf, gen, n,
+		    MIN (PREFIXES_PER_PATH, first + count - n));
+      receive ();
+    }
+  settle ();
+}
+
+static void
+withdraw (int first, int count)
+{
+  int n;
+
+  for (n = first; n < first + count; n += PREFIXES_PER_WITHDRAW)
+    {
+      build_withdraw (source->ibuf, n,
+		      MIN (PREFIXES_PER_WITHDRAW, first + count - n));
+      receive ();
+    }
+  settle ();
+}
+
+/* Write everything the receiver has pending to its socket.  */
+static void
+send_updates (int r)
+{
+  struct peer *peer = receivers[r];
+  struct thread thread;
+  char buf[BGP_MAX_PACKET_SIZE];
+
+  do
+    {
+      BGP_WRITE_OFF (peer->t_write);
+      thread.arg = peer;
+      bgp_write (&thread);
+      while (read (sinks[r], buf, sizeof (buf)) > 0)
+	;
+    }
+  while (peer->t_write);
+}
+
+static void
+send_all (void)
+{
+  int r;
+
+  for (r = 0; r < RECEIVERS; r++)
+    send_updates (r);
+}
+
+static struct peer *
+test_peer (struct bgp *bgp, int p, as_t as)
+{
+  struct peer *peer;
+  char host[32];
+
+  snprintf (host, sizeof (host), "192.0.2.%d", p + 1);
+  peer = peer_create_accept (bgp);
+  peer->host = strdup (host);
+  peer->as = as;
+  peer->local_as = asn;
+  peer->status = Established;
+  peer->established = 1;
+  peer->afc[AFI_IP][SAFI_UNICAST] = 1;
+  str2sockunion (host, &peer->su);
+  peer->su_remote = sockunion_dup (&peer->su);
+  peer->remote_id = peer->su.sin.sin_addr;
+
+  return peer;
+}
+
+static struct peer *
+test_receiver (struct bgp *bgp, int r)
+{
+  struct peer *peer;
+  int fds[2];
+
+  peer = test_peer (bgp, 10 + r, 301 + r);
+  peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+  /* The last one announces itself as another next hop.  */
+  peer->nexthop.v4.s_addr = htonl (r == RECEIVERS - 1
+				   ? 0xc0000264 : 0xc0000263);
+  /* Everything received is older.  */
+  peer->synctime = INT_MAX;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+      perror ("socketpair");
+      exit (1);
+    }
+  set_nonblocking (fds[0]);
+  set_nonblocking (fds[1]);
+  peer->fd = fds[0];
+  sinks[r] = fds[1];
+
+  return peer;
+}
+
+static void
+count_adj (struct bgp *bgp, struct adj_count *c)
+{
+  struct bgp_node *rn;
+  struct bgp_adj_out *adj;
+  struct bgp_adj_out_shared *shared;
+
+  memset (c, 0, sizeof (struct adj_count));
+  for (rn = bgp_table_top (bgp->rib[AFI_IP][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    {
+      for (adj = rn->adj_out; adj; adj = adj->next)
+	c->adj++;
+      for (shared = rn->adj_out_shared; shared; shared = shared->next)
+	{
+	  c->shared++;
+	  c->bits += shared->count;
+	}
+    }
+}
+
+static void
+check_adj (struct bgp *bgp, const char *what, unsigned long adj,
+	   unsigned long shared, unsigned long bits)
+{
+  struct adj_count c;
+
+  count_adj (bgp, &c);
+  CHECK (c.adj == adj && c.shared == shared && c.bits == bits,
+	 "%s: %lu adjacencies, %lu shared entries with %lu bits, "
+	 "expected %lu, %lu and %lu", what, c.adj, c.shared, c.bits,
+	 adj, shared, bits);
+}
+
+/* The routes whose last advertisement to peer has the path of
+   generation gen, or that have no adjacency for peer if gen is -1.  */
+static int
+advertised (struct bgp *bgp, struct peer *peer, int gen)
+{
+  struct bgp_node *rn;
+  struct attr *attr;
+  char as[16];
+  int count = 0;
+
+  snprintf (as, sizeof (as), " %d ", 5000 + gen);
+  for (rn = bgp_table_top (bgp->rib[AFI_IP][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    {
+      if (! rn->info)
+	continue;
+      if (! bgp_adj_out_advertised (rn, peer, &attr))
+	count += (gen == -1);
+      else if (attr && gen != -1
+	       && strstr (aspath_print (attr->aspath), as))
+	count++;
+    }
+  return count;
+}
+
+/* The first two receivers must have been sent the same attribute for
+   every prefix, and the third another.  */
+static void
+check_shared_by_two (struct bgp *bgp, const char *what)
+{
+  struct bgp_node *rn;
+  struct attr *attr0, *attr1, *attr2;
+  int same = 0, other = 0;
+
+  for (rn = bgp_table_top (bgp->rib[AFI_IP][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    if (bgp_adj_out_advertised (rn, receivers[0], &attr0)
+	&& bgp_adj_out_advertised (rn, receivers[1], &attr1)
+	&& bgp_adj_out_advertised (rn, receivers[2], &attr2))
+      {
+	same += (attr0 == attr1);
+	other += (attr0 != attr2);
+      }
+
+  CHECK (same == other && same > 0,
+	 "%s: %d prefixes with the same attribute, %d with another",
+	 what, same, other);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct bgp *bgp;
+  int prefixes = 1000;
+  int half, quarter, r, lock[RECEIVERS];
+
+  if (argc > 1)
+    prefixes = atoi (argv[1]);
+  if (prefixes < 4 || prefixes > 0xf0000)
+    {
+      fprintf (stderr, "usage: %s [prefixes]\n", argv[0]);
+      exit (1);
+    }
+  half = prefixes / 2;
+  quarter = prefixes / 4;
+
+  zprivs_init (&bgpd_privs);
+  bgp_master_init ();
+  master = bm->master;
+  bm->port = 0;
+  bgp_option_set (BGP_OPT_NO_FIB);
+  bgp_attr_init ();
+  if_init ();
+  bgp_scan_init ();
+
+  if (bgp_get (&bgp, &asn, NULL))
+    return -1;
+
+  /* Not negotiated, so that nothing is announced back to it.  */
+  source = test_peer (bgp, 0, 200);
+  for (r = 0; r < RECEIVERS; r++)
+    {
+      receivers[r] = test_receiver (bgp, r);
+      lock[r] = receivers[r]->lock;
+    }
+
+  /* Announced, but nothing sent yet: one pending adjacency each.  */
+  announce (0, 0, prefixes);
+  check_adj (bgp, "announced", RECEIVERS * prefixes, 0, 0);
+
+  /* Once sent, two shared entries per prefix, one with two bits.  */
+  send_all ();
+  check_adj (bgp, "sent", 0, 2 * prefixes, RECEIVERS * prefixes);
+  check_shared_by_two (bgp, "sent");
+  for (r = 0; r < RECEIVERS; r++)
+    {
+      CHECK (advertised (bgp, receivers[r], 0) == prefixes,
+	     "sent: %d prefixes advertised to %s, expected %d",
+	     advertised (bgp, receivers[r], 0), receivers[r]->host, prefixes);
+      CHECK (receivers[r]->scount[AFI_IP][SAFI_UNICAST] == prefixes,
+	     "sent: %s counts %lu prefixes sent", receivers[r]->host,
+	     receivers[r]->scount[AFI_IP][SAFI_UNICAST]);
+      CHECK (receivers[r]->lock == lock[r] + prefixes,
+	     "sent: %s has %d references, expected %d", receivers[r]->host,
+	     receivers[r]->lock, lock[r] + prefixes);
+    }
+
+  /* A new path for the first half moves them out of the shared
+     entries, with the old attribute, until it is sent.  */
+  announce (1, 0, half);
+  check_adj (bgp, "updated", RECEIVERS * half, 2 * (prefixes - half),
+	     RECEIVERS * (prefixes - half));
+  CHECK (advertised (bgp, receivers[0], 0) == prefixes,
+	 "updated: new path advertised before it was sent");
+  send_all ();
+  check_adj (bgp, "update sent", 0, 2 * prefixes, RECEIVERS * prefixes);
+  check_shared_by_two (bgp, "update sent");
+  for (r = 0; r < RECEIVERS; r++)
+    CHECK (advertised (bgp, receivers[r], 1) == half
+	   && advertised (bgp, receivers[r], 0) == prefixes - half,
+	   "update sent: %s was sent %d new paths and %d old ones",
+	   receivers[r]->host, advertised (bgp, receivers[r], 1),
+	   advertised (bgp, receivers[r], 0));
+
+  /* A withdraw of the last quarter moves them out until it is sent,
+     then they are gone.  */
+  withdraw (prefixes - quarter, quarter);
+  check_adj (bgp, "withdrawn", RECEIVERS * quarter,
+	     2 * (prefixes - quarter), RECEIVERS * (prefixes - quarter));
+  send_all ();
+  check_adj (bgp, "withdraw sent", 0, 2 * (prefixes - quarter),
+	     RECEIVERS * (prefixes - quarter));
+  for (r = 0; r < RECEIVERS; r++)
+    CHECK (receivers[r]->scount[AFI_IP][SAFI_UNICAST]
+	   == (unsigned long) (prefixes - quarter),
+	   "withdraw sent: %s counts %lu prefixes sent", receivers[r]->host,
+	   receivers[r]->scount[AFI_IP][SAFI_UNICAST]);
+
+  /* Clearing the first receiver takes its bit only, and gives its
+     references back.  The second is then alone in its entries.  */
+  SET_FLAG (receivers[0]->flags, PEER_FLAG_SHUTDOWN);
+  receivers[0]->status = Clearing;
+  bgp_clear_route_all (receivers[0]);
+  settle ();
+  check_adj (bgp, "cleared", 0, 2 * (prefixes - quarter),
+	     2 * (prefixes - quarter));
+  CHECK (advertised (bgp, receivers[0], -1) == prefixes - quarter,
+	 "cleared: %d prefixes still advertised to %s",
+	 prefixes - quarter - advertised (bgp, receivers[0], -1),
+	 receivers[0]->host);
+  CHECK (advertised (bgp, receivers[1], 1) == half,
+	 "cleared: %s lost its advertisements", receivers[1]->host);
+  CHECK (receivers[0]->lock == lock[0],
+	 "cleared: %s has %d references, expected %d", receivers[0]->host,
+	 receivers[0]->lock, lock[0]);
+
+  /* And once they all are, nothing is left.  */
+  for (r = 1; r < RECEIVERS; r++)
+    {
+      SET_FLAG (receivers[r]->flags, PEER_FLAG_SHUTDOWN);
+      receivers[r]->status = Clearing;
+      bgp_clear_route_all (receivers[r]);
+    }
+  SET_FLAG (source->flags, PEER_FLAG_SHUTDOWN);
+  source->status = Clearing;
+  bgp_clear_route_all (source);
+  settle ();
+  check_adj (bgp, "all cleared", 0, 0, 0);
+  CHECK (mtype_stats_alloc (MTYPE_BGP_ADJ_OUT) == 0
+	 && mtype_stats_alloc (MTYPE_BGP_ADJ_OUT_SHARED) == 0
+	 && mtype_stats_alloc (MTYPE_BGP_ADVERTISE) == 0,
+	 "all cleared: %ld adjacencies, %ld shared entries and %ld "
+	 "advertisements allocated",
+	 mtype_stats_alloc (MTYPE_BGP_ADJ_OUT),
+	 mtype_stats_alloc (MTYPE_BGP_ADJ_OUT_SHARED),
+	 mtype_stats_alloc (MTYPE_BGP_ADVERTISE));
+  for (r = 0; r < RECEIVERS; r++)
+    CHECK (receivers[r]->lock == lock[r],
+	   "all cleared: %s has %d references, expected %d",
+	   receivers[r]->host, receivers[r]->lock, lock[r]);
+
+  printf ("%d prefixes to %d peers: %s\n", prefixes, RECEIVERS,
+	  failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,789 @@
+/*
+ * MRT replay injector.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Opens a BGP session to a bgpd and feeds it the routes of one or more
+ * MRT files as fast as the socket takes them, so that convergence and
+ * policy can be benchmarked without live peers.
+ *
+ * TABLE_DUMP_V2 RIB records, as written by "dump bgp routes-mrt", are
+ * turned into UPDATEs: one path per prefix is taken (the first, or that
+ * of the peer given with -P) and consecutive prefixes with the same
+ * attributes are packed into one message.  BGP4MP UPDATE messages, as
+ * written by "dump bgp updates" or "dump bgp all", are sent as recorded.
+ * Either way the attributes are passed through a rewrite which supplies
+ * the MULTI_EXIT_DISC and LOCAL_PREF this bgpd insists on and, with -s,
+ * sets NEXT_HOP to the local end of the session.
+ *
+ * The session is kept up after the last message until -w seconds have
+ * passed (by default until interrupted), so that bgpd keeps the routes.
+ *
+ * usage: bgpmrtreplay [-p port] [-a as] [-i router-id] [-P peer-index]
+ *                     [-s] [-2] [-w seconds] address file...
+ */
+#include <zebra.h>
+#include <sys/time.h>
+#include <poll.h>
+
+#include "log.h"
+#include "vty.h"
+#include "prefix.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_open.h"
+#include "bgpd/bgp_dump.h"
+
+#define MRT_HEADER_SIZE      12
+#define MRT_TABLE_DUMP_V2    13
+#define MRT_BGP4MP           MSG_PROTOCOL_BGP4MP
+#define MRT_BGP4MP_ET        17
+
+#define KEEPALIVE_INTERVAL   30
+#define HOLDTIME             180
+#define UPDATE_BODY_MAX      (BGP_MAX_PACKET_SIZE - BGP_HEADER_SIZE)
+
+/* Options.  */
+static as_t local_as = 65000;
+static struct in_addr router_id;
+static int peer_index = -1;
+static int nexthop_self;
+static int as4 = 1;
+static int wait_secs = -1;
+
+/* Session.  */
+static int sock = -1;
+static struct in_addr local_addr;
+static time_t last_keepalive;
+
+static u_char obuf[64 * 1024];
+static size_t olen;
+static u_char ibuf[2 * BGP_MAX_PACKET_SIZE];
+static size_t ilen;
+
+static int got_open;
+static int established;
+
+/* Statistics.  */
+static unsigned long records, skipped, updates, prefixes, bytes;
+static unsigned long updates_rcvd;
+
+/* UPDATE being packed from RIB entries.  */
+static struct
+{
+  afi_t afi;
+  u_char attr[UPDATE_BODY_MAX];
+  size_t attrlen;
+  u_char nh[32];
+  size_t nhlen;
+  u_char nlri[UPDATE_BODY_MAX];
+  size_t nlrilen;
+  unsigned int count;
+} pack;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+usage (const char *progname)
+{
+  fprintf (stderr,
+	   "usage: %s [-p port] [-a as] [-i router-id] [-P peer-index]"
+	   " [-s] [-2] [-w seconds] address file...\n", progname);
+  exit (1);
+}
+
+/* Consume what bgpd sent.  Anything but a NOTIFICATION is only
+   counted; the routes bgpd advertises back are not of interest.  */
+static void
+session_input (void)
+{
+  ssize_t n;
+  size_t off = 0;
+
+  n = read (sock, ibuf + ilen, sizeof (ibuf) - ilen);
+  if (n < 0 && (errno == EAGAIN || errno == EINTR))
+    return;
+  if (n <= 0)
+    {
+      fprintf (stderr, "session closed by peer%s%s\n",
+	       n < 0 ? ": " : "", n < 0 ? safe_strerror (errno) : "");
+      exit (1);
+    }
+  ilen += n;
+
+  while (ilen - off >= BGP_HEADER_SIZE)
+    {
+      u_char *m = ibuf + off;
+      size_t len = m[16] << 8 | m[17];
+
+      if (len < BGP_HEADER_SIZE || len > BGP_MAX_PACKET_SIZE)
+	{
+	  fprintf (stderr, "bad message length %zu from peer\n", len);
+	  exit (1);
+	}
+      if (ilen - off < len)
+	break;
+
+      switch (m[18])
+	{
+	case BGP_MSG_OPEN:
+	  got_open = 1;
+	  break;
+	case BGP_MSG_KEEPALIVE:
+	  if (got_open)
+	    established = 1;
+	  break;
+	case BGP_MSG_UPDATE:
+	  updates_rcvd++;
+	  break;
+	case BGP_MSG_NOTIFY:
+	  fprintf (stderr, "NOTIFICATION from peer: code %d subcode %d\n",
+		   len > BGP_HEADER_SIZE ? m[19] : 0,
+		   len > BGP_HEADER_SIZE + 1 ? m[20] : 0);
+	  exit (1);
+	}
+      off += len;
+    }
+  memmove (ibuf, ibuf + off, ilen - off);
+  ilen -= off;
+}
+
+/* Write out the output buffer, reading whatever comes in meanwhile.  */
+static void
+session_flush (void)
+{
+  size_t off = 0;
+
+  while (off < olen)
+    {
+      struct pollfd pfd = { sock, POLLIN | POLLOUT, 0 };
+      ssize_t n;
+
+      if (poll (&pfd, 1, -1) < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  perror ("poll");
+	  exit (1);
+	}
+      if (pfd.revents & (POLLIN | POLLHUP | POLLERR))
+	session_input ();
+      if (! (pfd.revents & POLLOUT))
+	continue;
+
+      n = write (sock, obuf + off, olen - off);
+      if (n < 0)
+	{
+	  if (errno == EAGAIN || errno == EINTR)
+	    continue;
+	  fprintf (stderr, "write: %s\n", safe_strerror (errno));
+	  exit (1);
+	}
+      off += n;
+    }
+  bytes += olen;
+  olen = 0;
+}
+
+static void
+session_send (u_char type, const u_char *body, size_t len)
+{
+  if (olen + BGP_HEADER_SIZE + len > sizeof (obuf))
+    session_flush ();
+
+  memset (obuf + olen, 0xff, BGP_MARKER_SIZE);
+  obuf[olen + 16] = (BGP_HEADER_SIZE + len) >> 8;
+  obuf[olen + 17] = (BGP_HEADER_SIZE + len) & 0xff;
+  obuf[olen + 18] = type;
+  memcpy (obuf + olen + BGP_HEADER_SIZE, body, len);
+  olen += BGP_HEADER_SIZE + len;
+
+  if (type == BGP_MSG_UPDATE)
+    updates++;
+
+  if (time (NULL) - last_keepalive >= KEEPALIVE_INTERVAL)
+    {
+      last_keepalive = time (NULL);
+      session_send (BGP_MSG_KEEPALIVE, NULL, 0);
+    }
+}
+
+static u_char *
+put_cap (u_char *p, u_char code, u_char len)
+{
+  *p++ = BGP_OPEN_OPT_CAP;
+  *p++ = 2 + len;
+  *p++ = code;
+  *p++ = len;
+  return p;
+}
+
+static void
+session_open (const char *address, int port)
+{
+  struct sockaddr_in sin;
+  socklen_t slen = sizeof (sin);
+  u_char open[64], *p = open, *optlen;
+  afi_t afi;
+  double deadline;
+
+  memset (&sin, 0, sizeof (sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons (port);
+  if (inet_pton (AF_INET, address, &sin.sin_addr) != 1)
+    {
+      fprintf (stderr, "%s: not an IPv4 address\n", address);
+      exit (1);
+    }
+
+  sock = socket (AF_INET, SOCK_STREAM, 0);
+  if (sock < 0 || connect (sock, (struct sockaddr *) &sin, sizeof (sin)) < 0)
+    {
+      fprintf (stderr, "connect to %s: %s\n", address, safe_strerror (errno));
+      exit (1);
+    }
+  getsockname (sock, (struct sockaddr *) &sin, &slen);
+  local_addr = sin.sin_addr;
+  if (! router_id.s_addr)
+    router_id = local_addr;
+  fcntl (sock, F_SETFL, fcntl (sock, F_GETFL) | O_NONBLOCK);
+
+  *p++ = BGP_VERSION_4;
+  *p++ = (local_as > BGP_AS_MAX ? BGP_AS_TRANS : local_as) >> 8;
+  *p++ = (local_as > BGP_AS_MAX ? BGP_AS_TRANS : local_as) & 0xff;
+  *p++ = HOLDTIME >> 8;
+  *p++ = HOLDTIME & 0xff;
+  memcpy (p, &router_id, 4);
+  p += 4;
+  optlen = p++;
+
+  for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+    {
+      p = put_cap (p, CAPABILITY_CODE_MP, CAPABILITY_CODE_MP_LEN);
+      *p++ = 0;
+      *p++ = afi;
+      *p++ = 0;
+      *p++ = SAFI_UNICAST;
+    }
+  if (as4)
+    {
+      p = put_cap (p, CAPABILITY_CODE_AS4, CAPABILITY_CODE_AS4_LEN);
+      *p++ = local_as >> 24;
+      *p++ = local_as >> 16;
+      *p++ = local_as >> 8;
+      *p++ = local_as;
+    }
+  *optlen = p - optlen - 1;
+
+  last_keepalive = time (NULL);
+  session_send (BGP_MSG_OPEN, open, p - open);
+  session_send (BGP_MSG_KEEPALIVE, NULL, 0);
+  session_flush ();
+
+  deadline = now () + HOLDTIME;
+  while (! established)
+    {
+      struct pollfd pfd = { sock, POLLIN, 0 };
+
+      if (now () > deadline)
+	{
+	  fprintf (stderr, "no session with %s\n", address);
+	  exit (1);
+	}
+      if (poll (&pfd, 1, 1000) > 0)
+	session_input ();
+    }
+}
+
+/* Copy the path attributes IN to OUT the way bgpd wants to see them.
+   If NH is given, an MP_REACH_NLRI is dropped and its next hop stored
+   there instead, for the NLRI to be added when the UPDATE is packed; it
+   may be in RFC 6396 form, next hop only, or in the full form Quagga
+   has written.  Returns the length written, -1 if IN is malformed.  */
+static ssize_t
+rewrite_attrs (const u_char *in, size_t len, u_char *out, size_t size,
+	       u_char *nh, size_t *nhlen)
+{
+  const u_char *end = in + len;
+  u_char *o = out;
+  int med = 0, local_pref = 0;
+
+  while (in < end)
+    {
+      u_char flags, type;
+      size_t hlen, alen;
+      const u_char *val;
+
+      if (end - in < 3)
+	return -1;
+      flags = in[0];
+      type = in[1];
+      if (flags & BGP_ATTR_FLAG_EXTLEN)
+	{
+	  if (end - in < 4)
+	    return -1;
+	  alen = in[2] << 8 | in[3];
+	  hlen = 4;
+	}
+      else
+	{
+	  alen = in[2];
+	  hlen = 3;
+	}
+      if ((size_t) (end - in) < hlen + alen)
+	return -1;
+      val = in + hlen;
+      in += hlen + alen;
+
+      if (type == BGP_ATTR_MP_REACH_NLRI && nh)
+	{
+	  if (alen >= 1 && val[0] == alen - 1)
+	    {
+	      *nhlen = val[0];
+	      val++;
+	    }
+	  else if (alen >= 4 && val[3] <= alen - 4)
+	    {
+	      *nhlen = val[3];
+	      val += 4;
+	    }
+	  else
+	    return -1;
+	  if (*nhlen > 32)
+	    return -1;
+	  memcpy (nh, val, *nhlen);
+	  continue;
+	}
+
+      if ((size_t) (o - out) + hlen + alen + 14 > size)
+	return -1;
+
+      /* This bgpd wants MULTI_EXIT_DISC flagged transitive only.  */
+      if (type == BGP_ATTR_MULTI_EXIT_DISC)
+	{
+	  flags = BGP_ATTR_FLAG_TRANS | (flags & BGP_ATTR_FLAG_EXTLEN);
+	  med = 1;
+	}
+      else if (type == BGP_ATTR_LOCAL_PREF)
+	local_pref = 1;
+
+      *o++ = flags;
+      *o++ = type;
+      if (hlen == 4)
+	*o++ = alen >> 8;
+      *o++ = alen;
+      memcpy (o, val, alen);
+      if (type == BGP_ATTR_NEXT_HOP && nexthop_self && alen == 4)
+	memcpy (o, &local_addr, 4);
+      o += alen;
+    }
+
+  if (! med)
+    {
+      *o++ = BGP_ATTR_FLAG_TRANS;
+      *o++ = BGP_ATTR_MULTI_EXIT_DISC;
+      *o++ = 4;
+      memset (o, 0, 4);
+      o += 4;
+    }
+  if (! local_pref)
+    {
+      u_int32_t lp = htonl (BGP_DEFAULT_LOCAL_PREF);
+
+      *o++ = BGP_ATTR_FLAG_TRANS;
+      *o++ = BGP_ATTR_LOCAL_PREF;
+      *o++ = 4;
+      memcpy (o, &lp, 4);
+      o += 4;
+    }
+  return o - out;
+}
+
+static size_t
+pack_mp_reach_size (void)
+{
+  return pack.afi == AFI_IP ? 0 : 4 + 5 + pack.nhlen;
+}
+
+static void
+pack_flush (void)
+{
+  u_char body[UPDATE_BODY_MAX], *p = body;
+  size_t attrlen;
+
+  if (! pack.count)
+    return;
+
+  attrlen = pack.attrlen;
+  if (pack.afi != AFI_IP)
+    attrlen += pack_mp_reach_size () + pack.nlrilen;
+
+  *p++ = 0;
+  *p++ = 0;
+  *p++ = attrlen >> 8;
+  *p++ = attrlen & 0xff;
+  memcpy (p, pack.attr, pack.attrlen);
+  p += pack.attrlen;
+
+  if (pack.afi == AFI_IP)
+    {
+      memcpy (p, pack.nlri, pack.nlrilen);
+      p += pack.nlrilen;
+    }
+  else
+    {
+      size_t mplen = 5 + pack.nhlen + pack.nlrilen;
+
+      *p++ = BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_EXTLEN;
+      *p++ = BGP_ATTR_MP_REACH_NLRI;
+      *p++ = mplen >> 8;
+      *p++ = mplen & 0xff;
+      *p++ = 0;
+      *p++ = pack.afi;
+      *p++ = SAFI_UNICAST;
+      *p++ = pack.nhlen;
+      memcpy (p, pack.nh, pack.nhlen);
+      p += pack.nhlen;
+      *p++ = 0;
+      memcpy (p, pack.nlri, pack.nlrilen);
+      p += pack.nlrilen;
+    }
+
+  session_send (BGP_MSG_UPDATE, body, p - body);
+  pack.count = 0;
+  pack.nlrilen = 0;
+}
+
+/* Add PREFIX (length byte and address) with ATTR to the UPDATE being
+   packed, sending that first if it has other attributes or is full.  */
+static void
+pack_add (afi_t afi, const u_char *prefix, size_t plen,
+	  const u_char *attr, size_t attrlen, const u_char *nh, size_t nhlen)
+{
+  if (pack.count
+      && (pack.afi != afi || pack.attrlen != attrlen
+	  || memcmp (pack.attr, attr, attrlen)
+	  || pack.nhlen != nhlen || memcmp (pack.nh, nh, nhlen)))
+    pack_flush ();
+
+  if (pack.count
+      && 4 + pack.attrlen + pack_mp_reach_size () + pack.nlrilen + plen
+         > UPDATE_BODY_MAX)
+    pack_flush ();
+
+  if (! pack.count)
+    {
+      pack.afi = afi;
+      memcpy (pack.attr, attr, attrlen);
+      pack.attrlen = attrlen;
+      memcpy (pack.nh, nh, nhlen);
+      pack.nhlen = nhlen;
+    }
+  memcpy (pack.nlri + pack.nlrilen, prefix, plen);
+  pack.nlrilen += plen;
+  pack.count++;
+  prefixes++;
+}
+
+static int
+replay_rib (afi_t afi, const u_char *p, size_t len)
+{
+  const u_char *end = p + len;
+  const u_char *prefix;
+  size_t plen;
+  unsigned int count, i;
+
+  if (! as4)
+    return -1;
+
+  if (len < 5 || (p[4] > (afi == AFI_IP ? 32 : 128)))
+    return -1;
+  prefix = p + 4;
+  plen = 1 + (p[4] + 7) / 8;
+  p += 4 + plen;
+  if (end - p < 2)
+    return -1;
+  count = p[0] << 8 | p[1];
+  p += 2;
+
+  for (i = 0; i < count; i++)
+    {
+      u_char attr[UPDATE_BODY_MAX];
+      u_char nh[32];
+      size_t nhlen = 0, alen;
+      ssize_t attrlen;
+      unsigned int index;
+
+      if (end - p < 8)
+	return -1;
+      index = p[0] << 8 | p[1];
+      alen = p[6] << 8 | p[7];
+      p += 8;
+      if ((size_t) (end - p) < alen)
+	return -1;
+
+      if (peer_index < 0 || (unsigned int) peer_index == index)
+	{
+	  attrlen = rewrite_attrs (p, alen, attr, sizeof (attr) - 64,
+				   nh, &nhlen);
+	  if (attrlen < 0 || (afi != AFI_IP && ! nhlen))
+	    return -1;
+	  pack_add (afi, prefix, plen, attr, attrlen, nh, nhlen);
+	  return 0;
+	}
+      p += alen;
+    }
+  return 0;
+}
+
+/* A BGP4MP message record: the peering it was received on, then the
+   whole BGP message.  */
+static int
+replay_message (int subtype, const u_char *p, size_t len)
+{
+  const u_char *end = p + len;
+  const u_char *m, *attrs;
+  u_char body[UPDATE_BODY_MAX];
+  size_t aslen, addrlen, mlen, wlen, alen;
+  ssize_t attrlen;
+  u_char *b;
+
+  aslen = subtype == BGP4MP_MESSAGE_AS4 ? 4 : 2;
+  if (aslen == 4 ? ! as4 : as4)
+    return -1;
+
+  if (len < 2 * aslen + 4)
+    return -1;
+  p += 2 * aslen + 2;
+  addrlen = (p[0] << 8 | p[1]) == AFI_IP6 ? 16 : 4;
+  p += 2 + 2 * addrlen;
+  if (end - p < BGP_HEADER_SIZE)
+    return -1;
+
+  m = p;
+  mlen = m[16] << 8 | m[17];
+  if (m[18] != BGP_MSG_UPDATE)
+    return 0;
+  if (mlen < BGP_HEADER_SIZE + 4 || mlen > (size_t) (end - m))
+    return -1;
+
+  p = m + BGP_HEADER_SIZE;
+  end = m + mlen;
+  wlen = p[0] << 8 | p[1];
+  if ((size_t) (end - p) < 2 + wlen + 2)
+    return -1;
+  attrs = p + 2 + wlen;
+  alen = attrs[0] << 8 | attrs[1];
+  attrs += 2;
+  if ((size_t) (end - attrs) < alen)
+    return -1;
+
+  /* Withdrawn routes.  */
+  b = body;
+  memcpy (b, p, 2 + wlen);
+  b += 2 + wlen;
+
+  /* A pure withdrawal has no attributes to complete.  */
+  if (alen == 0)
+    {
+      memcpy (b, attrs - 2, end - attrs + 2);
+      b += end - attrs + 2;
+    }
+  else
+    {
+      attrlen = rewrite_attrs (attrs, alen, b + 2,
+			       sizeof (body) - (b + 2 - body), NULL, NULL);
+      if (attrlen < 0
+	  || (size_t) (b + 2 + attrlen - body) + (end - attrs - alen)
+	     > sizeof (body))
+	return -1;
+      b[0] = attrlen >> 8;
+      b[1] = attrlen & 0xff;
+      b += 2 + attrlen;
+      memcpy (b, attrs + alen, end - attrs - alen);
+      b += end - attrs - alen;
+    }
+
+  session_send (BGP_MSG_UPDATE, body, b - body);
+  return 0;
+}
+
+static void
+replay_file (const char *path)
+{
+  FILE *fp;
+  u_char header[MRT_HEADER_SIZE];
+  u_char *body = NULL;
+  size_t size = 0;
+
+  fp = fopen (path, "r");
+  if (! fp)
+    {
+      fprintf (stderr, "%s: %s\n", path, safe_strerror (errno));
+      exit (1);
+    }
+
+  while (fread (header, MRT_HEADER_SIZE, 1, fp) == 1)
+    {
+      unsigned int type = header[4] << 8 | header[5];
+      unsigned int subtype = header[6] << 8 | header[7];
+      size_t len = (size_t) header[8] << 24 | header[9] << 16
+	| header[10] << 8 | header[11];
+      const u_char *p;
+      int ret = 0;
+
+      if (len > size)
+	{
+	  size = len;
+	  body = realloc (body, size);
+	  if (! body)
+	    {
+	      perror ("realloc");
+	      exit (1);
+	    }
+	}
+      if (len && fread (body, len, 1, fp) != 1)
+	{
+	  fprintf (stderr, "%s: truncated record\n", path);
+	  break;
+	}
+      records++;
+      p = body;
+
+      if (type == MRT_BGP4MP_ET)
+	{
+	  if (len < 4)
+	    ret = -1;
+	  p += 4;
+	  len -= 4;
+	}
+
+      if (ret < 0)
+	;
+      else if (type == MRT_TABLE_DUMP_V2
+	       && subtype == TABLE_DUMP_V2_RIB_IPV4_UNICAST)
+	ret = replay_rib (AFI_IP, p, len);
+      else if (type == MRT_TABLE_DUMP_V2
+	       && subtype == TABLE_DUMP_V2_RIB_IPV6_UNICAST)
+	ret = replay_rib (AFI_IP6, p, len);
+      else if ((type == MRT_BGP4MP || type == MRT_BGP4MP_ET)
+	       && (subtype == BGP4MP_MESSAGE || subtype == BGP4MP_MESSAGE_AS4))
+	{
+	  pack_flush ();
+	  ret = replay_message (subtype, p, len);
+	}
+      else
+	continue;
+
+      if (ret < 0)
+	skipped++;
+    }
+
+  pack_flush ();
+  free (body);
+  fclose (fp);
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *progname = argv[0];
+  int port = BGP_PORT_DEFAULT;
+  double t, elapsed;
+  int c;
+
+  while ((c = getopt (argc, argv, "p:a:i:P:s2w:")) != -1)
+    switch (c)
+      {
+      case 'p':
+	port = atoi (optarg);
+	break;
+      case 'a':
+	local_as = strtoul (optarg, NULL, 10);
+	break;
+      case 'i':
+	if (inet_pton (AF_INET, optarg, &router_id) != 1)
+	  usage (progname);
+	break;
+      case 'P':
+	peer_index = atoi (optarg);
+	break;
+      case 's':
+	nexthop_self = 1;
+	break;
+      case '2':
+	as4 = 0;
+	break;
+      case 'w':
+	wait_secs = atoi (optarg);
+	break;
+      default:
+	usage (progname);
+      }
+  argc -= optind;
+  argv += optind;
+  if (argc < 2 || ! local_as || (! as4 && local_as > BGP_AS_MAX))
+    usage (progname);
+
+  signal (SIGPIPE, SIG_IGN);
+  session_open (argv[0], port);
+  bytes = 0;
+
+  t = now ();
+  for (c = 1; c < argc; c++)
+    replay_file (argv[c]);
+  session_flush ();
+  elapsed = now () - t;
+
+  printf ("%lu records, %lu skipped\n", records, skipped);
+  printf ("%lu UPDATEs, %lu prefixes from RIB entries, %lu bytes in %.3f s\n",
+	  updates, prefixes, bytes, elapsed);
+  if (elapsed > 0)
+    printf ("%.0f UPDATEs/s, %.0f prefixes/s\n",
+	    updates / elapsed, prefixes / elapsed);
+  fflush (stdout);
+
+  /* Keep the session, and with it the routes, up.  */
+  t = now ();
+  while (wait_secs < 0 || now () - t < wait_secs)
+    {
+      struct pollfd pfd = { sock, POLLIN, 0 };
+
+      if (poll (&pfd, 1, 1000) > 0)
+	session_input ();
+      if (time (NULL) - last_keepalive >= KEEPALIVE_INTERVAL)
+	{
+	  last_keepalive = time (NULL);
+	  session_send (BGP_MSG_KEEPALIVE, NULL, 0);
+	  session_flush ();
+	}
+    }
+
+  close (sock);
+  return 0;
+}
@@ -0,0 +1,575 @@
+/*
+ * UPDATE decode pipeline test.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Two peers, each in a BGP instance of its own, are fed the same
+ * stream of UPDATE messages, one through bgp_update_receive directly
+ * and one through the decode pipeline.  Afterwards both must have the
+ * same routes with the same interned attributes in the RIB.  The
+ * stream is made to look like a full table: a few prefixes per
+ * message, AS paths of a few ASes, some with AS_SETs, prepends or an
+ * AS4_PATH, communities, withdrawals and MP_REACH / MP_UNREACH for
+ * IPv6.  A few carry a malformed AS4_PATH, which the pipeline has to
+ * leave to the main thread and which is treated as a withdrawal.
+ *
+ * The stream is fed in bursts, the two peers taking turns, and after
+ * each burst the event loop runs until the burst is in the RIB, as
+ * bgpd would.  Both the wall clock time and the CPU time of the main
+ * thread are reported: with one CPU the workers take their time from
+ * the main thread, so only the latter can come down.
+ *
+ * Last, a message with broken NLRI, which the workers cannot decode,
+ * must bring both sessions down.
+ *
+ * usage: testbgppipeline [messages [threads]]
+ */
+#include <zebra.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "prefix.h"
+#include "thread.h"
+#include "if.h"
+#include "log.h"
+#include "workqueue.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_pipeline.h"
+
+/* need these to link in libbgp; bgp_get opens the listen socket */
+struct zebra_privs_t bgpd_privs;
+struct thread_master *master = NULL;
+
+static as_t asn = 100;
+
+/* Messages fed to one peer before the event loop runs.  */
+#define BURST  32
+
+/* Distinct AS paths the routes are spread over.  */
+#define PATHS  2000
+
+struct test_message
+{
+  u_char data[BGP_MAX_PACKET_SIZE];
+  bgp_size_t size;
+};
+
+static struct test_message *messages;
+
+/* Wall clock and main thread CPU time spent on each side.  */
+struct test_time
+{
+  double wall;
+  double cpu;
+};
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static double
+cpu_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void
+put_prefix4 (struct stream *s, int n)
+{
+  stream_putc (s, 24);
+  stream_putc (s, 20 + (n >> 16 & 0x3f));
+  stream_putc (s, n >> 8);
+  stream_putc (s, n);
+}
+
+static void
+put_prefix6 (struct stream *s, int n)
+{
+  stream_putc (s, 48);
+  stream_putw (s, 0x2001);
+  stream_putw (s, 0x0db8);
+  stream_putw (s, n);
+}
+
+static void
+put_attr (struct stream *s, u_char flag, u_char type, size_t *lpos)
+{
+  stream_putc (s, flag | BGP_ATTR_FLAG_EXTLEN);
+  stream_putc (s, type);
+  *lpos = stream_get_endp (s);
+  stream_putw (s, 0);
+}
+
+static void
+end_attr (struct stream *s, size_t lpos)
+{
+  stream_putw_at (s, lpos, stream_get_endp (s) - lpos - 2);
+}
+
+static as_t
+path_as (int path, int k)
+{
+  return 1000 + (path * 31 + k * 7919) % 20000;
+}
+
+/* AS path number PATH: 2 to 10 ASes after the peer's, some with
+   the first of them prepended and some ending in an unsorted AS_SET
+   with a duplicate.  With AS4, the 16 bit AS_PATH has AS_TRANS where
+   the AS4_PATH has an AS of 32 bits.  */
+static void
+put_aspath (struct stream *s, int path, int as4)
+{
+  size_t lpos, spos;
+  int j, len = 2 + path % 9;
+
+  put_attr (s, BGP_ATTR_FLAG_TRANS, BGP_ATTR_AS_PATH, &lpos);
+  stream_putc (s, AS_SEQUENCE);
+  spos = stream_get_endp (s);
+  stream_putc (s, 0);
+  stream_putw (s, 200);
+  if (path % 5 == 0)
+    for (j = 0; j < 3; j++)
+      stream_putw (s, path_as (path, 0));
+  for (j = 0; j < len; j++)
+    stream_putw (s, as4 && j == len - 1 ? BGP_AS_TRANS : path_as (path, j));
+  stream_putc_at (s, spos, (stream_get_endp (s) - spos - 1) / 2);
+  if (path % 11 == 0)
+    {
+      stream_putc (s, AS_SET);
+      stream_putc (s, 4);
+      stream_putw (s, path_as (path, 12));
+      stream_putw (s, path_as (path, 11));
+      stream_putw (s, path_as (path, 12));
+      stream_putw (s, path_as (path, 10));
+    }
+  end_attr (s, lpos);
+
+  if (as4)
+    {
+      put_attr (s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS,
+		BGP_ATTR_AS4_PATH, &lpos);
+      stream_putc (s, AS_SEQUENCE);
+      stream_putc (s, 2);
+      stream_putl (s, path_as (path, len - 2));
+      stream_putl (s, 0x10000 + path);
+      end_attr (s, lpos);
+    }
+}
+
+/* Up to 6 communities, unsorted, some with a duplicate.  */
+static void
+put_community (struct stream *s, int path)
+{
+  size_t lpos;
+  int j, count = path % 7;
+
+  if (count == 0)
+    return;
+
+  put_attr (s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS,
+	    BGP_ATTR_COMMUNITIES, &lpos);
+  for (j = 0; j < count; j++)
+    stream_putl (s, 200 << 16 | (path * 13 + (count - j) * 101) % 1000);
+  if (path % 4 == 0)
+    stream_putl (s, 200 << 16 | (path * 13 + count * 101) % 1000);
+  if (path % 17 == 0)
+    stream_putl (s, COMMUNITY_NO_EXPORT);
+  end_attr (s, lpos);
+}
+
+/* Build message I.  Most announce a few IPv4 /24s with one of the AS
+   paths, some withdraw a few, some carry IPv6 in MP attributes and a
+   few an AS4_PATH which is malformed.  */
+static void
+build_message (struct test_message *m)
+{
+  struct stream *s = stream_new (BGP_MAX_PACKET_SIZE);
+  size_t wpos, apos, alen, lpos;
+  int j, n, kind, path, count;
+
+  n = random () % 0x10000;
+  kind = random () % 20;
+  path = random () % PATHS;
+  count = 1 + random () % 6;
+
+  /* Withdrawn routes.  */
+  wpos = stream_get_endp (s);
+  stream_putw (s, 0);
+  if (kind == 1 || kind == 2 || kind == 3)
+    for (j = 0; j < count; j++)
+      put_prefix4 (s, (n + count + j) % 0x10000);
+  stream_putw_at (s, wpos, stream_get_endp (s) - wpos - 2);
+
+  /* Path attributes.  */
+  apos = stream_get_endp (s);
+  stream_putw (s, 0);
+  if (kind != 1 && kind != 2)
+    {
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_ORIGIN);
+      stream_putc (s, 1);
+      stream_putc (s, BGP_ORIGIN_IGP);
+
+      put_aspath (s, path, kind == 5);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_NEXT_HOP);
+      stream_putc (s, 4);
+      stream_putl (s, 0xc0000201);
+
+      /* This tree insists on MED and LOCAL_PREF, see bgp_attr_check.  */
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_MULTI_EXIT_DISC);
+      stream_putc (s, 4);
+      stream_putl (s, path % 7);
+
+      stream_putc (s, BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_LOCAL_PREF);
+      stream_putc (s, 4);
+      stream_putl (s, 100);
+
+      put_community (s, path);
+
+      if (kind == 6 && random () % 10 == 0)
+	{
+	  /* A segment type no AS path has, in a partial optional
+	     attribute: the routes are withdrawn.  */
+	  put_attr (s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS
+		    | BGP_ATTR_FLAG_PARTIAL, BGP_ATTR_AS4_PATH, &lpos);
+	  stream_putc (s, 7);
+	  stream_putc (s, 1);
+	  stream_putl (s, 0x10000);
+	  end_attr (s, lpos);
+	}
+      else if (kind == 7)
+	{
+	  put_attr (s, BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_MP_REACH_NLRI, &lpos);
+	  stream_putw (s, AFI_IP6);
+	  stream_putc (s, SAFI_UNICAST);
+	  stream_putc (s, 16);
+	  stream_putl (s, 0x20010db8);
+	  stream_putl (s, 0);
+	  stream_putl (s, 0);
+	  stream_putl (s, 1);
+	  stream_putc (s, 0);
+	  for (j = 0; j < count; j++)
+	    put_prefix6 (s, n + j);
+	  end_attr (s, lpos);
+	}
+      else if (kind == 8)
+	{
+	  put_attr (s, BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_MP_UNREACH_NLRI, &lpos);
+	  stream_putw (s, AFI_IP6);
+	  stream_putc (s, SAFI_UNICAST);
+	  for (j = 0; j < count; j++)
+	    put_prefix6 (s, n + j);
+	  end_attr (s, lpos);
+	}
+    }
+  alen = stream_get_endp (s) - apos - 2;
+  stream_putw_at (s, apos, alen);
+
+  /* NLRI.  */
+  if (kind > 3 && kind != 7 && kind != 8)
+    for (j = 0; j < count; j++)
+      put_prefix4 (s, (n + j) % 0x10000);
+
+  m->size = stream_get_endp (s);
+  memcpy (m->data, STREAM_DATA (s), m->size);
+  stream_free (s);
+}
+
+static struct peer *
+test_peer (struct bgp *bgp, const char *host)
+{
+  struct peer *peer;
+
+  peer = peer_create_accept (bgp);
+  peer->host = strdup (host);
+  peer->as = 200;
+  peer->local_as = asn;
+  peer->status = Established;
+  peer->established = 1;
+  peer->afc[AFI_IP][SAFI_UNICAST] = 1;
+  peer->afc_nego[AFI_IP][SAFI_UNICAST] = 1;
+  peer->afc[AFI_IP6][SAFI_UNICAST] = 1;
+  peer->afc_nego[AFI_IP6][SAFI_UNICAST] = 1;
+  str2sockunion ("192.0.2.2", &peer->su);
+
+  return peer;
+}
+
+static void
+feed (struct peer *peer, struct test_message *m)
+{
+  stream_reset (peer->ibuf);
+  stream_put (peer->ibuf, m->data, m->size);
+}
+
+static unsigned long
+count_routes (struct peer *peer, afi_t afi)
+{
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+  unsigned long count = 0;
+
+  for (rn = bgp_table_top (peer->bgp->rib[afi][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    for (ri = rn->info; ri; ri = ri->next)
+      if (ri->peer == peer && ! CHECK_FLAG (ri->flags, BGP_INFO_REMOVED))
+	count++;
+
+  return count;
+}
+
+/* Each route A has must be in B's instance too, with the same
+   interned attributes, and the counts match.  */
+static int
+compare (struct peer *a, struct peer *b, afi_t afi, unsigned long *count)
+{
+  struct bgp_node *rn, *rm;
+  struct bgp_info *ri, *rj;
+  int errors = 0;
+
+  for (rn = bgp_table_top (a->bgp->rib[afi][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    for (ri = rn->info; ri; ri = ri->next)
+      {
+	char buf[INET6_ADDRSTRLEN];
+
+	if (ri->peer != a || CHECK_FLAG (ri->flags, BGP_INFO_REMOVED))
+	  continue;
+
+	rj = NULL;
+	rm = bgp_node_lookup (b->bgp->rib[afi][SAFI_UNICAST], &rn->p);
+	if (rm)
+	  {
+	    for (rj = rm->info; rj; rj = rj->next)
+	      if (rj->peer == b && ! CHECK_FLAG (rj->flags, BGP_INFO_REMOVED))
+		break;
+	    bgp_unlock_node (rm);
+	  }
+	if (! rj)
+	  {
+	    if (errors++ < 10)
+	      printf ("%s/%d missing from pipeline instance\n",
+		      inet_ntop (rn->p.family, &rn->p.u.prefix, buf,
+				 sizeof (buf)),
+		      rn->p.prefixlen);
+	  }
+	else if (rj->attr != ri->attr)
+	  {
+	    if (errors++ < 10)
+	      printf ("%s/%d has path %s, communities %s in the pipeline"
+		      " instance, %s, %s synchronously\n",
+		      inet_ntop (rn->p.family, &rn->p.u.prefix, buf,
+				 sizeof (buf)),
+		      rn->p.prefixlen,
+		      aspath_print (rj->attr->aspath),
+		      community_str (rj->attr->community),
+		      aspath_print (ri->attr->aspath),
+		      community_str (ri->attr->community));
+	  }
+      }
+
+  *count = count_routes (a, afi);
+  if (*count != count_routes (b, afi))
+    {
+      printf ("%s: %lu routes synchronously, %lu through the pipeline\n",
+	      afi == AFI_IP ? "IPv4" : "IPv6", *count, count_routes (b, afi));
+      errors++;
+    }
+
+  return errors;
+}
+
+static int
+queued (struct work_queue *wq)
+{
+  return wq && listcount (wq->items);
+}
+
+/* Run the event loop until everything PEER was fed is in the RIB and
+   bgp_process has been over it.  */
+static void
+settle (struct peer *peer)
+{
+  struct thread thread;
+
+  /* Process each burst as soon as it is in, not 50ms later.  The queue
+     is made by the first bgp_process.  */
+  if (bm->process_main_queue)
+    bm->process_main_queue->spec.hold = 0;
+
+  while (peer->update_pipeline || master->event.count
+	 || queued (bm->process_main_queue))
+    {
+      if (! thread_fetch (master, &thread))
+	break;
+      thread_call (&thread);
+    }
+}
+
+/* Feed messages FIRST to LAST to PEER, through the pipeline or not, and
+   let them settle.  */
+static void
+burst (struct peer *peer, int first, int last, int piped, struct test_time *t)
+{
+  double wall = now (), cpu = cpu_now ();
+  int i;
+
+  for (i = first; i < last; i++)
+    {
+      feed (peer, &messages[i]);
+      if (! piped || bgp_pipeline_submit (peer, messages[i].size) < 0)
+	bgp_update_receive (peer, messages[i].size, NULL);
+    }
+  settle (peer);
+
+  t->wall += now () - wall;
+  t->cpu += cpu_now () - cpu;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct bgp *bgp_sync, *bgp_piped;
+  struct peer *sync, *piped;
+  struct test_message broken;
+  struct test_time tsync = { 0, 0 }, tpipe = { 0, 0 }, warmup = { 0, 0 };
+  int nmessages = 50000;
+  int nthreads = 4;
+  int i, errors;
+  unsigned long count4 = 0, count6 = 0;
+
+  if (argc > 1)
+    nmessages = atoi (argv[1]);
+  if (argc > 2)
+    nthreads = atoi (argv[2]);
+  if (nmessages <= 0 || nthreads <= 0)
+    {
+      fprintf (stderr, "usage: %s [messages [threads]]\n", argv[0]);
+      exit (1);
+    }
+
+  zprivs_init (&bgpd_privs);
+  bgp_master_init ();
+  master = bm->master;
+  bm->port = 0;
+  bgp_option_set (BGP_OPT_NO_FIB);
+  bgp_option_set (BGP_OPT_MULTIPLE_INSTANCE);
+  bgp_attr_init ();
+  if_init ();
+  bgp_scan_init ();
+
+  /* One instance each, so that both sides do the same work.  */
+  if (bgp_get (&bgp_sync, &asn, "sync")
+      || bgp_get (&bgp_piped, &asn, "pipeline"))
+    return -1;
+
+  sync = test_peer (bgp_sync, "sync");
+  piped = test_peer (bgp_piped, "pipeline");
+
+  srandom (1);
+  messages = XCALLOC (MTYPE_TMP, nmessages * sizeof (struct test_message));
+  for (i = 0; i < nmessages; i++)
+    build_message (&messages[i]);
+
+  if (bgp_pipeline_start (nthreads) != nthreads)
+    {
+      printf ("could not start %d threads\n", nthreads);
+      return 1;
+    }
+
+  /* Taking turns, so that neither side has the emptier tables.  The
+     first burst makes the process queue, and waits for it, untimed.  */
+  for (i = 0; i < nmessages; i += BURST)
+    {
+      int last = MIN (i + BURST, nmessages);
+
+      burst (sync, i, last, 0, i ? &tsync : &warmup);
+      burst (piped, i, last, 1, i ? &tpipe : &warmup);
+    }
+
+  errors = compare (sync, piped, AFI_IP, &count4);
+  errors += compare (sync, piped, AFI_IP6, &count6);
+  if (piped->update_pipeline)
+    {
+      printf ("%u messages left in the pipeline\n", piped->update_pipeline);
+      errors++;
+    }
+
+  printf ("%d messages, %lu IPv4 and %lu IPv6 routes, %ld CPUs\n",
+	  nmessages, count4, count6, sysconf (_SC_NPROCESSORS_ONLN));
+  printf ("synchronous: %8.3f s, %8.3f s main thread CPU\n",
+	  tsync.wall, tsync.cpu);
+  printf ("pipeline:    %8.3f s, %8.3f s main thread CPU with %d threads\n",
+	  tpipe.wall, tpipe.cpu, nthreads);
+
+  /* A prefix length no address family has: the workers leave it to the
+     main thread, which has to reset the session all the same.  */
+  memcpy (&broken, &messages[0], sizeof (broken));
+  broken.data[broken.size++] = 33;
+  peer_lock (sync);
+  peer_lock (piped);
+  feed (sync, &broken);
+  bgp_update_receive (sync, broken.size, NULL);
+  feed (piped, &broken);
+  if (bgp_pipeline_submit (piped, broken.size) < 0)
+    bgp_update_receive (piped, broken.size, NULL);
+  settle (sync);
+  settle (piped);
+  if (sync->status == Established || piped->status == Established)
+    {
+      printf ("broken message left the session %s synchronously,"
+	      " %s through the pipeline\n",
+	      LOOKUP (bgp_status_msg, sync->status),
+	      LOOKUP (bgp_status_msg, piped->status));
+      errors++;
+    }
+  peer_unlock (sync);
+  peer_unlock (piped);
+
+  bgp_pipeline_finish ();
+  XFREE (MTYPE_TMP, messages);
+
+  printf ("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,412 @@
+/*
+ * BGP table memory harness.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* A number of eBGP peers (by default 20) each send the same synthetic
+ * table, by default 50000 IPv4 prefixes and a tenth as many IPv6 ones,
+ * through bgp_update_receive.  Every four prefixes share a path, with
+ * an AS_PATH of the peer's AS and two more, a community on a third of
+ * them and an AGGREGATOR on a seventh; the IPv6 prefixes come in
+ * MP_REACH_NLRI with the peer's address as nexthop.  Every other peer
+ * has a weight set, as is done for a preferred transit.
+ *
+ * Once the RIB is settled, the heap taken by the tables, from the
+ * MTYPE counters, is divided by the number of paths.  The same is given
+ * for the old layout, a malloc for each path of a bgp_info with a prev
+ * pointer and of its extra, and a copy of the extra attributes for each
+ * interned attribute, from the counts of this run.  Then the peers are
+ * taken down again and the memory must all be given back.
+ *
+ * usage: testbgptable [peers [prefixes]]
+ */
+#include <zebra.h>
+#include <sys/time.h>
+#include <stddef.h>
+#include <malloc.h>
+
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "prefix.h"
+#include "thread.h"
+#include "workqueue.h"
+#include "if.h"
+#include "sockunion.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_packet.h"
+
+/* need these to link in libbgp; bgp_get opens the listen socket */
+struct zebra_privs_t bgpd_privs;
+struct thread_master *master = NULL;
+
+static as_t asn = 100;
+
+#define PREFIXES_PER_PATH 4
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* The heap a malloc of size bytes takes, with the allocator's header. */
+static size_t
+chunk (size_t size)
+{
+  void *p = malloc (size);
+  size_t used = malloc_usable_size (p) + sizeof (size_t);
+
+  free (p);
+  return used;
+}
+
+static size_t
+mtype_heap (int type)
+{
+  return mtype_stats_bytes (type) + mtype_stats_alloc (type) * sizeof (size_t);
+}
+
+static size_t
+heap_used (void)
+{
+  size_t used = 0;
+  int type;
+
+  for (type = 1; type < MTYPE_MAX; type++)
+    used += mtype_heap (type);
+  return used;
+}
+
+static void
+report (const char *layout, size_t info, size_t extra, size_t attre,
+	size_t other, unsigned long paths)
+{
+  size_t total = info + extra + attre + other;
+
+  printf ("%-7s %10zu %10zu %10zu %10zu %10zu %8.1f\n", layout,
+	  info, extra, attre, other, total, (double) total / paths);
+}
+
+static void
+put_prefix4 (struct stream *s, int n)
+{
+  stream_putc (s, 24);
+  stream_putc (s, 1 + (n >> 16));
+  stream_putc (s, n >> 8);
+  stream_putc (s, n);
+}
+
+static void
+put_prefix6 (struct stream *s, int n)
+{
+  stream_putc (s, 48);
+  stream_putl (s, 0x20010db8);
+  stream_putw (s, n);
+}
+
+/* One UPDATE with the attributes of path j from peer number p and its
+   prefixes. */
+static void
+build_update (struct stream *s, int p, int j, int paths, int prefixes,
+	      int v6)
+{
+  size_t apos, lpos;
+  int k, n;
+
+  stream_reset (s);
+
+  /* No withdrawn routes.  */
+  stream_putw (s, 0);
+
+  apos = stream_get_endp (s);
+  stream_putw (s, 0);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_ORIGIN);
+  stream_putc (s, 1);
+  stream_putc (s, BGP_ORIGIN_IGP);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_AS_PATH);
+  stream_putc (s, 8);
+  stream_putc (s, AS_SEQUENCE);
+  stream_putc (s, 3);
+  stream_putw (s, 200 + p);
+  stream_putw (s, 1000 + (j * 7) % 200);
+  stream_putw (s, 20000 + j % 30000);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_NEXT_HOP);
+  stream_putc (s, 4);
+  stream_putl (s, 0xc0000201 + p);
+
+  /* This tree insists on MED and LOCAL_PREF, see bgp_attr_check.  */
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_MULTI_EXIT_DISC);
+  stream_putc (s, 4);
+  stream_putl (s, 0);
+
+  stream_putc (s, BGP_ATTR_FLAG_TRANS);
+  stream_putc (s, BGP_ATTR_LOCAL_PREF);
+  stream_putc (s, 4);
+  stream_putl (s, 100);
+
+  if (j % 3 == 0)
+    {
+      stream_putc (s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_COMMUNITIES);
+      stream_putc (s, 4);
+      stream_putl (s, ((200 + p) << 16) | (j % 100));
+    }
+
+  if (j % 7 == 0)
+    {
+      stream_putc (s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANS);
+      stream_putc (s, BGP_ATTR_AGGREGATOR);
+      stream_putc (s, 6);
+      stream_putw (s, 20000 + j % 30000);
+      stream_putl (s, 0x0a000000 + j);
+    }
+
+  if (v6)
+    {
+      stream_putc (s, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_EXTLEN);
+      stream_putc (s, BGP_ATTR_MP_REACH_NLRI);
+      lpos = stream_get_endp (s);
+      stream_putw (s, 0);
+      stream_putw (s, AFI_IP6);
+      stream_putc (s, SAFI_UNICAST);
+      stream_putc (s, 16);
+      stream_putl (s, 0x20010db8);
+      stream_putl (s, 0);
+      stream_putl (s, 0);
+      stream_putl (s, 0x100 + p);
+      stream_putc (s, 0);
+      for (k = 0; k < PREFIXES_PER_PATH; k++)
+	if ((n = j + k * paths) < prefixes)
+	  put_prefix6 (s, n);
+      stream_putw_at (s, lpos, stream_get_endp (s) - lpos - 2);
+    }
+
+  stream_putw_at (s, apos, stream_get_endp (s) - apos - 2);
+
+  if (! v6)
+    for (k = 0; k < PREFIXES_PER_PATH; k++)
+      if ((n = j + k * paths) < prefixes)
+	put_prefix4 (s, n);
+}
+
+static struct peer *
+test_peer (struct bgp *bgp, int p)
+{
+  struct peer *peer;
+  char host[32];
+
+  snprintf (host, sizeof (host), "192.0.2.%d", p + 1);
+  peer = peer_create_accept (bgp);
+  peer->host = strdup (host);
+  peer->as = 200 + p;
+  peer->local_as = asn;
+  peer->status = Established;
+  peer->established = 1;
+  /* Not negotiated, so that nothing is announced back and only the
+     paths are counted. */
+  peer->afc[AFI_IP][SAFI_UNICAST] = 1;
+  peer->afc[AFI_IP6][SAFI_UNICAST] = 1;
+  if (p % 2)
+    peer->weight = 100;
+  str2sockunion (host, &peer->su);
+  peer->su_remote = sockunion_dup (&peer->su);
+  peer->remote_id = peer->su.sin.sin_addr;
+
+  return peer;
+}
+
+static void
+load (struct peer *peer, int p, int prefixes, int v6)
+{
+  struct thread thread;
+  int paths = (prefixes + PREFIXES_PER_PATH - 1) / PREFIXES_PER_PATH;
+  int j;
+
+  for (j = 0; j < paths; j++)
+    {
+      build_update (peer->ibuf, p, j, paths, prefixes, v6);
+      bgp_update_receive (peer, stream_get_endp (peer->ibuf), NULL);
+
+      /* The Receive_UPDATE_message event, as the daemon would run it
+	 straight away.  */
+      while (master->event.count && thread_fetch (master, &thread))
+	thread_call (&thread);
+    }
+}
+
+static int
+queued (struct work_queue *wq)
+{
+  return wq && listcount (wq->items);
+}
+
+/* Let bgp_process and the clearing of peers run over everything
+   queued.  */
+static void
+settle (struct peer **peers, int npeers)
+{
+  struct thread thread;
+  int p, busy;
+
+  for (;;)
+    {
+      busy = queued (bm->process_main_queue);
+      for (p = 0; p < npeers; p++)
+	busy |= queued (peers[p]->clear_node_queue);
+      if (! busy || ! thread_fetch (master, &thread))
+	break;
+      thread_call (&thread);
+    }
+}
+
+static unsigned long
+count_paths (struct bgp *bgp, afi_t afi)
+{
+  struct bgp_node *rn;
+  struct bgp_info *ri;
+  unsigned long count = 0;
+
+  for (rn = bgp_table_top (bgp->rib[afi][SAFI_UNICAST]); rn;
+       rn = bgp_route_next (rn))
+    for (ri = rn->info; ri; ri = ri->next)
+      count++;
+
+  return count;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct bgp *bgp;
+  struct peer **peers;
+  int npeers = 20;
+  int prefixes = 50000;
+  int p, errors = 0;
+  unsigned long paths, paths4, paths6, expected;
+  size_t base, loaded, after, info, extra, attre, other;
+  double t;
+
+  if (argc > 1)
+    npeers = atoi (argv[1]);
+  if (argc > 2)
+    prefixes = atoi (argv[2]);
+  if (npeers <= 0 || npeers > 250 || prefixes <= 0 || prefixes > 0xf00000)
+    {
+      fprintf (stderr, "usage: %s [peers [prefixes]]\n", argv[0]);
+      exit (1);
+    }
+
+  zprivs_init (&bgpd_privs);
+  bgp_master_init ();
+  master = bm->master;
+  bm->port = 0;
+  bgp_option_set (BGP_OPT_NO_FIB);
+  bgp_attr_init ();
+  if_init ();
+  bgp_scan_init ();
+
+  if (bgp_get (&bgp, &asn, NULL))
+    return -1;
+
+  peers = XCALLOC (MTYPE_TMP, npeers * sizeof (struct peer *));
+  for (p = 0; p < npeers; p++)
+    peers[p] = test_peer (bgp, p);
+
+  base = heap_used ();
+  t = now ();
+  for (p = 0; p < npeers; p++)
+    {
+      load (peers[p], p, prefixes, 0);
+      load (peers[p], p, prefixes / 10, 1);
+    }
+  settle (peers, npeers);
+  t = now () - t;
+  loaded = heap_used ();
+
+  paths4 = count_paths (bgp, AFI_IP);
+  paths6 = count_paths (bgp, AFI_IP6);
+  paths = paths4 + paths6;
+  expected = (unsigned long) npeers * (prefixes + prefixes / 10);
+  if (paths != expected)
+    {
+      printf ("%lu paths in the RIB, expected %lu\n", paths, expected);
+      errors++;
+    }
+
+  printf ("%d peers, %lu IPv4 and %lu IPv6 paths loaded in %.3f s\n",
+	  npeers, paths4, paths6, t);
+  printf ("%lu attributes, %lu extra attributes shared by %lu of them, "
+	  "%lu AS paths\n", attr_count (), attr_extra_count (),
+	  attr_extra_refcount (), aspath_count ());
+
+  /* Bytes of heap taken by the paths, their extras, the extra
+     attributes and everything else.  */
+  info = mtype_heap (MTYPE_BGP_ROUTE);
+  extra = mtype_heap (MTYPE_BGP_ROUTE_EXTRA);
+  attre = mtype_heap (MTYPE_ATTR_EXTRA);
+  other = loaded - base - info - extra - attre;
+  printf ("%-7s %10s %10s %10s %10s %10s %8s\n", "layout", "bgp_info",
+	  "extra", "attr_extra", "other", "total", "per path");
+  report ("old", paths * chunk (sizeof (struct bgp_info) + sizeof (void *)),
+	  bgp_info_extra_count () * chunk (sizeof (struct bgp_info_extra)),
+	  attr_extra_refcount ()
+	  * chunk (offsetof (struct attr_extra, refcnt)),
+	  other, paths);
+  report ("current", info, extra, attre, other, paths);
+
+  for (p = 0; p < npeers; p++)
+    {
+      /* Or the FSM would try to connect again once cleared.  */
+      SET_FLAG (peers[p]->flags, PEER_FLAG_SHUTDOWN);
+      peers[p]->status = Clearing;
+      bgp_clear_route_all (peers[p]);
+    }
+  settle (peers, npeers);
+  after = heap_used ();
+  if (count_paths (bgp, AFI_IP) || count_paths (bgp, AFI_IP6))
+    {
+      printf ("paths left after clearing the peers\n");
+      errors++;
+    }
+  printf ("%zd bytes of heap left after clearing the peers\n",
+	  (ssize_t) (after - base));
+
+  XFREE (MTYPE_TMP, peers);
+
+  printf ("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
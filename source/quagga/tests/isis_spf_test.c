@@ -0,0 +1,453 @@
+/*
+ * IS-IS SPF test.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* An L1L2 area is given a random LSP database for each level, a number
+ * of systems (by default 200) each announcing one prefix, with small
+ * metrics so that there are many paths of the same cost.  This system
+ * is the first one, its neighbours on point-to-point circuits.  The
+ * level 2 database also has a neighbour whose LSP is missing.
+ *
+ * The distances SPF finds must be those of a plain Dijkstra over the
+ * same graph, and PATHS must come out of TENT in order of distance,
+ * vertex type and system id.  With spf-parallel, computing both levels
+ * at once must give the same PATHS, in the same order, as computing
+ * them in turn, and what level 2 logs from its thread must be logged
+ * once it is done.
+ *
+ * usage: testisisspf [systems]
+ */
+#include <zebra.h>
+
+#include "vty.h"
+#include "log.h"
+#include "memory.h"
+#include "linklist.h"
+#include "prefix.h"
+#include "thread.h"
+#include "hash.h"
+#include "pqueue.h"
+#include "if.h"
+#include "privs.h"
+
+#include "isisd/dict.h"
+#include "isisd/isis_constants.h"
+#include "isisd/isis_common.h"
+#include "isisd/isisd.h"
+#include "isisd/isis_circuit.h"
+#include "isisd/isis_csm.h"
+#include "isisd/isis_adjacency.h"
+#include "isisd/isis_tlv.h"
+#include "isisd/isis_lsp.h"
+#include "isisd/isis_spf.h"
+
+/* need these to link in libisis, without the socket code of isisd */
+struct zebra_privs_t isisd_privs;
+struct thread_master *master = NULL;
+
+int
+isis_sock_init (struct isis_circuit *circuit)
+{
+  return ISIS_ERROR;
+}
+
+extern struct isis *isis;
+extern void isis_new (unsigned long);
+extern struct isis_area *isis_area_create (void);
+extern int isis_run_spf_l1 (struct thread *);
+extern int isis_run_spf_l2 (struct thread *);
+
+/* Metrics are 1 to METRIC_MAX, prefixes are announced at 0 to
+   PREFIX_METRIC_MAX.  */
+#define METRIC_MAX 4
+#define PREFIX_METRIC_MAX 3
+#define LINKS_PER_SYSTEM 3
+
+#define UNREACHABLE 0xffffffff
+
+static int failed;
+
+#define CHECK(C, ...) \
+  do { \
+    if (! (C)) \
+      { \
+	printf ("FAILED %s:%d: ", __FILE__, __LINE__); \
+	printf (__VA_ARGS__); \
+	printf ("\n"); \
+	failed++; \
+      } \
+  } while (0)
+
+/* Systems 0 to systems - 1 have an LSP, system "systems" is the level 2
+   neighbour which has none.  */
+static int systems;
+
+/* metric[level][a * (systems + 1) + b] of the link from a to b, 0 for
+   none.  */
+static u_char *metric[ISIS_LEVELS];
+static u_char *prefix_metric[ISIS_LEVELS];
+static u_int32_t *dist[ISIS_LEVELS];
+
+static struct nlpids nlpids = { 1, { NLPID_IP } };
+
+/* A vertex as SPF put it in PATHS.  */
+struct path
+{
+  enum vertextype type;
+  u_int32_t d_N;
+  int system;
+};
+
+#define LINK(L, A, B) metric[L][(A) * (systems + 1) + (B)]
+
+static void
+system_id (int system, u_char *id)
+{
+  memset (id, 0, ISIS_SYS_ID_LEN + 2);
+  id[ISIS_SYS_ID_LEN - 2] = system >> 8;
+  id[ISIS_SYS_ID_LEN - 1] = system;
+}
+
+static void
+system_prefix (int system, struct prefix *p)
+{
+  memset (p, 0, sizeof (struct prefix));
+  p->family = AF_INET;
+  p->prefixlen = 24;
+  p->u.prefix4.s_addr = htonl (0x0a000000 | (system << 8));
+}
+
+/* Each system is linked to one before it, so that all are reachable,
+   and to a few more at random.  */
+static void
+make_graph (int level)
+{
+  int a, b, i, m;
+
+  for (a = 1; a < systems; a++)
+    for (i = 0; i < LINKS_PER_SYSTEM; i++)
+      {
+	b = i == 0 ? random () % a : random () % systems;
+	if (a == b)
+	  continue;
+	m = 1 + random () % METRIC_MAX;
+	LINK (level, a, b) = LINK (level, b, a) = m;
+      }
+  for (a = 1; a < systems; a++)
+    prefix_metric[level][a] = random () % (PREFIX_METRIC_MAX + 1);
+
+  if (level == 1)
+    LINK (level, systems - 1, systems) = 1;
+}
+
+static void
+dijkstra (int level)
+{
+  u_int32_t *d = dist[level];
+  char *done;
+  int a, b;
+
+  done = calloc (systems + 1, 1);
+  for (a = 0; a <= systems; a++)
+    d[a] = UNREACHABLE;
+  d[0] = 0;
+
+  for (;;)
+    {
+      a = -1;
+      for (b = 0; b <= systems; b++)
+	if (! done[b] && d[b] != UNREACHABLE && (a < 0 || d[b] < d[a]))
+	  a = b;
+      if (a < 0)
+	break;
+      done[a] = 1;
+      if (a == systems)
+	continue;
+      for (b = 0; b <= systems; b++)
+	if (LINK (level, a, b) && d[a] + LINK (level, a, b) < d[b])
+	  d[b] = d[a] + LINK (level, a, b);
+    }
+  free (done);
+}
+
+static struct isis_circuit *
+test_circuit (struct isis_area *area, int system)
+{
+  struct isis_circuit *circuit;
+  struct isis_adjacency *adj;
+  int level;
+
+  circuit = XCALLOC (MTYPE_ISIS_CIRCUIT, sizeof (struct isis_circuit));
+  adj = XCALLOC (MTYPE_ISIS_ADJACENCY, sizeof (struct isis_adjacency));
+
+  system_id (system, adj->sysid);
+  adj->sys_type = ISIS_SYSTYPE_L2_IS;
+  adj->nlpids = nlpids;
+  adj->circuit = circuit;
+
+  circuit->state = C_STATE_UP;
+  circuit->circ_type = CIRCUIT_T_P2P;
+  circuit->ip_router = 1;
+  circuit->ip_addrs = list_new ();
+  circuit->u.p2p.neighbor = adj;
+  for (level = 0; level < ISIS_LEVELS; level++)
+    if (LINK (level, 0, system))
+      {
+	circuit->circuit_is_type |= level + 1;
+	circuit->te_metric[level] = LINK (level, 0, system);
+      }
+
+  listnode_add (area->circuit_list, circuit);
+  area->ip_circuits++;
+
+  return circuit;
+}
+
+static void
+make_lsps (struct isis_area *area, int level, struct isis_adjacency *adj)
+{
+  struct isis_lsp *lsp;
+  struct is_neigh *neigh;
+  struct ipv4_reachability *reach;
+  struct prefix p;
+  u_char id[ISIS_SYS_ID_LEN + 2];
+  int a, b;
+
+  for (a = 0; a < systems; a++)
+    {
+      system_id (a, id);
+      lsp = lsp_new (id, MAX_AGE, 1, 0, 0, level + 1);
+      lsp->adj = adj;
+      lsp->tlv_data.nlpids = &nlpids;
+      lsp->tlv_data.is_neighs = list_new ();
+      for (b = 0; b <= systems; b++)
+	if (LINK (level, a, b))
+	  {
+	    neigh = calloc (1, sizeof (struct is_neigh));
+	    system_id (b, neigh->neigh_id);
+	    neigh->metrics.metric_default = LINK (level, a, b);
+	    listnode_add (lsp->tlv_data.is_neighs, neigh);
+	  }
+      if (a > 0)
+	{
+	  system_prefix (a, &p);
+	  reach = calloc (1, sizeof (struct ipv4_reachability));
+	  reach->prefix = p.u.prefix4;
+	  masklen2ip (p.prefixlen, &reach->mask);
+	  reach->metrics.metric_default = prefix_metric[level][a];
+	  lsp->tlv_data.ipv4_int_reachs = list_new ();
+	  listnode_add (lsp->tlv_data.ipv4_int_reachs, reach);
+	}
+      lsp_insert (lsp, area->lspdb[level]);
+    }
+}
+
+/* Take PATHS down, checking them against the distances of Dijkstra and
+   the order they must come out of TENT in.  */
+static int
+check_paths (struct isis_area *area, int level, const char *what,
+	     struct path *paths)
+{
+  struct isis_spftree *spftree = area->spftree[level];
+  struct listnode *node;
+  struct isis_vertex *vertex, *prev = NULL;
+  u_int32_t want;
+  int n = 0, systems_found = 0, prefixes_found = 0;
+  int reachable = 0, announced = 0, a;
+
+  CHECK (spftree->tents->size == 0, "%s: L%d TENT has %d vertices left",
+	 what, level + 1, spftree->tents->size);
+
+  for (ALL_LIST_ELEMENTS_RO (spftree->paths, node, vertex))
+    {
+      if (vertex->type <= VTYPE_ES)
+	{
+	  a = (vertex->N.id[ISIS_SYS_ID_LEN - 2] << 8)
+	    | vertex->N.id[ISIS_SYS_ID_LEN - 1];
+	  want = dist[level][a];
+	  systems_found++;
+	}
+      else
+	{
+	  a = (ntohl (vertex->N.prefix.u.prefix4.s_addr) >> 8) & 0xffff;
+	  want = dist[level][a] + prefix_metric[level][a];
+	  prefixes_found++;
+	}
+      CHECK (vertex->d_N == want, "%s: L%d %s %d at %u, expected %u",
+	     what, level + 1, vertex->type <= VTYPE_ES ? "system" : "prefix",
+	     a, vertex->d_N, want);
+      CHECK (vertex->tent_index == -1 || prev == NULL,
+	     "%s: L%d vertex %d in PATHS still in TENT", what, level + 1, n);
+
+      if (prev)
+	CHECK (prev->d_N < vertex->d_N
+	       || (prev->d_N == vertex->d_N
+		   && (prev->type < vertex->type
+		       || (prev->type == vertex->type
+			   && (vertex->type > VTYPE_ES
+			       || memcmp (prev->N.id, vertex->N.id,
+					  ISIS_SYS_ID_LEN + 1) < 0)))),
+	       "%s: L%d vertex %d out of order", what, level + 1, n);
+
+      paths[n].type = vertex->type;
+      paths[n].d_N = vertex->d_N;
+      paths[n].system = a;
+      prev = vertex;
+      n++;
+    }
+
+  for (a = 0; a <= systems; a++)
+    if (dist[level][a] != UNREACHABLE)
+      {
+	reachable++;
+	announced += (a > 0 && a < systems);
+      }
+  CHECK (systems_found == reachable && prefixes_found == announced,
+	 "%s: L%d %d systems and %d prefixes in PATHS, expected %d and %d",
+	 what, level + 1, systems_found, prefixes_found, reachable, announced);
+
+  return n;
+}
+
+static int
+logged (const char *file, const char *text)
+{
+  char line[512];
+  FILE *fp;
+  int found = 0;
+
+  fp = fopen (file, "r");
+  if (fp == NULL)
+    return 0;
+  while (! found && fgets (line, sizeof (line), fp))
+    found = (strstr (line, text) != NULL);
+  fclose (fp);
+  return found;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct isis_area *area;
+  struct isis_circuit *circuit = NULL;
+  struct path *serial[ISIS_LEVELS], *parallel[ISIS_LEVELS];
+  int n_serial[ISIS_LEVELS], n_parallel[ISIS_LEVELS];
+  struct thread thread;
+  char logfile[] = "/tmp/testisisspf.XXXXXX";
+  char missing[64];
+  int level, a, i, fd;
+
+  if (argc > 1)
+    systems = atoi (argv[1]);
+  else
+    systems = 200;
+  if (systems < 4 || systems > 0xff00)
+    {
+      fprintf (stderr, "usage: %s [systems]\n", argv[0]);
+      exit (1);
+    }
+
+  fd = mkstemp (logfile);
+  if (fd < 0)
+    {
+      perror ("mkstemp");
+      exit (1);
+    }
+  close (fd);
+  snprintf (missing, sizeof (missing), "No LSP found for 0000.0000.%02x%02x."
+	    "00-00", (systems >> 8) & 0xff, systems & 0xff);
+  zlog_default = openzlog ("testisisspf", ZLOG_ISIS, LOG_NDELAY,
+			   LOG_DAEMON);
+  zlog_set_level (NULL, ZLOG_DEST_STDOUT, ZLOG_DISABLED);
+  zlog_set_level (NULL, ZLOG_DEST_SYSLOG, ZLOG_DISABLED);
+  zlog_set_file (NULL, logfile, LOG_WARNING);
+
+  srandom (1);
+  master = thread_master_create ();
+  isis_new (0);
+  system_id (0, isis->sysid);
+  area = isis_area_create ();
+  area->area_tag = strdup ("test");
+  listnode_add (isis->area_list, area);
+
+  for (level = 0; level < ISIS_LEVELS; level++)
+    {
+      metric[level] = calloc ((systems + 1) * (systems + 1), 1);
+      prefix_metric[level] = calloc (systems + 1, 1);
+      dist[level] = calloc (systems + 1, sizeof (u_int32_t));
+      serial[level] = calloc (2 * (systems + 1), sizeof (struct path));
+      parallel[level] = calloc (2 * (systems + 1), sizeof (struct path));
+      make_graph (level);
+      dijkstra (level);
+    }
+
+  /* A circuit to each neighbour on either level.  */
+  for (a = 1; a < systems; a++)
+    if (LINK (0, 0, a) || LINK (1, 0, a))
+      circuit = test_circuit (area, a);
+  for (level = 0; level < ISIS_LEVELS; level++)
+    make_lsps (area, level, circuit->u.p2p.neighbor);
+
+  /* One level after the other.  */
+  thread.arg = area;
+  isis_run_spf_l1 (&thread);
+  isis_run_spf_l2 (&thread);
+  for (level = 0; level < ISIS_LEVELS; level++)
+    n_serial[level] = check_paths (area, level, "serial", serial[level]);
+  CHECK (logged (logfile, missing),
+	 "serial: missing LSP not logged");
+
+  /* Both at once, from either level's timer.  */
+  area->spf_parallel = 1;
+  for (i = 0; i < 2; i++)
+    {
+      fd = open (logfile, O_WRONLY | O_TRUNC);
+      close (fd);
+      if (i == 0)
+	isis_run_spf_l1 (&thread);
+      else
+	isis_run_spf_l2 (&thread);
+
+      for (level = 0; level < ISIS_LEVELS; level++)
+	{
+	  n_parallel[level] = check_paths (area, level, "parallel",
+					   parallel[level]);
+	  CHECK (n_parallel[level] == n_serial[level]
+		 && ! memcmp (parallel[level], serial[level],
+			      n_serial[level] * sizeof (struct path)),
+		 "parallel: L%d PATHS differ from those computed in turn",
+		 level + 1);
+	  CHECK (area->spftree[level]->msgs == NULL,
+		 "parallel: L%d messages left held", level + 1);
+	}
+      CHECK (logged (logfile, missing),
+	     "parallel: missing LSP not logged from the L2 thread");
+      CHECK (area->spftree[0]->runcount == 2 + i
+	     && area->spftree[1]->runcount == 2 + i,
+	     "parallel: %u L1 and %u L2 runs, expected %d each",
+	     area->spftree[0]->runcount, area->spftree[1]->runcount, 2 + i);
+    }
+
+  unlink (logfile);
+
+  printf ("%d systems, %d and %d vertices in PATHS: %s\n", systems,
+	  n_serial[0], n_serial[1], failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+/*
+ * Prefix-list lookup test and benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Builds a large prefix-list (by default 50000 entries, the size of an
+ * IRR generated transit filter) and runs a table's worth of prefixes
+ * (by default 800000) through prefix_list_apply.  A sample of the
+ * lookups is cross-checked against a linear first-match walk, which is
+ * also timed to show what the old per-entry walk cost.
+ *
+ * usage: testplist [entries [prefixes]]
+ */
+#include <zebra.h>
+#include <sys/time.h>
+
+#include "prefix.h"
+#include "memory.h"
+#include "vty.h"
+#include "command.h"
+#include "plist.h"
+
+struct thread_master *master;
+
+#define PLIST_NAME  "testplist"
+#define SAMPLE      2000
+
+struct entry
+{
+  struct orf_prefix orf;
+  int permit;
+  int deleted;
+};
+
+static struct entry *entries;
+static int nentries;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+random_prefix (struct prefix *p, int minlen, int maxlen)
+{
+  memset (p, 0, sizeof (struct prefix));
+  p->family = AF_INET;
+  p->prefixlen = minlen + random () % (maxlen - minlen + 1);
+  p->u.prefix4.s_addr = htonl ((u_int32_t) random () << 1 ^ random ());
+  apply_mask (p);
+}
+
+/* The semantics prefix_list_apply implements: first entry in seq
+   order whose prefix covers P and whose ge/le range allows P's length. */
+static enum prefix_list_type
+linear_apply (struct prefix *p)
+{
+  int i;
+
+  for (i = 0; i < nentries; i++)
+    {
+      struct entry *e = &entries[i];
+
+      if (e->deleted || ! prefix_match (&e->orf.p, p))
+	continue;
+
+      if (! e->orf.le && ! e->orf.ge)
+	{
+	  if (e->orf.p.prefixlen != p->prefixlen)
+	    continue;
+	}
+      else
+	{
+	  if (e->orf.le && p->prefixlen > e->orf.le)
+	    continue;
+	  if (e->orf.ge && p->prefixlen < e->orf.ge)
+	    continue;
+	}
+      return e->permit ? PREFIX_PERMIT : PREFIX_DENY;
+    }
+  return PREFIX_DENY;
+}
+
+static void
+build_list (int count)
+{
+  int i;
+
+  entries = XCALLOC (MTYPE_TMP, count * sizeof (struct entry));
+
+  /* Random entries sometimes repeat one already in the list, which
+     prefix_bgp_orf_set refuses; draw until the list is full. */
+  for (i = 0; nentries < count; i++)
+    {
+      struct entry *e = &entries[nentries];
+      struct orf_prefix *orf = &e->orf;
+
+      random_prefix (&orf->p, 8, 24);
+      orf->seq = (i + 1) * 5;
+      switch (random () % 3)
+	{
+	case 0:
+	  break;
+	case 1:
+	  orf->le = orf->p.prefixlen + 1 + random () % (32 - orf->p.prefixlen);
+	  break;
+	default:
+	  orf->ge = orf->p.prefixlen + 1 + random () % (31 - orf->p.prefixlen);
+	  orf->le = orf->ge + random () % (33 - orf->ge);
+	  break;
+	}
+      e->permit = (random () % 4) != 0;
+
+      if (prefix_bgp_orf_set (PLIST_NAME, AFI_IP, orf, e->permit, 1)
+	  == CMD_SUCCESS)
+	nentries++;
+      else
+	memset (e, 0, sizeof (struct entry));
+    }
+}
+
+/* Half of the prefixes are carved out of list entries so that a good
+   share of lookups hit something deep in the list. */
+static struct prefix *
+build_prefixes (int count)
+{
+  struct prefix *ps;
+  int i;
+
+  ps = XCALLOC (MTYPE_TMP, count * sizeof (struct prefix));
+  for (i = 0; i < count; i++)
+    {
+      if (i % 2)
+	random_prefix (&ps[i], 8, 32);
+      else
+	{
+	  struct prefix *e = &entries[random () % nentries].orf.p;
+	  struct prefix r;
+
+	  random_prefix (&r, 8, 32);
+	  ps[i] = *e;
+	  ps[i].prefixlen = e->prefixlen + random () % (33 - e->prefixlen);
+	  ps[i].u.prefix4.s_addr |= r.u.prefix4.s_addr
+	    & ~htonl (0xffffffff << (32 - e->prefixlen) & 0xffffffff);
+	  apply_mask (&ps[i]);
+	}
+    }
+  return ps;
+}
+
+static int
+verify (struct prefix_list *plist, struct prefix *ps, int count)
+{
+  int i, errors = 0;
+
+  for (i = 0; i < count; i++)
+    if (prefix_list_apply (plist, &ps[i]) != linear_apply (&ps[i]))
+      {
+	char buf[INET_ADDRSTRLEN];
+
+	if (errors++ < 10)
+	  printf ("mismatch for %s/%d\n",
+		  inet_ntop (AF_INET, &ps[i].u.prefix4, buf, sizeof (buf)),
+		  ps[i].prefixlen);
+      }
+  return errors;
+}
+
+/* Remove and re-add some entries, so that the index has to follow
+   edits in the middle of the list. */
+static void
+edit_list (int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      struct entry *e = &entries[random () % nentries];
+
+      if (e->deleted)
+	continue;
+      prefix_bgp_orf_set (PLIST_NAME, AFI_IP, &e->orf, e->permit, 0);
+      e->deleted = 1;
+    }
+  for (i = 0; i < count / 2; i++)
+    {
+      struct entry *e = &entries[random () % nentries];
+
+      if (! e->deleted)
+	continue;
+      if (prefix_bgp_orf_set (PLIST_NAME, AFI_IP, &e->orf, ! e->permit, 1)
+	  != CMD_SUCCESS)
+	continue;
+      e->permit = ! e->permit;
+      e->deleted = 0;
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  struct prefix_list *plist;
+  struct prefix *ps;
+  int nlist = 50000;
+  int nprefix = 800000;
+  int sample;
+  int errors;
+  int i, permit;
+  double t, tlist, tlinear, ttrie;
+
+  if (argc > 1)
+    nlist = atoi (argv[1]);
+  if (argc > 2)
+    nprefix = atoi (argv[2]);
+  if (nlist <= 0 || nprefix <= 0)
+    {
+      fprintf (stderr, "usage: %s [entries [prefixes]]\n", argv[0]);
+      exit (1);
+    }
+  sample = nprefix < SAMPLE ? nprefix : SAMPLE;
+
+  srandom (1);
+
+  t = now ();
+  build_list (nlist);
+  tlist = now () - t;
+
+  plist = prefix_list_lookup (AFI_ORF_PREFIX, PLIST_NAME);
+  assert (plist);
+  ps = build_prefixes (nprefix);
+
+  printf ("prefix-list: %d entries, built in %.3f s\n", nentries, tlist);
+
+  errors = verify (plist, ps, sample);
+
+  t = now ();
+  for (i = 0, permit = 0; i < sample; i++)
+    permit += (linear_apply (&ps[i]) == PREFIX_PERMIT);
+  tlinear = (now () - t) / sample;
+
+  t = now ();
+  for (i = 0, permit = 0; i < nprefix; i++)
+    permit += (prefix_list_apply (plist, &ps[i]) == PREFIX_PERMIT);
+  ttrie = (now () - t) / nprefix;
+
+  printf ("linear walk: %8.3f us/prefix, %8.3f s for %d prefixes"
+	  " (extrapolated from %d)\n",
+	  tlinear * 1e6, tlinear * nprefix, nprefix, sample);
+  printf ("trie index:  %8.3f us/prefix, %8.3f s for %d prefixes,"
+	  " %d permitted\n",
+	  ttrie * 1e6, ttrie * nprefix, nprefix, permit);
+
+  edit_list (nentries / 10 + 1);
+  errors += verify (plist, ps, sample);
+
+  prefix_bgp_orf_remove_all (PLIST_NAME);
+  assert (prefix_list_lookup (AFI_ORF_PREFIX, PLIST_NAME) == NULL);
+
+  XFREE (MTYPE_TMP, ps);
+  XFREE (MTYPE_TMP, entries);
+
+  printf ("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
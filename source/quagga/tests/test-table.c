@@ -0,0 +1,386 @@
+/*
+ * Routing table test and benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* First a few thousand random IPv4 and IPv6 prefixes are put in a
+ * table, half of them taken out again and some put back, checking
+ * route_node_get, route_node_lookup, route_node_match and a walk with
+ * route_next against a plain array of the prefixes after each round.
+ * The table must be empty, with its node blocks given back, at the end.
+ *
+ * Then the benchmark: a table of a number of IPv4 prefixes (by default
+ * 500000, /8 to /24 weighted as a full BGP table is) is built, random
+ * addresses looked up in it, and torn down again, timing each.
+ *
+ * usage: testtable [prefixes [lookups]]
+ */
+#include <zebra.h>
+#include <sys/time.h>
+
+#include "prefix.h"
+#include "table.h"
+#include "memory.h"
+
+struct thread_master *master;
+
+#define CHECK_PREFIXES 3000
+#define CHECK_ADDRS    20000
+
+struct entry
+{
+  struct prefix p;
+  int present;
+};
+
+static struct entry entries[CHECK_PREFIXES];
+static int failed;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+fail (const char *what, const struct prefix *p)
+{
+  char buf[INET6_ADDRSTRLEN + 4];
+
+  prefix2str (p, buf, sizeof (buf));
+  printf ("FAIL: %s %s\n", what, buf);
+  failed++;
+}
+
+/* Prefixes are drawn from a few short ranges, so that they nest. */
+static void
+random_prefix (struct prefix *p, int family)
+{
+  int i;
+
+  memset (p, 0, sizeof (struct prefix));
+  p->family = family;
+  if (family == AF_INET)
+    {
+      p->prefixlen = random () % (IPV4_MAX_BITLEN + 1);
+      p->u.prefix4.s_addr = htonl ((10U << 24) | (random () & 0x3ffff));
+      if (random () % 4 == 0)
+	p->u.prefix4.s_addr = htonl (random ());
+    }
+  else
+    {
+      p->prefixlen = random () % (IPV6_MAX_BITLEN + 1);
+      for (i = 0; i < 16; i++)
+	p->u.prefix6.s6_addr[i] = (i < 2 ? 0x20 : (random () & 0x0f));
+    }
+  apply_mask (p);
+}
+
+static void
+random_addr (struct prefix *p, int family)
+{
+  random_prefix (p, family);
+  p->prefixlen = (family == AF_INET ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN);
+  if (family == AF_INET)
+    p->u.prefix4.s_addr |= htonl (random () & 0xff);
+}
+
+/* Longest present prefix covering p, the slow way. */
+static struct entry *
+reference_match (const struct prefix *p)
+{
+  struct entry *best = NULL;
+  int i;
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    if (entries[i].present && prefix_match (&entries[i].p, p)
+	&& (best == NULL || entries[i].p.prefixlen > best->p.prefixlen))
+      best = &entries[i];
+  return best;
+}
+
+static struct entry *
+reference_lookup (const struct prefix *p)
+{
+  int i;
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    if (entries[i].present && prefix_same (&entries[i].p, p))
+      return &entries[i];
+  return NULL;
+}
+
+static void
+check_table (struct route_table *table, int family)
+{
+  struct route_node *rn;
+  struct prefix p;
+  int i, walked, present;
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    {
+      rn = route_node_lookup (table, &entries[i].p);
+      if ((rn ? rn->info : NULL) != reference_lookup (&entries[i].p))
+	fail ("lookup", &entries[i].p);
+      if (rn)
+	route_unlock_node (rn);
+    }
+
+  for (i = 0; i < CHECK_ADDRS; i++)
+    {
+      random_addr (&p, family);
+      rn = route_node_match (table, &p);
+      if ((rn ? rn->info : NULL) != reference_match (&p))
+	fail ("match", &p);
+      if (rn)
+	route_unlock_node (rn);
+    }
+
+  present = 0;
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    if (entries[i].present)
+      present++;
+
+  walked = 0;
+  for (rn = route_top (table); rn; rn = route_next (rn))
+    if (rn->info)
+      {
+	struct entry *e = rn->info;
+
+	if (!prefix_same (&rn->p, &e->p))
+	  fail ("walk", &rn->p);
+	walked++;
+      }
+  if (walked != present)
+    {
+      printf ("FAIL: walked %d routes of %d\n", walked, present);
+      failed++;
+    }
+}
+
+static void
+add (struct route_table *table, struct entry *e)
+{
+  struct route_node *rn;
+
+  rn = route_node_get (table, &e->p);
+  if (rn->info)
+    {
+      /* A duplicate prefix drawn, keep the first. */
+      route_unlock_node (rn);
+      return;
+    }
+  rn->info = e;
+  e->present = 1;
+}
+
+static void
+del (struct route_table *table, struct entry *e)
+{
+  struct route_node *rn;
+
+  if (!e->present)
+    return;
+  rn = route_node_lookup (table, &e->p);
+  if (rn == NULL || rn->info != e)
+    {
+      fail ("delete", &e->p);
+      return;
+    }
+  rn->info = NULL;
+  route_unlock_node (rn);
+  route_unlock_node (rn);
+  e->present = 0;
+}
+
+static void
+check (int family)
+{
+  struct route_table *table;
+  int i;
+
+  table = route_table_init ();
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    {
+      random_prefix (&entries[i].p, family);
+      entries[i].present = 0;
+      add (table, &entries[i]);
+    }
+  check_table (table, family);
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    if (random () % 2)
+      del (table, &entries[i]);
+  check_table (table, family);
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    if (random () % 4 == 0)
+      add (table, &entries[i]);
+  check_table (table, family);
+
+  for (i = 0; i < CHECK_PREFIXES; i++)
+    del (table, &entries[i]);
+  if (table->top || table->count || table->blocks)
+    {
+      printf ("FAIL: %s table not empty, %lu nodes left\n",
+	      family == AF_INET ? "IPv4" : "IPv6", table->count);
+      failed++;
+    }
+
+  route_table_finish (table);
+}
+
+/* Prefix lengths roughly as in a full BGP table, mostly /24. */
+static u_char
+bench_prefixlen (void)
+{
+  int r = random () % 100;
+
+  if (r < 55)
+    return 24;
+  if (r < 65)
+    return 23;
+  if (r < 75)
+    return 22;
+  if (r < 85)
+    return 20 + random () % 2;
+  return 8 + random () % 12;
+}
+
+/* Unicast addresses, 1.0.0.0 to 222.255.255.255. */
+static u_int32_t
+bench_addr (void)
+{
+  return (1U << 24) + ((u_int32_t) random () << 1 ^ random ()) % (222U << 24);
+}
+
+static void
+bench (int prefixes, int lookups)
+{
+  struct route_table *table;
+  struct route_node *rn;
+  struct prefix_ipv4 p;
+  struct in_addr *addrs;
+  struct prefix_ipv4 *ps;
+  double start, took;
+  int i, found = 0;
+  unsigned long nodes;
+
+  ps = XMALLOC (MTYPE_TMP, prefixes * sizeof (struct prefix_ipv4));
+  addrs = XMALLOC (MTYPE_TMP, lookups * sizeof (struct in_addr));
+  for (i = 0; i < prefixes; i++)
+    {
+      ps[i].family = AF_INET;
+      ps[i].prefixlen = bench_prefixlen ();
+      ps[i].prefix.s_addr = htonl (bench_addr ());
+      apply_mask_ipv4 (&ps[i]);
+    }
+  for (i = 0; i < lookups; i++)
+    addrs[i].s_addr = htonl (bench_addr ());
+
+  table = route_table_init ();
+
+  start = now ();
+  for (i = 0; i < prefixes; i++)
+    {
+      rn = route_node_get (table, (struct prefix *) &ps[i]);
+      if (rn->info)
+	route_unlock_node (rn);
+      else
+	rn->info = &ps[i];
+    }
+  took = now () - start;
+  nodes = table->count;
+  printf ("%d prefixes added in %.3f s, %.0f ns each, %lu nodes\n",
+	  prefixes, took, took * 1e9 / prefixes, nodes);
+
+  printf ("%zu bytes per IPv4 node, %zu full size\n",
+	  offsetof (struct route_node, p) + sizeof (struct prefix_ipv4),
+	  sizeof (struct route_node));
+
+  start = now ();
+  for (i = 0; i < lookups; i++)
+    if ((rn = route_node_match_ipv4 (table, &addrs[i])) != NULL)
+      {
+	found++;
+	route_unlock_node (rn);
+      }
+  took = now () - start;
+  printf ("%d lookups in %.3f s, %.0f ns each, %d matched\n",
+	  lookups, took, took * 1e9 / lookups, found);
+
+  start = now ();
+  for (i = 0; i < prefixes; i++)
+    {
+      p = ps[i];
+      rn = route_node_lookup (table, (struct prefix *) &p);
+      if (rn && rn->info == &ps[i])
+	{
+	  rn->info = NULL;
+	  route_unlock_node (rn);
+	  route_unlock_node (rn);
+	}
+      else if (rn)
+	route_unlock_node (rn);
+    }
+  took = now () - start;
+  printf ("%d prefixes deleted in %.3f s, %.0f ns each, %lu nodes left\n",
+	  prefixes, took, took * 1e9 / prefixes, table->count);
+
+  route_table_finish (table);
+  XFREE (MTYPE_TMP, ps);
+  XFREE (MTYPE_TMP, addrs);
+}
+
+int
+main (int argc, char **argv)
+{
+  int prefixes = 500000;
+  int lookups = 2000000;
+
+  if (argc > 1)
+    prefixes = atoi (argv[1]);
+  if (argc > 2)
+    lookups = atoi (argv[2]);
+  if (prefixes <= 0 || lookups <= 0)
+    {
+      fprintf (stderr, "usage: %s [prefixes [lookups]]\n", argv[0]);
+      exit (1);
+    }
+
+  srandom (1);
+
+  check (AF_INET);
+#ifdef HAVE_IPV6
+  check (AF_INET6);
+#endif /* HAVE_IPV6 */
+  if (failed)
+    {
+      printf ("%d checks failed\n", failed);
+      exit (1);
+    }
+  printf ("table checks passed\n");
+
+  bench (prefixes, lookups);
+  return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * Thread timer test and benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* First a few thousand short timers, foreground and background, are
+ * added, some cancelled and re-added, and run through thread_fetch:
+ * every timer left must fire exactly once, never before its time and
+ * not much after it.
+ *
+ * Then the benchmark: a number of concurrent timers (by default 10000,
+ * a few per peer of a large BGP speaker) with keepalive / hold sized
+ * timeouts, of which random ones are reset (cancelled and added again)
+ * over and over, as receiving a message does to a hold timer.  The same
+ * is timed for the sorted list the timers used to be kept in.
+ *
+ * usage: testtimer [timers [resets]]
+ */
+#include <zebra.h>
+#include <sys/time.h>
+
+#include "thread.h"
+#include "memory.h"
+
+struct thread_master *master;
+
+#define SHORT_TIMERS   4000
+#define SHORT_MAX_MSEC 1500
+
+/* Late beyond scheduling noise: a timer missed until the wheel came
+   round again would be a quarter of a second late, or more. */
+#define SHORT_MAX_LATE 100000
+
+struct short_timer
+{
+  struct thread *t;
+  struct timeval deadline;
+  int cancelled;
+  int fired;
+};
+
+static struct short_timer *shorts;
+static int early, late_ones, twice, spurious;
+static long max_late;
+static int outstanding;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static long
+timeval_diff_usec (struct timeval a, struct timeval b)
+{
+  return (a.tv_sec - b.tv_sec) * 1000000L + (a.tv_usec - b.tv_usec);
+}
+
+static int
+short_timer_func (struct thread *t)
+{
+  struct short_timer *s = THREAD_ARG (t);
+  struct timeval tv;
+  long late;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &tv);
+  late = timeval_diff_usec (tv, s->deadline);
+
+  if (s->cancelled)
+    spurious++;
+  if (s->fired++)
+    twice++;
+  if (late < 0)
+    early++;
+  if (late > SHORT_MAX_LATE)
+    late_ones++;
+  if (late > max_late)
+    max_late = late;
+
+  s->t = NULL;
+  outstanding--;
+  return 0;
+}
+
+static void
+short_timer_add (struct short_timer *s, int background)
+{
+  long msec = random () % SHORT_MAX_MSEC;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &s->deadline);
+  s->deadline.tv_sec += msec / 1000;
+  s->deadline.tv_usec += (msec % 1000) * 1000;
+  if (s->deadline.tv_usec >= 1000000)
+    {
+      s->deadline.tv_sec++;
+      s->deadline.tv_usec -= 1000000;
+    }
+
+  if (background)
+    s->t = thread_add_background (master, short_timer_func, s, msec);
+  else
+    s->t = thread_add_timer_msec (master, short_timer_func, s, msec);
+  s->cancelled = 0;
+  outstanding++;
+}
+
+static int
+run_short_timers (void)
+{
+  struct thread thread;
+  struct thread *far;
+  int i, errors = 0;
+  double deadline;
+
+  shorts = XCALLOC (MTYPE_TMP, SHORT_TIMERS * sizeof (struct short_timer));
+  for (i = 0; i < SHORT_TIMERS; i++)
+    short_timer_add (&shorts[i], i % 4 == 0);
+
+  /* Something far beyond the reach of the wheel, which must stay put. */
+  far = thread_add_timer (master, short_timer_func, NULL, 60 * 86400);
+
+  for (i = 0; i < SHORT_TIMERS; i += 3)
+    {
+      thread_cancel (shorts[i].t);
+      shorts[i].t = NULL;
+      shorts[i].cancelled = 1;
+      outstanding--;
+      if (i % 2)
+	short_timer_add (&shorts[i], i % 4 == 0);
+    }
+
+  deadline = now () + SHORT_MAX_MSEC / 1000.0 + 5;
+  while (outstanding > 0 && now () < deadline
+	 && thread_fetch (master, &thread))
+    thread_call (&thread);
+
+  for (i = 0; i < SHORT_TIMERS; i++)
+    if (! shorts[i].cancelled && ! shorts[i].fired)
+      errors++;
+  if (errors)
+    printf ("%d timers did not fire\n", errors);
+  if (early)
+    printf ("%d timers fired early\n", early);
+  if (late_ones)
+    printf ("%d timers fired late\n", late_ones);
+  if (twice)
+    printf ("%d timers fired twice\n", twice);
+  if (spurious)
+    printf ("%d cancelled timers fired\n", spurious);
+  printf ("short timers: %d, fired up to %ld us late\n",
+	  SHORT_TIMERS, max_late);
+
+  thread_cancel (far);
+  XFREE (MTYPE_TMP, shorts);
+  return errors + early + late_ones + twice + spurious;
+}
+
+/* The timer list as it was: sorted, with insertion by linear scan. */
+struct list_timer
+{
+  struct list_timer *next, *prev;
+  struct timeval sands;
+};
+
+static struct list_timer *list_head, *list_tail;
+
+static void
+list_timer_add (struct list_timer *t, long secs)
+{
+  struct list_timer *tt;
+
+  gettimeofday (&t->sands, NULL);
+  t->sands.tv_sec += secs;
+
+  for (tt = list_head; tt; tt = tt->next)
+    if (t->sands.tv_sec < tt->sands.tv_sec
+	|| (t->sands.tv_sec == tt->sands.tv_sec
+	    && t->sands.tv_usec <= tt->sands.tv_usec))
+      break;
+
+  t->next = tt;
+  t->prev = tt ? tt->prev : list_tail;
+  if (t->prev)
+    t->prev->next = t;
+  else
+    list_head = t;
+  if (tt)
+    tt->prev = t;
+  else
+    list_tail = t;
+}
+
+static void
+list_timer_delete (struct list_timer *t)
+{
+  if (t->next)
+    t->next->prev = t->prev;
+  else
+    list_tail = t->prev;
+  if (t->prev)
+    t->prev->next = t->next;
+  else
+    list_head = t->next;
+}
+
+static int
+dummy_func (struct thread *t)
+{
+  return 0;
+}
+
+/* Keepalive to hold time sized timeouts, in seconds. */
+static long
+random_timeout (void)
+{
+  return 30 + random () % 151;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct thread **timers;
+  struct list_timer *lists;
+  int ntimers = 10000;
+  int nresets = 1000000;
+  int nlist;
+  int i, errors;
+  double t, tadd, twheel, tlist;
+
+  if (argc > 1)
+    ntimers = atoi (argv[1]);
+  if (argc > 2)
+    nresets = atoi (argv[2]);
+  if (ntimers <= 0 || nresets <= 0)
+    {
+      fprintf (stderr, "usage: %s [timers [resets]]\n", argv[0]);
+      exit (1);
+    }
+
+  srandom (1);
+  master = thread_master_create ();
+
+  errors = run_short_timers ();
+
+  timers = XCALLOC (MTYPE_TMP, ntimers * sizeof (struct thread *));
+
+  t = now ();
+  for (i = 0; i < ntimers; i++)
+    timers[i] = thread_add_timer (master, dummy_func, NULL, random_timeout ());
+  tadd = (now () - t) / ntimers;
+
+  t = now ();
+  for (i = 0; i < nresets; i++)
+    {
+      int n = random () % ntimers;
+
+      thread_cancel (timers[n]);
+      timers[n] = thread_add_timer (master, dummy_func, NULL,
+				    random_timeout ());
+    }
+  twheel = (now () - t) / nresets;
+
+  for (i = 0; i < ntimers; i++)
+    thread_cancel (timers[i]);
+
+  /* The list is too slow to do as many resets.  */
+  lists = XCALLOC (MTYPE_TMP, ntimers * sizeof (struct list_timer));
+  for (i = 0; i < ntimers; i++)
+    list_timer_add (&lists[i], random_timeout ());
+  nlist = nresets / 50 + 1;
+  t = now ();
+  for (i = 0; i < nlist; i++)
+    {
+      int n = random () % ntimers;
+
+      list_timer_delete (&lists[n]);
+      list_timer_add (&lists[n], random_timeout ());
+    }
+  tlist = (now () - t) / nlist;
+
+  printf ("%d concurrent timers, added in %.3f us each\n",
+	  ntimers, tadd * 1e6);
+  printf ("timer wheel: %8.3f us/reset over %d resets\n",
+	  twheel * 1e6, nresets);
+  printf ("sorted list: %8.3f us/reset over %d resets\n",
+	  tlist * 1e6, nlist);
+
+  XFREE (MTYPE_TMP, lists);
+  XFREE (MTYPE_TMP, timers);
+  thread_master_free (master);
+
+  printf ("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
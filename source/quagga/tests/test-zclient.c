@@ -0,0 +1,258 @@
+/*
+ * zclient to zebra route channel benchmark.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/* Connects to a running zebra over its unix socket as a BGP client,
+ * pushes a number of blackhole routes (by default 100000) into it and
+ * then withdraws them, timing each until zebra has read every route.
+ * With -b the routes go in ZEBRA_IPV4_ROUTE_BATCH frames, as bgpd
+ * sends them, otherwise in one ZEBRA_IPV4_ROUTE_ADD/DELETE each; a
+ * zebra which does not acknowledge batches gets them one by one too.
+ *
+ * Routes are handed to zclient 1000 at a time from a background
+ * thread, so the acknowledgments of batch frames get read in between,
+ * and the next 1000 wait while the window holds messages back.
+ *
+ * With -c each route is announced that many times over when added,
+ * the whole set again each time with a higher metric, as a table does
+ * while BGP hunts for paths: the kernel need only see the last.
+ *
+ * With -k the routes are left in zebra, to be looked at there.
+ *
+ * zebra reads a client's messages in order, so the router-id update it
+ * answers a ZEBRA_ROUTER_ID_ADD with tells that it has read all the
+ * routes sent before.
+ *
+ * usage: testzclient [-b] [-c changes] [-k] [-n routes] [-z path]
+ */
+#include <zebra.h>
+#include <sys/time.h>
+
+#include "thread.h"
+#include "stream.h"
+#include "prefix.h"
+#include "zclient.h"
+#include "memory.h"
+#include "log.h"
+
+struct thread_master *master;
+
+#define ROUTES_PER_RUN 1000
+
+/* Routes are 16.0.0.0/24 upwards, up to 31.255.255.0/24. */
+#define ROUTES_MAX     (1 << 20)
+
+static struct zclient *zclient;
+static int routes = 100000;
+static int changes = 1;
+static int keep;
+static int total;
+static int sent;
+static u_char command;
+static unsigned long messages;
+static double start;
+static struct thread *t_timeout;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Ask for the router-id, zebra answers once it has read the routes. */
+static void
+send_barrier (void)
+{
+  struct stream *s = zclient->obuf;
+
+  stream_reset (s);
+  zclient_create_header (s, ZEBRA_ROUTER_ID_ADD);
+  zclient_send_message (zclient);
+}
+
+static int
+send_routes (struct thread *t)
+{
+  struct zapi_ipv4 api;
+  struct prefix_ipv4 p;
+  int n;
+
+  /* Let zebra catch up with the frames held back. */
+  if (zclient->batch_held->count)
+    {
+      thread_add_background (master, send_routes, NULL, 0);
+      return 0;
+    }
+
+  api.type = ZEBRA_ROUTE_BGP;
+  api.flags = ZEBRA_FLAG_BLACKHOLE;
+  api.message = 0;
+  SET_FLAG (api.message, ZAPI_MESSAGE_NEXTHOP);
+  api.nexthop_num = 0;
+  api.nexthop = NULL;
+  api.ifindex_num = 0;
+  api.ifindex = NULL;
+  SET_FLAG (api.message, ZAPI_MESSAGE_METRIC);
+
+  p.family = AF_INET;
+  p.prefixlen = 24;
+
+  for (n = 0; n < ROUTES_PER_RUN && sent < total; n++, sent++)
+    {
+      p.prefix.s_addr = htonl ((16U << 24)
+			       + ((u_int32_t) (sent % routes) << 8));
+      api.metric = sent / routes;
+      zapi_ipv4_route (command, zclient, &p, &api);
+    }
+
+  if (sent < total)
+    thread_add_background (master, send_routes, NULL, 0);
+  else
+    send_barrier ();
+
+  return 0;
+}
+
+static void
+start_phase (u_char cmd)
+{
+  command = cmd;
+  total = (cmd == ZEBRA_IPV4_ROUTE_ADD ? routes * changes : routes);
+  sent = 0;
+  messages = zclient->batch_frames;
+  start = now ();
+  thread_add_background (master, send_routes, NULL, 0);
+}
+
+static void
+report (const char *what)
+{
+  double took = now () - start;
+
+  printf ("%d routes %s in %.3f s, %.0f routes/s",
+	  total, what, took, total / took);
+  if (zclient->batch_state == ZCLIENT_BATCH_ON)
+    printf (", %lu frames\n", zclient->batch_frames - messages);
+  else
+    printf (", %d messages\n", total);
+}
+
+static int
+router_id_update (int command, struct zclient *zclient, uint16_t length)
+{
+  static int updates;
+
+  switch (updates++)
+    {
+    case 0:
+      /* Connected. */
+      thread_cancel (t_timeout);
+      start_phase (ZEBRA_IPV4_ROUTE_ADD);
+      break;
+    case 1:
+      report ("added");
+      if (keep)
+	exit (0);
+      start_phase (ZEBRA_IPV4_ROUTE_DELETE);
+      break;
+    case 2:
+      report ("deleted");
+      if (zclient->batch_state == ZCLIENT_BATCH_ON)
+	printf ("%lu frames held back by the window of %d, %lu overruns\n",
+		zclient->batch_stalls, ZAPI_IPV4_BATCH_WINDOW,
+		zclient->batch_overruns);
+      else if (zclient->route_batch)
+	printf ("zebra does not take batches, routes sent one by one\n");
+      zclient_stop (zclient);
+      exit (0);
+    }
+  return 0;
+}
+
+static int
+connect_timeout (struct thread *t)
+{
+  fprintf (stderr, "could not get a router-id from zebra\n");
+  exit (1);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct thread thread;
+  int batch = 0;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "bc:kn:z:")) != -1)
+    switch (opt)
+      {
+      case 'b':
+	batch = 1;
+	break;
+      case 'c':
+	changes = atoi (optarg);
+	break;
+      case 'k':
+	keep = 1;
+	break;
+      case 'n':
+	routes = atoi (optarg);
+	break;
+      case 'z':
+	zclient_serv_path_set (optarg);
+	break;
+      default:
+	fprintf (stderr, "usage: %s [-b] [-c changes] [-k] [-n routes] "
+		 "[-z path]\n", argv[0]);
+	exit (1);
+      }
+
+  if (routes <= 0 || routes > ROUTES_MAX)
+    {
+      fprintf (stderr, "routes must be between 1 and %d\n", ROUTES_MAX);
+      exit (1);
+    }
+  if (changes <= 0 || changes > ROUTES_MAX / routes)
+    {
+      fprintf (stderr, "changes must be between 1 and %d\n",
+	       ROUTES_MAX / routes);
+      exit (1);
+    }
+
+  master = thread_master_create ();
+  zlog_default = openzlog ("testzclient", ZLOG_NONE,
+			   LOG_CONS|LOG_NDELAY|LOG_PID, LOG_DAEMON);
+  zlog_set_level (NULL, ZLOG_DEST_STDOUT, LOG_WARNING);
+
+  zclient = zclient_new ();
+  zclient_init (zclient, ZEBRA_ROUTE_BGP);
+  zclient->router_id_update = router_id_update;
+  zclient->route_batch = batch;
+
+  t_timeout = thread_add_timer (master, connect_timeout, NULL, 5);
+
+  while (thread_fetch (master, &thread))
+    thread_call (&thread);
+
+  return 0;
+}
@@ -39,3 +39,4 @@ int kernel_address_delete_ipv4 (struct interface *a, struct connected *b)
 
 void kernel_init (void) { return; }
 #pragma weak route_read = kernel_init
+#pragma weak kernel_flush = kernel_init
@@ -34,6 +34,7 @@
 #include "sigevent.h"
 
 #include "zebra/rib.h"
+#include "zebra/rt.h"
 #include "zebra/zserv.h"
 #include "zebra/debug.h"
 #include "zebra/router-id.h"
@@ -167,6 +168,7 @@ sigint (void)
 
   if (!retain_mode)
     rib_close ();
+  kernel_flush ();
 #ifdef HAVE_IRDP
   irdp_finish();
 #endif
@@ -95,6 +95,32 @@ struct meta_queue
 {
   struct list *subq[MQ_SIZE];
   u_int32_t size; /* sum of lengths of all subqueues */
+  unsigned last;  /* subqueue processed last */
+};
+
+/* FIB update queue.  When a window is set, rib_process does not tell
+ * the kernel about each change as it makes it: the prefixes changed are
+ * held here for the window, and then only the difference between what
+ * the kernel had and what is selected by then goes down.
+ */
+#define FIB_COALESCE_DEFAULT 0    /* msecs */
+#define FIB_COALESCE_MAX     1000
+struct fib_queue
+{
+  struct list *updates;     /* struct fib_update, in order of first change */
+  struct hash *nodes;       /* the same, by route_node */
+  struct thread *t_flush;
+  unsigned long window;     /* msecs, 0 to update the kernel at once */
+
+  /* statistics */
+  unsigned long requested;  /* kernel operations asked for by rib_process */
+  unsigned long issued;     /* and those made */
+  unsigned long prefixes;   /* prefixes flushed */
+  unsigned long unchanged;  /* of which the kernel already had the route */
+  unsigned long requeued;   /* held for another window as still queued */
+  unsigned long runs;
+  unsigned long yields;
+  unsigned long held_max;
 };
 
 /* Static route information. */
@@ -265,6 +291,7 @@ extern void rib_update (void);
 extern void rib_weed_tables (void);
 extern void rib_sweep_route (void);
 extern void rib_close (void);
+extern void rib_fib_coalesce_set (unsigned long);
 extern void rib_init (void);
 
 extern int
@@ -347,6 +347,12 @@ kernel_delete_ipv4 (struct prefix *p, struct rib *rib)
 {
   return kernel_ioctl_ipv4 (SIOCDELRT, p, rib, AF_INET);
 }
+
+/* Route changes go to the kernel at once, nothing is held. */
+void
+kernel_flush (void)
+{
+}
 
 #ifdef HAVE_IPV6
 
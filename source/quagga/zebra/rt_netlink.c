@@ -209,6 +209,8 @@ netlink_socket (struct nlsock *nl, unsigned long groups)
   return ret;
 }
 
+static void netlink_batch_flush (void);
+
 /* Get type specified information from netlink. */
 static int
 netlink_request (int family, int type, struct nlsock *nl)
@@ -231,6 +233,10 @@ netlink_request (int family, int type, struct nlsock *nl)
       return -1;
     }
 
+  /* Route changes still batched go first, see netlink_batch_add. */
+  if (nl == &netlink_cmd)
+    netlink_batch_flush ();
+
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
@@ -1189,6 +1195,9 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl)
   memset (&snl, 0, sizeof snl);
   snl.nl_family = AF_NETLINK;
 
+  if (nl == &netlink_cmd)
+    netlink_batch_flush ();
+
   n->nlmsg_seq = ++nl->seq;
 
   /* Request an acknowledgement by setting NLM_F_ACK */
@@ -1222,6 +1231,276 @@ netlink_talk (struct nlmsghdr *n, struct nlsock *nl)
   return netlink_parse_info (netlink_talk_filter, nl);
 }
 
+/* Route changes are not sent one at a time, each waiting for its
+   acknowledgement: they are packed into a batch which goes down in a
+   single sendmsg() when it is full, when the event loop comes round
+   and before anything else is said on the command socket.  Batched
+   messages ask for no ACK, so the kernel only answers the ones that
+   failed, and those answers are collected without waiting.  Only then
+   is a route marked as in the FIB, on the rib it was sent for.  */
+#define NL_BATCH_SIZE  32768
+#define NL_BATCH_MSGS  512
+
+static struct
+{
+  char buf[NL_BATCH_SIZE];
+  size_t len;
+
+  /* What each message is about, by sequence number from SEQ. */
+  u_int32_t seq;
+  unsigned int count;
+  struct
+  {
+    int cmd;
+    struct prefix p;
+
+    /* For RTM_NEWROUTE, the rib installed and its locked node. */
+    struct route_node *rn;
+    struct rib *rib;
+
+    /* The answer of the kernel, 0 if none. */
+    int error;
+  } msg[NL_BATCH_MSGS];
+
+  struct thread *t_flush;
+} nl_batch;
+
+/* Mark as in the FIB the nexthops of RIB that netlink_route_multipath
+   puts in an RTM_NEWROUTE.  */
+static void
+netlink_route_fib (struct rib *rib)
+{
+  struct nexthop *nexthop;
+  int nexthop_num = 0;
+
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    {
+      if ((rib->flags & ZEBRA_FLAG_BLACKHOLE)
+	  || (rib->flags & ZEBRA_FLAG_REJECT))
+	SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+      else if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE)
+	       && (MULTIPATH_NUM == 0 || nexthop_num < MULTIPATH_NUM))
+	{
+	  SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+	  nexthop_num++;
+	  if (rib->nexthop_active_num == 1 || MULTIPATH_NUM == 1)
+	    break;
+	}
+    }
+}
+
+/* Message MSG of the batch just sent has had its answer. */
+static void
+netlink_batch_result (unsigned int msg)
+{
+  int cmd = nl_batch.msg[msg].cmd;
+  int errnum = nl_batch.msg[msg].error;
+  struct prefix *p = &nl_batch.msg[msg].p;
+  struct route_node *rn = nl_batch.msg[msg].rn;
+  struct rib *rib;
+  struct nexthop *nexthop;
+  char buf[BUFSIZ];
+
+  /* The same races netlink_parse_info lets pass.  */
+  if ((cmd == RTM_DELROUTE && (errnum == ENODEV || errnum == ESRCH))
+      || (cmd == RTM_NEWROUTE && errnum == EEXIST))
+    {
+      if (IS_ZEBRA_DEBUG_KERNEL)
+	zlog_debug ("%s: error: %s type=%s(%u) %s/%d", netlink_cmd.name,
+		    safe_strerror (errnum), lookup (nlmsg_str, cmd), cmd,
+		    inet_ntop (p->family, &p->u.prefix, buf, sizeof buf),
+		    p->prefixlen);
+      errnum = 0;
+    }
+  else if (errnum)
+    zlog_err ("%s error: %s, type=%s(%u) %s/%d", netlink_cmd.name,
+	      safe_strerror (errnum), lookup (nlmsg_str, cmd), cmd,
+	      inet_ntop (p->family, &p->u.prefix, buf, sizeof buf),
+	      p->prefixlen);
+
+  if (! rn)
+    return;
+
+  /* The rib may have gone or been replaced since the message was
+     sent, when whatever replaced it has a change of its own.  */
+  for (rib = rn->info; rib; rib = rib->next)
+    if (rib == nl_batch.msg[msg].rib)
+      break;
+  if (rib && CHECK_FLAG (rib->flags, ZEBRA_FLAG_SELECTED))
+    {
+      if (errnum)
+	for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+	  UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+      else
+	netlink_route_fib (rib);
+    }
+  route_unlock_node (rn);
+}
+
+/* Pick up the answers to the batch just sent.  The kernel has handled
+   it by the time sendmsg() returns, so nothing is waited for.  */
+static void
+netlink_batch_read (void)
+{
+  char buf[4096];
+  struct iovec iov = { buf, sizeof buf };
+  struct sockaddr_nl snl;
+  struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+  struct nlmsghdr *h;
+  unsigned int i;
+  int status;
+
+  while (1)
+    {
+      status = recvmsg (netlink_cmd.sock, &msg, MSG_DONTWAIT);
+      if (status < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno == EWOULDBLOCK || errno == EAGAIN)
+	    return;
+
+	  /* Answers were lost: which routes made it is not known, so
+	     none is taken as installed.  */
+	  zlog (NULL, LOG_ERR, "%s recvmsg overrun: %s",
+		netlink_cmd.name, safe_strerror (errno));
+	  for (i = 0; i < nl_batch.count; i++)
+	    if (! nl_batch.msg[i].error)
+	      nl_batch.msg[i].error = errno;
+	  return;
+	}
+      if (status == 0)
+	return;
+
+      for (h = (struct nlmsghdr *) buf; NLMSG_OK (h, (unsigned int) status);
+	   h = NLMSG_NEXT (h, status))
+	{
+	  struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA (h);
+	  u_int32_t n;
+
+	  if (h->nlmsg_type != NLMSG_ERROR
+	      || h->nlmsg_len < NLMSG_LENGTH (sizeof (struct nlmsgerr)))
+	    {
+	      zlog_warn ("%s: ignoring message type 0x%04x", __func__,
+			 h->nlmsg_type);
+	      continue;
+	    }
+
+	  n = err->msg.nlmsg_seq - nl_batch.seq;
+	  if (n < nl_batch.count)
+	    nl_batch.msg[n].error = -err->error;
+	}
+    }
+}
+
+/* Send the batch down. */
+static void
+netlink_batch_flush (void)
+{
+  struct sockaddr_nl snl;
+  struct iovec iov = { (void *) nl_batch.buf, nl_batch.len };
+  struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+  unsigned int i;
+  int status;
+  int save_errno;
+
+  if (nl_batch.t_flush)
+    {
+      thread_cancel (nl_batch.t_flush);
+      nl_batch.t_flush = NULL;
+    }
+  if (nl_batch.count == 0)
+    return;
+
+  memset (&snl, 0, sizeof snl);
+  snl.nl_family = AF_NETLINK;
+
+  if (IS_ZEBRA_DEBUG_KERNEL)
+    zlog_debug ("%s: %s %u messages, %lu bytes", __func__, netlink_cmd.name,
+		nl_batch.count, (unsigned long) nl_batch.len);
+
+  if (zserv_privs.change (ZPRIVS_RAISE))
+    zlog (NULL, LOG_ERR, "Can't raise privileges");
+  status = sendmsg (netlink_cmd.sock, &msg, 0);
+  save_errno = errno;
+  if (zserv_privs.change (ZPRIVS_LOWER))
+    zlog (NULL, LOG_ERR, "Can't lower privileges");
+
+  if (status < 0)
+    {
+      zlog (NULL, LOG_ERR, "%s: sendmsg() error: %s", __func__,
+	    safe_strerror (save_errno));
+      for (i = 0; i < nl_batch.count; i++)
+	nl_batch.msg[i].error = save_errno;
+    }
+  else
+    netlink_batch_read ();
+
+  for (i = 0; i < nl_batch.count; i++)
+    netlink_batch_result (i);
+
+  nl_batch.len = 0;
+  nl_batch.count = 0;
+}
+
+static int
+netlink_batch_event (struct thread *thread)
+{
+  nl_batch.t_flush = NULL;
+  netlink_batch_flush ();
+  return 0;
+}
+
+/* Add route change N about P, for RIB, to the batch. */
+static int
+netlink_batch_add (struct nlmsghdr *n, struct prefix *p, struct rib *rib)
+{
+  struct route_table *table;
+  unsigned int i;
+
+  if (nl_batch.count == NL_BATCH_MSGS
+      || nl_batch.len + NLMSG_ALIGN (n->nlmsg_len) > NL_BATCH_SIZE)
+    netlink_batch_flush ();
+
+  n->nlmsg_seq = ++netlink_cmd.seq;
+  if (nl_batch.count == 0)
+    nl_batch.seq = n->nlmsg_seq;
+
+  if (IS_ZEBRA_DEBUG_KERNEL)
+    zlog_debug ("%s: %s type %s(%u), seq=%u", __func__, netlink_cmd.name,
+		lookup (nlmsg_str, n->nlmsg_type), n->nlmsg_type,
+		n->nlmsg_seq);
+
+  i = nl_batch.count++;
+  memcpy (nl_batch.buf + nl_batch.len, n, n->nlmsg_len);
+  nl_batch.len += NLMSG_ALIGN (n->nlmsg_len);
+  nl_batch.msg[i].cmd = n->nlmsg_type;
+  prefix_copy (&nl_batch.msg[i].p, p);
+  nl_batch.msg[i].rn = NULL;
+  nl_batch.msg[i].rib = rib;
+  nl_batch.msg[i].error = 0;
+
+  if (n->nlmsg_type == RTM_NEWROUTE)
+    {
+      table = vrf_table (p->family == AF_INET ? AFI_IP : AFI_IP6,
+			 SAFI_UNICAST, 0);
+      if (table)
+	nl_batch.msg[i].rn = route_node_lookup (table, p);
+    }
+
+  if (! nl_batch.t_flush)
+    nl_batch.t_flush = thread_add_event (zebrad.master, netlink_batch_event,
+					 NULL, 0);
+  return 0;
+}
+
+/* Send down the route changes batched so far. */
+void
+kernel_flush (void)
+{
+  netlink_batch_flush ();
+}
+
 /* Routing table change via netlink interface. */
 static int
 netlink_route (int cmd, int family, void *dest, int length, void *gate,
@@ -1302,7 +1581,6 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
                          int family)
 {
   int bytelen;
-  struct sockaddr_nl snl;
   struct nexthop *nexthop = NULL;
   int nexthop_num = 0;
   int discard;
@@ -1353,12 +1631,7 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
   addattr32 (&req.n, sizeof req, RTA_PRIORITY, rib->metric);
 
   if (discard)
-    {
-      if (cmd == RTM_NEWROUTE)
-        for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
-          SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
-      goto skip;
-    }
+    goto skip;
 
   /* Multipath case. */
   if (rib->nexthop_active_num == 1 || MULTIPATH_NUM == 1)
@@ -1509,9 +1782,6 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
 		    }
                 }
 
-              if (cmd == RTM_NEWROUTE)
-                SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
-
               nexthop_num++;
               break;
             }
@@ -1692,9 +1962,6 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
 		    }
                 }
               rtnh = RTNH_NEXT (rtnh);
-
-              if (cmd == RTM_NEWROUTE)
-                SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
             }
         }
       if (src)
@@ -1715,12 +1982,7 @@ netlink_route_multipath (int cmd, struct prefix *p, struct rib *rib,
 
 skip:
 
-  /* Destination netlink address. */
-  memset (&snl, 0, sizeof snl);
-  snl.nl_family = AF_NETLINK;
-
-  /* Talk to netlink socket. */
-  return netlink_talk (&req.n, &netlink_cmd);
+  return netlink_batch_add (&req.n, p, rib);
 }
 
 int
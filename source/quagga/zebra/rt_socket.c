@@ -256,6 +256,12 @@ kernel_delete_ipv4 (struct prefix *p, struct rib *rib)
   return route;
 }
 
+/* Route changes go to the kernel at once, nothing is held. */
+void
+kernel_flush (void)
+{
+}
+
 #ifdef HAVE_IPV6
 
 /* Calculate sin6_len value for netmask socket value. */
@@ -34,6 +34,8 @@
 #include "workqueue.h"
 #include "prefix.h"
 #include "routemap.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "zebra/rib.h"
 #include "zebra/rt.h"
@@ -903,7 +905,7 @@ nexthop_active_update (struct route_node *rn, struct rib *rib, int set)
 
 
 static void
-rib_install_kernel (struct route_node *rn, struct rib *rib)
+rib_fib_install (struct route_node *rn, struct rib *rib)
 {
   int ret = 0;
   struct nexthop *nexthop;
@@ -930,7 +932,7 @@ rib_install_kernel (struct route_node *rn, struct rib *rib)
 
 /* Uninstall the route from kernel. */
 static int
-rib_uninstall_kernel (struct route_node *rn, struct rib *rib)
+rib_fib_uninstall (struct route_node *rn, struct rib *rib)
 {
   int ret = 0;
   struct nexthop *nexthop;
@@ -953,6 +955,397 @@ rib_uninstall_kernel (struct route_node *rn, struct rib *rib)
   return ret;
 }
 
+/* A prefix whose kernel route is out of date, see rib_install_kernel. */
+struct fib_update
+{
+  struct route_node *rn;
+
+  /* Copy of the route the kernel had when the prefix first changed,
+   * NULL if it had none from us.
+   */
+  struct rib *kernel;
+
+  unsigned int changes;
+  unsigned int age;		/* windows held for */
+};
+
+/* A prefix still waiting in the meta queue is held for another window,
+ * but not for more than this many.
+ */
+#define FIB_UPDATE_AGE_MAX 4
+
+/* Look at the clock every so many prefixes when flushing. */
+#define FIB_FLUSH_GRANULARITY 64
+
+static unsigned int
+fib_update_hash_key (void *arg)
+{
+  struct fib_update *fu = arg;
+
+  return jhash_1word ((u_int32_t) (uintptr_t) fu->rn, 0);
+}
+
+static int
+fib_update_hash_cmp (const void *a, const void *b)
+{
+  const struct fib_update *fa = a;
+  const struct fib_update *fb = b;
+
+  return fa->rn == fb->rn;
+}
+
+static void *
+fib_update_hash_alloc (void *arg)
+{
+  struct fib_update *key = arg;
+  struct fib_update *fu;
+
+  fu = XCALLOC (MTYPE_FIB_UPDATE, sizeof (struct fib_update));
+  fu->rn = route_lock_node (key->rn);
+  return fu;
+}
+
+/* Copy of the FIB part of RIB, enough to delete it from the kernel. */
+static struct rib *
+rib_fib_copy (struct rib *rib)
+{
+  struct rib *copy;
+  struct nexthop *nexthop;
+  struct nexthop *new;
+
+  copy = XCALLOC (MTYPE_RIB, sizeof (struct rib));
+  copy->type = rib->type;
+  copy->table = rib->table;
+  copy->metric = rib->metric;
+  copy->distance = rib->distance;
+  copy->flags = rib->flags;
+  copy->nexthop_active_num = rib->nexthop_active_num;
+
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
+      {
+	new = XCALLOC (MTYPE_NEXTHOP, sizeof (struct nexthop));
+	*new = *nexthop;
+	new->next = new->prev = NULL;
+	if (nexthop->ifname)
+	  new->ifname = XSTRDUP (0, nexthop->ifname);
+	nexthop_add (copy, new);
+      }
+
+  return copy;
+}
+
+static void
+rib_fib_copy_free (struct rib *copy)
+{
+  struct nexthop *nexthop;
+  struct nexthop *next;
+
+  for (nexthop = copy->nexthop; nexthop; nexthop = next)
+    {
+      next = nexthop->next;
+      nexthop_free (nexthop);
+    }
+  XFREE (MTYPE_RIB, copy);
+}
+
+static int
+nexthop_fib_same (struct nexthop *a, struct nexthop *b)
+{
+  if (a->type != b->type
+      || a->ifindex != b->ifindex
+      || memcmp (&a->gate, &b->gate, sizeof (a->gate))
+      || memcmp (&a->src, &b->src, sizeof (a->src))
+      || CHECK_FLAG (a->flags, NEXTHOP_FLAG_RECURSIVE)
+         != CHECK_FLAG (b->flags, NEXTHOP_FLAG_RECURSIVE))
+    return 0;
+
+  if (CHECK_FLAG (a->flags, NEXTHOP_FLAG_RECURSIVE)
+      && (a->rtype != b->rtype
+	  || a->rifindex != b->rifindex
+	  || memcmp (&a->rgate, &b->rgate, sizeof (a->rgate))))
+    return 0;
+
+  return 1;
+}
+
+/* Would installing RIB give the kernel the route KERNEL it already has?
+ * If so the FIB nexthops of RIB are set as the kernel has them.
+ */
+static int
+rib_fib_same (struct rib *kernel, struct rib *rib)
+{
+  struct nexthop *k;
+  struct nexthop *nexthop;
+  u_char discard = ZEBRA_FLAG_BLACKHOLE | ZEBRA_FLAG_REJECT;
+
+  if (kernel->table != rib->table
+      || kernel->metric != rib->metric
+      || (kernel->flags & discard) != (rib->flags & discard))
+    return 0;
+
+  if (rib->flags & discard)
+    {
+      for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+	SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+      return 1;
+    }
+
+  /* The kernel copy holds only its FIB nexthops, installing RIB would
+   * send its active ones.
+   */
+  k = kernel->nexthop;
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE))
+      {
+	if (! k || ! nexthop_fib_same (k, nexthop))
+	  return 0;
+	k = k->next;
+      }
+  if (k)
+    return 0;
+
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE))
+      SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+    else
+      UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+  return 1;
+}
+
+/* Bring the kernel route for the prefix of FU up to date: whatever it
+ * had goes, unless it is what the selected route would install anyway.
+ */
+static void
+rib_fib_update (struct fib_queue *fq, struct fib_update *fu)
+{
+  struct route_node *rn = fu->rn;
+  struct rib *rib;
+  struct rib *select = NULL;
+
+  for (rib = rn->info; rib; rib = rib->next)
+    if (CHECK_FLAG (rib->flags, ZEBRA_FLAG_SELECTED)
+	&& ! RIB_SYSTEM_ROUTE (rib))
+      {
+	select = rib;
+	break;
+      }
+
+  if (IS_ZEBRA_DEBUG_RIB)
+    {
+      char buf[INET6_ADDRSTRLEN];
+
+      zlog_debug ("%s: %s/%d: %u changes, kernel %p, select %p", __func__,
+		  inet_ntop (rn->p.family, &rn->p.u.prefix, buf,
+			     INET6_ADDRSTRLEN),
+		  rn->p.prefixlen, fu->changes, fu->kernel, select);
+    }
+
+  fq->prefixes++;
+  if (fu->kernel && select && rib_fib_same (fu->kernel, select))
+    fq->unchanged++;
+  else
+    {
+      if (fu->kernel)
+	{
+	  rib_fib_uninstall (rn, fu->kernel);
+	  fq->issued++;
+	}
+      if (select)
+	{
+	  struct nexthop *nexthop;
+
+	  for (nexthop = select->nexthop; nexthop; nexthop = nexthop->next)
+	    UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+	  rib_fib_install (rn, select);
+	  fq->issued++;
+	}
+    }
+
+  if (fu->kernel)
+    rib_fib_copy_free (fu->kernel);
+  route_unlock_node (rn);
+  XFREE (MTYPE_FIB_UPDATE, fu);
+}
+
+static int rib_fib_flush (struct thread *);
+
+static void
+rib_fib_schedule (struct fib_queue *fq)
+{
+  if (! fq->t_flush && listcount (fq->updates))
+    fq->t_flush = thread_add_timer_msec (zebrad.master, rib_fib_flush, fq,
+					 fq->window);
+}
+
+/* The window is over: update the kernel for the prefixes changed in it.
+ * A prefix queued for rib_process again is about to change once more,
+ * so it is left for the next window, and the flush yields when it has
+ * run for its time slot, letting the rest of zebra in.
+ */
+static int
+rib_fib_flush (struct thread *thread)
+{
+  struct fib_queue *fq = THREAD_ARG (thread);
+  struct listnode *node;
+  struct fib_update *fu;
+  struct rib *head;
+  unsigned int count = listcount (fq->updates);
+  unsigned int done;
+
+  fq->t_flush = NULL;
+  fq->runs++;
+
+  for (done = 0; done < count && (node = listhead (fq->updates)); done++)
+    {
+      if (done && ! (done % FIB_FLUSH_GRANULARITY)
+	  && thread_should_yield (thread))
+	{
+	  fq->yields++;
+	  fq->t_flush = thread_add_background (zebrad.master, rib_fib_flush,
+					       fq, 0);
+	  return 0;
+	}
+
+      fu = listgetdata (node);
+      list_delete_node (fq->updates, node);
+
+      head = fu->rn->info;
+      if (head && head->rn_status && fu->age < FIB_UPDATE_AGE_MAX)
+	{
+	  fu->age++;
+	  fq->requeued++;
+	  listnode_add (fq->updates, fu);
+	  continue;
+	}
+
+      hash_release (fq->nodes, fu);
+      rib_fib_update (fq, fu);
+    }
+
+  rib_fib_schedule (fq);
+  return 0;
+}
+
+/* Update the kernel for every prefix held, at once. */
+static void
+rib_fib_flush_all (struct fib_queue *fq)
+{
+  struct listnode *node;
+  struct fib_update *fu;
+
+  if (fq->t_flush)
+    {
+      thread_cancel (fq->t_flush);
+      fq->t_flush = NULL;
+    }
+
+  while ((node = listhead (fq->updates)))
+    {
+      fu = listgetdata (node);
+      list_delete_node (fq->updates, node);
+      hash_release (fq->nodes, fu);
+      rib_fib_update (fq, fu);
+    }
+}
+
+/* The update held for the prefix of RN, started if there is none. */
+static struct fib_update *
+rib_fib_hold (struct fib_queue *fq, struct route_node *rn)
+{
+  struct fib_update key;
+  struct fib_update *fu;
+
+  key.rn = rn;
+  fu = hash_get (fq->nodes, &key, fib_update_hash_alloc);
+  if (! fu->changes)
+    {
+      listnode_add (fq->updates, fu);
+      if (listcount (fq->updates) > fq->held_max)
+	fq->held_max = listcount (fq->updates);
+      rib_fib_schedule (fq);
+    }
+  fu->changes++;
+  fq->requested++;
+  return fu;
+}
+
+/* Install RIB, or with a coalescing window, just mark it installed: the
+ * kernel is told once the window is over.  Its FIB nexthops are set as
+ * kernel_add would, as recursive nexthops resolve only through those.
+ */
+static void
+rib_install_kernel (struct route_node *rn, struct rib *rib)
+{
+  struct fib_queue *fq = zebrad.fq;
+  struct nexthop *nexthop;
+
+  if (! fq->window)
+    {
+      fq->requested++;
+      fq->issued++;
+      rib_fib_install (rn, rib);
+      return;
+    }
+
+  rib_fib_hold (fq, rn);
+
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_ACTIVE)
+	|| (rib->flags & (ZEBRA_FLAG_BLACKHOLE | ZEBRA_FLAG_REJECT)))
+      SET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+}
+
+/* Uninstall the route from kernel, or with a coalescing window, note
+ * what the kernel has for the prefix, if this is its first change.
+ */
+static int
+rib_uninstall_kernel (struct route_node *rn, struct rib *rib)
+{
+  struct fib_queue *fq = zebrad.fq;
+  struct fib_update *fu;
+  struct nexthop *nexthop;
+
+  if (! fq->window)
+    {
+      fq->requested++;
+      fq->issued++;
+      return rib_fib_uninstall (rn, rib);
+    }
+
+  fu = rib_fib_hold (fq, rn);
+  if (fu->changes == 1)
+    for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+      if (CHECK_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB))
+	{
+	  fu->kernel = rib_fib_copy (rib);
+	  break;
+	}
+
+  for (nexthop = rib->nexthop; nexthop; nexthop = nexthop->next)
+    UNSET_FLAG (nexthop->flags, NEXTHOP_FLAG_FIB);
+
+  return 0;
+}
+
+/* Set the coalescing window, 0 to update the kernel at once. */
+void
+rib_fib_coalesce_set (unsigned long window)
+{
+  struct fib_queue *fq = zebrad.fq;
+
+  fq->window = window;
+  if (! window)
+    rib_fib_flush_all (fq);
+  else if (fq->t_flush && fq->t_flush->type == THREAD_TIMER)
+    {
+      /* The batch held so far waits for the new window instead. */
+      thread_cancel (fq->t_flush);
+      fq->t_flush = NULL;
+      rib_fib_schedule (fq);
+    }
+}
+
 /* Uninstall the route from kernel. */
 static void
 rib_uninstall (struct route_node *rn, struct rib *rib)
@@ -1208,11 +1601,21 @@ meta_queue_process (struct work_queue *dummy, void *data)
   unsigned i;
 
   for (i = 0; i < MQ_SIZE; i++)
-    if (process_subq (mq->subq[i], i))
-      {
-	mq->size--;
-	break;
-      }
+    {
+      /* Routes may resolve through those of an earlier subqueue, by
+       * their FIB nexthops only: the kernel must have had those first.
+       */
+      if (i != mq->last && listcount (mq->subq[i]))
+	{
+	  kernel_flush ();
+	  mq->last = i;
+	}
+      if (process_subq (mq->subq[i], i))
+	{
+	  mq->size--;
+	  break;
+	}
+    }
   return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
@@ -1336,6 +1739,11 @@ rib_queue_init (struct zebra_t *zebra)
   
   if (!(zebra->mq = meta_queue_new ()))
     zlog_err ("%s: could not initialise meta queue!", __func__);
+
+  zebra->fq = XCALLOC (MTYPE_FIB_UPDATE, sizeof (struct fib_queue));
+  zebra->fq->updates = list_new ();
+  zebra->fq->nodes = hash_create (fib_update_hash_key, fib_update_hash_cmp);
+  zebra->fq->window = FIB_COALESCE_DEFAULT;
 }
 
 /* RIB updates are processed via a queue of pointers to route_nodes.
@@ -2863,7 +3271,7 @@ rib_sweep_table (struct route_table *table)
 	  if (rib->type == ZEBRA_ROUTE_KERNEL && 
 	      CHECK_FLAG (rib->flags, ZEBRA_FLAG_SELFROUTE))
 	    {
-	      ret = rib_uninstall_kernel (rn, rib);
+	      ret = rib_fib_uninstall (rn, rib);
 	      if (! ret)
                 rib_delnode (rn, rib);
 	    }
@@ -2899,6 +3307,7 @@ rib_close_table (struct route_table *table)
 void
 rib_close (void)
 {
+  rib_fib_coalesce_set (0);
   rib_close_table (vrf_table (AFI_IP, SAFI_UNICAST, 0));
   rib_close_table (vrf_table (AFI_IP6, SAFI_UNICAST, 0));
 }
@@ -30,6 +30,8 @@
 
 #include "zebra/zserv.h"
 
+extern struct zebra_t zebrad;
+
 /* General fucntion for static route. */
 static int
 zebra_static_ipv4 (struct vty *vty, int add_cmd, const char *dest_str,
@@ -475,6 +477,67 @@ DEFUN (no_ip_route_mask_flags_distance2,
   return zebra_static_ipv4 (vty, 0, argv[0], argv[1], NULL, argv[2], argv[3]);
 }
 
+DEFUN (fib_coalesce,
+       fib_coalesce_cmd,
+       "fib coalesce <0-1000>",
+       "Forwarding table updates\n"
+       "Hold kernel route changes, sending only the last per prefix\n"
+       "Time to hold them for in milliseconds, 0 to send at once\n")
+{
+  unsigned long window;
+
+  VTY_GET_INTEGER_RANGE ("window", window, argv[0], 0, FIB_COALESCE_MAX);
+  rib_fib_coalesce_set (window);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_fib_coalesce,
+       no_fib_coalesce_cmd,
+       "no fib coalesce",
+       NO_STR
+       "Forwarding table updates\n"
+       "Hold kernel route changes, sending only the last per prefix\n")
+{
+  rib_fib_coalesce_set (FIB_COALESCE_DEFAULT);
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_fib_coalesce,
+       no_fib_coalesce_val_cmd,
+       "no fib coalesce <0-1000>",
+       NO_STR
+       "Forwarding table updates\n"
+       "Hold kernel route changes, sending only the last per prefix\n"
+       "Time to hold them for in milliseconds, 0 to send at once\n")
+
+DEFUN (show_fib_coalesce,
+       show_fib_coalesce_cmd,
+       "show fib coalesce",
+       SHOW_STR
+       "Forwarding table updates\n"
+       "Kernel route changes held and suppressed\n")
+{
+  struct fib_queue *fq = zebrad.fq;
+
+  if (fq->window)
+    vty_out (vty, "Kernel route changes are held for %lu msecs%s",
+	     fq->window, VTY_NEWLINE);
+  else
+    vty_out (vty, "Kernel route changes are sent at once%s", VTY_NEWLINE);
+  vty_out (vty, "  %u prefixes held now, at most %lu%s",
+	   listcount (fq->updates), fq->held_max, VTY_NEWLINE);
+  vty_out (vty, "  %lu kernel operations asked for, %lu made, "
+	   "%lu suppressed%s", fq->requested, fq->issued,
+	   fq->requested - fq->issued, VTY_NEWLINE);
+  vty_out (vty, "  %lu prefixes updated, %lu of them already in the kernel%s",
+	   fq->prefixes, fq->unchanged, VTY_NEWLINE);
+  vty_out (vty, "  %lu held for another window while queued%s",
+	   fq->requeued, VTY_NEWLINE);
+  vty_out (vty, "  %lu flushes, %lu of them yielded%s",
+	   fq->runs, fq->yields, VTY_NEWLINE);
+  return CMD_SUCCESS;
+}
+
 char *proto_rm[AFI_MAX][ZEBRA_ROUTE_MAX+1];	/* "any" == ZEBRA_ROUTE_MAX */
 
 DEFUN (ip_protocol,
@@ -2055,6 +2118,12 @@ zebra_ip_config (struct vty *vty)
 {
   int write = 0;
 
+  if (zebrad.fq->window != FIB_COALESCE_DEFAULT)
+    {
+      vty_out (vty, "fib coalesce %lu%s", zebrad.fq->window, VTY_NEWLINE);
+      write++;
+    }
+
   write += static_config_ipv4 (vty);
 #ifdef HAVE_IPV6
   write += static_config_ipv6 (vty);
@@ -2098,6 +2167,11 @@ zebra_vty_init (void)
   install_element (CONFIG_NODE, &no_ip_protocol_cmd);
   install_element (VIEW_NODE, &show_ip_protocol_cmd);
   install_element (ENABLE_NODE, &show_ip_protocol_cmd);
+  install_element (CONFIG_NODE, &fib_coalesce_cmd);
+  install_element (CONFIG_NODE, &no_fib_coalesce_cmd);
+  install_element (CONFIG_NODE, &no_fib_coalesce_val_cmd);
+  install_element (VIEW_NODE, &show_fib_coalesce_cmd);
+  install_element (ENABLE_NODE, &show_fib_coalesce_cmd);
   install_element (CONFIG_NODE, &ip_route_cmd);
   install_element (CONFIG_NODE, &ip_route_flags_cmd);
   install_element (CONFIG_NODE, &ip_route_flags2_cmd);
@@ -881,6 +881,114 @@ zread_ipv4_delete (struct zserv *client, u_short length)
   return 0;
 }
 
+/* Acknowledge a ZEBRA_IPV4_ROUTE_BATCH frame to the client. */
+static int
+zsend_ipv4_batch_ack (struct zserv *client, u_int32_t seq)
+{
+  struct stream *s;
+
+  s = client->obuf;
+  stream_reset (s);
+
+  zserv_create_header (s, ZEBRA_IPV4_ROUTE_BATCH_ACK);
+  stream_putl (s, seq);
+
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  return zebra_server_send_message (client);
+}
+
+/*
+ * Parse a ZEBRA_IPV4_ROUTE_BATCH sent from client.  The entries are
+ * fixed-size and aligned, they are used straight from the input
+ * buffer rather than through the stream_get*() calls of
+ * zread_ipv4_add()/zread_ipv4_delete(), which they otherwise mirror.
+ */
+static int
+zread_ipv4_batch (struct zserv *client, u_short length)
+{
+  struct stream *s;
+  struct zapi_ipv4_batch_entry *e;
+  struct prefix_ipv4 p;
+  struct rib *rib;
+  struct in_addr nexthop;
+  unsigned int ifindex;
+  u_int32_t seq;
+  u_int16_t count;
+  u_int16_t i;
+
+  s = client->ibuf;
+  seq = stream_getl (s);
+  count = stream_getw (s);
+
+  if (ZAPI_IPV4_BATCH_HEADER_SIZE + count * ZAPI_IPV4_BATCH_ENTRY_SIZE
+      > length)
+    {
+      zlog_warn ("%s: socket %d batch of %u routes overruns %u byte message",
+		 __func__, client->sock, count, length);
+      return -1;
+    }
+
+  memset (&p, 0, sizeof (struct prefix_ipv4));
+  p.family = AF_INET;
+
+  e = (struct zapi_ipv4_batch_entry *) STREAM_PNT (s);
+  for (i = 0; i < count; i++, e++)
+    {
+      p.prefixlen = e->prefixlen;
+      p.prefix = e->prefix;
+      apply_mask_ipv4 (&p);
+
+      if (e->command == ZEBRA_IPV4_ROUTE_ADD)
+	{
+	  rib = XCALLOC (MTYPE_RIB, sizeof (struct rib));
+	  rib->type = e->type;
+	  rib->flags = e->flags;
+	  rib->uptime = time (NULL);
+
+	  if (CHECK_FLAG (e->message, ZAPI_MESSAGE_NEXTHOP))
+	    switch (e->nexthop_type)
+	      {
+	      case ZEBRA_NEXTHOP_IFINDEX:
+		nexthop_ifindex_add (rib, ntohl (e->ifindex));
+		break;
+	      case ZEBRA_NEXTHOP_IPV4:
+		nexthop_ipv4_add (rib, &e->nexthop, NULL);
+		break;
+	      case ZEBRA_NEXTHOP_BLACKHOLE:
+		nexthop_blackhole_add (rib);
+		break;
+	      }
+
+	  if (CHECK_FLAG (e->message, ZAPI_MESSAGE_DISTANCE))
+	    rib->distance = e->distance;
+	  if (CHECK_FLAG (e->message, ZAPI_MESSAGE_METRIC))
+	    rib->metric = ntohl (e->metric);
+
+	  rib->table = zebrad.rtm_table_default;
+	  rib_add_ipv4_multipath (&p, rib);
+	}
+      else if (e->command == ZEBRA_IPV4_ROUTE_DELETE)
+	{
+	  nexthop.s_addr = 0;
+	  ifindex = 0;
+	  if (CHECK_FLAG (e->message, ZAPI_MESSAGE_NEXTHOP))
+	    {
+	      if (e->nexthop_type == ZEBRA_NEXTHOP_IPV4)
+		nexthop = e->nexthop;
+	      else if (e->nexthop_type == ZEBRA_NEXTHOP_IFINDEX)
+		ifindex = ntohl (e->ifindex);
+	    }
+
+	  rib_delete_ipv4 (e->type, e->flags, &p, &nexthop, ifindex,
+			   client->rtm_table);
+	}
+    }
+  stream_forward_getp (s, count * ZAPI_IPV4_BATCH_ENTRY_SIZE);
+
+  return zsend_ipv4_batch_ack (client, seq);
+}
+
 /* Nexthop lookup for IPv4. */
 static int
 zread_ipv4_nexthop_lookup (struct zserv *client, u_short length)
@@ -1252,6 +1360,9 @@ zebra_client_read (struct thread *thread)
     case ZEBRA_IPV4_ROUTE_DELETE:
       zread_ipv4_delete (client, length);
       break;
+    case ZEBRA_IPV4_ROUTE_BATCH:
+      zread_ipv4_batch (client, length);
+      break;
 #ifdef HAVE_IPV6
     case ZEBRA_IPV6_ROUTE_ADD:
       zread_ipv6_add (client, length);
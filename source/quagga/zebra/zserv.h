@@ -81,6 +81,9 @@ struct zebra_t
   /* rib work queue */
   struct work_queue *ribq;
   struct meta_queue *mq;
+
+  /* kernel updates held back by rib_process */
+  struct fib_queue *fq;
 };
 
 /* Count prefix size from mask length */